@@ -9,6 +9,7 @@
 #pragma once
 
 #include <assert.h>
+#include <algorithm>
 #include <math.h>
 #include <sys/mman.h>
 #include <any>
@@ -18,6 +19,7 @@
 #include <vector>
 
 #include "bufferblock/buffer_obj.h"
+#include "compressed_tier.h"
 #include "config.h"
 #include "debug.h"
 #include "extendible_hash.h"
@@ -60,7 +62,8 @@ class BP_async_request_type {
     runtime_phase = Phase::Begin;
   }
   virtual ~BP_async_request_type() {}
-  virtual void PromiseSetValue() = 0;
+  // 请求处理完毕后由server线程调用，调用之后server线程不再访问本请求
+  virtual void SetValue() = 0;
 
  public:
   enum Phase {
@@ -85,28 +88,44 @@ class BP_async_request_type {
   PTE tmp;
 };
 
+/**
+ * 异步请求与其结果共享同一个对象：由调用者线程从ObjectPool中分配，
+ * server线程处理完毕后SetValue()，调用者通过AsyncFuture取得结果后归还给ObjectPool
+ */
 template <typename T>
-class BP_async_request_type_instance : public BP_async_request_type {
+class BP_async_request_type_instance : public BP_async_request_type,
+                                       public AsyncState<T> {
   friend class BufferPool;
 
  public:
   BP_async_request_type_instance(in_req_type _req_type, GBPfile_handle_type _fd,
                                  size_t _file_offset, size_t _block_size)
       : BP_async_request_type(_req_type, _fd, _file_offset, _block_size) {}
-  ~BP_async_request_type_instance() override { PromiseSetValue(); }
+  ~BP_async_request_type_instance() override = default;
 
-  void PromiseSetValue() override { assert(false); };
+  void SetValue() override { assert(false); };
 
- private:
-  std::promise<T> promise;
+  static BP_async_request_type_instance* New(in_req_type _req_type,
+                                             GBPfile_handle_type _fd,
+                                             size_t _file_offset,
+                                             size_t _block_size) {
+    return ObjectPool<BP_async_request_type_instance>::New(
+        _req_type, _fd, _file_offset, _block_size);
+  }
+
+  AsyncFuture<T> GetFuture() {
+    return AsyncFuture<T>(this, [](AsyncState<T>* state) {
+      ObjectPool<BP_async_request_type_instance>::Delete(
+          static_cast<BP_async_request_type_instance*>(state));
+    });
+  }
 };
 
 template <>
-void BP_async_request_type_instance<
-    gbp::pair_min<PTE*, char*>>::PromiseSetValue();
+void BP_async_request_type_instance<gbp::pair_min<PTE*, char*>>::SetValue();
 
 template <>
-void BP_async_request_type_instance<BufferBlock>::PromiseSetValue();
+void BP_async_request_type_instance<BufferBlock>::SetValue();
 
 class BP_sync_request_type {
   friend class BufferPool;
@@ -146,6 +165,15 @@ class BP_sync_request_type {
   pair_min<PTE*, char*> response;
   AsyncMesg* ssd_io_finished;
   bool is_inserted = false;
+
+  // IO_LOCAL_RING_ENABLE时Loading阶段的完成消息，随请求复用，不需要每次缺页都new一个；
+  // 请求被复制时不复制完成状态
+  struct InlineMesg : public AsyncMesg1 {
+    InlineMesg() = default;
+    InlineMesg(const InlineMesg&) : AsyncMesg1() {}
+    InlineMesg& operator=(const InlineMesg&) { return *this; }
+  };
+  InlineMesg ssd_io_finished_inline;
 };
 
 struct flush_request_type {
@@ -154,6 +182,7 @@ struct flush_request_type {
 
 class BufferPool {
   friend class BufferPoolManager;
+  friend class EvictionServer;
 
  public:
   BufferPool() = default;
@@ -181,6 +210,23 @@ class BufferPool {
     return disk_manager_->GetFileDescriptor(fd);
   }
 
+  // 所有IOServer，条带化的文件按设备选择IOServer，同一设备的请求由同一个IOServer调度
+  void SetIOServers(const std::vector<IOServer*>& io_servers) {
+    io_servers_ = io_servers;
+  }
+
+  void SetCompressedTier(CompressedTier* compressed_tier) {
+    compressed_tier_ = compressed_tier;
+  }
+
+  FORCE_INLINE IOServer* GetIOServer(GBPfile_handle_type fd,
+                                     size_t offset) const {
+    if (likely(io_servers_.empty() || disk_manager_->GetStripeNum(fd) == 1))
+      return io_server_;
+    return io_servers_[disk_manager_->GetDeviceId(fd, offset) %
+                       io_servers_.size()];
+  }
+
   int GetObject(char* buf, size_t file_offset, size_t block_size,
                 GBPfile_handle_type fd = 0);
   int SetObject(const char* buf, size_t file_offset, size_t block_size,
@@ -204,12 +250,11 @@ class BufferPool {
   void WarmUp() {
     size_t free_page_num = GetFreePageNum();
     size_t count = 0;
-    for (int fd_gbp = 0; fd_gbp < disk_manager_->file_size_inBytes_.size();
-         fd_gbp++) {
-      if (!disk_manager_->fd_oss_[fd_gbp].second)
+    for (int fd_gbp = 0; fd_gbp < disk_manager_->GetFileNum(); fd_gbp++) {
+      if (!disk_manager_->ValidFD(fd_gbp))
         continue;
       size_t page_f_num =
-          ceil(disk_manager_->file_size_inBytes_[fd_gbp], PAGE_SIZE_FILE);
+          ceil(disk_manager_->GetFileSizeFast(fd_gbp), PAGE_SIZE_FILE);
       for (size_t page_idx_f = 0; page_idx_f < page_f_num; page_idx_f++) {
         if (partitioner_->GetPartitionId(page_idx_f) != pool_ID_)
           continue;
@@ -233,6 +278,30 @@ class BufferPool {
     return;
   }
 
+  // 按热度从高到低返回本pool中的常驻页，replacer不支持时按mpage_id的顺序
+  void GetResidentPages(
+      std::vector<std::pair<GBPfile_handle_type, fpage_id_type>>& pages)
+      const {
+    std::vector<mpage_id_type> mpage_ids;
+    if (!replacer_->GetHotnessOrder(mpage_ids)) {
+      mpage_ids.clear();
+      for (mpage_id_type mpage_id = 0; mpage_id < pool_size_; mpage_id++)
+        mpage_ids.push_back(mpage_id);
+    }
+    for (auto mpage_id : mpage_ids) {
+      auto pte = page_table_->FromPageId(mpage_id)->ToUnpacked();
+      // 被淘汰的页不会清空PTE，需要通过page table确认映射仍然存在
+      if (!disk_manager_->ValidFD(pte.fd_cur) ||
+          pte.fpage_id_cur >=
+              ceil(disk_manager_->GetFileSizeFast(pte.fd_cur), PAGE_SIZE_FILE))
+        continue;
+      auto [success, mpage_id_cur] =
+          page_table_->FindMapping(pte.fd_cur, pte.fpage_id_cur);
+      if (success && mpage_id_cur == mpage_id)
+        pages.emplace_back(pte.fd_cur, pte.fpage_id_cur);
+    }
+  }
+
   void RegisterFile(GBPfile_handle_type fd);
   void CloseFile(GBPfile_handle_type fd);
 
@@ -240,6 +309,9 @@ class BufferPool {
                                       GBPfile_handle_type fd);
   bool FetchPageSync1(BP_sync_request_type& req);
   bool FetchPageSync2(BP_sync_request_type& req);
+  // 与FetchPageSync2相同，但读请求直接提交到调用者的io_uring上，且不阻塞等待
+  // req.ssd_io_finished由调用者提供
+  bool FetchPageCoro(BP_sync_request_type& req, IOBackend& io_backend);
   FORCE_INLINE pair_min<PTE*, char*> Pin(fpage_id_type fpage_id,
                                          GBPfile_handle_type fd) {
     // 1.1
@@ -269,28 +341,24 @@ class BufferPool {
             replacer_->GetMemoryUsage(), free_list_->GetMemoryUsage()};
   }
 
-  std::future<pair_min<PTE*, char*>> FetchPageAsync(GBPfile_handle_type fd,
+  AsyncFuture<pair_min<PTE*, char*>> FetchPageAsync(GBPfile_handle_type fd,
                                                     size_t file_offset,
                                                     size_t block_size) {
-    auto req = new BP_async_request_type_instance<pair_min<PTE*, char*>>(
+    auto req = BP_async_request_type_instance<pair_min<PTE*, char*>>::New(
         BP_async_request_type::in_req_type::miss, fd, file_offset, block_size);
-    auto ret =
-        req->promise
-            .get_future();  // 存在push完后req就被立刻释放的可能，所以需要在此处就获得future
+    auto ret = req->GetFuture();
 
     while (!request_channel_.push(req))
       ;
     return ret;
   }
 
-  std::future<BufferBlock> FetchBlockAsync(GBPfile_handle_type fd,
+  AsyncFuture<BufferBlock> FetchBlockAsync(GBPfile_handle_type fd,
                                            size_t file_offset,
                                            size_t block_size) {
-    auto req = new BP_async_request_type_instance<BufferBlock>(
+    auto req = BP_async_request_type_instance<BufferBlock>::New(
         BP_async_request_type::in_req_type::miss, fd, file_offset, block_size);
-    auto ret =
-        req->promise
-            .get_future();  // 存在push完后req就被立刻释放的可能，所以需要在此处就获得future
+    auto ret = req->GetFuture();
 
     while (!request_channel_.push(req))
       ;
@@ -300,9 +368,46 @@ class BufferPool {
  private:
   bool ReadWriteSync(size_t offset, size_t file_size, char* buf,
                      size_t buf_size, GBPfile_handle_type fd, bool is_read);
+  // finish为空时分配一个新的AsyncMesg（由调用者delete），否则使用调用者提供的finish
   AsyncMesg* ReadWriteAsync(size_t offset, size_t file_size, char* buf,
                             size_t buf_size, GBPfile_handle_type fd,
-                            bool is_read);
+                            bool is_read, AsyncMesg* finish = nullptr);
+  // 写回脏页：经过IOServer时以WriteBack优先级与前台读共享队列，完成时Post finish；
+  // 压缩的文件或者没有IOServer时同步写回
+  void WriteBackAsync(PTE* pte, char* buf, AsyncMesg* finish);
+  FORCE_INLINE void WriteBack(PTE* pte, char* buf) {
+    AsyncMesg1 finish;
+    WriteBackAsync(pte, buf, &finish);
+    while (!finish.TryWait())
+      std::this_thread::yield();
+  }
+
+  // 页被映射到UffdRegion时，在写回/淘汰之前解除映射；映射期间的写入无法感知，视为dirty
+  FORCE_INLINE void UnmapPage(PTE* pte) {
+    if (disk_manager_->UnmapPage(pte->fd_cur, pte->fpage_id_cur))
+      pte->dirty = true;
+  }
+
+  // 被淘汰的页（已经与磁盘一致）复制到压缩层，压缩由压缩层的后台线程完成
+  FORCE_INLINE void DemotePage(GBPfile_handle_type fd, fpage_id_type fpage_id,
+                               const char* data) {
+    if (compressed_tier_ != nullptr)
+      compressed_tier_->Insert(fd, fpage_id, data);
+  }
+  // 页写回之后压缩层中的副本已经过时
+  FORCE_INLINE void EraseFromTier(GBPfile_handle_type fd, size_t offset,
+                                  size_t size = PAGE_SIZE_FILE) {
+    if (compressed_tier_ == nullptr)
+      return;
+    for (size_t idx = 0; idx < ceil(size, PAGE_SIZE_FILE); idx++)
+      compressed_tier_->Erase(fd, (offset >> LOG_PAGE_SIZE_FILE) + idx);
+  }
+  // 只有单页的读经过压缩层，见CompressedTier::LoadRange
+  FORCE_INLINE bool LoadFromTier(GBPfile_handle_type fd, size_t offset,
+                                 char* buf, size_t buf_size) {
+    return compressed_tier_ != nullptr &&
+           compressed_tier_->LoadRange(fd, offset, buf, buf_size);
+  }
   bool FetchPageAsyncInner(BP_async_request_type& req);
 
   FORCE_INLINE bool ProcessFunc(BP_async_request_type& req) {
@@ -339,7 +444,7 @@ class BufferPool {
         }
 
         if (ProcessFunc(*req)) {
-          delete req;
+          req->SetValue();  // 之后req由调用者归还给ObjectPool
           if (request_channel_.pop(async_request)) {
             req = async_request;
             ProcessFunc(*req);
@@ -400,6 +505,8 @@ class BufferPool {
   MemoryPool memory_pool_;
   PageTable* page_table_ = nullptr;  // array of pages
   IOServer* io_server_;
+  std::vector<IOServer*> io_servers_;
+  CompressedTier* compressed_tier_ = nullptr;
   DiskManager* disk_manager_;
   RoundRobinPartitioner* partitioner_;
   EvictionServer* eviction_server_;
@@ -410,10 +517,26 @@ class BufferPool {
   // replacement
   std::mutex latch_;  // to protect shared data structure
 
-  lockfree_queue_type<mpage_id_type>* free_list_;
+  magazine_queue_type<mpage_id_type>* free_list_;
   std::atomic<bool> eviction_marker_ = false;
+  // free list的水位，由EvictionServer维护
+  size_t low_watermark_ = 0;
+  size_t high_watermark_ = 0;
+  bool refilling_ = false;  // 只被EvictionServer线程访问
 
   PTE* GetVictimPage();
+  size_t EvictBatch(size_t page_num);
+
+  // 从free list中获取空闲页，低于low watermark时唤醒负责本pool的eviction worker；
+  // 只有访问了全局队列时才检查水位，magazine命中时不读取被所有refill/flush/淘汰写入的size_
+  FORCE_INLINE bool PollFreePage(mpage_id_type& mpage_id) {
+    bool global_polled;
+    auto ret = free_list_->Poll(mpage_id, global_polled);
+    if (eviction_server_ != nullptr && global_polled &&
+        free_list_->GlobalSize() < low_watermark_)
+      eviction_server_->Notify(pool_ID_);
+    return ret;
+  }
 
   std::thread server_;
   boost::lockfree::queue<BP_async_request_type*,
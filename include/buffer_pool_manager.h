@@ -8,17 +8,21 @@
 
 #pragma once
 #include <assert.h>
+#include <boost/container/small_vector.hpp>
 #include <list>
 #include <mutex>
 #include <vector>
 
 #include <math.h>
 #include <any>
+#include <functional>
+#include <limits>
 #include <thread>
 
 #include "buffer_pool.h"
 #include "bufferblock/buffer_obj.h"
 #include "config.h"
+#include "coroutine.h"
 #include "csv_reader.h"
 #include "data_parse.h"
 #include "debug.h"
@@ -28,6 +32,7 @@
 #include "logger.h"
 #include "rw_lock.h"
 #include "utils.h"
+#include "vm_cache.h"
 
 namespace gbp {
 struct batch_request_type {
@@ -43,7 +48,8 @@ struct batch_request_type {
 
 // FIXME: 未实现读写的并发
 class BufferPoolManager {
-  class async_request_type {
+  // 请求与结果共享同一个对象，由调用者线程从ObjectPool中分配，调用者取得结果后归还
+  class async_request_type : public AsyncState<BufferBlock> {
    public:
     async_request_type(GBPfile_handle_type _fd, size_t _file_offset,
                        size_t _block_size, fpage_id_type _page_num)
@@ -56,7 +62,20 @@ class BufferPoolManager {
           response(_block_size, _page_num),
           run_time_phase(Phase::Begin) {}
 
-    ~async_request_type() { promise.set_value(response); }
+    ~async_request_type() = default;
+
+    // 调用之后处理线程不再访问本请求
+    void SetValue() {
+      value = std::move(response);
+      finish.Post();
+    }
+
+    AsyncFuture<BufferBlock> GetFuture() {
+      return AsyncFuture<BufferBlock>(this, [](AsyncState<BufferBlock>* state) {
+        ObjectPool<async_request_type>::Delete(
+            static_cast<async_request_type*>(state));
+      });
+    }
 
     enum Phase { Begin, Waiting, FinishWaiting, End } run_time_phase;
 
@@ -64,11 +83,10 @@ class BufferPoolManager {
     const size_t file_offset;
     const size_t block_size;
     const fpage_id_type page_num;
-    std::vector<std::future<pair_min<PTE*, char*>>> futures;
+    boost::container::small_vector<AsyncFuture<pair_min<PTE*, char*>>, 4>
+        futures;
     fpage_id_type curr_page_unfinished = 0;  // TODO:可能可以提升性能
     BufferBlock response;
-
-    std::promise<BufferBlock> promise;
   };
 
  public:
@@ -97,10 +115,55 @@ class BufferPoolManager {
   const BufferBlock GetBlockSync1(size_t file_offset, size_t block_size,
                                   GBPfile_handle_type fd = 0) const;
 
-  std::future<BufferBlock> GetBlockAsync(size_t file_offset, size_t block_size,
+  AsyncFuture<BufferBlock> GetBlockAsync(size_t file_offset, size_t block_size,
                                          GBPfile_handle_type fd = 0) const;
   const BufferBlock GetBlockAsync1(size_t file_offset, size_t block_size,
                                    GBPfile_handle_type fd = 0) const;
+
+#if COROUTINE_ENABLE
+  class block_awaiter_type : public CoroAwaiterBase {
+   public:
+    block_awaiter_type(const BufferPoolManager& bpm, size_t file_offset,
+                       size_t block_size, GBPfile_handle_type fd)
+        : bpm_(bpm),
+          file_offset_(file_offset),
+          block_size_(block_size),
+          fd_(fd) {}
+    block_awaiter_type(const block_awaiter_type&) = delete;
+    ~block_awaiter_type() override = default;
+
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> handle) {
+      CoroScheduler::Current()->Park(this, handle);
+    }
+    BufferBlock await_resume() { return std::move(response_); }
+
+    bool Poll() override;
+
+   private:
+    const BufferPoolManager& bpm_;
+    const size_t file_offset_;
+    const size_t block_size_;
+    const GBPfile_handle_type fd_;
+
+    BufferBlock response_;
+    BP_sync_request_type requests_[COROUTINE_MAX_PAGE_NUM];
+    AsyncMesg1 io_finished_[COROUTINE_MAX_PAGE_NUM];
+    uint32_t num_request_ = 0;
+    uint32_t num_finished_ = 0;
+  };
+
+  /**
+   * 协程版本的GetBlock，需在CoroScheduler::Run()所驱动的协程中使用：
+   *   BufferBlock block = co_await bpm.GetBlockCoro(file_offset, block_size,
+   * fd);
+   * 缺页时在当前线程的io_uring上提交读请求并挂起协程，不会阻塞worker线程
+   */
+  block_awaiter_type GetBlockCoro(size_t file_offset, size_t block_size,
+                                  GBPfile_handle_type fd = 0) const {
+    return block_awaiter_type(*this, file_offset, block_size, fd);
+  }
+#endif
   FORCE_INLINE const void GetBlockBatch(
       const std::vector<batch_request_type>& requests,
       std::vector<BufferBlock>& results) const {
@@ -126,7 +189,56 @@ class BufferPoolManager {
   int SetBlock(const BufferBlock& buf, size_t file_offset, size_t block_size,
                GBPfile_handle_type fd = 0, bool flush = false);
 
+  // VM_CACHE_ENABLE时可用：返回的Guard持有[file_offset, file_offset + block_size)所在的页，
+  // 数据在虚拟地址上连续，可以直接通过指针访问
+  VMCache::Guard GetBlockVM(size_t file_offset, size_t block_size,
+                            GBPfile_handle_type fd = 0) const {
+#if ASSERT_ENABLE
+    assert(vm_cache_ != nullptr);
+#endif
+    return vm_cache_->Fix(file_offset, block_size, fd);
+  }
+  VMCache* GetVMCache() const { return vm_cache_; }
+
+  // 返回被钉住的帧，调用者负责DecRefCount（供UffdRegion把帧映射到其它地址）
+  pair_min<PTE*, char*> FetchPageSync(fpage_id_type fpage_id,
+                                      GBPfile_handle_type fd) const {
+    return pools_[partitioner_->GetPartitionId(fpage_id)]->FetchPageSync(
+        fpage_id, fd);
+  }
+  // UFFD_REGION_ENABLE时有效：帧所在的memfd及其在memfd中的偏移
+  std::pair<int, size_t> GetFrameFile(const char* frame) const {
+    return {memory_pool_global_->GetMemfd(),
+            frame - memory_pool_global_->GetPool()};
+  }
+  void SetPageMapper(GBPfile_handle_type fd, PageMapper* mapper) {
+    disk_manager_->SetPageMapper(fd, mapper);
+  }
+  CompressedTier* GetCompressedTier() const { return compressed_tier_; }
+  // EVICTION_BATCH_ENABLE为false或者VM模式下为nullptr
+  EvictionServer* GetEvictionServer() const { return eviction_server_; }
+  // 供每个worker线程创建自己的CoroScheduler（其io_uring按DiskManager翻译fd）
+  DiskManager* GetDiskManager() const { return disk_manager_; }
+
   int Resize(GBPfile_handle_type fd, size_t new_size_inByte) {
+    // 缩小时丢弃新文件末尾之后的页，避免之后重新扩大时读到旧数据
+    auto fpage_num_old =
+        ceil(disk_manager_->GetFileSizeFast(fd), PAGE_SIZE_FILE);
+    auto fpage_num_new = ceil(new_size_inByte, PAGE_SIZE_FILE);
+    // VM模式下文件只能在预留的地址范围内扩大
+    if constexpr (VM_CACHE_ENABLE) {
+      if (!vm_cache_->EnableFile(fd, new_size_inByte)) {
+        GBPLOG << "failed to resize fd = " << fd << " to " << new_size_inByte
+               << "B in VMCache";
+        exit(-1);
+      }
+    }
+    if (fpage_num_new < fpage_num_old) {
+      if constexpr (VM_CACHE_ENABLE)
+        vm_cache_->Truncate(fd, fpage_num_new, fpage_num_old);
+      if (compressed_tier_ != nullptr)
+        compressed_tier_->EraseFile(fd, fpage_num_new);
+    }
     disk_manager_->Resize(fd, new_size_inByte);
     for (auto pool : pools_) {
       pool->Resize(fd, ceil(new_size_inByte, pool_num_));
@@ -135,11 +247,34 @@ class BufferPoolManager {
   }
 
   size_t GetFreePageNum() {
+    if constexpr (VM_CACHE_ENABLE)
+      return vm_cache_->GetCapacity() - vm_cache_->GetResidentPageNum();
     size_t free_page_num = 0;
     for (auto pool : pools_)
       free_page_num += pool->GetFreePageNum();
     return free_page_num;
   }
+  // 页当前是否在buffer pool中，不pin该页也不改变它的热度
+  bool IsPageResident(fpage_id_type fpage_id,
+                      GBPfile_handle_type fd = 0) const {
+    return pools_[partitioner_->GetPartitionId(fpage_id)]
+        ->page_table_->FindMapping(fd, fpage_id)
+        .first;
+  }
+  // 所有pool全局队列中的空闲页数，不包括各线程magazine中的空闲页
+  size_t GetSharedFreePageNum() {
+    size_t free_page_num = 0;
+    for (auto pool : pools_)
+      free_page_num += pool->free_list_->GlobalSize();
+    return free_page_num;
+  }
+  // 单个pool全局队列中的空闲页数及其<low watermark, high watermark>
+  size_t GetSharedFreePageNum(uint16_t pool_id) const {
+    return pools_[pool_id]->free_list_->GlobalSize();
+  }
+  std::pair<size_t, size_t> GetWatermark(uint16_t pool_id) const {
+    return {pools_[pool_id]->low_watermark_, pools_[pool_id]->high_watermark_};
+  }
   void CheckValid() {
     for (auto pool : pools_) {
       for (size_t page_id = 0; page_id < pool->memory_pool_.GetSize();
@@ -150,7 +285,7 @@ class BufferPoolManager {
   void WarmUp() {
     std::vector<std::thread> thread_pool;
 
-    for (int fd = 0; fd < disk_manager_->fd_oss_.size(); fd++) {
+    for (int fd = 0; fd < disk_manager_->GetFileNum(); fd++) {
       if (disk_manager_->ValidFD(fd)) {
         // ret = FlushFile(fd);
         thread_pool.emplace_back([&, fd]() { LoadFile(fd); });
@@ -162,28 +297,63 @@ class BufferPoolManager {
     }
   }
 
-  GBPfile_handle_type OpenFile(const std::string& file_name, int o_flag) {
+  // 把之后打开的文件条带化到stripe_dirs下（见DiskManager::SetStripeDirs），
+  // 每个目录对应一个设备，IOServer数不小于目录数时每个设备由独立的IOServer调度
+  void SetStripeDirs(const std::vector<std::string>& stripe_dirs) {
+    disk_manager_->SetStripeDirs(stripe_dirs);
+  }
+
+  // compressed为true时文件以压缩格式存储（见CompressedFile）
+  GBPfile_handle_type OpenFile(const std::string& file_name, int o_flag,
+                               bool compressed = false) {
     static std::mutex mtx;
     std::lock_guard<std::mutex> lock(mtx);
-    auto fd = disk_manager_->OpenFile(file_name, o_flag);
+    auto fd = disk_manager_->OpenFile(file_name, o_flag, compressed);
     RegisterFile(fd);
     return fd;
   }
 
+  // 删除文件以及条带化的backing file（见DiskManager::RemoveFile），文件需要先关闭
+  static bool RemoveFile(const std::string& file_name) {
+    return DiskManager::RemoveFile(file_name);
+  }
+
   void CloseFile(GBPfile_handle_type fd) {
-    assert(FlushFile(fd));
+    // VM模式下同时淘汰该文件的页，fd被复用时不会读到旧文件的数据
+    bool ret = FlushFile(fd, VM_CACHE_ENABLE);
+    if (unlikely(!ret))
+      GBPLOG << "flush error when closing fd = " << fd;
+    assert(ret);
     disk_manager_->CloseFile(fd);
     for (auto pool : pools_) {
       pool->CloseFile(fd);
     }
+    if (compressed_tier_ != nullptr)
+      compressed_tier_->EraseFile(fd);
   }
 
   bool FlushPage(fpage_id_type fpage_id, GBPfile_handle_type fd = 0,
                  bool delete_from_memory = false);
   bool FlushFile(GBPfile_handle_type fd = 0, bool delete_from_memory = false);
+  // 按顺序分批装入文件的所有页，以IOPriority::Bulk排队
   bool LoadFile(GBPfile_handle_type fd = 0);
   bool Flush(bool delete_from_memory = false);
 
+  /**
+   * warm restart
+   * 1. DumpResidentSet把所有pool的常驻页按热度（replacer中的相对位置）合并排序后写入path
+   * 2. LoadResidentSet需要在相关文件都打开之后调用（文件按路径匹配），
+   * 每个pool一个线程按热度顺序分批异步装入，最多装入page_budget页
+   * （每个pool不超过pool的大小减去EvictionServer维持的high watermark），
+   * 不会因为装入较冷的页而淘汰已装入的较热的页；可以在服务请求的同时在后台执行
+   * 3. EnableResidentSetSnapshot启动后台线程定期写快照，析构时再写一次
+   */
+  bool DumpResidentSet(const std::string& path) const;
+  size_t LoadResidentSet(
+      const std::string& path,
+      size_t page_budget = std::numeric_limits<size_t>::max());
+  void EnableResidentSetSnapshot(const std::string& path);
+
   bool ReadWrite(size_t offset, size_t file_size, char* buf, size_t buf_size,
                  GBPfile_handle_type fd, bool is_read = true) const;
   bool LoadPage(pair_min<PTE*, char*> mpage);
@@ -246,6 +416,16 @@ class BufferPoolManager {
  private:
   void RegisterFile(OSfile_handle_type fd);
 
+  // VM模式（VM_CACHE_ENABLE）下的读写：页来自VMCache，BufferBlock中PTE为空，
+  // 释放时按地址unfix（见BufferBlockImp9::ReleasePage）
+  BufferBlock GetBlockFromVM(size_t file_offset, size_t block_size,
+                             GBPfile_handle_type fd) const;
+  void SetBlockVM(size_t file_offset, size_t block_size,
+                  GBPfile_handle_type fd, bool flush,
+                  const std::function<void(char*)>& write);
+  // 整批请求先全部提交再逐个等待，以IOPriority::Bulk排队，完成后unpin
+  void LoadPageBatch(std::vector<BP_sync_request_type>& requests) const;
+
   FORCE_INLINE bool ProcessFunc(async_request_type& req) const {
     while (true) {
       switch (req.run_time_phase) {
@@ -279,8 +459,7 @@ class BufferPoolManager {
         for (; req.curr_page_unfinished < req.page_num;
              req.curr_page_unfinished++) {
           if (req.futures[req.curr_page_unfinished].valid() &&
-              req.futures[req.curr_page_unfinished].wait_for(
-                  std::chrono::milliseconds(0)) != std::future_status::ready) {
+              !req.futures[req.curr_page_unfinished].is_ready()) {
             return false;
           }
         }
@@ -329,7 +508,7 @@ class BufferPoolManager {
         }
 
         if (ProcessFunc(*req)) {
-          delete req;
+          req->SetValue();  // 之后req由调用者归还给ObjectPool
           if (!request_channel_.empty()) {
             request_channel_.pop(async_request);
             req = async_request;
@@ -354,8 +533,14 @@ class BufferPoolManager {
   RoundRobinPartitioner* partitioner_;
   std::vector<IOServer*> io_servers_;
 
-  EvictionServer* eviction_server_;
+  EvictionServer* eviction_server_ = nullptr;
   std::vector<BufferPool*> pools_;
+  VMCache* vm_cache_ = nullptr;
+  CompressedTier* compressed_tier_ = nullptr;
+
+  std::string snapshot_path_;
+  std::thread snapshot_server_;
+  std::atomic<bool> snapshot_stop_ = false;
 
   std::thread server_;
   mutable boost::lockfree::queue<
@@ -17,9 +17,76 @@
 #include "../logger.h"
 #include "../page_table.h"
 #include "../utils.h"
+#include "../vm_cache.h"
 
 namespace gbp {
 
+/**
+ * 多页BufferBlock页表的per-thread slab
+ * 1. 页表按SoA存放在一段连续内存中：datas[page_num] | ptes[page_num] | marks[page_num]
+ * 2. 按容量分级缓存，超过最大级别时退化为LBMalloc
+ * 3. 页表可以在其它线程被释放，此时内存归还到该线程的freelist（与ObjectPool一致）
+ */
+class PageArraySlab {
+ public:
+  FORCE_INLINE static size_t ByteSize(size_t page_num) {
+    return page_num * (sizeof(char*) + sizeof(PTE*) + sizeof(bool));
+  }
+
+  static void* Allocate(size_t page_num) {
+    auto class_id = GetClassId(page_num);
+    if (unlikely(class_id >= BUFFER_BLOCK_SLAB_CLASS_NUM))
+      return LBMalloc(ByteSize(page_num));
+
+    auto& free_list = GetSlab().free_lists[class_id];
+    if (likely(!free_list.empty())) {
+      auto mem = free_list.back();
+      free_list.pop_back();
+      return mem;
+    }
+    return LBMalloc(ByteSize(GetClassCapacity(class_id)));
+  }
+
+  static void Deallocate(void* mem, size_t page_num) {
+    auto class_id = GetClassId(page_num);
+    if (likely(class_id < BUFFER_BLOCK_SLAB_CLASS_NUM)) {
+      auto& free_list = GetSlab().free_lists[class_id];
+      if (likely(free_list.size() < BUFFER_BLOCK_SLAB_MAX_SIZE)) {
+        free_list.push_back(mem);
+        return;
+      }
+    }
+    LBFree(mem);
+  }
+
+ private:
+  FORCE_INLINE static size_t GetClassCapacity(size_t class_id) {
+    return BUFFER_BLOCK_INLINE_PAGE_NUM << (class_id + 1);
+  }
+
+  FORCE_INLINE static size_t GetClassId(size_t page_num) {
+    size_t class_id = 0;
+    while (class_id < BUFFER_BLOCK_SLAB_CLASS_NUM &&
+           GetClassCapacity(class_id) < page_num)
+      class_id++;
+    return class_id;
+  }
+
+  struct Slab {
+    std::vector<void*> free_lists[BUFFER_BLOCK_SLAB_CLASS_NUM];
+    ~Slab() {
+      for (auto& free_list : free_lists)
+        for (auto mem : free_list)
+          LBFree(mem);
+    }
+  };
+
+  static Slab& GetSlab() {
+    thread_local Slab slab;
+    return slab;
+  }
+};
+
 class BufferBlockImp9 {
  public:
   BufferBlockImp9() : size_(0), page_num_(0) {}
@@ -27,9 +94,14 @@ class BufferBlockImp9 {
   BufferBlockImp9(size_t size, size_t page_num)
       : page_num_(page_num), size_(size) {
     if (page_num > 1) {
-      datas_.datas = (char**) LBMalloc(page_num_ * sizeof(char*));
-      ptes_.ptes = (PTE**) LBMalloc(page_num_ * sizeof(PTE*));
-      marks_.marks = (bool*) LBMalloc(page_num_ * sizeof(bool));
+      if (likely(page_num <= BUFFER_BLOCK_INLINE_PAGE_NUM)) {
+        BindInlinePages();
+      } else {
+        auto mem = (char*) PageArraySlab::Allocate(page_num);
+        datas_.datas = (char**) mem;
+        ptes_.ptes = (PTE**) (mem + page_num * sizeof(char*));
+        marks_.marks = (bool*) (mem + page_num * (sizeof(char*) + sizeof(PTE*)));
+      }
     }
   }
 
@@ -155,7 +227,7 @@ class BufferBlockImp9 {
     assert(datas_.data != nullptr);
     assert(offset < size_);
 #endif
-    size_t ret = (buf_size + offset) > size_ ? size_ : buf_size;
+    size_t ret = (buf_size + offset) > size_ ? size_ - offset : buf_size;
 
     if (page_num_ < 2) {
       memcpy(buf, datas_.data + offset, ret);
@@ -165,7 +237,7 @@ class BufferBlockImp9 {
       for (idx = 0; idx < page_num_; idx++) {
         loc_inpage =
             PAGE_SIZE_MEMORY - (uintptr_t) datas_.datas[idx] % PAGE_SIZE_MEMORY;
-        if (offset_t > loc_inpage) {
+        if (offset_t >= loc_inpage) {
           offset_t -= loc_inpage;
         } else {
           break;
@@ -181,7 +253,7 @@ class BufferBlockImp9 {
         memcpy(buf + size_new, datas_.datas[idx] + offset_t, slice_len);
         size_new += slice_len;
         size_old -= slice_len;
-        offset = 0;
+        offset_t = 0;
         if (size_old == 0)
           break;
       }
@@ -198,6 +270,11 @@ class BufferBlockImp9 {
     dst.marks_ = src.marks_;
     dst.ptes_ = src.ptes_;
     dst.size_ = src.size_;
+    // 内联的页表需要随对象一起拷贝
+    if (dst.IsInlinePages()) {
+      dst.inline_pages_ = src.inline_pages_;
+      dst.BindInlinePages();
+    }
     // if (dst.page_num_ == 1 && dst.ptes_.pte->fd_cur == 26 &&
     //     dst.ptes_.pte->fpage_id_cur == 76)
     //   GBPLOG << (uintptr_t) &src << " " << src.size_ << " " << (uintptr_t)
@@ -221,24 +298,18 @@ class BufferBlockImp9 {
     // 如果ptes不为空，则free
     if (size_ != 0) {
       if (likely(page_num_ == 1)) {
-        if (!marks_.mark)
-          ptes_.pte->DecRefCount();
-        else
-          DirectCache::GetDirectCache().Erase(ptes_.pte->fd_cur,
-                                              ptes_.pte->fpage_id_cur);
+        ReleasePage(datas_.data, ptes_.pte, marks_.mark);
       } else if (page_num_ > 1) {
+        auto page_num = page_num_;
         while (page_num_ != 0) {
           // ptes_.ptes[--page_num_]->DecRefCount();
           --page_num_;
-          if (!marks_.marks[page_num_])
-            ptes_.ptes[page_num_]->DecRefCount();
-          else
-            DirectCache::GetDirectCache().Erase(
-                ptes_.ptes[page_num_]->fd_cur,
-                ptes_.ptes[page_num_]->fpage_id_cur);
+          ReleasePage(datas_.datas[page_num_], ptes_.ptes[page_num_],
+                      marks_.marks[page_num_]);
         }
-        LBFree(ptes_.ptes);
-        LBFree(datas_.datas);
+        // datas/ptes/marks在同一段内存中，以datas为起始地址
+        if (page_num > BUFFER_BLOCK_INLINE_PAGE_NUM)
+          PageArraySlab::Deallocate(datas_.datas, page_num);
       } else {
         LBFree(datas_.data);
       }
@@ -276,7 +347,10 @@ class BufferBlockImp9 {
                                          size_t idx = 0) {
     auto data = obj.DecodeWithPTE<OBJ_Type>(idx);
     cb(*data.first);
-    data.second->SetDirty(true);
+    if constexpr (VM_CACHE_ENABLE)
+      VMCache::GetGlobalInstance()->MarkDirty((char*) data.first);
+    else
+      data.second->SetDirty(true);
   }
 
   template <class OBJ_Type>
@@ -554,7 +628,37 @@ class BufferBlockImp9 {
     bool* marks;
   };
 
+  // 页数不超过BUFFER_BLOCK_INLINE_PAGE_NUM时页表（SoA）直接存放在对象内部
+  struct InlinePages {
+    char* datas[BUFFER_BLOCK_INLINE_PAGE_NUM];
+    PTE* ptes[BUFFER_BLOCK_INLINE_PAGE_NUM];
+    bool marks[BUFFER_BLOCK_INLINE_PAGE_NUM];
+  };
+
+  FORCE_INLINE bool IsInlinePages() const {
+    return page_num_ > 1 && page_num_ <= BUFFER_BLOCK_INLINE_PAGE_NUM;
+  }
+
+  FORCE_INLINE void BindInlinePages() {
+    datas_.datas = inline_pages_.datas;
+    ptes_.ptes = inline_pages_.ptes;
+    marks_.marks = inline_pages_.marks;
+  }
+
+  // VM模式下页来自VMCache（PTE为空），按页内地址unfix
+  FORCE_INLINE static void ReleasePage(char* data, PTE* pte, bool mark) {
+    if constexpr (VM_CACHE_ENABLE) {
+      VMCache::GetGlobalInstance()->UnfixShared(data);
+    } else if (!mark) {
+      pte->DecRefCount();
+    } else {
+      DirectCache::GetDirectCache().Erase(pte->fd_cur, pte->fpage_id_cur);
+    }
+  }
+
   FORCE_INLINE bool InitPage(size_t page_id) const {
+    if constexpr (VM_CACHE_ENABLE)
+      return true;
 #if LAZY_SSD_IO_NEW
     if (likely(page_num_ == 1)) {
 #if ASSERT_ENABLE
@@ -575,9 +679,12 @@ class BufferBlockImp9 {
   AnyValue datas_;
   AnyValue ptes_;
   AnyValue marks_;
+  InlinePages inline_pages_;
 
   size_t size_ = 0;
   size_t page_num_ = 0;
 };
+// 内联页表使BufferBlock从40字节增长到112字节，仍然不超过两个cache line
+static_assert(sizeof(BufferBlockImp9) <= 2 * CACHELINE_SIZE);
 
 }  // namespace gbp
\ No newline at end of file
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "logger.h"
+#include "page_compressor.h"
+#include "utils.h"
+
+namespace gbp {
+
+/**
+ * 压缩存储的文件
+ * 1. 每个页单独压缩（PageCompressor）后写入数据文件（path.cdata）中的一个extent，
+ * extent由连续的COMPRESSION_SLOT_SIZE大小的slot组成，压缩后节省不到一个slot的页按原样存储
+ * 2. 页到extent的索引常驻内存，Flush时写入索引文件（path.cidx，先写临时文件再rename）
+ * 3. 写回总是写入新的extent再更新索引，被替换的extent在下一次Flush之后才会被复用，
+ * 因此崩溃之后磁盘上的索引指向的extent都是完整的
+ * 4. 原路径上的文件只作为稀疏的占位文件，记录逻辑文件大小；文件缩小时（Truncate）新末尾之后的extent被丢弃
+ * 5. 空闲的slot按区间管理，相邻的区间总是合并，分配时选择能放下的最小区间（best fit）
+ * 6. Read/Write由调用线程同步完成；io_uring上的读（见IOURing::Read）通过Locate找到extent，
+ * 读完成时再用Decode解压
+ * 7. 数据文件不使用O_DIRECT：extent按COMPRESSION_SLOT_SIZE对齐，不一定是设备逻辑块大小的整数倍
+ */
+class CompressedFile {
+  struct Extent {
+    uint64_t slot_id : 40;
+    uint64_t slot_num : 8;  // 0表示该页还没有写入过
+    uint64_t size : 15;     // 压缩后的字节数
+    uint64_t raw : 1;       // 按原样存储
+  };
+  static_assert(sizeof(Extent) == sizeof(uint64_t));
+
+ public:
+  CompressedFile(const std::string& file_path, int o_flag)
+      : data_path_(file_path + ".cdata"),
+        index_path_(file_path + ".cidx"),
+        slot_end_(0),
+        dirty_(false) {
+    if (o_flag & O_TRUNC) {
+      ::unlink(data_path_.c_str());
+      ::unlink(index_path_.c_str());
+    }
+    data_fd_ =
+        ::open(data_path_.c_str(), (o_flag & ~O_DIRECT) | O_CREAT, 0777);
+    assert(data_fd_ != -1);
+    read_only_ = (o_flag & O_ACCMODE) == O_RDONLY;
+    LoadIndex();
+  }
+
+  ~CompressedFile() {
+    Flush();
+    ::close(data_fd_);
+  }
+
+  // 页在数据文件中的extent，size为0表示该页还没有写入过（读为0）
+  struct Location {
+    size_t offset;           // extent在数据文件中的偏移
+    size_t size;             // extent的大小（整数个slot）
+    size_t compressed_size;  // 压缩后的字节数
+    bool raw;                // 按原样存储，可以直接读入页中
+  };
+
+  Location Locate(fpage_id_type fpage_id) const {
+    auto extent = GetExtent(fpage_id);
+    return {extent.slot_id * COMPRESSION_SLOT_SIZE,
+            extent.slot_num * COMPRESSION_SLOT_SIZE, extent.size,
+            (bool) extent.raw};
+  }
+
+  // 把从数据文件读入data的extent还原为页
+  static bool Decode(const Location& location, const char* data, char* page) {
+    if (location.raw) {
+      if (data != page)
+        ::memcpy(page, data, PAGE_SIZE_FILE);
+      return true;
+    }
+    return PageCompressor::Decompress(data, location.compressed_size, page,
+                                      PAGE_SIZE_FILE) == PAGE_SIZE_FILE;
+  }
+
+  FORCE_INLINE int GetDataFd() const { return data_fd_; }
+
+  // 读取从offset开始的size字节（页对齐）到buf，未写入过的页读为0
+  bool Read(size_t offset, char* buf, size_t size) {
+#if ASSERT_ENABLE
+    assert(offset % PAGE_SIZE_FILE == 0 && size % PAGE_SIZE_FILE == 0);
+#endif
+    alignas(PAGE_SIZE_MEMORY) thread_local static char
+        compressed[PAGE_SIZE_FILE];
+    for (size_t idx = 0; idx < size / PAGE_SIZE_FILE; idx++) {
+      auto page = buf + idx * PAGE_SIZE_FILE;
+      auto location = Locate(offset / PAGE_SIZE_FILE + idx);
+      if (location.size == 0) {
+        ::memset(page, 0, PAGE_SIZE_FILE);
+        continue;
+      }
+      auto data = location.raw ? page : compressed;
+      auto ret = ::pread(data_fd_, data, location.size, location.offset);
+      if (ret < (ssize_t) location.compressed_size ||
+          !Decode(location, data, page))
+        return false;
+    }
+    return true;
+  }
+
+  bool Write(size_t offset, const char* buf, size_t size) {
+#if ASSERT_ENABLE
+    assert(offset % PAGE_SIZE_FILE == 0 && size % PAGE_SIZE_FILE == 0);
+#endif
+    alignas(PAGE_SIZE_MEMORY) thread_local static char
+        compressed[PAGE_SIZE_FILE];
+    for (size_t idx = 0; idx < size / PAGE_SIZE_FILE; idx++) {
+      auto page = buf + idx * PAGE_SIZE_FILE;
+      Extent extent = {0, 0, 0, 0};
+      extent.size = PageCompressor::Compress(
+          page, PAGE_SIZE_FILE, compressed,
+          PAGE_SIZE_FILE - COMPRESSION_SLOT_SIZE);
+      extent.raw = extent.size == 0;
+      if (extent.raw)
+        extent.size = PAGE_SIZE_FILE;
+      extent.slot_num = ceil(extent.size, COMPRESSION_SLOT_SIZE);
+      extent.slot_id = AllocateSlots(extent.slot_num);
+
+      auto ret = ::pwrite(data_fd_, extent.raw ? page : compressed,
+                          extent.slot_num * COMPRESSION_SLOT_SIZE,
+                          extent.slot_id * COMPRESSION_SLOT_SIZE);
+      if (ret != (ssize_t) (extent.slot_num * COMPRESSION_SLOT_SIZE))
+        return false;
+      SetExtent(offset / PAGE_SIZE_FILE + idx, extent);
+    }
+    return true;
+  }
+
+  // 文件缩小到new_size_inByte：丢弃新末尾之后的页，之后读为0；extent与被替换的一样在下一次Flush之后回收
+  void Truncate(size_t new_size_inByte) {
+    auto fpage_num = ceil(new_size_inByte, PAGE_SIZE_FILE);
+    std::lock_guard lock(latch_);
+    if (fpage_num >= extents_.size())
+      return;
+    for (size_t fpage_id = fpage_num; fpage_id < extents_.size(); fpage_id++)
+      if (extents_[fpage_id].slot_num != 0)
+        pending_free_.push_back(extents_[fpage_id]);
+    extents_.resize(fpage_num);
+    dirty_ = true;
+  }
+
+  // 数据落盘之后持久化索引，并回收之前被替换的extent
+  void Flush() {
+    if (read_only_)
+      return;
+    std::vector<Extent> extents;
+    std::vector<Extent> pending_free;
+    {
+      // 快照中的extent在此之前都已经写入，快照之后被替换的extent留到下一次Flush回收
+      std::lock_guard lock(latch_);
+      if (!dirty_)
+        return;
+      extents = extents_;
+      pending_free.swap(pending_free_);
+      dirty_ = false;
+    }
+    ::fdatasync(data_fd_);
+
+    auto tmp_path = index_path_ + ".tmp";
+    {
+      std::ofstream index_file(tmp_path, std::ios::binary | std::ios::trunc);
+      uint64_t header[2] = {COMPRESSION_INDEX_MAGIC, extents.size()};
+      index_file.write((const char*) header, sizeof(header));
+      index_file.write((const char*) extents.data(),
+                       extents.size() * sizeof(Extent));
+      index_file.flush();
+      if (!index_file) {
+        GBPLOG << "failed to write compression index " << tmp_path;
+        std::lock_guard lock(latch_);
+        pending_free_.insert(pending_free_.end(), pending_free.begin(),
+                             pending_free.end());
+        dirty_ = true;
+        return;
+      }
+    }
+    auto index_fd = ::open(tmp_path.c_str(), O_RDONLY);
+    ::fsync(index_fd);
+    ::close(index_fd);
+    ::rename(tmp_path.c_str(), index_path_.c_str());
+
+    std::lock_guard lock(latch_);
+    for (auto& extent : pending_free)
+      FreeSlots(extent.slot_id, extent.slot_num);
+  }
+
+  // 数据文件实际占用的空间（Byte）
+  size_t GetStorageSize() const {
+    std::shared_lock lock(latch_);
+    return slot_end_ * COMPRESSION_SLOT_SIZE;
+  }
+
+ private:
+  Extent GetExtent(fpage_id_type fpage_id) const {
+    std::shared_lock lock(latch_);
+    return fpage_id < extents_.size() ? extents_[fpage_id]
+                                      : Extent{0, 0, 0, 0};
+  }
+
+  void SetExtent(fpage_id_type fpage_id, Extent extent) {
+    std::lock_guard lock(latch_);
+    if (fpage_id >= extents_.size())
+      extents_.resize(std::max<size_t>(fpage_id + 1, extents_.size() * 2),
+                      Extent{0, 0, 0, 0});
+    if (extents_[fpage_id].slot_num != 0)
+      pending_free_.push_back(extents_[fpage_id]);
+    extents_[fpage_id] = extent;
+    dirty_ = true;
+  }
+
+  size_t AllocateSlots(size_t slot_num) {
+    std::lock_guard lock(latch_);
+    auto iter = free_by_size_.lower_bound({slot_num, 0});
+    if (iter == free_by_size_.end()) {
+      auto slot_id = slot_end_;
+      slot_end_ += slot_num;
+      return slot_id;
+    }
+    auto [free_num, slot_id] = *iter;
+    free_by_size_.erase(iter);
+    free_slots_.erase(slot_id);
+    if (free_num > slot_num) {
+      free_slots_.emplace(slot_id + slot_num, free_num - slot_num);
+      free_by_size_.emplace(free_num - slot_num, slot_id + slot_num);
+    }
+    return slot_id;
+  }
+
+  // 在latch_下调用：与前后相邻的空闲区间合并，位于末尾的区间直接归还给slot_end_
+  void FreeSlots(size_t slot_id, size_t slot_num) {
+    auto next = free_slots_.lower_bound(slot_id);
+    if (next != free_slots_.end() && next->first == slot_id + slot_num) {
+      slot_num += next->second;
+      free_by_size_.erase({next->second, next->first});
+      next = free_slots_.erase(next);
+    }
+    if (next != free_slots_.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == slot_id) {
+        slot_id = prev->first;
+        slot_num += prev->second;
+        free_by_size_.erase({prev->second, prev->first});
+        free_slots_.erase(prev);
+      }
+    }
+    if (slot_id + slot_num == slot_end_) {
+      slot_end_ = slot_id;
+      return;
+    }
+    free_slots_.emplace(slot_id, slot_num);
+    free_by_size_.emplace(slot_num, slot_id);
+  }
+
+  // 读入索引，并把extent之间的空洞放入空闲区间
+  void LoadIndex() {
+    std::ifstream index_file(index_path_, std::ios::binary);
+    if (!index_file)
+      return;
+    uint64_t header[2] = {0, 0};
+    index_file.read((char*) header, sizeof(header));
+    if (!index_file || header[0] != COMPRESSION_INDEX_MAGIC) {
+      GBPLOG << "invalid compression index " << index_path_;
+      return;
+    }
+    extents_.resize(header[1]);
+    index_file.read((char*) extents_.data(), header[1] * sizeof(Extent));
+    assert(index_file);
+
+    std::vector<std::pair<size_t, size_t>> used;
+    for (auto& extent : extents_)
+      if (extent.slot_num != 0)
+        used.emplace_back((size_t) extent.slot_id, (size_t) extent.slot_num);
+    std::sort(used.begin(), used.end());
+    if (!used.empty())
+      slot_end_ = used.back().first + used.back().second;
+    size_t slot_cur = 0;
+    for (auto [slot_id, slot_num] : used) {
+      if (slot_cur < slot_id)
+        FreeSlots(slot_cur, slot_id - slot_cur);
+      slot_cur = slot_id + slot_num;
+    }
+  }
+
+  const std::string data_path_;
+  const std::string index_path_;
+  int data_fd_;
+  bool read_only_;
+
+  mutable std::shared_mutex latch_;  // 保护下面的成员
+  std::vector<Extent> extents_;      // 以fpage_id为下标
+  std::map<size_t, size_t> free_slots_;  // 空闲区间：起始slot -> slot数
+  std::set<std::pair<size_t, size_t>> free_by_size_;  // (slot数, 起始slot)
+  std::vector<Extent> pending_free_;
+  size_t slot_end_;
+  bool dirty_;
+};
+
+}  // namespace gbp
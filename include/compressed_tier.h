@@ -0,0 +1,354 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/lockfree/queue.hpp>
+
+#include "config.h"
+#include "page_compressor.h"
+#include "utils.h"
+
+namespace gbp {
+
+/**
+ * 帧池与SSD之间的压缩层（类似zswap）
+ * 1. buffer pool淘汰页时（脏页已写回，页与磁盘一致）把压缩后的页放入该层，
+ * 压缩率不足COMPRESSED_TIER_MAX_PAGE_SIZE的页直接丢弃
+ * 2. 缺页时先查找该层，命中则解压到帧中并从该层删除（promote），不再发起SSD I/O；
+ * 该层与帧池互斥，页写回或者被Flush从帧池中删除时，buffer pool删除或刷新该层中对应的项
+ * 3. 独立的内存预算，按(fd, fpage_id)分成COMPRESSED_TIER_SHARD_NUM个shard，每个shard一个LRU；
+ * 数据保存在构造时一次性分配的slab中，按COMPRESSED_TIER_SLOT_SIZE的slot分配，
+ * 每一项占用bitmap同一个字中连续的slot，空间不足时从LRU尾部淘汰；链表节点同样复用，放入时不分配内存
+ * 4. 淘汰路径上只复制页（raw项）并放入队列，由后台线程压缩；raw项同样可以命中，
+ * 压缩完成之前已被读取、删除或替换的项丢弃压缩结果；队列满时在当前线程上压缩。
+ * 后台线程没有工作时在条件变量上等待，由放入队列的线程唤醒
+ * 5. 压缩在锁外进行：压缩期间raw项的slot归压缩线程所有，项被删除时也不释放，由压缩线程释放；
+ * 解压与复制在锁内进行，因为项删除之后slot可能立即被复用
+ */
+class CompressedTier {
+  struct Entry {
+    uint64_t key;
+    size_t size;  // raw时为PAGE_SIZE_FILE，否则为压缩后的字节数
+    uint32_t slot_id;
+    bool raw;
+    bool compressing;  // 正在被压缩，slot归压缩线程所有
+  };
+  using list_type = std::list<Entry>;
+
+  struct alignas(CACHELINE_SIZE) Shard {
+    std::mutex latch;
+    list_type lru;         // 头部为最近放入的页
+    list_type free_nodes;  // 被删除的项的链表节点，放入时复用
+    std::unordered_map<uint64_t, list_type::iterator> index;
+    size_t used_inByte = 0;
+    char* slab = nullptr;
+    std::vector<uint64_t> slot_bitmap;  // 置位表示slot已被占用
+    size_t cursor = 0;                  // 下一次分配开始查找的字
+  };
+
+  constexpr static size_t SLOT_NUM_PER_WORD = 64;
+  constexpr static size_t RAW_SLOT_NUM =
+      PAGE_SIZE_FILE / COMPRESSED_TIER_SLOT_SIZE;
+
+ public:
+  explicit CompressedTier(size_t capacity_inByte)
+      : hit_count_(0),
+        miss_count_(0),
+        reject_count_(0),
+        pending_num_(0),
+        idle_(false),
+        stop_(false) {
+    size_t word_num = std::max<size_t>(
+        1, capacity_inByte / COMPRESSED_TIER_SHARD_NUM /
+               (SLOT_NUM_PER_WORD * COMPRESSED_TIER_SLOT_SIZE));
+    size_t shard_size = word_num * SLOT_NUM_PER_WORD * COMPRESSED_TIER_SLOT_SIZE;
+    slab_ = (char*) ::aligned_alloc(PAGE_SIZE_MEMORY,
+                                    shard_size * COMPRESSED_TIER_SHARD_NUM);
+    assert(slab_ != nullptr);
+    for (size_t idx = 0; idx < COMPRESSED_TIER_SHARD_NUM; idx++) {
+      shards_[idx].slab = slab_ + idx * shard_size;
+      shards_[idx].slot_bitmap.assign(word_num, 0);
+    }
+    server_ = std::thread([this]() { Run(); });
+  }
+
+  ~CompressedTier() {
+    {
+      std::lock_guard<std::mutex> lck(idle_latch_);
+      stop_ = true;
+    }
+    idle_cv_.notify_one();
+    if (server_.joinable())
+      server_.join();
+    ::free(slab_);
+  }
+
+  // page必须与磁盘上的内容一致；只复制页，压缩由后台线程完成
+  void Insert(GBPfile_handle_type fd, fpage_id_type fpage_id,
+              const char* page) {
+    auto key = GetKey(fd, fpage_id);
+    {
+      auto& shard = GetShard(key);
+      std::lock_guard<std::mutex> lck(shard.latch);
+      auto iter = shard.index.find(key);
+      if (iter != shard.index.end())
+        Unlink(shard, iter->second);
+      uint32_t slot_id;
+      while (!AllocSlots(shard, RAW_SLOT_NUM, slot_id)) {
+        // 剩余的slot都在压缩中，放弃这一页
+        if (shard.lru.empty())
+          return;
+        Unlink(shard, std::prev(shard.lru.end()));
+      }
+      ::memcpy(GetSlot(shard, slot_id), page, PAGE_SIZE_FILE);
+      if (shard.free_nodes.empty())
+        shard.lru.emplace_front();
+      else
+        shard.lru.splice(shard.lru.begin(), shard.free_nodes,
+                         shard.free_nodes.begin());
+      shard.lru.front() = {key, PAGE_SIZE_FILE, slot_id, true, false};
+      shard.index[key] = shard.lru.begin();
+    }
+    if (!channel_.push(key)) {
+      Compress(key);
+      return;
+    }
+    pending_num_.fetch_add(1);
+    if (idle_.load()) {
+      std::lock_guard<std::mutex> lck(idle_latch_);
+      idle_cv_.notify_one();
+    }
+  }
+
+  // 命中时把页解压到page中并从该层删除
+  bool Load(GBPfile_handle_type fd, fpage_id_type fpage_id, char* page) {
+    auto key = GetKey(fd, fpage_id);
+    auto& shard = GetShard(key);
+    std::lock_guard<std::mutex> lck(shard.latch);
+    auto iter = shard.index.find(key);
+    if (iter == shard.index.end()) {
+      miss_count_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    auto& entry = *iter->second;
+    if (entry.raw) {
+      ::memcpy(page, GetSlot(shard, entry.slot_id), PAGE_SIZE_FILE);
+    } else {
+      auto size = PageCompressor::Decompress(GetSlot(shard, entry.slot_id),
+                                             entry.size, page, PAGE_SIZE_FILE);
+      assert(size == PAGE_SIZE_FILE);
+    }
+    Unlink(shard, iter->second);
+    hit_count_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // I/O路径上的读[offset, offset + buf_size)：该层只保存整页，只有恰好读一个页时才查找该层；
+  // 多页的读返回false，由调用者整体读磁盘（该层中的页与磁盘一致）
+  bool LoadRange(GBPfile_handle_type fd, size_t offset, char* buf,
+                 size_t buf_size) {
+    if (buf_size != PAGE_SIZE_FILE)
+      return false;
+#if ASSERT_ENABLE
+    assert(offset % PAGE_SIZE_FILE == 0);
+#endif
+    return Load(fd, offset >> LOG_PAGE_SIZE_FILE, buf);
+  }
+
+  // 删除一个页（页被写回之后，该层中的副本已经过时）
+  void Erase(GBPfile_handle_type fd, fpage_id_type fpage_id) {
+    auto key = GetKey(fd, fpage_id);
+    auto& shard = GetShard(key);
+    std::lock_guard<std::mutex> lck(shard.latch);
+    auto iter = shard.index.find(key);
+    if (iter != shard.index.end())
+      Unlink(shard, iter->second);
+  }
+
+  // [fpage_id, fpage_id + page_num)中是否有页在该层中
+  bool ContainsAny(GBPfile_handle_type fd, fpage_id_type fpage_id,
+                   size_t page_num = 1) {
+    for (size_t idx = 0; idx < page_num; idx++) {
+      auto key = GetKey(fd, fpage_id + idx);
+      auto& shard = GetShard(key);
+      std::lock_guard<std::mutex> lck(shard.latch);
+      if (shard.index.find(key) != shard.index.end())
+        return true;
+    }
+    return false;
+  }
+
+  // 删除文件中fpage_id不小于fpage_id_begin的所有页（文件关闭或缩小之后）
+  void EraseFile(GBPfile_handle_type fd, fpage_id_type fpage_id_begin = 0) {
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> lck(shard.latch);
+      for (auto iter = shard.lru.begin(); iter != shard.lru.end();) {
+        auto cur = iter++;
+        if ((cur->key >> 32) == (uint64_t) fd &&
+            (uint32_t) cur->key >= fpage_id_begin)
+          Unlink(shard, cur);
+      }
+    }
+  }
+
+  // (占用的内存, 命中次数, 未命中次数, 因压缩率不足被拒绝的次数)
+  std::tuple<size_t, size_t, size_t, size_t> GetStats() {
+    size_t used_inByte = 0;
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> lck(shard.latch);
+      used_inByte += shard.used_inByte;
+    }
+    return {used_inByte, hit_count_.load(), miss_count_.load(),
+            reject_count_.load()};
+  }
+
+ private:
+  FORCE_INLINE static uint64_t GetKey(GBPfile_handle_type fd,
+                                      fpage_id_type fpage_id) {
+    return ((uint64_t) fd << 32) | fpage_id;
+  }
+
+  FORCE_INLINE Shard& GetShard(uint64_t key) {
+    return shards_[((key * 0x9e3779b97f4a7c15) >> 32) %
+                   COMPRESSED_TIER_SHARD_NUM];
+  }
+
+  FORCE_INLINE static char* GetSlot(Shard& shard, uint32_t slot_id) {
+    return shard.slab + (size_t) slot_id * COMPRESSED_TIER_SLOT_SIZE;
+  }
+
+  FORCE_INLINE static uint64_t GetSlotMask(size_t slot_num, size_t bit) {
+    return (slot_num == SLOT_NUM_PER_WORD ? ~0LU : (1LU << slot_num) - 1)
+           << bit;
+  }
+
+  // 调用者持有shard.latch；在bitmap的同一个字中查找slot_num个连续的空闲slot
+  bool AllocSlots(Shard& shard, size_t slot_num, uint32_t& slot_id) {
+    auto word_num = shard.slot_bitmap.size();
+    for (size_t idx = 0; idx < word_num; idx++) {
+      auto word_id = (shard.cursor + idx) % word_num;
+      // 第i位为1表示从第i个slot开始的slot_num个slot都是空闲的
+      auto run = ~shard.slot_bitmap[word_id];
+      for (size_t len = 1; len < slot_num && run != 0; len++)
+        run &= run >> 1;
+      if (run == 0)
+        continue;
+      size_t bit = __builtin_ctzll(run);
+      shard.slot_bitmap[word_id] |= GetSlotMask(slot_num, bit);
+      shard.cursor = word_id;
+      shard.used_inByte += slot_num * COMPRESSED_TIER_SLOT_SIZE;
+      slot_id = word_id * SLOT_NUM_PER_WORD + bit;
+      return true;
+    }
+    return false;
+  }
+
+  // 调用者持有shard.latch
+  void FreeSlots(Shard& shard, uint32_t slot_id, size_t slot_num) {
+    shard.slot_bitmap[slot_id / SLOT_NUM_PER_WORD] &=
+        ~GetSlotMask(slot_num, slot_id % SLOT_NUM_PER_WORD);
+    shard.used_inByte -= slot_num * COMPRESSED_TIER_SLOT_SIZE;
+  }
+
+  FORCE_INLINE static size_t GetSlotNum(size_t size) {
+    return ceil(size, COMPRESSED_TIER_SLOT_SIZE);
+  }
+
+  // 把raw项压缩后替换原项，压缩率不足时删除
+  void Compress(uint64_t key) {
+    thread_local static char compressed[COMPRESSED_TIER_MAX_PAGE_SIZE];
+    auto& shard = GetShard(key);
+    uint32_t raw_slot_id;
+    {
+      std::lock_guard<std::mutex> lck(shard.latch);
+      auto iter = shard.index.find(key);
+      if (iter == shard.index.end() || !iter->second->raw ||
+          iter->second->compressing)
+        return;
+      iter->second->compressing = true;
+      raw_slot_id = iter->second->slot_id;
+    }
+    auto size =
+        PageCompressor::Compress(GetSlot(shard, raw_slot_id), PAGE_SIZE_FILE,
+                                 compressed, COMPRESSED_TIER_MAX_PAGE_SIZE);
+
+    std::lock_guard<std::mutex> lck(shard.latch);
+    auto iter = shard.index.find(key);
+    if (iter == shard.index.end() || iter->second->slot_id != raw_slot_id) {
+      // 压缩期间已被读取、删除或替换
+      FreeSlots(shard, raw_slot_id, RAW_SLOT_NUM);
+      return;
+    }
+    auto& entry = *iter->second;
+    entry.compressing = false;
+    if (size == 0) {
+      reject_count_.fetch_add(1, std::memory_order_relaxed);
+      Unlink(shard, iter->second);
+      return;
+    }
+    // 释放raw项的slot之后，同一个字中至少有RAW_SLOT_NUM个连续的空闲slot，分配不会失败
+    FreeSlots(shard, raw_slot_id, RAW_SLOT_NUM);
+    auto allocated = AllocSlots(shard, GetSlotNum(size), entry.slot_id);
+    assert(allocated);
+    ::memcpy(GetSlot(shard, entry.slot_id), compressed, size);
+    entry.size = size;
+    entry.raw = false;
+  }
+
+  void Run() {
+    uint64_t key;
+    while (true) {
+      if (channel_.pop(key)) {
+        pending_num_.fetch_sub(1);
+        Compress(key);
+        continue;
+      }
+      std::unique_lock<std::mutex> lck(idle_latch_);
+      idle_.store(true);
+      idle_cv_.wait(lck, [this]() { return stop_ || pending_num_.load() > 0; });
+      idle_.store(false);
+      if (stop_)
+        break;
+    }
+  }
+
+  // 调用者持有shard.latch；正在被压缩的项的slot由压缩线程释放
+  void Unlink(Shard& shard, list_type::iterator iter) {
+    if (!iter->compressing)
+      FreeSlots(shard, iter->slot_id,
+                iter->raw ? RAW_SLOT_NUM : GetSlotNum(iter->size));
+    shard.index.erase(iter->key);
+    shard.free_nodes.splice(shard.free_nodes.begin(), shard.lru, iter);
+  }
+
+  Shard shards_[COMPRESSED_TIER_SHARD_NUM];
+  char* slab_;
+
+  std::atomic<size_t> hit_count_;
+  std::atomic<size_t> miss_count_;
+  std::atomic<size_t> reject_count_;
+
+  // 队列中的页数，与idle_一起保证后台线程不会错过唤醒
+  std::atomic<int64_t> pending_num_;
+  std::atomic<bool> idle_;
+  std::mutex idle_latch_;
+  std::condition_variable idle_cv_;
+  bool stop_;
+  std::thread server_;
+  boost::lockfree::queue<uint64_t,
+                         boost::lockfree::capacity<COMPRESSED_TIER_CHANNEL_SIZE>>
+      channel_;
+};
+
+}  // namespace gbp
@@ -67,9 +67,24 @@ constexpr bool WAL_ENABLE = false;
 constexpr bool PERSISTENT = true;
 constexpr bool DEBUG = false;
 
-constexpr bool EVICTION_BATCH_ENABLE = false;
-constexpr size_t EVICTION_BATCH_SIZE = 10;
-constexpr static size_t EVICTION_FIBER_CHANNEL_DEPTH = 10;
+// EvictionServer在后台把每个pool的free list维持在[low, high]水位之间（包括脏页写回）
+constexpr bool EVICTION_BATCH_ENABLE = true;
+constexpr size_t EVICTION_BATCH_SIZE = 10;  // 每轮对单个pool最多淘汰的页数
+constexpr static double EVICTION_LOW_WATERMARK_RATIO = 0.01;
+constexpr static double EVICTION_HIGH_WATERMARK_RATIO = 0.03;
+constexpr static size_t EVICTION_MIN_WATERMARK =
+    EVICTION_BATCH_SIZE;  // 小pool的最低水位
+constexpr static size_t EVICTION_POOL_NUM_PER_WORKER =
+    4;  // 每个eviction worker负责的pool个数
+// 一轮淘汰没有任何进展（所有页都被pin住）时，worker按指数退避休眠，不响应Notify
+constexpr static size_t EVICTION_BACKOFF_MIN_MICROSECOND = 100;
+constexpr static size_t EVICTION_BACKOFF_MAX_MICROSECOND = 10000;
+
+// 每个线程在free list之前维护一个magazine（本地空闲页缓存），只有在magazine为空/满时才访问全局的lock-free队列
+constexpr bool FREE_LIST_MAGAZINE_ENABLE = true;
+constexpr static size_t FREE_LIST_MAGAZINE_SIZE = 32;  // 单个magazine的容量
+constexpr static size_t FREE_LIST_MAGAZINE_NUM =
+    256;  // 同时拥有magazine的最大线程数，超出的线程直接访问全局队列
 
 constexpr uint32_t INVALID_PAGE_ID =
     std::numeric_limits<uint32_t>::max();  // representing an invalid page id
@@ -82,17 +97,52 @@ constexpr static size_t PAGE_SIZE_FILE = PAGE_SIZE_MEMORY;
 constexpr static size_t LOG_PAGE_SIZE_FILE = LOG_PAGE_SIZE_MEMORY;
 constexpr static size_t CACHELINE_SIZE = 64;
 
+// warm restart：定期把常驻页集合（按热度排序）写入快照文件，重启后按热度顺序重新装入
+constexpr static size_t WARM_RESTART_DUMP_INTERVAL_SECOND = 600;
+constexpr static uint64_t WARM_RESTART_SNAPSHOT_MAGIC = 0x314D524157504247;
+// WarmUp、LoadFile、LoadResidentSet每批提交的读请求数，整批提交之后再等待
+constexpr static size_t BULK_LOAD_BATCH_SIZE = 64;
+
 // 该模式类似于TriCache，每一个bufferpool维护一个server用于处理request
 constexpr bool BP_ASYNC_ENABLE = false;
 constexpr int IO_BACKEND_TYPE =
     2;  // 1: pread; 2:
         // IO_Uring（IO_uring模式下每一个IO_server会维护一个thread，用于处理IO请求）
 constexpr static size_t ASYNC_SSDIO_SLEEP_TIME_MICROSECOND = 500;
-constexpr bool IO_SERVER_ENABLE = IO_BACKEND_TYPE == 2 && !BP_ASYNC_ENABLE;
+// 协程接口（GetBlockCoro）单个awaiter内联支持的最大页数，超过时退化为同步读
+constexpr static size_t COROUTINE_MAX_PAGE_NUM = 4;
+// scheduler中所有协程都在等待其它线程的缺页时：先yield若干轮，之后按指数退避休眠，
+// 上限与一次NVMe读的延迟相当，避免一次较慢的跨线程缺页拖慢本线程的所有协程
+constexpr static size_t COROUTINE_IDLE_YIELD_ROUNDS = 64;
+constexpr static size_t COROUTINE_BACKOFF_MIN_MICROSECOND = 5;
+constexpr static size_t COROUTINE_BACKOFF_MAX_MICROSECOND = 80;
+// 每个worker线程拥有一个thread-local的io_uring，自己提交并回收I/O，不经过IOServer线程（类似TriCache/LeanStore）
+constexpr bool IO_LOCAL_RING_ENABLE = false;
+constexpr bool IO_SERVER_ENABLE =
+    IO_BACKEND_TYPE == 2 && !BP_ASYNC_ENABLE && !IO_LOCAL_RING_ENABLE;
 constexpr static size_t IOURing_MAX_DEPTH = 32;
 constexpr static size_t BATCH_SIZE_IO_SERVER =
     IOURing_MAX_DEPTH * 1.5;  // 这个值高点好？？？
 constexpr static size_t IO_SERVER_CHANNEL_SIZE = BATCH_SIZE_IO_SERVER * 1.5;
+// IOServer中的优先级（前台读 > 写回 > 批量装入），每一级独立排队并限制在途请求数，
+// 等待超过deadline的后台请求会被提升，防止饿死
+constexpr static size_t IO_PRIORITY_NUM = 3;
+constexpr static size_t IO_PRIORITY_INFLIGHT_LIMIT[IO_PRIORITY_NUM] = {
+    BATCH_SIZE_IO_SERVER, BATCH_SIZE_IO_SERVER / 4, BATCH_SIZE_IO_SERVER / 4};
+constexpr static size_t IO_PRIORITY_DEADLINE_MICROSECOND[IO_PRIORITY_NUM] = {
+    0, 20000, 100000};
+// 条带化时逻辑文件以chunk为单位轮流分布到各个目录（设备）下的backing file中，chunk需为PAGE_SIZE_FILE的整数倍
+constexpr static size_t DISK_STRIPE_CHUNK_SIZE = PAGE_SIZE_FILE * 16;
+static_assert(DISK_STRIPE_CHUNK_SIZE % PAGE_SIZE_FILE == 0);
+// DiskManager的文件表按段分配，段分配之后不再移动，最多支持SEGMENT_NUM * SEGMENT_SIZE个文件
+constexpr static size_t LOG_DISK_FILE_TABLE_SEGMENT_SIZE = 10;
+constexpr static size_t DISK_FILE_TABLE_SEGMENT_SIZE =
+    1LU << LOG_DISK_FILE_TABLE_SEGMENT_SIZE;
+constexpr static size_t DISK_FILE_TABLE_SEGMENT_NUM = 1024;
+// 压缩存储的文件中extent的分配粒度（数据文件不使用O_DIRECT，不受设备逻辑块大小的限制）
+constexpr static size_t COMPRESSION_SLOT_SIZE = 512;
+static_assert(PAGE_SIZE_FILE % COMPRESSION_SLOT_SIZE == 0);
+constexpr static uint64_t COMPRESSION_INDEX_MAGIC = 0x3158444943504247;
 
 constexpr static size_t BATCH_SIZE_BUFFER_POOL_MANAGER = 20;
 constexpr static size_t BUFFER_POOL_MANAGER_CHANNEL_SIZE =
@@ -101,9 +151,44 @@ constexpr static size_t BUFFER_POOL_MANAGER_CHANNEL_SIZE =
 constexpr static size_t BATCH_SIZE_BUFFER_POOL = IOURing_MAX_DEPTH * 1.5;
 constexpr static size_t BUFFER_POOL_CHANNEL_SIZE = BATCH_SIZE_BUFFER_POOL * 2;
 
-constexpr static size_t BATCH_SIZE_EVICTION_SERVER = 15;
-constexpr static size_t EVICTION_SERVER_CHANNEL_SERVER =
-    BATCH_SIZE_EVICTION_SERVER * 1.2;
+// 每个线程的ObjectPool freelist中最多缓存的对象个数
+constexpr static size_t OBJECT_POOL_MAX_SIZE = 1024;
+
+// 多页BufferBlock的页表（datas/ptes/marks）不超过该页数时内联在BufferBlock中
+constexpr static size_t BUFFER_BLOCK_INLINE_PAGE_NUM = 4;
+// 更大的页表来自per-thread的slab，第i级可容纳(BUFFER_BLOCK_INLINE_PAGE_NUM << (i + 1))页
+constexpr static size_t BUFFER_BLOCK_SLAB_CLASS_NUM = 8;
+constexpr static size_t BUFFER_BLOCK_SLAB_MAX_SIZE =
+    64;  // 每一级freelist中最多缓存的页表个数
+
+// vmcache模式：每个文件预留一段虚拟地址空间，页直接装入其文件偏移对应的地址，命中时不经过page table
+constexpr bool VM_CACHE_ENABLE = false;
+constexpr static size_t VM_CACHE_FILE_RESERVE_SIZE =
+    1lu << 38;  // 单个文件预留的虚拟地址空间（Byte）
+constexpr static size_t VM_CACHE_MAX_FILE_NUM = 256;
+constexpr static size_t VM_CACHE_EVICTION_BATCH_SIZE = 64;
+
+// 帧池与SSD之间的压缩层（类似zswap）：被淘汰的页压缩后保存在DRAM中，命中时解压回帧中
+constexpr bool COMPRESSED_TIER_ENABLE = false;
+constexpr static double COMPRESSED_TIER_CAPACITY_RATIO =
+    0.25;  // 压缩层的内存预算相对于帧池大小的比例
+constexpr static size_t COMPRESSED_TIER_SHARD_NUM = 64;
+constexpr static size_t COMPRESSED_TIER_MAX_PAGE_SIZE =
+    PAGE_SIZE_FILE / 2;  // 压缩后超过该大小的页不放入压缩层
+constexpr static size_t COMPRESSED_TIER_CHANNEL_SIZE =
+    1024;  // 等待后台线程压缩的页数上限
+// 压缩层slab的分配粒度，一个页（raw项）占PAGE_SIZE_FILE / COMPRESSED_TIER_SLOT_SIZE个slot
+constexpr static size_t COMPRESSED_TIER_SLOT_SIZE = 512;
+static_assert(PAGE_SIZE_FILE % COMPRESSED_TIER_SLOT_SIZE == 0 &&
+              PAGE_SIZE_FILE / COMPRESSED_TIER_SLOT_SIZE <= 64);
+
+// userfaultfd模式的mmap_array：缺页时把buffer pool中的帧直接映射到对应地址（见UffdRegion）
+// 开启后帧池来自memfd（MAP_SHARED），以便同一个帧可以被映射到多个地址
+#define UFFD_REGION_ENABLE false
+constexpr static size_t UFFD_REGION_RESERVE_SIZE =
+    1lu << 38;  // 单个映射预留的虚拟地址空间（Byte）
+constexpr static size_t UFFD_REGION_BATCH_SIZE = 64;  // 每次read的最大消息数
+constexpr static int UFFD_REGION_POLL_TIMEOUT_MILLISECOND = 100;
 
 constexpr bool PURE_THREADING = true;
 constexpr static size_t HYBRID_SPIN_THRESHOLD =
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define COROUTINE_ENABLE true
+#include <coroutine>
+#else
+#define COROUTINE_ENABLE false
+#endif
+
+#include "config.h"
+#include "io_backend.h"
+#include "utils.h"
+
+#if COROUTINE_ENABLE
+namespace gbp {
+
+/**
+ * 基于C++20协程的页面获取
+ * 1. 每个worker线程持有一个CoroScheduler，scheduler自己维护一个io_uring
+ * 2. co_await bpm.GetBlockCoro(...)时，命中的页面直接返回；缺页在当前线程的
+ * io_uring上提交读请求，然后挂起协程，scheduler继续执行其它协程
+ * 3. awaiter对象位于协程帧中，挂起队列是侵入式链表，缺页请求本身不需要额外的堆分配
+ */
+class CoroAwaiterBase {
+  friend class CoroScheduler;
+
+ public:
+  CoroAwaiterBase() = default;
+  virtual ~CoroAwaiterBase() = default;
+
+  // 推进本awaiter中的所有请求，全部完成时返回true
+  virtual bool Poll() = 0;
+
+ protected:
+  std::coroutine_handle<> handle_;
+  CoroAwaiterBase* next_ = nullptr;
+};
+
+// fire-and-forget式的协程任务，由CoroScheduler负责resume与销毁
+class CoroTask {
+ public:
+  struct promise_type {
+    CoroTask get_return_object() {
+      return CoroTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { assert(false); }
+  };
+
+  CoroTask() = default;
+  explicit CoroTask(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+  CoroTask(const CoroTask&) = delete;
+  CoroTask(CoroTask&& src) noexcept : handle_(src.handle_) {
+    src.handle_ = nullptr;
+  }
+  CoroTask& operator=(CoroTask&& src) noexcept {
+    std::swap(handle_, src.handle_);
+    return *this;
+  }
+  ~CoroTask() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  std::coroutine_handle<promise_type> Release() {
+    return std::exchange(handle_, nullptr);
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * 每个worker线程一个实例，只能在创建它的线程上Spawn与Run
+ * ring_、ready_与parked_只被该线程访问，因此不需要加锁；不同线程的scheduler之间
+ * 通过buffer pool的page table同步（同一页的并发缺页只有一个会提交I/O）
+ */
+class CoroScheduler {
+ public:
+  explicit CoroScheduler(DiskManager* disk_manager)
+      : ring_(disk_manager),
+        num_task_(0),
+        owner_(std::this_thread::get_id()) {}
+  ~CoroScheduler() = default;
+
+  static CoroScheduler*& Current() {
+    thread_local CoroScheduler* scheduler = nullptr;
+    return scheduler;
+  }
+
+  FORCE_INLINE IOURing& Ring() { return ring_; }
+
+  void Spawn(CoroTask&& task) {
+#if ASSERT_ENABLE
+    assert(std::this_thread::get_id() == owner_);
+#endif
+    auto handle = task.Release();
+    num_task_++;
+    ready_.push_back(handle);
+  }
+
+  // 挂起一个awaiter，直到其Poll()返回true
+  FORCE_INLINE void Park(CoroAwaiterBase* awaiter,
+                         std::coroutine_handle<> handle) {
+    awaiter->handle_ = handle;
+    awaiter->next_ = parked_;
+    parked_ = awaiter;
+  }
+
+  // 运行直至所有被Spawn的任务结束
+  void Run() {
+#if ASSERT_ENABLE
+    assert(std::this_thread::get_id() == owner_);
+#endif
+    auto* previous = std::exchange(Current(), this);
+    size_t idle_rounds = 0, backoff_us = 0;
+    while (num_task_ != 0) {
+      while (!ready_.empty()) {
+        auto handle = ready_.back();
+        ready_.pop_back();
+        handle.resume();
+        if (handle.done()) {
+          handle.destroy();
+          num_task_--;
+        }
+      }
+
+      ring_.Progress();
+      bool resumed = false;
+      auto* awaiter = std::exchange(parked_, nullptr);
+      while (awaiter != nullptr) {
+        auto* next = awaiter->next_;
+        if (awaiter->Poll()) {
+          // awaiter位于协程帧中，resume之后便不可再访问
+          auto handle = awaiter->handle_;
+          handle.resume();
+          if (handle.done()) {
+            handle.destroy();
+            num_task_--;
+          }
+          resumed = true;
+        } else {
+          awaiter->next_ = parked_;
+          parked_ = awaiter;
+        }
+        awaiter = next;
+      }
+
+      // 本轮没有任何协程可以继续：阻塞等待本线程ring上的completion；
+      // ring上没有在途的I/O时（等待的是其它线程的缺页），先yield，之后以不超过一次I/O延迟的间隔退避
+      if (resumed || !ready_.empty() || num_task_ == 0) {
+        idle_rounds = 0;
+        backoff_us = 0;
+      } else if (!ring_.WaitCompletion()) {
+        if (idle_rounds++ < COROUTINE_IDLE_YIELD_ROUNDS) {
+          std::this_thread::yield();
+        } else {
+          backoff_us = backoff_us == 0
+                           ? COROUTINE_BACKOFF_MIN_MICROSECOND
+                           : std::min(backoff_us * 2,
+                                      COROUTINE_BACKOFF_MAX_MICROSECOND);
+          std::this_thread::sleep_for(std::chrono::microseconds(backoff_us));
+        }
+      }
+    }
+    Current() = previous;
+  }
+
+ private:
+  IOURing ring_;
+  std::vector<std::coroutine_handle<>> ready_;
+  CoroAwaiterBase* parked_ = nullptr;
+  size_t num_task_;
+  const std::thread::id owner_;
+};
+
+}  // namespace gbp
+#endif
@@ -1,13 +1,26 @@
 #pragma once
 
 #include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace csv {
 
 class CSVLoader {
@@ -98,4 +111,284 @@ class CSVLoader {
   std::vector<std::vector<std::string>> data_;
 };
 
+// 返回[begin, end)中第一个等于c的字符的位置，不存在时返回end
+inline const char* find_char(const char* begin, const char* end, char c) {
+#if defined(__SSE2__)
+  const __m128i pattern = _mm_set1_epi8(c);
+  while (begin + 16 <= end) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern));
+    if (mask != 0)
+      return begin + __builtin_ctz(mask);
+    begin += 16;
+  }
+#endif
+  while (begin < end && *begin != c)
+    begin++;
+  return begin;
+}
+
+/**
+ * 基于mmap的分块并行CSV读取（用于bulkload，替代CSVLoader）
+ * 1. 文件按照线程数切分为若干chunk，chunk的边界对齐到记录结尾的换行符
+ * 2. 第一遍并行统计每个chunk的行数，前缀和得到每个chunk的起始行号
+ * 3. 第二遍并行解析（SIMD查找分隔符），每攒够batch_size行调用一次回调
+ * 4. 回调中的string_view直接指向mmap的内存，不产生拷贝，只在回调期间有效
+ * 5. 支持RFC 4180的引号：以'"'开头的cell中可以包含分隔符与换行，""表示一个'"'；
+ * 含有""的cell需要反转义，此时string_view指向chunk私有的缓冲区。
+ * 切分chunk时先并行统计每段中'"'的个数，由其奇偶性确定每段起点是否位于引号内
+ */
+class ChunkedCSVReader {
+ public:
+  // cells按行主序排列，每行column_count()个，缺失的cell为空
+  using batch_func_type =
+      std::function<void(size_t first_row_id, size_t row_num,
+                         const std::vector<std::string_view>& cells)>;
+
+  ChunkedCSVReader() = default;
+  ChunkedCSVReader(const std::string& file_path, char delimiter = '|') {
+    assert(open(file_path, delimiter));
+  }
+  ChunkedCSVReader(const ChunkedCSVReader&) = delete;
+  ChunkedCSVReader& operator=(const ChunkedCSVReader&) = delete;
+  ~ChunkedCSVReader() { close(); }
+
+  bool open(const std::string& file_path, char delimiter = '|') {
+    close();
+    delimiter_ = delimiter;
+    fd_ = ::open(file_path.c_str(), O_RDONLY);
+    if (fd_ == -1)
+      return false;
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || st.st_size == 0) {
+      close();
+      return false;
+    }
+    size_ = st.st_size;
+    data_ = static_cast<const char*>(
+        ::mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd_, 0));
+    if (data_ == MAP_FAILED) {
+      data_ = nullptr;
+      close();
+      return false;
+    }
+    ::madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+
+    // 读取表头
+    const char* end = data_ + size_;
+    const char* line_end = FindRecordEnd(data_, end);
+    headers_.clear();
+    std::deque<std::string> unescaped;
+    ParseLine(data_, line_end, unescaped,
+              [&](size_t, std::string_view cell) {
+                headers_.emplace_back(cell);
+              });
+    body_ = std::min(line_end + 1, end);
+    return true;
+  }
+
+  void close() {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<char*>(data_), size_);
+      data_ = nullptr;
+    }
+    if (fd_ != -1) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+    size_ = 0;
+    body_ = nullptr;
+    row_count_ = 0;
+  }
+
+  // 获取列名
+  const std::vector<std::string>& get_headers() const { return headers_; }
+
+  // 获取列数
+  size_t column_count() const { return headers_.size(); }
+
+  // 获取行数，在Parse之后有效
+  size_t row_count() const { return row_count_; }
+
+  // 并行解析所有数据行，不同线程会并发调用func，但各自的行号区间互不相交
+  void Parse(const batch_func_type& func,
+             size_t thread_num = std::thread::hardware_concurrency(),
+             size_t batch_size = 4096) {
+    assert(data_ != nullptr);
+    thread_num = std::max<size_t>(thread_num, 1);
+    const char* end = data_ + size_;
+
+    // 按长度等分之后，统计每段中'"'的个数，前缀的奇偶性即为该段起点是否位于引号内
+    std::vector<const char*> bounds(thread_num + 1, end);
+    size_t chunk_size = (end - body_) / thread_num;
+    for (size_t chunk_id = 0; chunk_id < thread_num; chunk_id++)
+      bounds[chunk_id] = body_ + chunk_id * chunk_size;
+    std::vector<size_t> quote_nums(thread_num, 0);
+    RunParallel(thread_num, [&](size_t chunk_id) {
+      for (auto pos = bounds[chunk_id];
+           (pos = find_char(pos, bounds[chunk_id + 1], '"')) <
+           bounds[chunk_id + 1];
+           pos++)
+        quote_nums[chunk_id]++;
+    });
+
+    // 切分chunk，边界对齐到不在引号内的换行符之后
+    bool quoted = false;
+    for (size_t chunk_id = 1; chunk_id < thread_num; chunk_id++) {
+      quoted ^= quote_nums[chunk_id - 1] & 1;
+      const char* pos = bounds[chunk_id];
+      bool in_quote = quoted;
+      while (pos < end && (in_quote || *pos != '\n')) {
+        in_quote ^= *pos == '"';
+        pos++;
+      }
+      bounds[chunk_id] = std::max(bounds[chunk_id - 1], std::min(pos + 1, end));
+    }
+    bounds[0] = body_;
+
+    // 第一遍：统计每个chunk的行数
+    std::vector<size_t> first_row_ids(thread_num + 1, 0);
+    RunParallel(thread_num, [&](size_t chunk_id) {
+      first_row_ids[chunk_id + 1] =
+          CountLines(bounds[chunk_id], bounds[chunk_id + 1]);
+    });
+    for (size_t chunk_id = 0; chunk_id < thread_num; chunk_id++)
+      first_row_ids[chunk_id + 1] += first_row_ids[chunk_id];
+    row_count_ = first_row_ids[thread_num];
+
+    // 第二遍：解析
+    RunParallel(thread_num, [&](size_t chunk_id) {
+      ParseChunk(bounds[chunk_id], bounds[chunk_id + 1],
+                 first_row_ids[chunk_id], batch_size, func);
+    });
+  }
+
+ private:
+  template <typename FUNC_T>
+  static void RunParallel(size_t thread_num, FUNC_T&& func) {
+    std::vector<std::thread> threads;
+    for (size_t thread_id = 1; thread_id < thread_num; thread_id++)
+      threads.emplace_back(func, thread_id);
+    func(0);
+    for (auto& thread : threads)
+      thread.join();
+  }
+
+  // 从记录的起点begin开始，返回该记录结尾的换行符（引号内的换行不算），不存在时返回end
+  static const char* FindRecordEnd(const char* begin, const char* end) {
+    const char* line_end = find_char(begin, end, '\n');
+    const char* quote = find_char(begin, line_end, '"');
+    if (quote == line_end)  // 绝大多数记录不含引号
+      return line_end;
+    bool in_quote = false;
+    for (; quote < end; quote++) {
+      if (*quote == '"')
+        in_quote = !in_quote;
+      else if (*quote == '\n' && !in_quote)
+        break;
+    }
+    return quote;
+  }
+
+  static bool IsEmptyLine(const char* begin, const char* line_end) {
+    return line_end == begin || (line_end - begin == 1 && *begin == '\r');
+  }
+
+  // 空行不计入行数
+  static size_t CountLines(const char* begin, const char* end) {
+    size_t count = 0;
+    while (begin < end) {
+      const char* line_end = FindRecordEnd(begin, end);
+      count += !IsEmptyLine(begin, line_end);
+      begin = line_end + 1;
+    }
+    return count;
+  }
+
+  // 需要反转义的cell保存在unescaped中（deque追加时不会移动已有的元素）
+  template <typename FUNC_T>
+  void ParseLine(const char* begin, const char* end,
+                 std::deque<std::string>& unescaped, FUNC_T&& func) const {
+    if (end != begin && *(end - 1) == '\r')
+      end--;
+    size_t column_id = 0;
+    while (true) {
+      const char* cell_end;
+      if (begin < end && *begin == '"') {
+        // 带引号的cell：内容到下一个不成对的'"'为止
+        const char* content = begin + 1;
+        const char* pos = content;
+        bool escaped = false;
+        while (true) {
+          pos = find_char(pos, end, '"');
+          if (pos + 1 < end && *(pos + 1) == '"') {
+            escaped = true;
+            pos += 2;
+            continue;
+          }
+          break;
+        }
+        if (!escaped) {
+          func(column_id++, std::string_view(content, pos - content));
+        } else {
+          auto& cell = unescaped.emplace_back();
+          cell.reserve(pos - content);
+          for (const char* c = content; c < pos; c++) {
+            cell.push_back(*c);
+            c += *c == '"';  // ""只保留一个
+          }
+          func(column_id++, std::string_view(cell));
+        }
+        cell_end = find_char(std::min(pos + 1, end), end, delimiter_);
+      } else {
+        cell_end = find_char(begin, end, delimiter_);
+        func(column_id++, std::string_view(begin, cell_end - begin));
+      }
+      if (cell_end == end)
+        break;
+      begin = cell_end + 1;
+    }
+  }
+
+  void ParseChunk(const char* begin, const char* end, size_t first_row_id,
+                  size_t batch_size, const batch_func_type& func) const {
+    const size_t column_num = column_count();
+    std::vector<std::string_view> cells;
+    cells.reserve(batch_size * column_num);
+    std::deque<std::string> unescaped;
+    size_t row_num = 0;
+
+    while (begin < end) {
+      const char* line_end = FindRecordEnd(begin, end);
+      if (!IsEmptyLine(begin, line_end)) {
+        cells.resize((row_num + 1) * column_num);
+        auto* row = cells.data() + row_num * column_num;
+        ParseLine(begin, line_end, unescaped,
+                  [&](size_t column_id, std::string_view cell) {
+                    if (column_id < column_num)
+                      row[column_id] = cell;
+                  });
+        if (++row_num == batch_size) {
+          func(first_row_id, row_num, cells);
+          first_row_id += row_num;
+          row_num = 0;
+          cells.clear();
+          unescaped.clear();
+        }
+      }
+      begin = line_end + 1;
+    }
+    if (row_num != 0)
+      func(first_row_id, row_num, cells);
+  }
+
+  int fd_ = -1;
+  const char* data_ = nullptr;
+  const char* body_ = nullptr;  // 第一行数据的起始位置
+  size_t size_ = 0;
+  char delimiter_ = '|';
+  size_t row_count_ = 0;
+  std::vector<std::string> headers_;
+};
+
 }  // namespace csv
@@ -1,146 +1,116 @@
 #pragma once
 
-#include <numa.h>
+#include <linux/futex.h>
 #include <pthread.h>
-#include <xmmintrin.h>
-#include <boost/circular_buffer.hpp>
-#include <boost/fiber/all.hpp>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <climits>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <mutex>
-#include <optional>
-#include <queue>
-#include <stdexcept>
 #include <thread>
-#include <tuple>
-#include <type_traits>
 #include <vector>
 
-#include <boost/lockfree/queue.hpp>
-
 #include "config.h"
-#include "io_backend.h"
-#include "page_table.h"
-#include "replacer/replacer.h"
 #include "utils.h"
 
 namespace gbp {
-using queue_lockfree_type =
-    boost::lockfree::queue<mpage_id_type, boost::lockfree::fixed_sized<true>>;
-
-struct async_eviction_request_type {
-  Replacer<mpage_id_type>*
-      replacer;  // to find an unpinned page for replacement
-  lockfree_queue_type<mpage_id_type>*
-      free_list;  // to find a free page for replacement
-  mpage_id_type page_num;
-  std::atomic<bool>* finish;
-
-  async_eviction_request_type(Replacer<mpage_id_type>* _replacer,
-                              lockfree_queue_type<mpage_id_type>* _free_list,
-                              mpage_id_type _page_num,
-                              std::atomic<bool>* _finish) {
-    replacer = _replacer;
-    free_list = _free_list;
-    page_num = _page_num;
-    finish = _finish;
-  }
-  ~async_eviction_request_type() = default;
-};
 
+class BufferPool;
+
+/**
+ * 主动淘汰（watermark-driven）
+ * 1. 每个pool的free list（全局队列部分）维持在[low watermark, high watermark]之间
+ * 2. 当free list低于low watermark时，后台线程持续调用replacer的Victim，
+ * 脏页先写回，然后解除映射并放入free list，直到达到high watermark
+ * 3. 前台线程缺页时直接从free list中获取空闲页，只有在free
+ * list耗尽时才会自己调用Victim
+ * 4. 共有N个worker，pool按照pool_ID % N固定归属于一个worker；
+ * worker没有工作时在futex上休眠，由前台线程在free list低于low watermark时唤醒
+ * 5. 水位按free list的GlobalSize()计算：各线程magazine中的空闲页只有其所属线程能用，
+ * 计入水位会使全局队列耗尽时worker仍不被唤醒
+ * 6. 需要补充但一轮下来没有淘汰出任何页（所有页都被pin住）时，worker带超时地休眠（指数退避），
+ * 休眠期间不被Notify唤醒，避免空转
+ */
 class EvictionServer {
+  struct eviction_worker_type {
+    enum State : uint32_t { Running = 0, Parked = 1, BackingOff = 2 };
+
+    std::thread server;
+    std::vector<BufferPool*> pools;
+    std::atomic<uint32_t> state{State::Running};
+  };
+
  public:
-  EvictionServer() : stop_(false) {
-    if (!server_.joinable())
-      server_ = std::thread([this]() { Run(); });
+  explicit EvictionServer(size_t worker_num) : stop_(false) {
+    assert(worker_num > 0);
+    for (size_t idx = 0; idx < worker_num; idx++)
+      workers_.emplace_back(new eviction_worker_type());
   }
-  ~EvictionServer() {
-    stop_ = true;
-    if (server_.joinable())
-      server_.join();
+  ~EvictionServer() { Stop(); }
+
+  // 需要在Start之前完成所有pool的注册
+  void RegisterPool(uint32_t pool_ID, BufferPool* pool) {
+    std::lock_guard<std::mutex> lck(latch_);
+    auto& worker = *workers_[pool_ID % workers_.size()];
+    assert(!worker.server.joinable());
+    worker.pools.push_back(pool);
   }
-  bool SendRequest(Replacer<mpage_id_type>* replacer,
-                   lockfree_queue_type<mpage_id_type>* free_list,
-                   mpage_id_type page_num, std::atomic<bool>* finish,
-                   bool blocked = true) {
-    if (!server_.joinable())
-      return false;
-
-    auto* req =
-        new async_eviction_request_type(replacer, free_list, page_num, finish);
-
-    if (likely(blocked))
-      while (!request_channel_.push(req))
-        ;
-    else {
-      return request_channel_.push(req);
-    }
 
-    return true;
+  void Start() {
+    for (auto& worker : workers_) {
+      if (!worker->server.joinable() && !worker->pools.empty()) {
+        auto* worker_ptr = worker.get();
+        worker->server = std::thread([this, worker_ptr]() { Run(*worker_ptr); });
+      }
+    }
   }
 
- private:
-  bool ProcessFunc(async_eviction_request_type& req) {
-    mpage_id_type mpage_id;
-    std::vector<mpage_id_type> pages;
-    req.replacer->Victim(pages, req.page_num);
-    for (auto& page : pages) {
-      assert(req.free_list->Push(page));
-    }
-    req.page_num -= pages.size();
-    if (unlikely(req.page_num == 0)) {
-      return true;
+  void Stop() {
+    stop_ = true;
+    for (auto& worker : workers_) {
+      Wake(*worker);
+      if (worker->server.joinable())
+        worker->server.join();
     }
+  }
 
-    return false;
+  // 前台线程调用：唤醒负责该pool的worker，worker未休眠时只有一次load
+  FORCE_INLINE void Notify(uint32_t pool_ID) {
+    auto& worker = *workers_[pool_ID % workers_.size()];
+    if (worker.state.load() == eviction_worker_type::State::Parked)
+      Wake(worker);
   }
 
-  void Run() {
-    boost::circular_buffer<std::optional<async_eviction_request_type*>>
-        async_requests(gbp::BATCH_SIZE_EVICTION_SERVER);
-
-    async_eviction_request_type* async_request;
-    while (!async_requests.full())
-      async_requests.push_back(std::nullopt);
-
-    size_t req_id = 0;
-    while (true) {
-      req_id = 0;
-      while (req_id != gbp::EVICTION_FIBER_CHANNEL_DEPTH) {
-        auto& req = async_requests[req_id];
-        if (!req.has_value()) {
-          if (request_channel_.pop(async_request)) {
-            req.emplace(async_request);
-          } else {
-            req_id++;
-            continue;
-          }
-        }
-        if (ProcessFunc(*req.value())) {
-          req.value()->finish->store(true);
-          delete req.value();
-          if (request_channel_.pop(async_request)) {
-            req.emplace(async_request);
-          } else {
-            req_id++;
-            req.reset();
-          }
-        } else {
-          req_id++;
-        }
-      }
-      if (stop_)
-        break;
-      // hybrid_spin(loops);
+  size_t GetWorkerNum() const { return workers_.size(); }
+  // 在futex上休眠（不包括退避中）的worker数
+  size_t GetParkedWorkerNum() const {
+    size_t parked_num = 0;
+    for (auto& worker : workers_) {
+      if (worker->state.load() == eviction_worker_type::State::Parked)
+        parked_num++;
     }
+    return parked_num;
   }
 
-  std::thread server_;
-  boost::lockfree::queue<
-      async_eviction_request_type*,
-      boost::lockfree::capacity<EVICTION_SERVER_CHANNEL_SERVER>>
-      request_channel_;
-  size_t num_async_fiber_processing_;
-  bool stop_;
+ private:
+  FORCE_INLINE void Wake(eviction_worker_type& worker) {
+    if (worker.state.exchange(eviction_worker_type::State::Running) !=
+        eviction_worker_type::State::Running)
+      ::syscall(SYS_futex, &worker.state, FUTEX_WAKE_PRIVATE, INT_MAX,
+                nullptr, nullptr, 0);
+  }
+
+  bool NeedRefill(BufferPool& pool);
+  // 为单个pool补充空闲页，返回本轮是否做了淘汰
+  bool ProcessFunc(BufferPool& pool);
+
+  void Run(eviction_worker_type& worker);
+
+  std::mutex latch_;
+  std::vector<std::unique_ptr<eviction_worker_type>> workers_;
+  std::atomic<bool> stop_;
 };
-}  // namespace gbp
\ No newline at end of file
+}  // namespace gbp
@@ -5,26 +5,66 @@
 #include <liburing.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/xattr.h>
 #include <unistd.h>
 #include <algorithm>
 #include <atomic>
 #include <boost/algorithm/string.hpp>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
+#include "compressed_file.h"
 #include "config.h"
+#include "lockfree_queue.h"
 // #include "partitioner.h"
 #include "logger.h"
 #include "utils.h"
 
 namespace gbp {
 
+/**
+ * 把文件页映射到其它地址的组件（UffdRegion），buffer pool在淘汰或写回该页之前通过
+ * DiskManager::UnmapPage解除映射，之后对该地址的访问会重新触发缺页
+ */
+class PageMapper {
+ public:
+  virtual ~PageMapper() = default;
+  // 返回true表示该页在映射期间可能被写过（buffer pool无法感知这些写入，需要当作dirty）
+  virtual bool Unmap(fpage_id_type fpage_id) = 0;
+};
+
 class DiskManager {
  public:
-  DiskManager() = default;
-  DiskManager(const std::string& file_path) {
+  /**
+   * 文件表中的一项，发布之后除了valid/size/page_mapper之外不再修改
+   */
+  struct FileEntry {
+    OSfile_handle_type fd_os = -1;
+    std::atomic<bool> valid = false;
+    std::string file_path;
+    std::atomic<size_t> size_inByte = 0;
+    std::vector<OSfile_handle_type> stripe_fds;  // 为空表示没有条带化
+    std::unique_ptr<CompressedFile> compressed;  // 为空表示没有压缩
+    std::atomic<PageMapper*> page_mapper = nullptr;
+    std::atomic<size_t> page_mapper_users = 0;  // 正在调用page_mapper的线程数
+    std::atomic<size_t> io_users = 0;  // 已经AcquireFile、还没有ReleaseFile的I/O数
+#ifdef DEBUG_BITMAP
+    bitset_dynamic used;
+#endif
+  };
+
+  DiskManager() : file_num_(0) {
+    for (auto& segment : segments_)
+      segment.store(nullptr, std::memory_order_relaxed);
+  }
+  DiskManager(const std::string& file_path) : DiskManager() {
     OpenFile(file_path);
     // thread_ = std::thread([this]() {
     //   while (true) {
@@ -42,74 +82,286 @@ class DiskManager {
   }
 
   ~DiskManager() {
-    for (auto& fd : fd_oss_) {
-      if (fd.second)
-        close(fd.first);
+    for (size_t fd = 0; fd < GetFileNum(); fd++) {
+      auto& entry = GetFileEntry(fd);
+      if (entry.valid) {
+        close(entry.fd_os);
+        for (auto stripe_fd : entry.stripe_fds)
+          close(stripe_fd);
+      }
+      GBPLOG << fd << " | " << entry.file_path << " | " << entry.size_inByte;
     }
-    for (size_t file_id = 0; file_id < fd_oss_.size(); file_id++)
-      GBPLOG << file_id << " | " << file_names_[file_id] << " | "
-             << file_size_inBytes_[file_id] << " | " << counts_[file_id].first
-             << " | " << counts_[file_id].second;
+    for (auto& segment : segments_)
+      delete[] segment.load();
   }
 
-  FORCE_INLINE OSfile_handle_type
-  GetFileDescriptor(GBPfile_handle_type fd) const {
+  /**
+   * 文件表：固定大小的段目录 + 按需分配的段（DISK_FILE_TABLE_SEGMENT_SIZE项）
+   * 1. 文件项分配后地址不变，GBP fd不复用，关闭的文件只清除valid，
+   * 因此读者（GetFileDescriptor、GetFileSizeFast、ValidFD等）不需要加锁；
+   * 使用OS fd进行I/O的读者在Translate之前AcquireFile、I/O提交之后ReleaseFile，
+   * CloseFile等待这些I/O结束之后才close OS fd（见AcquireFile）
+   * 2. OpenFile在latch_下初始化文件项（必要时分配新段），最后release发布file_num_
+   * 3. 文件大小缓存在文件项中，Resize时更新
+   */
+  FORCE_INLINE size_t GetFileNum() const {
+    return file_num_.load(std::memory_order_acquire);
+  }
+
+  FORCE_INLINE FileEntry& GetFileEntry(GBPfile_handle_type fd) const {
 #if ASSERT_ENABLE
-    assert(fd < fd_oss_.size());
+    assert(fd < GetFileNum());
 #endif
-    return fd_oss_[fd].first;
+    return segments_[fd >> LOG_DISK_FILE_TABLE_SEGMENT_SIZE].load(
+        std::memory_order_acquire)[fd & (DISK_FILE_TABLE_SEGMENT_SIZE - 1)];
+  }
+
+  FORCE_INLINE OSfile_handle_type
+  GetFileDescriptor(GBPfile_handle_type fd) const {
+    return GetFileEntry(fd).fd_os;
   }
 
   /**
    * Public helper function to get disk file size
    */
   FORCE_INLINE size_t GetFileSizeFast(GBPfile_handle_type fd) const {
-    return file_size_inBytes_[fd];
+    return GetFileEntry(fd).size_inByte.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * 条带化（striping）
+   * 1. SetStripeDirs之后新建（打开时为空）的文件按DISK_STRIPE_CHUNK_SIZE交错地分布在每个目录下的一个backing file中，
+   * 第chunk_id个chunk位于第chunk_id % N个backing file的(chunk_id / N) * CHUNK处
+   * 2. 原路径上的文件只作为稀疏的占位文件（不写数据），记录逻辑文件大小，
+   * 因此std::filesystem::file_size、rename、hard link等基于路径的操作保持不变
+   * 3. backing file的路径记录在占位文件的扩展属性STRIPE_XATTR_NAME中（随inode保存，rename之后仍然有效），
+   * 打开文件时以此判断该文件是否是条带化创建的，与当前的stripe_dirs无关；
+   * 已有的非条带化文件始终按原样打开
+   * 4. 目录数小于2或者文件系统不支持扩展属性时不做条带化
+   * 5. 删除条带化的文件需要通过RemoveFile，同时删除backing file
+   */
+  void SetStripeDirs(const std::vector<std::string>& stripe_dirs) {
+    std::lock_guard<std::mutex> lock(latch_);
+    for (auto& dir : stripe_dirs)
+      std::filesystem::create_directories(dir);
+    stripe_dirs_ = stripe_dirs;
+  }
+
+  FORCE_INLINE size_t GetStripeNum(GBPfile_handle_type fd) const {
+    return std::max<size_t>(GetFileEntry(fd).stripe_fds.size(), 1);
+  }
+
+  /**
+   * 保护OS fd（包括backing file）：AcquireFile成功之后到ReleaseFile之前，Translate得到的OS fd不会被close
+   * 1. 先增加io_users再检查valid，CloseFile先清除valid再等待io_users为0，
+   * 因此两者之间要么I/O看到文件已经关闭，要么CloseFile等到I/O结束
+   * 2. 文件已经关闭时返回false，不增加io_users
+   * 3. io_uring的I/O在提交（io_uring_submit）之后由内核持有文件的引用，提交之后就可以ReleaseFile
+   */
+  FORCE_INLINE bool AcquireFile(GBPfile_handle_type fd) const {
+    auto& entry = GetFileEntry(fd);
+    entry.io_users.fetch_add(1);
+    if (likely(entry.valid.load()))
+      return true;
+    entry.io_users.fetch_sub(1);
+    return false;
+  }
+
+  FORCE_INLINE void ReleaseFile(GBPfile_handle_type fd) const {
+    GetFileEntry(fd).io_users.fetch_sub(1);
+  }
+
+  // 逻辑文件中的offset所在的backing file及其中的offset
+  FORCE_INLINE std::pair<OSfile_handle_type, size_t> Translate(
+      GBPfile_handle_type fd, size_t offset) const {
+    auto& entry = GetFileEntry(fd);
+    auto& stripe_fds = entry.stripe_fds;
+    if (likely(stripe_fds.empty()))
+      return {entry.fd_os, offset};
+    size_t chunk_id = offset / DISK_STRIPE_CHUNK_SIZE;
+    return {stripe_fds[chunk_id % stripe_fds.size()],
+            chunk_id / stripe_fds.size() * DISK_STRIPE_CHUNK_SIZE +
+                offset % DISK_STRIPE_CHUNK_SIZE};
+  }
+
+  /**
+   * [offset, offset + size)按chunk拆分成backing file中连续的段，依次调用func(fd_os, offset_os, pos, len)，
+   * pos为段在[offset, offset + size)中的位置；没有条带化时只有一段
+   */
+  template <typename FuncType>
+  FORCE_INLINE void ForEachSegment(GBPfile_handle_type fd, size_t offset,
+                                   size_t size, FuncType&& func) const {
+    auto& entry = GetFileEntry(fd);
+    if (likely(entry.stripe_fds.empty())) {
+      func(entry.fd_os, offset, 0, size);
+      return;
+    }
+    for (size_t pos = 0; pos < size;) {
+      auto len = std::min(size - pos, DISK_STRIPE_CHUNK_SIZE -
+                                          (offset + pos) % DISK_STRIPE_CHUNK_SIZE);
+      auto [fd_os, offset_os] = Translate(fd, offset + pos);
+      func(fd_os, offset_os, pos, len);
+      pos += len;
+    }
+  }
+
+  // offset所在的设备（目录）编号，IOServer按设备分配请求
+  FORCE_INLINE size_t GetDeviceId(GBPfile_handle_type fd,
+                                  size_t offset) const {
+    auto& stripe_fds = GetFileEntry(fd).stripe_fds;
+    return stripe_fds.empty()
+               ? 0
+               : offset / DISK_STRIPE_CHUNK_SIZE % stripe_fds.size();
+  }
+
+  FORCE_INLINE CompressedFile* GetCompressedFile(
+      GBPfile_handle_type fd) const {
+    return GetFileEntry(fd).compressed.get();
+  }
+
+  // mapper为nullptr时等待正在进行的UnmapPage结束，返回之后不会再调用原来的mapper
+  void SetPageMapper(GBPfile_handle_type fd, PageMapper* mapper) {
+    auto& entry = GetFileEntry(fd);
+    entry.page_mapper.store(mapper);
+    if (mapper == nullptr) {
+      while (entry.page_mapper_users.load() != 0)
+        std::this_thread::yield();
+    }
+  }
+
+  // 先增加users再读取mapper，与SetPageMapper(fd, nullptr)配合保证mapper在调用期间有效
+  FORCE_INLINE bool UnmapPage(GBPfile_handle_type fd, fpage_id_type fpage_id) {
+    auto& entry = GetFileEntry(fd);
+    if (likely(entry.page_mapper.load(std::memory_order_relaxed) == nullptr))
+      return false;
+    bool ret = false;
+    entry.page_mapper_users.fetch_add(1);
+    if (auto mapper = entry.page_mapper.load())
+      ret = mapper->Unmap(fpage_id);
+    entry.page_mapper_users.fetch_sub(1);
+    return ret;
+  }
+
+  void Sync(GBPfile_handle_type fd) const {
+    auto& entry = GetFileEntry(fd);
+    if (entry.compressed != nullptr)
+      return entry.compressed->Flush();
+    if (!AcquireFile(fd))
+      return;
+    if (entry.stripe_fds.empty())
+      ::fdatasync(entry.fd_os);
+    for (auto stripe_fd : entry.stripe_fds)
+      ::fdatasync(stripe_fd);
+    ReleaseFile(fd);
   }
 
   int Resize(GBPfile_handle_type fd, size_t new_size_inByte) {
-    assert(::ftruncate(GetFileDescriptor(fd), new_size_inByte) == 0);
-    file_size_inBytes_[fd] = new_size_inByte;
+    auto& entry = GetFileEntry(fd);
+    // 压缩的文件丢弃新末尾之后的extent，否则文件再次扩大之后会读到旧的数据
+    if (entry.compressed != nullptr &&
+        new_size_inByte < entry.size_inByte.load(std::memory_order_relaxed))
+      entry.compressed->Truncate(new_size_inByte);
+    assert(::ftruncate(entry.fd_os, new_size_inByte) == 0);
+    auto& stripe_fds = entry.stripe_fds;
+    for (size_t stripe_id = 0; stripe_id < stripe_fds.size(); stripe_id++)
+      assert(::ftruncate(stripe_fds[stripe_id],
+                         GetStripeSize(new_size_inByte, stripe_id,
+                                       stripe_fds.size())) == 0);
+    entry.size_inByte.store(new_size_inByte, std::memory_order_relaxed);
 
 #ifdef DEBUG_BITMAP
-    used_[fd].resize(ceil(new_size_inByte, PAGE_SIZE_MEMORY));
+    entry.used.resize(ceil(new_size_inByte, PAGE_SIZE_MEMORY));
 #endif
     return 0;
   }
 
+  // compressed为true时页面压缩后存储在path.cdata中（见CompressedFile），不做条带化
   FORCE_INLINE GBPfile_handle_type OpenFile(const std::string& file_path,
                                             int o_flag = O_RDWR | O_CREAT |
-                                                         O_DIRECT) {
-    static std::mutex mtx;
-    std::lock_guard<std::mutex> lock(mtx);  // 保证本函数在多线程下执行的一致性
+                                                         O_DIRECT,
+                                            bool compressed = false) {
+    std::lock_guard<std::mutex> lock(latch_);  // 写者之间互斥，读者不加锁
     auto fd_os = ::open(file_path.c_str(), o_flag, 0777);
     assert(fd_os != -1);
 
-    fd_oss_.push_back(std::make_pair(fd_os, true));
-    file_names_.push_back(file_path);
-    file_size_inBytes_.push_back(GetFileSize(fd_oss_.size() - 1));
+    GBPfile_handle_type fd = file_num_.load(std::memory_order_relaxed);
+    auto segment_id = fd >> LOG_DISK_FILE_TABLE_SEGMENT_SIZE;
+    assert(segment_id < DISK_FILE_TABLE_SEGMENT_NUM);
+    if (segments_[segment_id].load(std::memory_order_relaxed) == nullptr)
+      segments_[segment_id].store(new FileEntry[DISK_FILE_TABLE_SEGMENT_SIZE],
+                                  std::memory_order_release);
+    auto& entry = segments_[segment_id].load(
+        std::memory_order_relaxed)[fd & (DISK_FILE_TABLE_SEGMENT_SIZE - 1)];
+
+    entry.fd_os = fd_os;
+    entry.file_path = file_path;
+    entry.size_inByte = GetOSFileSize(fd_os);
+    if (compressed) {
+      entry.compressed = std::make_unique<CompressedFile>(file_path, o_flag);
+    } else {
+      auto stripe_paths = GetStripePaths(fd_os);
+      if (stripe_paths.empty() && stripe_dirs_.size() > 1 &&
+          entry.size_inByte == 0 && (o_flag & O_ACCMODE) != O_RDONLY)
+        stripe_paths = CreateStripes(fd_os);
+      for (auto& stripe_path : stripe_paths) {
+        // 条带化创建的文件，backing file不存在说明数据已经丢失
+        auto stripe_fd =
+            ::open(stripe_path.c_str(), o_flag & ~O_CREAT, 0777);
+        if (stripe_fd == -1)
+          GBPLOG << "failed to open the stripe " << stripe_path << " of "
+                 << file_path << ": " << strerror(errno);
+        assert(stripe_fd != -1);
+        entry.stripe_fds.push_back(stripe_fd);
+      }
+    }
+    entry.valid = true;
+    file_num_.store(fd + 1, std::memory_order_release);
+
+    // 按占位文件的大小截断backing file，丢弃占位文件被截断之前留下的数据
+    if (!entry.stripe_fds.empty() && (o_flag & O_ACCMODE) != O_RDONLY)
+      Resize(fd, entry.size_inByte);
 
 #ifdef DEBUG
     debug::get_bitmaps().emplace_back(
-        ceil(file_sizes_[file_sizes_.size() - 1], PAGE_SIZE_MEMORY));
+        ceil(entry.size_inByte, PAGE_SIZE_MEMORY));
 #endif
 #ifdef DEBUG_BITMAP
-    used_.emplace_back(
-        ceil(file_size_inBytes_[fd_oss_.size() - 1], PAGE_SIZE_MEMORY));
+    entry.used.resize(ceil(entry.size_inByte, PAGE_SIZE_MEMORY));
 #endif
-
-    counts_.emplace_back(0, 0);
-    return fd_oss_.size() - 1;
+    return fd;
   }
 
+  // 文件项不回收，等待已经AcquireFile的I/O结束之后close OS fd（包括backing file）
   FORCE_INLINE void CloseFile(GBPfile_handle_type fd) {
-    auto fd_os = GetFileDescriptor(fd);
+    std::lock_guard<std::mutex> lock(latch_);
+    auto& entry = GetFileEntry(fd);
+    entry.valid.store(false);
+    while (entry.io_users.load() != 0)
+      std::this_thread::yield();
+    if (entry.compressed != nullptr)
+      entry.compressed->Flush();
+    ::close(entry.fd_os);
+    for (auto stripe_fd : entry.stripe_fds)
+      ::close(stripe_fd);
+  }
+
+  // 删除文件以及它的backing file（条带化）或压缩数据，文件不能处于打开状态
+  static bool RemoveFile(const std::string& file_path) {
+    auto fd_os = ::open(file_path.c_str(), O_RDONLY);
+    if (fd_os == -1)
+      return false;
+    auto stripe_paths = GetStripePaths(fd_os);
     ::close(fd_os);
-    fd_oss_[fd].second = false;
+    for (auto& stripe_path : stripe_paths)
+      ::unlink(stripe_path.c_str());
+    ::unlink((file_path + ".cdata").c_str());
+    ::unlink((file_path + ".cidx").c_str());
+    return ::unlink(file_path.c_str()) == 0;
   }
 
   FORCE_INLINE bool ValidFD(GBPfile_handle_type fd) const {
-    return fd < fd_oss_.size() && fd_oss_[fd].second;
+    return fd < GetFileNum() &&
+           GetFileEntry(fd).valid.load(std::memory_order_acquire);
   }
 
   // protected:
@@ -117,39 +369,95 @@ class DiskManager {
    * Public helper function to get disk file size
    */
   FORCE_INLINE size_t GetFileSize(GBPfile_handle_type fd) const {
-#if ASSERT_ENABLE
-    assert(fd < file_names_.size());
-#endif
-    return std::filesystem::file_size(file_names_[fd]);
+    return GetFileSizeFast(fd);
   }
 
-  FORCE_INLINE std::string GetFilePath(GBPfile_handle_type fd) const {
+  FORCE_INLINE const std::string& GetFilePath(GBPfile_handle_type fd) const {
 #if ASSERT_ENABLE
     assert(ValidFD(fd));
 #endif
 
-    return file_names_[fd];
+    return GetFileEntry(fd).file_path;
   }
 
 #ifdef DEBUG_BITMAP
   bool GetUsedMark(GBPfile_handle_type fd, fpage_id_type fpage_id) {
-    return used_[fd].get_atomic(fpage_id);
+    return GetFileEntry(fd).used.get_atomic(fpage_id);
   }
 
   void SetUsedMark(GBPfile_handle_type fd, fpage_id_type fpage_id, bool used) {
-    used_[fd].set_atomic(fpage_id, used);
+    GetFileEntry(fd).used.set_atomic(fpage_id, used);
   }
 #endif
 
-  std::vector<std::pair<OSfile_handle_type, bool>> fd_oss_;
-  std::vector<std::string> file_names_;
-  std::vector<size_t> file_size_inBytes_;
+  // 逻辑文件大小为file_size时第stripe_id个backing file的大小
+  static size_t GetStripeSize(size_t file_size, size_t stripe_id,
+                              size_t stripe_num) {
+    size_t chunk_num = file_size / DISK_STRIPE_CHUNK_SIZE;
+    size_t stripe_size = (chunk_num / stripe_num +
+                          (stripe_id < chunk_num % stripe_num)) *
+                         DISK_STRIPE_CHUNK_SIZE;
+    if (stripe_id == chunk_num % stripe_num)
+      stripe_size += file_size % DISK_STRIPE_CHUNK_SIZE;
+    return stripe_size;
+  }
+
+ private:
+  constexpr static const char* STRIPE_XATTR_NAME = "user.gbp.stripes";
+
+  // 占位文件中记录的backing file路径（以'\n'分隔），不是条带化创建的文件返回空
+  static std::vector<std::string> GetStripePaths(OSfile_handle_type fd_os) {
+    std::vector<std::string> stripe_paths;
+    auto size = ::fgetxattr(fd_os, STRIPE_XATTR_NAME, nullptr, 0);
+    if (size <= 0)
+      return stripe_paths;
+    std::string value(size, '\0');
+    size = ::fgetxattr(fd_os, STRIPE_XATTR_NAME, value.data(), value.size());
+    if (size <= 0)
+      return stripe_paths;
+    value.resize(size);
+    boost::split(stripe_paths, value, boost::is_any_of("\n"));
+    return stripe_paths;
+  }
 
-  std::vector<std::pair<size_t, size_t>> counts_;
+  // 在每个stripe目录下创建backing file并记录到占位文件中，失败时返回空（不做条带化）
+  std::vector<std::string> CreateStripes(OSfile_handle_type fd_os) const {
+    struct stat file_stat;
+    assert(::fstat(fd_os, &file_stat) == 0);
+    std::vector<std::string> stripe_paths;
+    for (auto& dir : stripe_dirs_) {
+      stripe_paths.push_back(dir + "/gbp_stripe_" +
+                             std::to_string(file_stat.st_dev) + "_" +
+                             std::to_string(file_stat.st_ino));
+      // 截断复用的inode留下的旧backing file
+      auto stripe_fd = ::open(stripe_paths.back().c_str(),
+                              O_WRONLY | O_CREAT | O_TRUNC, 0777);
+      assert(stripe_fd != -1);
+      ::close(stripe_fd);
+    }
+    auto value = boost::algorithm::join(stripe_paths, "\n");
+    if (::fsetxattr(fd_os, STRIPE_XATTR_NAME, value.data(), value.size(), 0) !=
+        0) {
+      GBPLOG << "failed to record the stripes, fall back to a plain file: "
+             << strerror(errno);
+      for (auto& stripe_path : stripe_paths)
+        ::unlink(stripe_path.c_str());
+      stripe_paths.clear();
+    }
+    return stripe_paths;
+  }
+
+  static size_t GetOSFileSize(OSfile_handle_type fd_os) {
+    struct stat file_stat;
+    assert(::fstat(fd_os, &file_stat) == 0);
+    return file_stat.st_size;
+  }
+
+  std::atomic<FileEntry*> segments_[DISK_FILE_TABLE_SEGMENT_NUM];
+  std::atomic<size_t> file_num_;
+  std::mutex latch_;  // 保护文件表的写入与stripe_dirs_
+  std::vector<std::string> stripe_dirs_;
   std::thread thread_;
-#ifdef DEBUG_BITMAP
-  std::vector<bitset_dynamic> used_;
-#endif
 };
 
 class IOBackend {
@@ -193,27 +501,184 @@ class IOBackend {
     return disk_manager_->Resize(fd, new_size);
   }
 
+  // 文件已经关闭（AcquireFile失败）时不进行I/O，仍然通知调用者，避免等待永远不会完成的I/O
+  bool ClosedFile(GBPfile_handle_type fd, AsyncMesg* finish) {
+    GBPLOG << "I/O on the closed file: fd = " << fd;
+    if (finish != nullptr)
+      finish->Post();
+    return true;
+  }
+
   DiskManager* disk_manager_;
 };
 
-// FIXME: no-Thread-safe
+class CompressedReadPool;
+
+/**
+ * io_uring上压缩的文件的读：extent读入buf_，completion时（Progress中）交给CompressedReadPool解压到页中，
+ * 之后再通知调用者。消息与缓冲区都属于CompressedReadPool，不会单独分配
+ */
+class CompressedReadMesg final : public AsyncMesg {
+  friend class CompressedReadPool;
+
+ public:
+  CompressedReadMesg() = default;
+  ~CompressedReadMesg() = default;
+
+  void Init(const CompressedFile::Location& location, char* page,
+            AsyncMesg* finish) {
+    location_ = location;
+    page_ = page;
+    finish_ = finish;
+  }
+
+  FORCE_INLINE char* GetBuffer() const { return buf_; }
+
+  void Post() override;
+  // 只由io_uring在completion时Post，调用者等待的是finish_
+  bool Wait() const override {
+    assert(false);
+    return false;
+  }
+  bool TryWait() const override {
+    assert(false);
+    return false;
+  }
+  void Reset() override { assert(false); }
+
+ private:
+  void Decode() {
+    auto success = CompressedFile::Decode(location_, buf_, page_);
+    if (!success)
+      GBPLOG << "failed to decompress a page";
+    assert(success);
+    if (finish_ != nullptr)
+      finish_->Post();
+  }
+
+  CompressedFile::Location location_;
+  char* page_ = nullptr;
+  AsyncMesg* finish_ = nullptr;
+  char* buf_ = nullptr;
+  CompressedReadPool* pool_ = nullptr;
+};
+
+/**
+ * 一个IOURing上压缩的extent的读：消息与对齐的读缓冲区在第一次读时一次性分配IOURing_MAX_DEPTH份
+ * 1. 用完时Acquire返回nullptr，ReadCompressed与sqe用完时一样返回false，由调用者Progress之后重试
+ * 2. 默认在completion时（Progress中）直接解压：线程自己的ring（IO_LOCAL_RING_ENABLE）的Progress
+ * 由等待该页的调用者驱动，解压也就在调用者上，不同调用者之间并行
+ * 3. IOServer的ring由一个线程服务所有请求，这时（offload）解压交给单独的解压线程，
+ * IOServer线程只负责提交与回收I/O；解压线程没有工作时在条件变量上等待
+ * 4. Acquire只在ring的线程上，Release只在进行解压的线程上，因此两个队列都是单生产者单消费者的
+ */
+class CompressedReadPool {
+ public:
+  explicit CompressedReadPool(bool offload)
+      : mesgs_(IOURing_MAX_DEPTH),
+        free_mesgs_(IOURing_MAX_DEPTH + 1),
+        decode_queue_(IOURing_MAX_DEPTH + 1),
+        offload_(offload),
+        stop_(false) {
+    bufs_ = (char*) ::aligned_alloc(PAGE_SIZE_MEMORY,
+                                    IOURing_MAX_DEPTH * PAGE_SIZE_FILE);
+    assert(bufs_ != nullptr);
+    for (size_t idx = 0; idx < IOURing_MAX_DEPTH; idx++) {
+      mesgs_[idx].buf_ = bufs_ + idx * PAGE_SIZE_FILE;
+      mesgs_[idx].pool_ = this;
+      free_mesgs_.push(&mesgs_[idx]);
+    }
+    if (offload_)
+      decoder_ = std::thread([this]() { Run(); });
+  }
+  CompressedReadPool(const CompressedReadPool&) = delete;
+  ~CompressedReadPool() {
+    {
+      std::lock_guard<std::mutex> lck(latch_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    if (decoder_.joinable())
+      decoder_.join();
+    ::free(bufs_);
+  }
+
+  FORCE_INLINE CompressedReadMesg* Acquire() {
+    CompressedReadMesg* mesg;
+    return free_mesgs_.pop(mesg) ? mesg : nullptr;
+  }
+
+  // 读完成时调用（ring的线程上）
+  void Complete(CompressedReadMesg* mesg) {
+    if (!offload_) {
+      mesg->Decode();
+      free_mesgs_.push(mesg);
+      return;
+    }
+    decode_queue_.push(mesg);  // 不会满：同时最多有IOURing_MAX_DEPTH个消息
+    {
+      std::lock_guard<std::mutex> lck(latch_);
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  void Run() {
+    CompressedReadMesg* mesg;
+    while (true) {
+      if (decode_queue_.pop(mesg)) {
+        mesg->Decode();
+        free_mesgs_.push(mesg);
+        continue;
+      }
+      std::unique_lock<std::mutex> lck(latch_);
+      cv_.wait(lck, [this]() { return stop_ || !decode_queue_.empty(); });
+      if (stop_ && decode_queue_.empty())
+        break;
+    }
+  }
+
+  std::vector<CompressedReadMesg> mesgs_;
+  char* bufs_;
+  LockFreeQueue<CompressedReadMesg*> free_mesgs_;
+  LockFreeQueue<CompressedReadMesg*> decode_queue_;
+  const bool offload_;
+
+  std::thread decoder_;
+  std::mutex latch_;
+  std::condition_variable cv_;
+  bool stop_;
+};
+
+inline void CompressedReadMesg::Post() { pool_->Complete(this); }
+
 class IOURing : public IOBackend {
  public:
-  IOURing(DiskManager* disk_manager)
+  // offload_decompress：压缩的页交给单独的线程解压（见CompressedReadPool）
+  IOURing(DiskManager* disk_manager, bool offload_decompress = false)
       : IOBackend(disk_manager),
         ring_(),
         cqes_(),
         num_preparing_(),
-        num_processing_() {
+        num_processing_(),
+        offload_decompress_(offload_decompress) {
     auto ret = io_uring_queue_init(IOURing_MAX_DEPTH, &ring_,
                                    0 /*IORING_SETUP_IOPOLL*/);
+    if (ret != 0)
+      GBPLOG << "io_uring_queue_init error: " << strerror(-ret);
     assert(ret == 0);
   }
 
   IOURing(const IOURing&) = delete;
   IOURing(IOURing&&) = delete;
 
-  ~IOURing() { io_uring_queue_exit(&ring_); }
+  // 先回收所有在途的I/O，之后才能释放compressed_reads_中的缓冲区
+  ~IOURing() {
+    while (Progress())
+      ;
+    compressed_reads_.reset();
+    io_uring_queue_exit(&ring_);
+  }
 
   bool Write(size_t offset, std::string_view data, GBPfile_handle_type fd,
              AsyncMesg* finish = nullptr) override {
@@ -224,20 +689,30 @@ class IOURing : public IOBackend {
   bool Write(size_t offset, const char* data, size_t size,
              GBPfile_handle_type fd, AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
-    assert(offset < disk_manager_->file_size_inBytes_[fd] &&
+    assert(disk_manager_->ValidFD(fd));
+    assert(offset < disk_manager_->GetFileSizeFast(fd) &&
            ((uintptr_t) data) % PAGE_SIZE_MEMORY == 0);
+    // 一个sqe只有一个OS fd，条带化时不能跨越chunk
+    assert(disk_manager_->GetStripeNum(fd) == 1 ||
+           offset % DISK_STRIPE_CHUNK_SIZE + PAGE_SIZE_MEMORY <=
+               DISK_STRIPE_CHUNK_SIZE);
 #endif
+    if (auto compressed = disk_manager_->GetCompressedFile(fd);
+        unlikely(compressed != nullptr))
+      return WriteCompressed(*compressed, offset, data, finish);
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
     auto sqe = io_uring_get_sqe(&ring_);
     if (!sqe) {
+      disk_manager_->ReleaseFile(fd);
       Progress();
       return false;
     }
 
-    io_uring_prep_write(sqe, disk_manager_->fd_oss_[fd].first, data,
-                        PAGE_SIZE_MEMORY, offset);
+    auto [fd_os, offset_os] = disk_manager_->Translate(fd, offset);
+    io_uring_prep_write(sqe, fd_os, data, PAGE_SIZE_MEMORY, offset_os);
     io_uring_sqe_set_data(sqe, finish);
+    preparing_fds_.push_back(fd);
     num_preparing_++;
 
     return true;
@@ -246,23 +721,34 @@ class IOURing : public IOBackend {
   bool Write(size_t offset, ::iovec* io_info, GBPfile_handle_type fd,
              AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
-    assert(offset < disk_manager_->file_size_inBytes_[fd] &&
+    assert(disk_manager_->ValidFD(fd));
+    assert(offset < disk_manager_->GetFileSizeFast(fd) &&
            ((uintptr_t) io_info->iov_base) % PAGE_SIZE_FILE == 0);
+    assert(disk_manager_->GetStripeNum(fd) == 1 ||
+           offset % DISK_STRIPE_CHUNK_SIZE + io_info->iov_len <=
+               DISK_STRIPE_CHUNK_SIZE);
 #endif
+    if (auto compressed = disk_manager_->GetCompressedFile(fd);
+        unlikely(compressed != nullptr))
+      return WriteCompressed(*compressed, offset, (char*) io_info->iov_base,
+                             finish);
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
     auto sqe = io_uring_get_sqe(&ring_);
     if (!sqe) {
+      disk_manager_->ReleaseFile(fd);
       Progress();
       return false;
     }
+    auto [fd_os, offset_os] = disk_manager_->Translate(fd, offset);
     io_uring_prep_writev(
-        sqe,  // 用这个 SQE 准备一个待提交的 read 操作
-        disk_manager_->fd_oss_[fd].first,  // 从 fd 打开的文件中读取数据
-        io_info,  // iovec 地址，读到的数据写入 iovec 缓冲区
-        1,        // iovec 数量
-        offset);  // 读取操作的起始地址偏移量
+        sqe,        // 用这个 SQE 准备一个待提交的 read 操作
+        fd_os,      // 从 fd 打开的文件中读取数据
+        io_info,    // iovec 地址，读到的数据写入 iovec 缓冲区
+        1,          // iovec 数量
+        offset_os);  // 读取操作的起始地址偏移量
     io_uring_sqe_set_data(sqe, finish);
+    preparing_fds_.push_back(fd);
     num_preparing_++;
 
     return true;
@@ -299,14 +785,22 @@ class IOURing : public IOBackend {
   bool Read(size_t offset, char* data, size_t size, GBPfile_handle_type fd,
             AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
-    assert(offset < disk_manager_->file_size_inBytes_[fd] &&
+    assert(disk_manager_->ValidFD(fd));
+    assert(offset < disk_manager_->GetFileSizeFast(fd) &&
            ((uintptr_t) data) % PAGE_SIZE_MEMORY == 0);
+    assert(disk_manager_->GetStripeNum(fd) == 1 ||
+           offset % DISK_STRIPE_CHUNK_SIZE + PAGE_SIZE_FILE <=
+               DISK_STRIPE_CHUNK_SIZE);
 #endif
+    if (auto compressed = disk_manager_->GetCompressedFile(fd);
+        unlikely(compressed != nullptr))
+      return ReadCompressed(*compressed, offset, data, finish);
 
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
     auto sqe = io_uring_get_sqe(&ring_);
     if (!sqe) {
+      disk_manager_->ReleaseFile(fd);
       Progress();
       return false;
     }
@@ -315,9 +809,10 @@ class IOURing : public IOBackend {
     //     .GetClientReadThroughputByte()
     //     .fetch_add(PAGE_SIZE_FILE);
 
-    io_uring_prep_read(sqe, disk_manager_->fd_oss_[fd].first, data,
-                       PAGE_SIZE_FILE, offset);
+    auto [fd_os, offset_os] = disk_manager_->Translate(fd, offset);
+    io_uring_prep_read(sqe, fd_os, data, PAGE_SIZE_FILE, offset_os);
     io_uring_sqe_set_data(sqe, finish);
+    preparing_fds_.push_back(fd);
     num_preparing_++;
 
     return true;
@@ -326,25 +821,39 @@ class IOURing : public IOBackend {
   bool Read(size_t offset, ::iovec* io_info, size_t count,
             GBPfile_handle_type fd, AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
-    assert(offset < disk_manager_->file_size_inBytes_[fd] &&
+    assert(disk_manager_->ValidFD(fd));
+    assert(offset < disk_manager_->GetFileSizeFast(fd) &&
            ((uintptr_t) io_info->iov_base) % PAGE_SIZE_FILE == 0);
+    assert(disk_manager_->GetStripeNum(fd) == 1 ||
+           offset % DISK_STRIPE_CHUNK_SIZE + count * PAGE_SIZE_FILE <=
+               DISK_STRIPE_CHUNK_SIZE);
 #endif
+    if (auto compressed = disk_manager_->GetCompressedFile(fd);
+        unlikely(compressed != nullptr)) {
+      assert(count == 1);  // 压缩的文件逐页读取
+      return ReadCompressed(*compressed, offset, (char*) io_info->iov_base,
+                            finish);
+    }
 
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
     auto sqe = io_uring_get_sqe(&ring_);
     if (!sqe) {
+      disk_manager_->ReleaseFile(fd);
       Progress();
       return false;
     }
 
+    // 条带化时一次readv不能跨越chunk
+    auto [fd_os, offset_os] = disk_manager_->Translate(fd, offset);
     io_uring_prep_readv(
-        sqe,  // 用这个 SQE 准备一个待提交的 read 操作
-        disk_manager_->fd_oss_[fd].first,  // 从 fd 打开的文件中读取数据
-        io_info,  // iovec 地址，读到的数据写入 iovec 缓冲区
-        count,    // iovec 数量
-        offset);  // 读取操作的起始地址偏移量
+        sqe,        // 用这个 SQE 准备一个待提交的 read 操作
+        fd_os,      // 从 fd 打开的文件中读取数据
+        io_info,    // iovec 地址，读到的数据写入 iovec 缓冲区
+        count,      // iovec 数量
+        offset_os);  // 读取操作的起始地址偏移量
     io_uring_sqe_set_data(sqe, finish);
+    preparing_fds_.push_back(fd);
     num_preparing_++;
     // disk_manager_->counts_[fd].first += count;
     return true;
@@ -356,11 +865,12 @@ class IOURing : public IOBackend {
       if (ret > 0) {
         num_processing_ += ret;
         num_preparing_ -= ret;
+        ReleaseSubmitted(ret);
       }
     }
 
     auto num_ready = io_uring_peek_batch_cqe(&ring_, cqes_, IOURing_MAX_DEPTH);
-    for (int i = 0; i < num_ready; i++) {
+    for (unsigned i = 0; i < num_ready; i++) {
       void* finish = io_uring_cqe_get_data(cqes_[i]);
 
       if (finish != nullptr) {
@@ -373,11 +883,86 @@ class IOURing : public IOBackend {
     return num_processing_;
   }
 
+  // 阻塞直到至少一个已提交的请求完成，cqe留给之后的Progress处理；没有在途的请求时返回false
+  bool WaitCompletion() {
+    if (num_processing_ == 0)
+      return false;
+    struct io_uring_cqe* cqe;
+    return io_uring_wait_cqe(&ring_, &cqe) == 0;
+  }
+
  private:
+  // 压缩的文件：读入页所在的extent，压缩的extent先读入池中CompressedReadMesg的缓冲区，完成时解压
+  bool ReadCompressed(CompressedFile& compressed, size_t offset, char* data,
+                      AsyncMesg* finish) {
+    auto location = compressed.Locate(offset >> LOG_PAGE_SIZE_FILE);
+    if (location.size == 0) {
+      ::memset(data, 0, PAGE_SIZE_FILE);
+      if (finish != nullptr)
+        finish->Post();
+      return true;
+    }
+    // 先确认sqe与消息都有空闲，取得之后不需要再归还
+    CompressedReadMesg* mesg = nullptr;
+    if (io_uring_sq_space_left(&ring_) == 0) {
+      Progress();
+      return false;
+    }
+    if (!location.raw) {
+      if (unlikely(compressed_reads_ == nullptr))
+        compressed_reads_ =
+            std::make_unique<CompressedReadPool>(offload_decompress_);
+      if ((mesg = compressed_reads_->Acquire()) == nullptr) {
+        Progress();
+        return false;
+      }
+    }
+    auto sqe = io_uring_get_sqe(&ring_);
+    assert(sqe != nullptr);
+    preparing_fds_.push_back(INVALID_FILE_HANDLE);  // 数据文件不随CloseFile关闭
+    if (location.raw) {
+      io_uring_prep_read(sqe, compressed.GetDataFd(), data, location.size,
+                         location.offset);
+      io_uring_sqe_set_data(sqe, finish);
+    } else {
+      mesg->Init(location, data, finish);
+      io_uring_prep_read(sqe, compressed.GetDataFd(), mesg->GetBuffer(),
+                         location.size, location.offset);
+      io_uring_sqe_set_data(sqe, mesg);
+    }
+    num_preparing_++;
+    return true;
+  }
+
+  // sqe按准备的顺序提交，提交之后内核持有文件的引用，释放最早的num个sqe的AcquireFile
+  void ReleaseSubmitted(size_t num) {
+    for (size_t idx = 0; idx < num; idx++) {
+      if (preparing_fds_.front() != INVALID_FILE_HANDLE)
+        disk_manager_->ReleaseFile(preparing_fds_.front());
+      preparing_fds_.pop_front();
+    }
+  }
+
+  // 压缩需要在提交之前完成，因此写入同步进行
+  bool WriteCompressed(CompressedFile& compressed, size_t offset,
+                       const char* data, AsyncMesg* finish) {
+    auto success = compressed.Write(offset, data, PAGE_SIZE_FILE);
+    if (!success)
+      GBPLOG << "failed to write a compressed page";
+    assert(success);
+    if (finish != nullptr)
+      finish->Post();
+    return true;
+  }
+
   io_uring ring_;
   io_uring_cqe* cqes_[IOURing_MAX_DEPTH];
   size_t num_preparing_;
   size_t num_processing_;
+  // 已经准备、还没有提交的sqe的文件（与num_preparing_一一对应）
+  std::deque<GBPfile_handle_type> preparing_fds_;
+  const bool offload_decompress_;
+  std::unique_ptr<CompressedReadPool> compressed_reads_;
 };
 
 class RWSysCall : public IOBackend {
@@ -395,16 +980,18 @@ class RWSysCall : public IOBackend {
   bool Write(size_t offset, std::string_view data, GBPfile_handle_type fd,
              AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
-#endif
-    auto ret = ::pwrite(disk_manager_->fd_oss_[fd].first, data.data(),
-                        data.size(), offset);
-#if ASSERT_ENABLE
-    assert(ret == data.size());  // check for I/O error
+    assert(disk_manager_->ValidFD(fd));
 #endif
-    ::fdatasync(disk_manager_->fd_oss_[fd]
-                    .first);  // needs to flush to keep disk file in sync
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
+    WriteSegments(fd, offset, data.data(), data.size());
+    // needs to flush to keep disk file in sync
+    disk_manager_->ForEachSegment(
+        fd, offset, data.size(),
+        [](OSfile_handle_type fd_os, size_t, size_t, size_t) {
+          ::fdatasync(fd_os);
+        });
+    disk_manager_->ReleaseFile(fd);
 
     if (finish != nullptr)
       ((AsyncMesg*) finish)->Post();
@@ -415,23 +1002,21 @@ class RWSysCall : public IOBackend {
   bool Write(size_t offset, const char* data, size_t size,
              GBPfile_handle_type fd, AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
+    assert(disk_manager_->ValidFD(fd));
 #endif
 
-    auto ret = ::pwrite(disk_manager_->fd_oss_[fd].first, data, size, offset);
-
-#if ASSERT_ENABLE
-    if (ret == -1) {
-      GBPLOG << "pwrite error: " << strerror(errno);
-    }
-    assert(ret != -1);  // check for I/O error
-#endif
-    if (unlikely(disk_manager_->file_size_inBytes_[fd] - offset < size))
-      disk_manager_->Resize(fd, disk_manager_->file_size_inBytes_[fd]);
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
+    WriteSegments(fd, offset, data, size);
+    if (unlikely(disk_manager_->GetFileSizeFast(fd) - offset < size))
+      disk_manager_->Resize(fd, disk_manager_->GetFileSizeFast(fd));
 
-    ::fdatasync(disk_manager_->fd_oss_[fd]
-                    .first);  // needs to flush to keep disk file in sync
+    // needs to flush to keep disk file in sync
+    disk_manager_->ForEachSegment(
+        fd, offset, size, [](OSfile_handle_type fd_os, size_t, size_t, size_t) {
+          ::fdatasync(fd_os);
+        });
+    disk_manager_->ReleaseFile(fd);
 
     if (finish != nullptr)
       ((AsyncMesg*) finish)->Post();
@@ -445,21 +1030,24 @@ class RWSysCall : public IOBackend {
   bool Write(size_t offset, ::iovec* io_info, GBPfile_handle_type fd,
              AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
+    assert(disk_manager_->ValidFD(fd));
 #endif
 
-    auto ret = ::pwrite(disk_manager_->fd_oss_[fd].first, io_info[0].iov_base,
-                        io_info[0].iov_len, offset);
-#if ASSERT_ENABLE
-    assert(ret != -1);  // check for I/O error
-#endif
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
+    WriteSegments(fd, offset, (const char*) io_info[0].iov_base,
+                  io_info[0].iov_len);
 
-    if (unlikely(disk_manager_->file_size_inBytes_[fd] - offset <
+    if (unlikely(disk_manager_->GetFileSizeFast(fd) - offset <
                  io_info[0].iov_len))
-      disk_manager_->Resize(fd, disk_manager_->file_size_inBytes_[fd]);
-    fsync(disk_manager_->fd_oss_[fd]
-              .first);  // needs to flush to keep disk file in sync
+      disk_manager_->Resize(fd, disk_manager_->GetFileSizeFast(fd));
+    // needs to flush to keep disk file in sync
+    disk_manager_->ForEachSegment(
+        fd, offset, io_info[0].iov_len,
+        [](OSfile_handle_type fd_os, size_t, size_t, size_t) {
+          fsync(fd_os);
+        });
+    disk_manager_->ReleaseFile(fd);
 
     if (finish != nullptr)
       ((AsyncMesg*) finish)->Post();
@@ -473,19 +1061,14 @@ class RWSysCall : public IOBackend {
   bool Read(size_t offset, std::string_view data, GBPfile_handle_type fd,
             AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
-    assert(offset <=
-           disk_manager_
-               ->file_size_inBytes_[fd]);  // check if read beyond file length
+    assert(disk_manager_->ValidFD(fd));
+    assert(offset <= disk_manager_->GetFileSizeFast(
+                         fd));  // check if read beyond file length
 #endif
-    auto ret = ::pread(disk_manager_->fd_oss_[fd].first, (void*) data.data(),
-                       data.size(), offset);
-
-    // if file ends before reading PAGE_SIZE
-    if (ret < data.size()) {
-      memset(const_cast<char*>(data.data()) + ret, 0, data.size() - ret);
-    }
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
+    ReadSegments(fd, offset, const_cast<char*>(data.data()), data.size());
+    disk_manager_->ReleaseFile(fd);
     if (finish != nullptr)
       ((AsyncMesg*) finish)->Post();
 
@@ -498,23 +1081,16 @@ class RWSysCall : public IOBackend {
   bool Read(size_t offset, char* data, size_t size, GBPfile_handle_type fd,
             AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
+    assert(disk_manager_->ValidFD(fd));
 
-    assert(offset <=
-           disk_manager_
-               ->file_size_inBytes_[fd]);  // check if read beyond file length
+    assert(offset <= disk_manager_->GetFileSizeFast(
+                         fd));  // check if read beyond file length
 #endif
 
-    auto ret = ::pread(disk_manager_->fd_oss_[fd].first, data, size, offset);
-
-#if ASSERT_ENABLE
-    assert(ret != -1);
-#endif
-
-    if (ret < size) {
-      memset(data + ret, 0, size - ret);
-    }
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
+    ReadSegments(fd, offset, data, size);
+    disk_manager_->ReleaseFile(fd);
     if (finish != nullptr)
       ((AsyncMesg*) finish)->Post();
     // disk_manager_->counts_[fd].first += 1;
@@ -529,37 +1105,53 @@ class RWSysCall : public IOBackend {
   bool Read(size_t offset, ::iovec* io_info, size_t io_count,
             GBPfile_handle_type fd, AsyncMesg* finish = nullptr) override {
 #if ASSERT_ENABLE
-    assert(fd < disk_manager_->fd_oss_.size() &&
-           disk_manager_->fd_oss_[fd].second);
-    assert(offset <=
-           disk_manager_
-               ->file_size_inBytes_[fd]);  // check if read beyond file length
+    assert(disk_manager_->ValidFD(fd));
+    assert(offset <= disk_manager_->GetFileSizeFast(
+                         fd));  // check if read beyond file length
 #endif
     const static size_t iovec_max = 512;
 
-    auto ret = ::preadv(disk_manager_->fd_oss_[fd].first, io_info,
-                        std::min(io_count, (size_t) iovec_max), offset);
+    if (unlikely(!disk_manager_->AcquireFile(fd)))
+      return ClosedFile(fd, finish);
+    // 条带化时相邻的页可能位于不同的backing file，逐个iovec读取
+    if (disk_manager_->GetStripeNum(fd) > 1) {
+      for (size_t idx = 0; idx < io_count; idx++) {
+        auto [fd_os, offset_os] = disk_manager_->Translate(fd, offset);
+        auto ret = ::pread(fd_os, io_info[idx].iov_base, io_info[idx].iov_len,
+                           offset_os);
+        if (unlikely(ret == -1))
+          GBPLOG << "pread error: " << strerror(errno);
+        assert(ret != -1);
+        offset += io_info[idx].iov_len;
+      }
+      disk_manager_->ReleaseFile(fd);
+      if (finish != nullptr)
+        ((AsyncMesg*) finish)->Post();
+      return true;
+    }
 
-#if ASSERT_ENABLE
+    auto ret = ::preadv(disk_manager_->GetFileDescriptor(fd), io_info,
+                        std::min(io_count, (size_t) iovec_max), offset);
+    if (unlikely(ret == -1))
+      GBPLOG << "preadv error: " << strerror(errno);
     assert(ret != -1);
-#endif
     if (unlikely(io_count > iovec_max)) {
       io_count -= iovec_max;
       io_info += iovec_max;
       size_t size_cur = 0;
       while (io_count > 0) {
         size_cur = std::min(io_count, (size_t) iovec_max);
-        ret = ::preadv(disk_manager_->fd_oss_[fd].first, io_info, size_cur,
+        ret = ::preadv(disk_manager_->GetFileDescriptor(fd), io_info, size_cur,
                        offset);
-
-#if ASSERT_ENABLE
+        if (unlikely(ret == -1))
+          GBPLOG << "preadv error: " << strerror(errno);
         assert(ret != -1);
-#endif
 
         io_count -= size_cur;
         io_info += size_cur;
       }
     }
+    disk_manager_->ReleaseFile(fd);
 
     // if file ends before reading PAGE_SIZE
     // if (ret < PAGE_SIZE_FILE) {
@@ -572,6 +1164,37 @@ class RWSysCall : public IOBackend {
   }
 
   bool Progress() override { return true; }
+
+ private:
+  // 条带化时[offset, offset + size)可能跨越chunk，按段读取（见DiskManager::ForEachSegment），
+  // 文件在段内结束时（if file ends before reading PAGE_SIZE）其余部分填0
+  void ReadSegments(GBPfile_handle_type fd, size_t offset, char* data,
+                    size_t size) {
+    disk_manager_->ForEachSegment(
+        fd, offset, size,
+        [data](OSfile_handle_type fd_os, size_t offset_os, size_t pos,
+               size_t len) {
+          auto ret = ::pread(fd_os, data + pos, len, offset_os);
+          if (unlikely(ret == -1))
+            GBPLOG << "pread error: " << strerror(errno);
+          assert(ret != -1);
+          if (ret >= 0 && (size_t) ret < len)
+            memset(data + pos + ret, 0, len - ret);
+        });
+  }
+
+  void WriteSegments(GBPfile_handle_type fd, size_t offset, const char* data,
+                     size_t size) {
+    disk_manager_->ForEachSegment(
+        fd, offset, size,
+        [data](OSfile_handle_type fd_os, size_t offset_os, size_t pos,
+               size_t len) {
+          auto ret = ::pwrite(fd_os, data + pos, len, offset_os);
+          if (unlikely(ret != (ssize_t) len))
+            GBPLOG << "pwrite error: " << strerror(errno);
+          assert(ret == (ssize_t) len);  // check for I/O error
+        });
+  }
 };
 
 }  // namespace gbp
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <pthread.h>
 #include <xmmintrin.h>
 #include <boost/circular_buffer.hpp>
+#include <boost/container/small_vector.hpp>
 #include <boost/fiber/all.hpp>
 #include <cstddef>
 #include <cstdint>
@@ -18,6 +19,9 @@
 #include <vector>
 
 #include <boost/lockfree/queue.hpp>
+#include <chrono>
+#include <deque>
+#include <memory>
 
 #include "config.h"
 #include "io_backend.h"
@@ -25,16 +29,43 @@
 
 namespace gbp {
 
-class IOServer {
+enum class IOPriority : uint8_t {
+  Foreground = 0,  // 前台缺页读
+  WriteBack = 1,   // 淘汰/Flush的写回
+  Bulk = 2,        // WarmUp、LoadFile、warm restart等批量装入
+};
+
+/**
+ * 在作用域内设置当前线程提交的I/O的默认优先级（SendRequest未显式指定优先级时使用）
+ */
+class IOPriorityScope {
+ public:
+  explicit IOPriorityScope(IOPriority priority) : prev_(Current()) {
+    Current() = priority;
+  }
+  ~IOPriorityScope() { Current() = prev_; }
+
+  static IOPriority& Current() {
+    thread_local IOPriority priority = IOPriority::Foreground;
+    return priority;
+  }
+
+ private:
+  IOPriority prev_;
+};
+
+class IOServer : public MagazineOwner {
  public:
   struct context_type {
-    context_type() : state(State::Commit) { finish = new AsyncMesg1(); }
-    ~context_type() { delete finish; }
+    context_type() : state(State::Commit), finish(&finish_inline) {}
+    context_type(const context_type&) = delete;
+    ~context_type() = default;
     void Reset() {
       finish->Reset();
       state = State::Commit;
     }
     enum class State { Commit, Poll, End } state;
+    AsyncMesg1 finish_inline;  // 内联存储，避免每个请求都new一个AsyncMesg
     AsyncMesg* finish;
   };
 
@@ -49,7 +80,7 @@ class IOServer {
       fd = _fd;
       finish = _finish;
       read = _read;
-      io_vec.swap(_io_vec);
+      io_vec.assign(_io_vec.begin(), _io_vec.end());
 
       async_context.Reset();
     }
@@ -72,7 +103,9 @@ class IOServer {
       async_context.Reset();
     }
 
-    std::vector<::iovec> io_vec;
+    boost::container::small_vector<::iovec, 1> io_vec;
+    IOPriority priority = IOPriority::Foreground;
+    std::chrono::steady_clock::time_point enqueue_time;
     size_t io_vec_size;
     size_t file_offset;
     size_t file_size;
@@ -82,18 +115,94 @@ class IOServer {
     AsyncMesg* finish;
   };
 
+  /**
+   * IOServer线程上的请求调度，不加锁，单独拿出来以便测试
+   * 1. 每一级一个本地FIFO队列，Schedule按优先级从高到低选择
+   * 2. 如果有后台请求等待超过了该级的deadline，优先处理等待最久的那个
+   * 3. 任何时候（包括被提升时）每一级的在途请求数都不超过其上限：
+   * 后台请求最多占用IO_PRIORITY_INFLIGHT_LIMIT[1] + IO_PRIORITY_INFLIGHT_LIMIT[2]个slot，
+   * 其余slot始终留给前台请求
+   */
+  class Scheduler {
+   public:
+    FORCE_INLINE bool Full(IOPriority priority) const {
+      return pending_requests_[(size_t) priority].size() >=
+             IO_SERVER_CHANNEL_SIZE;
+    }
+
+    FORCE_INLINE void Push(async_SSD_IO_request_type* req) {
+      pending_requests_[(size_t) req->priority].push_back(req);
+    }
+
+    async_SSD_IO_request_type* Schedule(
+        std::chrono::steady_clock::time_point now) {
+      size_t level_selected = IO_PRIORITY_NUM;
+      std::chrono::steady_clock::duration overdue_max{0};
+      for (size_t level = 1; level < IO_PRIORITY_NUM; level++) {
+        if (!Schedulable(level))
+          continue;
+        auto overdue = now - pending_requests_[level].front()->enqueue_time -
+                       std::chrono::microseconds(
+                           IO_PRIORITY_DEADLINE_MICROSECOND[level]);
+        if (overdue > overdue_max) {
+          overdue_max = overdue;
+          level_selected = level;
+        }
+      }
+      if (level_selected == IO_PRIORITY_NUM) {
+        for (size_t level = 0; level < IO_PRIORITY_NUM; level++) {
+          if (Schedulable(level)) {
+            level_selected = level;
+            break;
+          }
+        }
+      }
+      if (level_selected == IO_PRIORITY_NUM)
+        return nullptr;
+
+      auto req = pending_requests_[level_selected].front();
+      pending_requests_[level_selected].pop_front();
+      num_inflight_[level_selected]++;
+      return req;
+    }
+
+    // 请求完成之后调用
+    FORCE_INLINE void Complete(IOPriority priority) {
+      num_inflight_[(size_t) priority]--;
+    }
+
+    FORCE_INLINE size_t GetInflightNum(IOPriority priority) const {
+      return num_inflight_[(size_t) priority];
+    }
+
+   private:
+    FORCE_INLINE bool Schedulable(size_t level) const {
+      return !pending_requests_[level].empty() &&
+             num_inflight_[level] < IO_PRIORITY_INFLIGHT_LIMIT[level];
+    }
+
+    std::deque<async_SSD_IO_request_type*> pending_requests_[IO_PRIORITY_NUM];
+    size_t num_inflight_[IO_PRIORITY_NUM] = {};
+  };
+
   IOServer(DiskManager* disk_manager)
-      : request_channel_(), num_async_fiber_processing_(0), stop_(false) {
+      : disk_manager_(disk_manager),
+        request_channels_(),
+        num_async_fiber_processing_(0),
+        stop_(false) {
     sync_io_backend_ = new RWSysCall(disk_manager);
     if constexpr (IO_BACKEND_TYPE == 2) {
-      async_io_backend_ = new IOURing(disk_manager);
+      // IOServer线程服务所有请求，压缩的页交给单独的线程解压
+      async_io_backend_ = new IOURing(disk_manager, IO_SERVER_ENABLE);
       if constexpr (IO_SERVER_ENABLE)
         server_ = std::thread([this]() { Run(); });
     } else if constexpr (IO_BACKEND_TYPE != 1) {
       assert(false);
     }
+    MagazineSlots::GetInstance().Register(this);
   }
   ~IOServer() {
+    MagazineSlots::GetInstance().Unregister(this);
     stop_ = true;
     if (server_.joinable())
       server_.join();
@@ -108,19 +217,78 @@ class IOServer {
    * @param buf 缓冲区
    * @param finish 完成消息
    * @param is_read 是否读取
+   * @param priority 优先级
    * @param blocked 若为true，则阻塞式发送请求，否则非阻塞式发送请求
    */
   bool SendRequest(GBPfile_handle_type fd, size_t offset, size_t size,
                    char* buf, AsyncMesg* finish, bool is_read = true,
+                   IOPriority priority = IOPriorityScope::Current(),
                    bool blocked = true) {
 #if ASSERT_ENABLE
     assert(buf != nullptr);
 #endif
     async_SSD_IO_request_type* req = new async_SSD_IO_request_type();
     req->Init(buf, PAGE_SIZE_FILE, offset, size, fd, finish, is_read);
+    req->priority = priority;
     return SendRequest(req, blocked);
   }
 
+  /**
+   * per-worker io_uring（IO_LOCAL_RING_ENABLE）
+   * 1. 调用线程把请求直接提交到自己的ring上，并在等待时自己回收completion，
+   * 不需要分配请求对象，也没有跨线程的队列与忙等的IOServer线程
+   * 2. ring属于IOServer（绑定它的DiskManager），按MagazineSlots分配的线程槽位存放，
+   * 同一个线程使用多个IOServer时各有各的ring；线程退出时释放它的ring，IOServer析构时释放全部
+   * 3. 槽位被占满的线程没有ring，在调用线程上同步完成I/O
+   */
+  FORCE_INLINE IOURing* GetLocalRing() {
+    auto slot = MagazineSlots::GetSlot();
+    if (unlikely(slot == MagazineSlots::INVALID_SLOT))
+      return nullptr;
+    auto& ring = local_rings_[slot];
+    if (unlikely(ring == nullptr))
+      ring = std::make_unique<IOURing>(disk_manager_);
+    return ring.get();
+  }
+
+  void SubmitLocal(GBPfile_handle_type fd, size_t offset, char* buf,
+                   size_t buf_size, AsyncMesg* finish, bool is_read = true) {
+    auto ring = GetLocalRing();
+    if (unlikely(ring == nullptr)) {
+      bool ret;
+      if (auto compressed = disk_manager_->GetCompressedFile(fd))
+        ret = is_read ? compressed->Read(offset, buf, buf_size)
+                      : compressed->Write(offset, buf, buf_size);
+      else
+        ret = is_read ? sync_io_backend_->Read(offset, buf, buf_size, fd)
+                      : sync_io_backend_->Write(offset, buf, buf_size, fd);
+      assert(ret);
+      finish->Post();
+      return;
+    }
+    if (is_read) {
+      while (!ring->Read(offset, buf, buf_size, fd, finish))
+        ;  // ring满时Read内部会调用Progress回收completion
+    } else {
+      while (!ring->Write(offset, buf, buf_size, fd, finish))
+        ;
+    }
+    ring->Progress();  // 立即提交
+  }
+
+  FORCE_INLINE void WaitLocal(AsyncMesg* finish) {
+    auto ring = GetLocalRing();
+    if (unlikely(ring == nullptr)) {  // 没有ring时SubmitLocal已经同步完成
+      assert(finish->TryWait());
+      return;
+    }
+    while (!finish->TryWait())
+      ring->Progress();
+  }
+
+  // 槽位的拥有者线程退出时调用（在该线程上），释放它的ring
+  void Drain(uint32_t slot) override { local_rings_[slot].reset(); }
+
   bool ProcessFunc(async_SSD_IO_request_type& req) {
     switch (req.async_context.state) {
     case context_type::State::Commit: {  // 将read request提交至io_uring
@@ -175,16 +343,31 @@ class IOServer {
     if (unlikely(req == nullptr))
       return false;
 
+    req->enqueue_time = std::chrono::steady_clock::now();
+    auto& channel = request_channels_[(size_t) req->priority];
     if (likely(blocked))
-      while (!request_channel_.push(req))
+      while (!channel.push(req))
         ;
     else {
-      return request_channel_.push(req);
+      return channel.push(req);
     }
 
     return true;
   }
 
+  /**
+   * 选择下一个要处理的请求：先把各级channel中的请求取到本地队列中（保持FIFO），再由scheduler_选择
+   */
+  async_SSD_IO_request_type* Schedule() {
+    async_SSD_IO_request_type* req;
+    for (size_t level = 0; level < IO_PRIORITY_NUM; level++) {
+      while (!scheduler_.Full((IOPriority) level) &&
+             request_channels_[level].pop(req))
+        scheduler_.Push(req);
+    }
+    return scheduler_.Schedule(std::chrono::steady_clock::now());
+  }
+
   void Run() {
     {
       boost::circular_buffer<std::optional<async_SSD_IO_request_type*>>
@@ -196,16 +379,17 @@ class IOServer {
       while (true) {
         for (auto& req : async_requests) {
           if (!req.has_value()) {
-            if (request_channel_.pop(async_request)) {
+            if ((async_request = Schedule()) != nullptr) {
               req.emplace(async_request);
             } else {
               continue;
             }
           }
           if (ProcessFunc(*req.value())) {
+            scheduler_.Complete(req.value()->priority);
             req.value()->finish->Post();
             delete req.value();
-            if (request_channel_.pop(async_request)) {
+            if ((async_request = Schedule()) != nullptr) {
               req.emplace(async_request);
             } else
               req.reset();
@@ -218,10 +402,15 @@ class IOServer {
     }
   }
 
+  DiskManager* disk_manager_;
   std::thread server_;
+  // 每个槽位只被占用它的线程访问
+  std::unique_ptr<IOURing> local_rings_[FREE_LIST_MAGAZINE_NUM];
   boost::lockfree::queue<async_SSD_IO_request_type*,
                          boost::lockfree::capacity<IO_SERVER_CHANNEL_SIZE>>
-      request_channel_;
+      request_channels_[IO_PRIORITY_NUM];
+  // 以下成员只被IOServer线程访问
+  Scheduler scheduler_;
   size_t num_async_fiber_processing_;
   bool stop_;
 };
@@ -14,6 +14,7 @@
 
 #pragma once
 #include <sys/mman.h>
+#include <unistd.h>
 #include <algorithm>
 #include <boost/dynamic_bitset.hpp>
 #include <cassert>
@@ -33,7 +34,16 @@ class MemoryPool {
  public:
   MemoryPool() : num_pages_(0), need_free_(false), pool_(nullptr) {};
   MemoryPool(mpage_id_type num_pages) : num_pages_(num_pages) {
-#if ALIGNED_ALLOC
+#if UFFD_REGION_ENABLE
+    // 帧需要能以MAP_SHARED的方式映射到UffdRegion中，因此来自memfd
+    memfd_ = ::memfd_create("gbp_memory_pool", MFD_CLOEXEC);
+    assert(memfd_ != -1);
+    if (::ftruncate(memfd_, PAGE_SIZE_MEMORY * num_pages_) != 0)
+      assert(false);
+    pool_ = (char*) ::mmap(nullptr, PAGE_SIZE_MEMORY * num_pages_,
+                           PROT_READ | PROT_WRITE, MAP_SHARED, memfd_, 0);
+    assert(pool_ != MAP_FAILED);
+#elif ALIGNED_ALLOC
     pool_ = (char*) ::aligned_alloc(PAGE_SIZE_MEMORY,PAGE_SIZE_MEMORY * num_pages_);
 #elif NUMA_SINGLE_NODE
     pool_ = (char*)numa_alloc_onnode(PAGE_SIZE_MEMORY * num_pages_, 2); // 分配在numa node 2上
@@ -99,7 +109,12 @@ class MemoryPool {
 
   ~MemoryPool() {
     if (need_free_) {
+#if UFFD_REGION_ENABLE
+      ::munmap(pool_, PAGE_SIZE_MEMORY * num_pages_);
+      ::close(memfd_);
+#else
       LBFree(pool_);
+#endif
     }
   }
 
@@ -133,12 +148,15 @@ class MemoryPool {
 #endif
   mpage_id_type GetSize() const { return num_pages_; }
   FORCE_INLINE char* GetPool() const { return pool_; }
+  // UFFD_REGION_ENABLE时有效，整个帧池（而不是子池）在memfd中的偏移从0开始
+  FORCE_INLINE int GetMemfd() const { return memfd_; }
 
  private:
   void Move(MemoryPool& dst) const {
     dst.num_pages_ = num_pages_;
     dst.pool_ = pool_;
     dst.need_free_ = need_free_;
+    dst.memfd_ = memfd_;
 
     const_cast<MemoryPool&>(*this).need_free_ = false;
     const_cast<MemoryPool&>(*this).pool_ = nullptr;
@@ -150,5 +168,6 @@ class MemoryPool {
 #endif
   char* pool_ = nullptr;
   bool need_free_ = false;
+  int memfd_ = -1;
 };
 }  // namespace gbp
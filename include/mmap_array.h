@@ -191,7 +191,9 @@ class mmap_array {
             size_t chunk_size = 4096) {
     chunk_size_ = chunk_size;
     item_size_ = item_size;
-    OBJ_NUM_PERPAGE = gbp::PAGE_SIZE_FILE / item_size_;
+    // 大于一个页的obj从页边界开始，占用连续的PAGE_NUM_PEROBJ个页
+    OBJ_NUM_PERPAGE = std::max<size_t>(gbp::PAGE_SIZE_FILE / item_size_, 1);
+    PAGE_NUM_PEROBJ = gbp::ceil(item_size_, gbp::PAGE_SIZE_FILE);
     reset();
     filename_ = filename;
     read_only_ = read_only;
@@ -210,8 +212,9 @@ class mmap_array {
                                                O_RDWR | O_CREAT | FILE_FLAG);
     }
     size_t file_size = std::filesystem::file_size(filename);
-    size_ = (file_size / gbp::PAGE_SIZE_FILE) * OBJ_NUM_PERPAGE +
-            (file_size % gbp::PAGE_SIZE_FILE) / item_size_;
+    const size_t chunk_size_in_byte = PAGE_NUM_PEROBJ * gbp::PAGE_SIZE_FILE;
+    size_ = (file_size / chunk_size_in_byte) * OBJ_NUM_PERPAGE +
+            (file_size % chunk_size_in_byte) / item_size_;
   }
 #endif
 
@@ -309,8 +312,7 @@ class mmap_array {
             << "cannot resize read-only mmap_array to larger size than file";
       }
     } else {
-      size_t file_size_new = (size % OBJ_NUM_PERPAGE) * item_size_ +
-                             (size / OBJ_NUM_PERPAGE) * gbp::PAGE_SIZE_MEMORY;
+      size_t file_size_new = get_file_offset(size);
       // GBPLOG << filename_ << " resize " << size << " " << file_size_new << "
       // "
       //        << OBJ_NUM_PERPAGE << " " << item_size_;
@@ -360,14 +362,30 @@ class mmap_array {
                                    idx * item_size_, len * item_size_, fd_gbp_,
                                    false);
   }
+  // 批量设置[idx, idx + len)个obj，obj不跨页，因此每个页面调用一次SetBlock
+  void set_batch(size_t idx, std::string_view val, size_t len) {
+#if ASSERT_ENABLE
+    assert(idx + len <= size_);
+    assert(item_size_ * len == val.size());
+#endif
+    const char* buf = val.data();
+    while (len != 0) {
+      size_t obj_num = std::min(len, OBJ_NUM_PERPAGE - idx % OBJ_NUM_PERPAGE);
+      const size_t file_offset = get_file_offset(idx);
+      buffer_pool_manager_->SetBlock(buf, file_offset, obj_num * item_size_,
+                                     fd_gbp_, false);
+      buf += obj_num * item_size_;
+      idx += obj_num;
+      len -= obj_num;
+    }
+  }
   // 设置单个obj的某一部分
   void set_partial(size_t idx, size_t offset_in_item, std::string_view val) {
 #if ASSERT_ENABLE
     assert(idx < size_);
     assert(item_size_ >= offset_in_item + val.size());
 #endif
-    const size_t file_offset = idx / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_FILE +
-                               (idx % OBJ_NUM_PERPAGE) * item_size_;
+    const size_t file_offset = get_file_offset(idx);
     buffer_pool_manager_->SetBlock(reinterpret_cast<const char*>(val.data()),
                                    file_offset + offset_in_item, val.size(),
                                    fd_gbp_, false);
@@ -378,23 +396,11 @@ class mmap_array {
     assert(idx + len <= size_);
 #endif
 
-    size_t buf_size = 0;
-    // size_t num_page = 0;
-    const size_t file_offset = idx / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_FILE +
-                               (idx % OBJ_NUM_PERPAGE) * item_size_;
-
-    size_t rest_filelen_firstpage =
-        gbp::PAGE_SIZE_MEMORY - file_offset % gbp::PAGE_SIZE_MEMORY;
-    if (rest_filelen_firstpage > len * item_size_) {
-      buf_size += item_size_ * len;
-      // num_page = 1;
-    } else {
-      buf_size += rest_filelen_firstpage;
-      len -= rest_filelen_firstpage / item_size_;
-      buf_size += len / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_MEMORY +
-                  len % OBJ_NUM_PERPAGE * item_size_;
-      // num_page = 1 + CEIL(len, OBJ_NUM_PERPAGE);
-    }
+    const size_t file_offset = get_file_offset(idx);
+    // 包括中间各页末尾不足一个obj的空隙
+    const size_t buf_size =
+        len == 0 ? 0
+                 : get_file_offset(idx + len - 1) + item_size_ - file_offset;
 
     return buffer_pool_manager_->GetBlockSync(file_offset, buf_size, fd_gbp_);
   }
@@ -403,48 +409,37 @@ class mmap_array {
                                      size_t len_in_byte) const {
 #if ASSERT_ENABLE
     assert(idx < size_);
+    assert(offset_in_item + len_in_byte <= item_size_);
 #endif
-
-    size_t buf_size = 0;
-    // size_t num_page = 0;
-    const size_t file_offset = idx / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_FILE +
-                               (idx % OBJ_NUM_PERPAGE) * item_size_;
-
-    size_t rest_filelen_firstpage =
-        gbp::PAGE_SIZE_MEMORY - file_offset % gbp::PAGE_SIZE_MEMORY;
-    if (rest_filelen_firstpage - offset_in_item >= len_in_byte) {
-      buf_size += len_in_byte;
-      // num_page = 1;
-    } else {
-      assert(false);
-    }
+    // 大于一个页的obj中，请求的部分可能跨页，此时返回多页的BufferBlock
+    const size_t file_offset = get_file_offset(idx);
     return buffer_pool_manager_->GetBlockSync(file_offset + offset_in_item,
-                                              buf_size, fd_gbp_);
+                                              len_in_byte, fd_gbp_);
   }
 
-  const std::future<gbp::BufferBlock> get_async(size_t idx,
+  // vmcache模式（VM_CACHE_ENABLE）下直接返回指向数据的指针，布局与get相同
+  gbp::VMCache::Guard get_vm(size_t idx, size_t len = 1) const {
+#if ASSERT_ENABLE
+    assert(idx + len <= size_);
+#endif
+    const size_t file_offset = get_file_offset(idx);
+    const size_t buf_size =
+        len == 0 ? 0
+                 : get_file_offset(idx + len - 1) + item_size_ - file_offset;
+    return buffer_pool_manager_->GetBlockVM(file_offset, buf_size, fd_gbp_);
+  }
+
+  gbp::AsyncFuture<gbp::BufferBlock> get_async(size_t idx,
                                                 size_t len = 1) const {
 #if ASSERT_ENABLE
     assert(idx + len <= size_);
 #endif
     assert(false);
-    size_t buf_size = 0;
-    // size_t num_page = 0;
-    const size_t file_offset = idx / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_FILE +
-                               (idx % OBJ_NUM_PERPAGE) * item_size_;
-
-    size_t rest_filelen_firstpage =
-        gbp::PAGE_SIZE_MEMORY - file_offset % gbp::PAGE_SIZE_MEMORY;
-    if (rest_filelen_firstpage > len * item_size_) {
-      buf_size += item_size_ * len;
-      // num_page = 1;
-    } else {
-      buf_size += rest_filelen_firstpage;
-      len -= rest_filelen_firstpage / item_size_;
-      buf_size += len / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_MEMORY +
-                  len % OBJ_NUM_PERPAGE * item_size_;
-      // num_page = 1 + CEIL(len, OBJ_NUM_PERPAGE);
-    }
+    const size_t file_offset = get_file_offset(idx);
+    // 包括中间各页末尾不足一个obj的空隙
+    const size_t buf_size =
+        len == 0 ? 0
+                 : get_file_offset(idx + len - 1) + item_size_ - file_offset;
     auto ret =
         buffer_pool_manager_->GetBlockAsync(file_offset, buf_size, fd_gbp_);
 
@@ -480,8 +475,14 @@ class mmap_array {
 
   gbp::GBPfile_handle_type filehandle() const { return fd_gbp_; }
   size_t get_size_in_byte() const {
-    return (size_ % OBJ_NUM_PERPAGE) * item_size_ +
-           (size_ / OBJ_NUM_PERPAGE) * gbp::PAGE_SIZE_MEMORY;
+    return get_file_offset(size_);
+  }
+  size_t get_item_size() const { return item_size_; }
+
+  // obj在文件中的偏移量：不大于一个页的obj不跨页；大于一个页的obj从页边界开始
+  FORCE_INLINE size_t get_file_offset(size_t idx) const {
+    return idx / OBJ_NUM_PERPAGE * PAGE_NUM_PEROBJ * gbp::PAGE_SIZE_FILE +
+           (idx % OBJ_NUM_PERPAGE) * item_size_;
   }
 #endif
 
@@ -522,6 +523,7 @@ class mmap_array {
   size_t chunk_size_;
   size_t item_size_;
   uint16_t OBJ_NUM_PERPAGE;
+  size_t PAGE_NUM_PEROBJ = 1;
 #endif
 };
 }  // namespace gbp
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "config.h"
+
+namespace gbp {
+
+/**
+ * 页面压缩（LZ4 block格式）
+ * 1. 输出与LZ4_compress_default兼容，可以用LZ4_decompress_safe解压，之后可以直接替换为liblz4
+ * 2. 单个输入不超过64KB，因此hash表中只需要保存16位的位置
+ * 3. Compress在输出超过dst_capacity时返回0（调用者按不可压缩处理），
+ * Decompress对非法输入返回0，不会越界读写
+ */
+class PageCompressor {
+  constexpr static size_t MIN_MATCH = 4;
+  constexpr static size_t LAST_LITERALS = 5;  // 最后5个字节必须是literal
+  constexpr static size_t MF_LIMIT = 12;  // 距离结尾不足12个字节时不再查找match
+  constexpr static size_t HASH_LOG = 12;
+  constexpr static size_t MAX_INPUT_SIZE = 1LU << 16;
+
+ public:
+  static size_t Compress(const char* src, size_t src_size, char* dst,
+                         size_t dst_capacity) {
+#if ASSERT_ENABLE
+    assert(src_size < MAX_INPUT_SIZE);
+#endif
+    uint16_t hash_table[1LU << HASH_LOG] = {0};
+    auto ip = (const uint8_t*) src;
+    auto anchor = ip;
+    auto const src_end = ip + src_size;
+    auto op = (uint8_t*) dst;
+    auto const dst_end = op + dst_capacity;
+
+    if (src_size >= MF_LIMIT + 1) {
+      auto const mf_limit = src_end - MF_LIMIT;
+      auto const match_limit = src_end - LAST_LITERALS;
+      while (ip < mf_limit) {
+        auto seq = Read32(ip);
+        auto& slot = hash_table[Hash(seq)];
+        auto match = (const uint8_t*) src + slot;
+        slot = ip - (const uint8_t*) src;
+        if (match >= ip || Read32(match) != seq) {
+          ip++;
+          continue;
+        }
+
+        auto ip_end = ip + MIN_MATCH;
+        match += MIN_MATCH;
+        while (ip_end < match_limit && *ip_end == *match) {
+          ip_end++;
+          match++;
+        }
+        op = EmitSequence(op, dst_end, anchor, ip - anchor, ip_end - match,
+                          ip_end - ip);
+        if (op == nullptr)
+          return 0;
+        ip = anchor = ip_end;
+      }
+    }
+
+    // 最后一个sequence只有literal
+    op = EmitSequence(op, dst_end, anchor, src_end - anchor, 0, 0);
+    return op == nullptr ? 0 : op - (uint8_t*) dst;
+  }
+
+  static size_t Decompress(const char* src, size_t src_size, char* dst,
+                           size_t dst_capacity) {
+    auto ip = (const uint8_t*) src;
+    auto const src_end = ip + src_size;
+    auto op = (uint8_t*) dst;
+    auto const dst_end = op + dst_capacity;
+
+    while (ip < src_end) {
+      uint8_t token = *ip++;
+      size_t literal_len = token >> 4;
+      if (literal_len == 15 && !ReadLength(ip, src_end, literal_len))
+        return 0;
+      if (literal_len > (size_t) (src_end - ip) ||
+          literal_len > (size_t) (dst_end - op))
+        return 0;
+      ::memcpy(op, ip, literal_len);
+      ip += literal_len;
+      op += literal_len;
+      if (ip == src_end)
+        break;
+
+      if (src_end - ip < 2)
+        return 0;
+      size_t offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (offset == 0 || offset > (size_t) (op - (uint8_t*) dst))
+        return 0;
+      size_t match_len = token & 15;
+      if (match_len == 15 && !ReadLength(ip, src_end, match_len))
+        return 0;
+      match_len += MIN_MATCH;
+      if (match_len > (size_t) (dst_end - op))
+        return 0;
+
+      auto match = op - offset;
+      if (offset >= match_len) {
+        ::memcpy(op, match, match_len);
+        op += match_len;
+      } else {
+        // 重叠的match（例如连续重复的字节）只能逐字节复制
+        while (match_len--)
+          *op++ = *match++;
+      }
+    }
+    return op - (uint8_t*) dst;
+  }
+
+ private:
+  FORCE_INLINE static uint32_t Read32(const uint8_t* p) {
+    uint32_t ret;
+    ::memcpy(&ret, p, sizeof(ret));
+    return ret;
+  }
+
+  FORCE_INLINE static size_t Hash(uint32_t seq) {
+    return (seq * 2654435761U) >> (32 - HASH_LOG);
+  }
+
+  FORCE_INLINE static bool ReadLength(const uint8_t*& ip,
+                                      const uint8_t* src_end, size_t& len) {
+    uint8_t byte;
+    do {
+      if (ip == src_end)
+        return false;
+      byte = *ip++;
+      len += byte;
+    } while (byte == 255);
+    return true;
+  }
+
+  FORCE_INLINE static uint8_t* WriteLength(uint8_t* op, size_t len) {
+    for (; len >= 255; len -= 255)
+      *op++ = 255;
+    *op++ = len;
+    return op;
+  }
+
+  // match_len为0时表示最后一个sequence，空间不足时返回nullptr
+  static uint8_t* EmitSequence(uint8_t* op, const uint8_t* dst_end,
+                               const uint8_t* literals, size_t literal_len,
+                               size_t offset, size_t match_len) {
+    size_t need = 1 + literal_len / 255 + 1 + literal_len +
+                  (match_len == 0 ? 0 : 2 + match_len / 255 + 1);
+    if (need > (size_t) (dst_end - op))
+      return nullptr;
+
+    auto token = op++;
+    *token = (literal_len >= 15 ? 15 : literal_len) << 4;
+    if (literal_len >= 15)
+      op = WriteLength(op, literal_len - 15);
+    ::memcpy(op, literals, literal_len);
+    op += literal_len;
+    if (match_len == 0)
+      return op;
+
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    match_len -= MIN_MATCH;
+    *token |= match_len >= 15 ? 15 : match_len;
+    if (match_len >= 15)
+      op = WriteLength(op, match_len - 15);
+    return op;
+  }
+};
+
+}  // namespace gbp
@@ -43,7 +43,8 @@ class ListArray {
     if (nodeIndex >= capacity_)
       return false;
 
-    removeNode(nodeIndex);
+    if (!removeNode(nodeIndex))
+      size_++;
     addNodeToFront(nodeIndex);
     return true;
   }
@@ -54,7 +55,8 @@ class ListArray {
       return false;
 
     nodes_[nodeIndex] = value;
-    removeNode(nodeIndex);
+    if (!removeNode(nodeIndex))
+      size_++;
     addNodeToFront(nodeIndex);
 
     return true;
@@ -65,8 +67,8 @@ class ListArray {
     if (nodeIndex >= capacity_)
       return false;
 
-    removeNode(nodeIndex);
-    size_--;
+    if (removeNode(nodeIndex))
+      size_--;
 
     return true;
   }
@@ -77,7 +79,8 @@ class ListArray {
       throw std::out_of_range("Position out of range");
 
     index_type nodeIndex = getNodeAt(head_, pos);
-    removeNode(nodeIndex);
+    if (removeNode(nodeIndex))
+      size_--;
   }
 
   FORCE_INLINE value_type getNodeValAt(index_type pos) {
@@ -129,6 +132,7 @@ class ListArray {
     nodes_[head_].prev = nodes_[tail_].next = INVALID_INDEX;
     nodes_[head_].next = tail_;
     nodes_[tail_].prev = head_;
+    size_ = 0;
     return true;
   }
 
@@ -140,11 +144,11 @@ class ListArray {
   ListNode* nodes_;
   size_t size_ = 0;
 
-  // 移除指定节点
+  // 移除指定节点，节点不在链表中时返回false（size_由调用者维护）
   bool removeNode(index_type nodeIndex) {
     if (nodes_[nodeIndex].next == INVALID_INDEX ||
         nodes_[nodeIndex].prev == INVALID_INDEX)
-      return true;
+      return false;
     nodes_[nodes_[nodeIndex].prev].next = nodes_[nodeIndex].next;
     nodes_[nodes_[nodeIndex].next].prev = nodes_[nodeIndex].prev;
     nodes_[nodeIndex].next = nodes_[nodeIndex].prev = INVALID_INDEX;
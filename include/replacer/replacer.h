@@ -32,6 +32,10 @@ class Replacer {
   }
   virtual bool Erase(T value) = 0;
   virtual size_t Size() const = 0;
+  // 按热度从高到低返回所有被管理的值（用于warm restart），不支持时返回false
+  virtual bool GetHotnessOrder(std::vector<T>& /* values */) const {
+    return false;
+  }
   std::atomic<bool>& GetFinishMark() { return finish_mark_async_; }
 
   virtual size_t GetMemoryUsage() const = 0;
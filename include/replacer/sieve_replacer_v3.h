@@ -262,6 +262,27 @@ class SieveReplacer_v3 : public Replacer<mpage_id_type> {
     return list_.size();
   }
 
+  /**
+   * 先是被访问过的页，再是未被访问过的页，二者内部按照从新到旧的顺序
+   * 1. 总是持有latch_复制顺序（很少调用），与加锁的Insert/Victim/Erase互斥
+   * 2. EVICTION_SYNC_ENABLE为false时其它操作不加锁，结果只是尽力而为的快照：
+   * 最多走capacity_步，遇到不是页的节点（head/tail或者被并发摘下的节点）就停止，可能遗漏或重复
+   */
+  bool GetHotnessOrder(std::vector<mpage_id_type>& values) const override {
+    std::lock_guard<std::mutex> lck(latch_);
+    std::vector<mpage_id_type> cold_values;
+    auto idx = list_.GetHead();
+    for (size_t step = 0; step < list_.capacity_ && idx < list_.capacity_;
+         step++, idx = list_.getNextNodeIndex(idx)) {
+      if (list_.getValue(idx).load() > 0)
+        values.push_back(idx);
+      else
+        cold_values.push_back(idx);
+    }
+    values.insert(values.end(), cold_values.begin(), cold_values.end());
+    return true;
+  }
+
   size_t GetMemoryUsage() const override { return list_.GetMemoryUsage(); }
 
  private:
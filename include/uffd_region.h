@@ -0,0 +1,262 @@
+#pragma once
+
+#include <fcntl.h>
+#include <linux/userfaultfd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool_manager.h"
+#include "config.h"
+#include "logger.h"
+
+namespace gbp {
+
+/**
+ * 基于userfaultfd的透明映射：把一个GBP文件映射为一段普通内存，原有基于指针的代码无需修改
+ * 1. 需要UFFD_REGION_ENABLE（帧池来自memfd）以及内核支持UFFD_FEATURE_MINOR_SHMEM
+ * 2. 预留UFFD_REGION_RESERVE_SIZE大小的匿名映射并以MISSING模式注册到userfaultfd；
+ * 缺页时handler线程钉住该页所在的帧，用MAP_FIXED | MAP_SHARED把帧直接映射到缺页地址，
+ * 再以MINOR模式注册这一页。映射的就是buffer pool中的帧，不额外占用内存，
+ * 与经过buffer pool的读写（如mmap_array::set）看到的是同一份数据
+ * 3. 没有单独的容量：帧何时被淘汰由buffer pool的replacer决定。写回/淘汰之前buffer pool
+ * 通过PageMapper::Unmap通知这里，把该页重新映射回MISSING模式的匿名映射，
+ * 与相邻的匿名VMA合并，之后的访问重新触发missing fault
+ * 4. 可写映射中的写入buffer pool无法感知，因此Unmap返回true，由buffer pool按dirty写回；
+ * 析构时先FlushFile，使所有映射过的页都经过一次Unmap
+ * 5. 每个当前映射着的页是一个单独的VMA（相邻且帧偏移连续时会被合并），VMA数量不超过映射着的页数。
+ * 映射时超出vm.max_map_count（ENOMEM）则FlushFile解除本文件所有页的映射后重试；
+ * 仍然失败时只读映射用UFFDIO_COPY复制帧的内容，可写映射等待之后重试。
+ * 重新映射回匿名映射失败（拆分VMA时ENOMEM）时退化为MADV_DONTNEED并保留VMA，
+ * 之后的访问触发minor fault：帧没有变化时UFFDIO_CONTINUE，否则重新映射到新的帧
+ * 6. 只有一个handler线程，缺页按到达顺序逐个处理，每次都同步等待装入（FetchPageSync），
+ * 不同页的缺页之间没有并发；它只适合把已有代码透明地接入buffer pool，不适合作为高并发的访问路径
+ * 7. 访问超出文件末尾（GetFileSize）的页与普通mmap访问文件末尾之后一样是致命错误：
+ * handler记录日志并退出进程，而不是装入一个不存在的页或让缺页的线程永远等待
+ */
+class UffdRegion : public PageMapper {
+ public:
+  UffdRegion(BufferPoolManager* buffer_pool_manager, GBPfile_handle_type fd,
+             bool read_only)
+      : buffer_pool_manager_(buffer_pool_manager),
+        fd_(fd),
+        read_only_(read_only),
+        mapped_num_(0),
+        stop_(false) {
+    if (!UFFD_REGION_ENABLE)
+      GBPLOG << "UffdRegion requires UFFD_REGION_ENABLE";
+    assert(UFFD_REGION_ENABLE);
+    data_ = (char*) ::mmap(nullptr, UFFD_REGION_RESERVE_SIZE,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    assert(data_ != MAP_FAILED);
+
+    uffd_ = ::syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    assert(uffd_ != -1);
+
+    uffdio_api api = {};
+    api.api = UFFD_API;
+    api.features = UFFD_FEATURE_MINOR_SHMEM;
+    auto ret = ::ioctl(uffd_, UFFDIO_API, &api);
+    if (ret == -1)
+      GBPLOG << "userfaultfd minor fault on shmem is not supported: "
+             << strerror(errno);
+    assert(ret == 0);
+    Register(data_, UFFD_REGION_RESERVE_SIZE, UFFDIO_REGISTER_MODE_MISSING);
+
+    buffer_pool_manager_->SetPageMapper(fd_, this);
+    server_ = std::thread([this]() { Run(); });
+  }
+
+  ~UffdRegion() {
+    if (!read_only_)
+      buffer_pool_manager_->FlushFile(fd_);
+    buffer_pool_manager_->SetPageMapper(fd_, nullptr);
+    stop_ = true;
+    if (server_.joinable())
+      server_.join();
+    ::close(uffd_);
+    ::munmap(data_, UFFD_REGION_RESERVE_SIZE);
+  }
+
+  FORCE_INLINE char* Data() const { return data_; }
+
+  // buffer pool写回/淘汰该页之前调用
+  bool Unmap(fpage_id_type fpage_id) override {
+    std::lock_guard<std::mutex> lck(latch_);
+    if (fpage_id >= pages_.size() || !pages_[fpage_id].mapped)
+      return false;
+    auto& page = pages_[fpage_id];
+    auto addr = GetPageData(fpage_id);
+    if (::mmap(addr, PAGE_SIZE_FILE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1,
+               0) == addr) {
+      Register(addr, PAGE_SIZE_FILE, UFFDIO_REGISTER_MODE_MISSING);
+      page.frame_offset = INVALID_FRAME_OFFSET;
+    } else {
+      ::madvise(addr, PAGE_SIZE_FILE, MADV_DONTNEED);
+    }
+    page.mapped = false;
+    mapped_num_--;
+    return !read_only_;
+  }
+
+  size_t GetMappedPageNum() {
+    std::lock_guard<std::mutex> lck(latch_);
+    return mapped_num_;
+  }
+
+ private:
+  struct page_type {
+    size_t frame_offset = INVALID_FRAME_OFFSET;  // 该页的VMA指向的帧
+    bool mapped = false;  // 页表项可能存在，访问不会触发缺页
+  };
+  constexpr static size_t INVALID_FRAME_OFFSET =
+      std::numeric_limits<size_t>::max();
+
+  void Run() {
+    pollfd pfd = {uffd_, POLLIN, 0};
+    uffd_msg msgs[UFFD_REGION_BATCH_SIZE];
+    while (!stop_) {
+      if (::poll(&pfd, 1, UFFD_REGION_POLL_TIMEOUT_MILLISECOND) <= 0)
+        continue;
+      auto ret = ::read(uffd_, msgs, sizeof(msgs));
+      if (ret <= 0)
+        continue;
+
+      size_t msg_num = (size_t) ret / sizeof(uffd_msg);
+      for (size_t idx = 0; idx < msg_num; idx++) {
+        if (msgs[idx].event != UFFD_EVENT_PAGEFAULT)
+          continue;
+        auto addr = msgs[idx].arg.pagefault.address;
+        HandleFault((addr - (uintptr_t) data_) >> LOG_PAGE_SIZE_FILE);
+      }
+    }
+  }
+
+  // missing fault（第一次访问或被Unmap之后再次访问）与minor fault（Unmap退化为MADV_DONTNEED）的处理相同
+  void HandleFault(fpage_id_type fpage_id) {
+    auto file_size = buffer_pool_manager_->GetDiskManager()->GetFileSize(fd_);
+    if (fpage_id >= ceil(file_size, PAGE_SIZE_FILE)) {
+      GBPLOG << "access beyond EOF of fd = " << fd_ << ": fpage_id = "
+             << fpage_id << " file size = " << file_size;
+      exit(-1);
+    }
+    // 不持有latch_：装入时可能淘汰本文件的其它页而回调Unmap；帧被钉住期间不会被淘汰
+    auto mpage = buffer_pool_manager_->FetchPageSync(fpage_id, fd_);
+    for (size_t retry = 0; !MapPage(fpage_id, mpage.second, retry); retry++) {
+      // VMA数量超出vm.max_map_count：解除本文件所有页的映射（Unmap）后重试
+      if (retry == 0)
+        GBPLOG << "too many mappings, unmap all pages of fd = " << fd_;
+      else
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(UFFD_REGION_POLL_TIMEOUT_MILLISECOND));
+      buffer_pool_manager_->FlushFile(fd_);
+    }
+    mpage.first->DecRefCount();
+  }
+
+  // 把帧映射（或复制）到该页并唤醒缺页的线程，ENOMEM时返回false
+  bool MapPage(fpage_id_type fpage_id, const char* frame, size_t retry) {
+    auto [memfd, frame_offset] = buffer_pool_manager_->GetFrameFile(frame);
+    std::lock_guard<std::mutex> lck(latch_);
+    if (fpage_id >= pages_.size())
+      pages_.resize(std::max<size_t>(fpage_id + 1, pages_.size() * 2));
+    auto& page = pages_[fpage_id];
+    auto addr = GetPageData(fpage_id);
+    if (page.frame_offset == frame_offset) {
+      // VMA仍然指向该帧，只需要重新建立页表项
+      Continue(fpage_id);
+    } else {
+      auto ret = ::mmap(addr, PAGE_SIZE_FILE,
+                        read_only_ ? PROT_READ : PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_FIXED, memfd, frame_offset);
+      if (ret == MAP_FAILED) {
+        auto err = errno;
+        if (err != ENOMEM)
+          GBPLOG << "mmap error: " << strerror(err);
+        assert(err == ENOMEM);
+        // 解除映射之后仍然失败：只读映射复制帧的内容（仍在原来的匿名映射中）
+        if (!read_only_ || retry == 0)
+          return false;
+        uffdio_copy copy = {};
+        copy.dst = (uintptr_t) addr;
+        copy.src = (uintptr_t) frame;
+        copy.len = PAGE_SIZE_FILE;
+        if (::ioctl(uffd_, UFFDIO_COPY, &copy) == -1) {
+          if (errno != EEXIST) {
+            GBPLOG << "UFFDIO_COPY error: " << strerror(errno);
+            return false;
+          }
+          Wake(fpage_id);
+        }
+        page.frame_offset = INVALID_FRAME_OFFSET;
+      } else {
+        // 新的VMA中还没有页表项，直接建立，避免缺页的线程再触发一次minor fault
+        Register(addr, PAGE_SIZE_FILE, UFFDIO_REGISTER_MODE_MINOR);
+        page.frame_offset = frame_offset;
+        Continue(fpage_id);
+      }
+    }
+    if (!page.mapped) {
+      page.mapped = true;
+      mapped_num_++;
+    }
+    return true;
+  }
+
+  void Register(char* addr, size_t len, uint64_t mode) {
+    uffdio_register reg = {};
+    reg.range.start = (uintptr_t) addr;
+    reg.range.len = len;
+    reg.mode = mode;
+    auto ret = ::ioctl(uffd_, UFFDIO_REGISTER, &reg);
+    if (ret == -1)
+      GBPLOG << "UFFDIO_REGISTER error: " << strerror(errno);
+    assert(ret == 0);
+  }
+
+  // 为该页建立页表项并唤醒缺页的线程
+  void Continue(fpage_id_type fpage_id) {
+    uffdio_continue cont = {};
+    cont.range = {(uintptr_t) GetPageData(fpage_id), PAGE_SIZE_FILE};
+    if (::ioctl(uffd_, UFFDIO_CONTINUE, &cont) == -1) {
+      assert(errno == EEXIST);
+      Wake(fpage_id);
+    }
+  }
+
+  void Wake(fpage_id_type fpage_id) {
+    uffdio_range range = {(uintptr_t) GetPageData(fpage_id), PAGE_SIZE_FILE};
+    ::ioctl(uffd_, UFFDIO_WAKE, &range);
+  }
+
+  FORCE_INLINE char* GetPageData(fpage_id_type fpage_id) const {
+    return data_ + ((size_t) fpage_id << LOG_PAGE_SIZE_FILE);
+  }
+
+  BufferPoolManager* buffer_pool_manager_;
+  const GBPfile_handle_type fd_;
+  const bool read_only_;
+
+  char* data_;
+  int uffd_;
+  std::thread server_;
+  std::atomic<bool> stop_;
+
+  std::mutex latch_;  // 保护下面的成员，handler线程与Unmap之间互斥
+  std::vector<page_type> pages_;
+  size_t mapped_num_;
+};
+
+}  // namespace gbp
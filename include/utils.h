@@ -1,6 +1,9 @@
 #pragma once
 
 #include <execinfo.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <atomic>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/date_time/posix_time/posix_time_io.hpp>
@@ -9,7 +12,11 @@
 #include <boost/interprocess/sync/interprocess_semaphore.hpp>
 #include <boost/lockfree/queue.hpp>
 #include <boost/regex.hpp>
+#include <algorithm>
+#include <climits>
 #include <cstring>
+#include <mutex>
+#include <vector>
 
 #include "config.h"
 
@@ -184,6 +191,29 @@ class lockfree_queue_type {
     return ret;
   }
 
+  // 批量操作只更新一次size_；返回成功放入的个数，失败时只有items的这一前缀在队列中
+  size_t PushBatch(const T* items, size_t num) {
+    size_.fetch_add(num);
+    for (size_t idx = 0; idx < num; idx++) {
+      if (!queue_.push(items[idx])) {
+        size_.fetch_sub(num - idx);
+        return idx;
+      }
+    }
+    return num;
+  }
+
+  size_t PollBatch(T* items, size_t num) {
+    size_t idx = 0;
+    for (; idx < num; idx++) {
+      if (!queue_.pop(items[idx]))
+        break;
+    }
+    if (idx != 0)
+      size_.fetch_sub(idx);
+    return idx;
+  }
+
   size_t Size() { return size_.load(); }
   size_t GetMemoryUsage() {
     // 获取元素类型的大小
@@ -206,6 +236,213 @@ class lockfree_queue_type {
   size_t capacity_;
 };
 
+size_t get_thread_id();
+
+class MagazineOwner {
+ public:
+  virtual ~MagazineOwner() = default;
+  // 把槽位slot对应的magazine中的空闲页全部归还全局队列，由即将退出的槽位拥有者调用
+  virtual void Drain(uint32_t slot) = 0;
+};
+
+/**
+ * magazine槽位的分配
+ * 1. 线程第一次访问magazine时占用一个空闲槽位，线程退出时（thread_local的析构函数）
+ * 先把该槽位在所有magazine_queue_type中的空闲页归还全局队列，再释放槽位供新线程复用
+ * 2. 槽位被占满时新线程没有magazine，直接访问全局队列，因此同一个magazine不会被两个线程同时访问
+ * 3. 单例不会被析构，保证静态对象（如BufferPoolManager）析构时仍然可以注销
+ */
+class MagazineSlots {
+ public:
+  constexpr static uint32_t INVALID_SLOT = std::numeric_limits<uint32_t>::max();
+
+  static MagazineSlots& GetInstance() {
+    static auto* instance = new MagazineSlots();
+    return *instance;
+  }
+
+  // 当前线程的槽位，没有可用槽位时返回INVALID_SLOT
+  static uint32_t GetSlot() {
+    thread_local SlotHolder holder;
+    return holder.slot;
+  }
+
+  void Register(MagazineOwner* owner) {
+    std::lock_guard lock(latch_);
+    owners_.push_back(owner);
+  }
+
+  void Unregister(MagazineOwner* owner) {
+    std::lock_guard lock(latch_);
+    owners_.erase(std::find(owners_.begin(), owners_.end(), owner));
+  }
+
+ private:
+  struct SlotHolder {
+    SlotHolder() : slot(GetInstance().Acquire()) {}
+    ~SlotHolder() {
+      if (slot != INVALID_SLOT)
+        GetInstance().Release(slot);
+    }
+    const uint32_t slot;
+  };
+
+  MagazineSlots() : used_(FREE_LIST_MAGAZINE_NUM, false) {}
+
+  uint32_t Acquire() {
+    std::lock_guard lock(latch_);
+    auto iter = std::find(used_.begin(), used_.end(), false);
+    if (iter == used_.end())
+      return INVALID_SLOT;
+    *iter = true;
+    return iter - used_.begin();
+  }
+
+  void Release(uint32_t slot) {
+    std::lock_guard lock(latch_);
+    for (auto owner : owners_)
+      owner->Drain(slot);
+    used_[slot] = false;
+  }
+
+  std::mutex latch_;  // 保护下面的成员，只在线程创建/退出以及pool创建/销毁时访问
+  std::vector<bool> used_;
+  std::vector<MagazineOwner*> owners_;
+};
+
+/**
+ * 在lockfree_queue_type之前加一层per-thread的magazine缓存
+ * 1. Poll时优先从本线程的magazine中取，magazine为空时才从全局队列中批量refill
+ * 2. Push时优先放入本线程的magazine，magazine满时才将一半批量flush到全局队列
+ * 3. 按照MagazineSlots分配的槽位选择magazine，每个magazine只被一个线程访问，
+ * 线程退出时magazine中的空闲页被归还全局队列
+ * 4. 当容量过小时（magazine可能囤积过多的空闲页），直接退化为全局队列
+ */
+template <typename T>
+class magazine_queue_type : public MagazineOwner {
+  struct alignas(CACHELINE_SIZE) Magazine {
+    std::atomic<uint32_t> size{0};  // 只有拥有者会写，其它线程仅在Size()中读
+    T items[FREE_LIST_MAGAZINE_SIZE];
+  };
+
+ public:
+  magazine_queue_type(size_t capacity)
+      : global_(capacity),
+        batch_size_(FREE_LIST_MAGAZINE_ENABLE &&
+                            capacity >= 4 * FREE_LIST_MAGAZINE_NUM *
+                                            FREE_LIST_MAGAZINE_SIZE
+                        ? FREE_LIST_MAGAZINE_SIZE / 2
+                        : 0),
+        magazines_(batch_size_ == 0 ? 0 : FREE_LIST_MAGAZINE_NUM) {
+    if (batch_size_ != 0)
+      MagazineSlots::GetInstance().Register(this);
+  }
+  ~magazine_queue_type() override {
+    if (batch_size_ != 0)
+      MagazineSlots::GetInstance().Unregister(this);
+  }
+
+  bool Push(T item) {
+    auto magazine = GetMagazine();
+    if (magazine == nullptr)
+      return global_.Push(item);
+
+    auto size = magazine->size.load(std::memory_order_relaxed);
+    if (unlikely(size == FREE_LIST_MAGAZINE_SIZE)) {
+      // 只从magazine中移除全局队列接受的前缀，其余的前移补上空位，同一页不会同时在两处
+      auto base = size - batch_size_;
+      auto pushed = global_.PushBatch(magazine->items + base, batch_size_);
+      std::copy(magazine->items + base + pushed, magazine->items + size,
+                magazine->items + base);
+      size -= pushed;
+      if (unlikely(size == FREE_LIST_MAGAZINE_SIZE))
+        return false;
+      magazine->items[size++] = item;
+      magazine->size.store(size, std::memory_order_relaxed);
+      return true;
+    }
+    magazine->items[size++] = item;
+    magazine->size.store(size, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool Poll(T& item) {
+    bool global_polled;
+    return Poll(item, global_polled);
+  }
+
+  // global_polled：本次是否访问了全局队列（没有magazine或者magazine为空时refill），
+  // 只有此时全局队列的大小才可能变化，调用者据此决定是否检查水位
+  bool Poll(T& item, bool& global_polled) {
+    auto magazine = GetMagazine();
+    global_polled = magazine == nullptr;
+    if (magazine == nullptr)
+      return global_.Poll(item);
+
+    auto size = magazine->size.load(std::memory_order_relaxed);
+    if (unlikely(size == 0)) {
+      global_polled = true;
+      size = global_.PollBatch(magazine->items, batch_size_);
+      if (size == 0)
+        return false;
+      item = magazine->items[--size];
+      magazine->size.store(size, std::memory_order_relaxed);
+      return true;
+    }
+    item = magazine->items[--size];
+    magazine->size.store(size, std::memory_order_relaxed);
+    return true;
+  }
+
+  // 后台线程（如EvictionServer）产生的空闲页直接进入全局队列，供所有线程refill
+  bool PushBatch(const T* items, size_t num) {
+    return global_.PushBatch(items, num) == num;
+  }
+
+  void Drain(uint32_t slot) override {
+    auto& magazine = magazines_[slot];
+    auto size = magazine.size.load(std::memory_order_relaxed);
+    if (size == 0)
+      return;
+    // 全局队列没有接受的页留在magazine中，由之后占用该槽位的线程使用
+    auto pushed = global_.PushBatch(magazine.items, size);
+    std::copy(magazine.items + pushed, magazine.items + size, magazine.items);
+    magazine.size.store(size - pushed, std::memory_order_relaxed);
+  }
+
+  // 单个线程的magazine最多囤积的空闲页数，退化为全局队列时为0
+  size_t GetMagazineCapacity() const {
+    return batch_size_ == 0 ? 0 : FREE_LIST_MAGAZINE_SIZE;
+  }
+
+  // 只统计全局队列，magazine中的空闲页只对其所属线程可见；只有一次load，可以在缺页路径上调用
+  FORCE_INLINE size_t GlobalSize() { return global_.Size(); }
+
+  size_t Size() {
+    size_t ret = global_.Size();
+    for (auto& magazine : magazines_)
+      ret += magazine.size.load(std::memory_order_relaxed);
+    return ret;
+  }
+
+  size_t GetMemoryUsage() {
+    return global_.GetMemoryUsage() + magazines_.size() * sizeof(Magazine);
+  }
+
+ private:
+  FORCE_INLINE Magazine* GetMagazine() {
+    if (batch_size_ == 0)
+      return nullptr;
+    auto slot = MagazineSlots::GetSlot();
+    return likely(slot != MagazineSlots::INVALID_SLOT) ? &magazines_[slot]
+                                                       : nullptr;
+  }
+
+  lockfree_queue_type<T> global_;
+  const size_t batch_size_;
+  std::vector<Magazine> magazines_;
+};
+
 void Log_mine(std::string& content);
 
 class string_view {};
@@ -402,6 +639,163 @@ class AsyncMesg4 : public AsyncMesg {
   mutable boost::interprocess::interprocess_semaphore sem;
 };
 
+// 这是最好（支持阻塞式等待）：先自旋HYBRID_SPIN_THRESHOLD次，之后在futex上park
+// Post在FUTEX_WAKE返回之前只把状态置为Waking，等待者看到Finished之后才返回（并可能释放本对象），
+// 因此Post对本对象的最后一次访问是写入Finished
+class AsyncMesg5 : public AsyncMesg {
+  enum State : uint32_t { Waiting = 0, Finished = 1, Parked = 2, Waking = 3 };
+
+ public:
+  AsyncMesg5() : state_(State::Waiting) {}
+  ~AsyncMesg5() = default;
+
+  FORCE_INLINE void Post() override {
+    if (state_.exchange(State::Waking) == State::Parked)
+      ::syscall(SYS_futex, &state_, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr,
+                nullptr, 0);
+    state_.store(State::Finished);
+  }
+  FORCE_INLINE bool Wait() const override {
+    for (size_t loops = 0; loops < HYBRID_SPIN_THRESHOLD; loops++) {
+      if (state_.load() == State::Finished)
+        return true;
+      nano_spin();
+    }
+    while (true) {
+      uint32_t expected = State::Waiting;
+      if (state_.compare_exchange_strong(expected, State::Parked) ||
+          expected == State::Parked) {
+        ::syscall(SYS_futex, &state_, FUTEX_WAIT_PRIVATE, State::Parked,
+                  nullptr, nullptr, 0);
+      } else if (expected == State::Waking) {
+        nano_spin();  // Post即将完成
+      } else {
+        return true;
+      }
+    }
+  }
+  FORCE_INLINE bool TryWait() const override {
+    return state_.load() == State::Finished;
+  }
+  FORCE_INLINE void Reset() override { state_.store(State::Waiting); }
+
+ private:
+  mutable std::atomic<uint32_t> state_;
+};
+
+/**
+ * per-thread的对象池：对象的内存来自当前线程的freelist，避免每次异步请求都调用malloc/free
+ * 对象可以在其它线程被Delete，此时内存归还到该线程的freelist
+ */
+template <typename T>
+class ObjectPool {
+ public:
+  template <typename... Args>
+  static T* New(Args&&... args) {
+    auto& free_list = GetFreeList().items;
+    void* mem;
+    if (likely(!free_list.empty())) {
+      mem = free_list.back();
+      free_list.pop_back();
+    } else {
+      mem = ::operator new(sizeof(T));
+    }
+    return new (mem) T(std::forward<Args>(args)...);
+  }
+
+  static void Delete(T* obj) {
+    obj->~T();
+    auto& free_list = GetFreeList().items;
+    if (likely(free_list.size() < OBJECT_POOL_MAX_SIZE))
+      free_list.push_back(obj);
+    else
+      ::operator delete(obj);
+  }
+
+ private:
+  struct FreeList {
+    std::vector<void*> items;
+    ~FreeList() {
+      for (auto item : items)
+        ::operator delete(item);
+    }
+  };
+
+  static FreeList& GetFreeList() {
+    thread_local FreeList free_list;
+    return free_list;
+  }
+};
+
+/**
+ * 异步请求的共享状态：生产者写入value后调用finish.Post()，之后不再访问本对象
+ * 消费者通过AsyncFuture等待并取出value，最后由AsyncFuture将本对象归还给对象池
+ */
+template <typename T>
+struct AsyncState {
+  T value;
+  AsyncMesg5 finish;
+};
+
+// std::future的轻量替代，接口与std::future的常用部分保持一致
+template <typename T>
+class AsyncFuture {
+ public:
+  using release_func_type = void (*)(AsyncState<T>*);
+
+  AsyncFuture() : state_(nullptr), release_(nullptr) {}
+  AsyncFuture(AsyncState<T>* state, release_func_type release)
+      : state_(state), release_(release) {}
+  AsyncFuture(const AsyncFuture&) = delete;
+  AsyncFuture& operator=(const AsyncFuture&) = delete;
+  AsyncFuture(AsyncFuture&& src) noexcept
+      : state_(src.state_), release_(src.release_) {
+    src.state_ = nullptr;
+  }
+  AsyncFuture& operator=(AsyncFuture&& src) noexcept {
+    std::swap(state_, src.state_);
+    std::swap(release_, src.release_);
+    return *this;
+  }
+  ~AsyncFuture() { Release(); }
+
+  // 构造一个已经完成的future
+  static AsyncFuture Ready(T&& value) {
+    auto* state = ObjectPool<AsyncState<T>>::New();
+    state->value = std::move(value);
+    state->finish.Post();
+    return AsyncFuture(state, [](AsyncState<T>* state) {
+      ObjectPool<AsyncState<T>>::Delete(state);
+    });
+  }
+
+  FORCE_INLINE bool valid() const { return state_ != nullptr; }
+  FORCE_INLINE bool is_ready() const { return state_->finish.TryWait(); }
+  FORCE_INLINE void wait() const { state_->finish.Wait(); }
+
+  T get() {
+#if ASSERT_ENABLE
+    assert(valid());
+#endif
+    state_->finish.Wait();
+    T ret = std::move(state_->value);
+    Release();
+    return ret;
+  }
+
+ private:
+  void Release() {
+    if (state_ != nullptr) {
+      state_->finish.Wait();  // 生产者完成之前不能归还
+      release_(state_);
+      state_ = nullptr;
+    }
+  }
+
+  AsyncState<T>* state_;
+  release_func_type release_;
+};
+
 void set_cpu_affinity();
 
 inline size_t parseDateTimeToMilliseconds(const std::string& datetime) {
@@ -0,0 +1,591 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "io_backend.h"
+#include "logger.h"
+#include "utils.h"
+
+namespace gbp {
+
+/**
+ * vmcache风格的buffer pool（VM_CACHE_ENABLE）
+ * 1. 一次性预留VM_CACHE_MAX_FILE_NUM * VM_CACHE_FILE_RESERVE_SIZE大小的虚拟地址空间
+ * （PROT_NONE的匿名映射，不计入commit charge，vm.overcommit_memory=2时也能预留），
+ * 文件fd占其中第fd段，页在文件中的偏移就是它在该段中的偏移，
+ * 命中时只需要一次指针运算，不经过partitioner、page table与PTE。
+ * 文件注册与扩大时由EnableFile把文件大小范围内的部分改为可读写，fd与大小的检查都在这里完成，
+ * 命中路径上不再检查
+ * 2. 每个页对应一个64位的状态字：低8位为state，第8位为dirty，其余为version；
+ * 状态字数组同样是MAP_NORESERVE的匿名映射，全0表示Evicted，因此不需要初始化。
+ * 状态字的下标就是页相对于预留区间起始地址的页号，因此也可以由页内的任意地址找到状态字
+ * 3. 缺页的线程先预留一个常驻名额（达到容量时批量淘汰后重试），获取排他锁后直接pread到该页的虚拟地址，
+ * 因此常驻页数不会超过容量，ResidentSet中总有空位
+ * 4. 淘汰为clock算法（ResidentSet上循环）：Unlocked的页先置为Marked，再次遇到时仍为Marked
+ * 则加排他锁；脏页写回后按地址连续的区间合并MADV_DONTNEED，减少TLB shootdown的次数
+ * 5. 装入/淘汰时不改变页的保护属性：否则每次都需要一次mprotect，反而多一次shootdown
+ * 6. VM模式下BufferPoolManager不再创建pool，所有读写都经过VMCache，
+ * 帧池的页预算全部交给VMCache；BufferBlock中PTE为空的页即为VMCache的页，按地址unfix
+ */
+class VMCache {
+ public:
+  // 状态字的低8位
+  enum State : uint64_t {
+    Evicted = 0,
+    Unlocked = 1,  // [Unlocked + 1, MaxShared]表示被共享持有的次数
+    MaxShared = 252,
+    Locked = 253,
+    Marked = 254,
+  };
+  constexpr static uint64_t STATE_MASK = 0xFF;
+  constexpr static uint64_t DIRTY_BIT = 1lu << 8;
+  constexpr static uint64_t VERSION_UNIT = 1lu << 9;
+
+  FORCE_INLINE static uint64_t GetState(uint64_t word) {
+    return word & STATE_MASK;
+  }
+  FORCE_INLINE static uint64_t WithState(uint64_t word, uint64_t state) {
+    return (word & ~STATE_MASK) | state;
+  }
+
+  /**
+   * 一段连续的、被共享持有的页
+   * 由于同一个文件的页在虚拟地址上连续，跨页的obj也可以直接通过指针访问
+   */
+  class Guard {
+   public:
+    Guard()
+        : cache_(nullptr), fd_(0), fpage_id_(0), page_num_(0), data_(nullptr) {}
+    Guard(VMCache* cache, GBPfile_handle_type fd, fpage_id_type fpage_id,
+          size_t page_num, char* data)
+        : cache_(cache),
+          fd_(fd),
+          fpage_id_(fpage_id),
+          page_num_(page_num),
+          data_(data) {}
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+    Guard(Guard&& src) noexcept : Guard() { *this = std::move(src); }
+    Guard& operator=(Guard&& src) noexcept {
+      if (this != &src) {
+        Release();
+        cache_ = src.cache_;
+        fd_ = src.fd_;
+        fpage_id_ = src.fpage_id_;
+        page_num_ = src.page_num_;
+        data_ = src.data_;
+        src.cache_ = nullptr;
+      }
+      return *this;
+    }
+    ~Guard() { Release(); }
+
+    FORCE_INLINE char* Data() const { return data_; }
+    template <typename T>
+    FORCE_INLINE T* Ptr(size_t idx = 0) const {
+      return reinterpret_cast<T*>(data_) + idx;
+    }
+
+    // 写入之后需要调用，淘汰或Flush时才会写回
+    void MarkDirty() const {
+      for (size_t idx = 0; idx < page_num_; idx++)
+        cache_->MarkDirty(fd_, fpage_id_ + idx);
+    }
+
+    void Release() {
+      if (cache_ != nullptr) {
+        for (size_t idx = 0; idx < page_num_; idx++)
+          cache_->UnfixShared(fd_, fpage_id_ + idx);
+        cache_ = nullptr;
+      }
+    }
+
+   private:
+    VMCache* cache_;
+    GBPfile_handle_type fd_;
+    fpage_id_type fpage_id_;
+    size_t page_num_;
+    char* data_;
+  };
+
+  VMCache(DiskManager* disk_manager, size_t capacity_inpage)
+      : disk_manager_(disk_manager),
+        capacity_inpage_(capacity_inpage),
+        resident_num_(0),
+        resident_set_(capacity_inpage) {
+    assert(capacity_inpage > VM_CACHE_EVICTION_BATCH_SIZE);
+    data_ = (char*) ::mmap(nullptr, GetReserveSize(), PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    states_ = (std::atomic<uint64_t>*) ::mmap(
+        nullptr, GetStateArraySize(), PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data_ == MAP_FAILED || states_ == MAP_FAILED) {
+      GBPLOG << "failed to reserve the VMCache address space: "
+             << strerror(errno);
+      exit(-1);
+    }
+    // 在此之前打开的文件
+    for (size_t fd = 0; fd < disk_manager_->GetFileNum(); fd++) {
+      if (disk_manager_->ValidFD(fd) &&
+          !EnableFile(fd, disk_manager_->GetFileSizeFast(fd)))
+        exit(-1);
+    }
+  }
+
+  ~VMCache() {
+    ::munmap(data_, GetReserveSize());
+    ::munmap(states_, GetStateArraySize());
+  }
+
+  // BufferBlock释放VM页时通过它找到VMCache，由BufferPoolManager在init时设置
+  static VMCache*& GetGlobalInstance() {
+    static VMCache* cache = nullptr;
+    return cache;
+  }
+
+  /**
+   * 使fd的前size_inByte字节可以访问（只会扩大，缩小时保持不变）
+   * fd或者大小超出预留范围、mprotect失败（vm.overcommit_memory=2时commit charge不足）时返回false
+   */
+  bool EnableFile(GBPfile_handle_type fd, size_t size_inByte) {
+    if (fd >= VM_CACHE_MAX_FILE_NUM ||
+        size_inByte > VM_CACHE_FILE_RESERVE_SIZE) {
+      GBPLOG << "file out of the VMCache reservation (VM_CACHE_MAX_FILE_NUM = "
+             << VM_CACHE_MAX_FILE_NUM << ", VM_CACHE_FILE_RESERVE_SIZE = "
+             << VM_CACHE_FILE_RESERVE_SIZE << "): fd = " << fd
+             << " size = " << size_inByte;
+      return false;
+    }
+    std::lock_guard<std::mutex> lck(enable_latch_);
+    fpage_id_type fpage_num_old = enabled_page_nums_[fd],
+                  fpage_num_new = ceil(size_inByte, PAGE_SIZE_FILE);
+    if (fpage_num_new <= fpage_num_old)
+      return true;
+    if (!Protect(GetPageData(fd, fpage_num_old),
+                 GetPageData(fd, fpage_num_new)) ||
+        !Protect((char*) &states_[GetStateId(fd, fpage_num_old)],
+                 (char*) &states_[GetStateId(fd, fpage_num_new)])) {
+      GBPLOG << "failed to enable fd = " << fd << " in VMCache: "
+             << strerror(errno);
+      return false;
+    }
+    enabled_page_nums_[fd] = fpage_num_new;
+    return true;
+  }
+
+  FORCE_INLINE char* GetBase(GBPfile_handle_type fd) const {
+#if ASSERT_ENABLE
+    assert(fd < VM_CACHE_MAX_FILE_NUM);
+#endif
+    return data_ + (size_t) fd * VM_CACHE_FILE_RESERVE_SIZE;
+  }
+
+  FORCE_INLINE char* GetPageData(GBPfile_handle_type fd,
+                                 fpage_id_type fpage_id) const {
+    return GetBase(fd) + ((size_t) fpage_id << LOG_PAGE_SIZE_FILE);
+  }
+
+  FORCE_INLINE std::atomic<uint64_t>& GetPageState(
+      GBPfile_handle_type fd, fpage_id_type fpage_id) const {
+#if ASSERT_ENABLE
+    assert(((size_t) fpage_id << LOG_PAGE_SIZE_FILE) <
+           VM_CACHE_FILE_RESERVE_SIZE);
+#endif
+    return GetPageState(GetPageData(fd, fpage_id));
+  }
+
+  // addr可以是页内的任意地址
+  FORCE_INLINE std::atomic<uint64_t>& GetPageState(const char* addr) const {
+#if ASSERT_ENABLE
+    assert(addr >= data_ && addr < data_ + GetReserveSize());
+#endif
+    return states_[(size_t) (addr - data_) >> LOG_PAGE_SIZE_FILE];
+  }
+
+  // 共享持有一个页，返回其地址；命中时只有一次CAS
+  char* FixShared(GBPfile_handle_type fd, fpage_id_type fpage_id) {
+    auto& state = GetPageState(fd, fpage_id);
+    size_t spin = 0;
+    while (true) {
+      auto word = state.load(std::memory_order_acquire);
+      switch (GetState(word)) {
+      case State::Evicted: {
+        // 没有淘汰出空位（其它线程正在淘汰或者页都被持有）时重试
+        if (!ReserveResident()) {
+          Evict();
+          break;
+        }
+        if (state.compare_exchange_strong(word,
+                                          WithState(word, State::Locked))) {
+          LoadPage(fd, fpage_id);
+          resident_set_.Insert(GetKey(fd, fpage_id));
+          state.store(WithState(word, State::Unlocked + 1),
+                      std::memory_order_release);
+          return GetPageData(fd, fpage_id);
+        }
+        resident_num_.fetch_sub(1, std::memory_order_relaxed);
+        break;
+      }
+      case State::Marked: {
+        if (state.compare_exchange_weak(word,
+                                        WithState(word, State::Unlocked + 1)))
+          return GetPageData(fd, fpage_id);
+        break;
+      }
+      case State::Locked:
+      case State::MaxShared:
+        break;
+      default: {
+        if (state.compare_exchange_weak(word, word + 1))
+          return GetPageData(fd, fpage_id);
+        break;
+      }
+      }
+      if (++spin > HYBRID_SPIN_THRESHOLD)
+        std::this_thread::yield();
+    }
+  }
+
+  FORCE_INLINE void UnfixShared(GBPfile_handle_type fd,
+                                fpage_id_type fpage_id) {
+    UnfixShared(GetPageData(fd, fpage_id));
+  }
+  FORCE_INLINE void UnfixShared(const char* addr) {
+    auto& state = GetPageState(addr);
+#if ASSERT_ENABLE
+    assert(GetState(state.load()) > State::Unlocked &&
+           GetState(state.load()) <= State::MaxShared);
+#endif
+    state.fetch_sub(1, std::memory_order_release);
+  }
+
+  // 调用者需要持有该页
+  FORCE_INLINE void MarkDirty(GBPfile_handle_type fd, fpage_id_type fpage_id) {
+    MarkDirty(GetPageData(fd, fpage_id));
+  }
+  FORCE_INLINE void MarkDirty(const char* addr) {
+    GetPageState(addr).fetch_or(DIRTY_BIT, std::memory_order_relaxed);
+  }
+
+  Guard Fix(size_t file_offset, size_t block_size, GBPfile_handle_type fd) {
+    if (block_size == 0)
+      return Guard();
+    fpage_id_type fpage_id = file_offset >> LOG_PAGE_SIZE_FILE;
+    fpage_id_type fpage_id_end =
+        (file_offset + block_size - 1) >> LOG_PAGE_SIZE_FILE;
+    for (auto page_id = fpage_id; page_id <= fpage_id_end; page_id++)
+      FixShared(fd, page_id);
+    return Guard(this, fd, fpage_id, fpage_id_end - fpage_id + 1,
+                 GetBase(fd) + file_offset);
+  }
+
+  // 淘汰最多VM_CACHE_EVICTION_BATCH_SIZE个页，同一时刻只有一个线程执行淘汰
+  void Evict() {
+    std::unique_lock<std::mutex> lck(eviction_latch_, std::try_to_lock);
+    if (!lck.owns_lock()) {
+      std::this_thread::yield();
+      return;
+    }
+
+    std::vector<uint64_t> victims;
+    victims.reserve(VM_CACHE_EVICTION_BATCH_SIZE);
+    // clock最多转两圈：第一圈把Unlocked标记为Marked，第二圈回收仍然是Marked的页
+    size_t scan_num = resident_set_.Capacity() * 2;
+    while (victims.size() < VM_CACHE_EVICTION_BATCH_SIZE && scan_num-- > 0) {
+      auto key = resident_set_.Next();
+      if (key == ResidentSet::EMPTY || key == ResidentSet::TOMBSTONE)
+        continue;
+      auto& state = GetPageState(GetFd(key), GetFpageId(key));
+      auto word = state.load(std::memory_order_acquire);
+      if (GetState(word) == State::Unlocked) {
+        state.compare_exchange_strong(word, WithState(word, State::Marked));
+      } else if (GetState(word) == State::Marked) {
+        if (state.compare_exchange_strong(word,
+                                          WithState(word, State::Locked)))
+          victims.push_back(key);
+      }
+    }
+    ReleaseVictims(victims, true);
+  }
+
+  // 写回fd的一个脏页，delete_from_memory为true时同时淘汰该页（等待其它线程释放该页）
+  bool FlushPage(GBPfile_handle_type fd, fpage_id_type fpage_id,
+                 bool delete_from_memory = false) {
+    auto& state = GetPageState(fd, fpage_id);
+    if (GetState(state.load()) == State::Evicted)
+      return true;
+    if (delete_from_memory) {
+      std::lock_guard<std::mutex> lck(eviction_latch_);
+      if (!LockUnpinned(state, 0))
+        return true;
+      std::vector<uint64_t> victims = {GetKey(fd, fpage_id)};
+      ReleaseVictims(victims, true);
+      return true;
+    }
+    if (!(state.load() & DIRTY_BIT))
+      return true;
+    FixShared(fd, fpage_id);
+    if (state.fetch_and(~DIRTY_BIT) & DIRTY_BIT)
+      WritePage(fd, fpage_id);
+    UnfixShared(fd, fpage_id);
+    return true;
+  }
+
+  // 写回fd的所有脏页，delete_from_memory为true时同时淘汰这些页（关闭文件时使用）
+  bool FlushFile(GBPfile_handle_type fd, bool delete_from_memory = false) {
+    bool ret = true;
+    size_t fpage_num =
+        ceil(disk_manager_->GetFileSizeFast(fd), PAGE_SIZE_FILE);
+    for (fpage_id_type fpage_id = 0; fpage_id < fpage_num; fpage_id++)
+      ret &= FlushPage(fd, fpage_id, delete_from_memory);
+    return ret;
+  }
+
+  // 丢弃fd中[fpage_id_begin, fpage_id_end)的页（不写回），文件缩小时使用
+  void Truncate(GBPfile_handle_type fd, fpage_id_type fpage_id_begin,
+                fpage_id_type fpage_id_end) {
+    std::lock_guard<std::mutex> lck(eviction_latch_);
+    std::vector<uint64_t> victims;
+    for (auto fpage_id = fpage_id_begin; fpage_id < fpage_id_end; fpage_id++) {
+      // 被截断的页可能还在被读者短暂持有，等待其释放
+      if (LockUnpinned(GetPageState(fd, fpage_id), DIRTY_BIT))
+        victims.push_back(GetKey(fd, fpage_id));
+    }
+    ReleaseVictims(victims, false);
+  }
+
+  size_t GetResidentPageNum() const { return resident_num_.load(); }
+  size_t GetCapacity() const { return capacity_inpage_; }
+
+ private:
+  // 预留一个常驻名额，常驻页数已达到容量时返回false
+  FORCE_INLINE bool ReserveResident() {
+    auto num = resident_num_.load(std::memory_order_relaxed);
+    while (num < capacity_inpage_) {
+      if (resident_num_.compare_exchange_weak(num, num + 1,
+                                              std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * 等待页不再被持有（Unlocked或Marked）后加排他锁并清除clear_bits，页已被淘汰时返回false
+   * 调用者需持有eviction_latch_，因此不会与Evict竞争；Locked只会是正在装入的页，很快会释放
+   */
+  bool LockUnpinned(std::atomic<uint64_t>& state, uint64_t clear_bits) {
+    size_t spin = 0;
+    while (true) {
+      auto word = state.load(std::memory_order_acquire);
+      if (GetState(word) == State::Evicted)
+        return false;
+      if ((GetState(word) == State::Unlocked ||
+           GetState(word) == State::Marked) &&
+          state.compare_exchange_strong(
+              word, WithState(word, State::Locked) & ~clear_bits))
+        return true;
+      if (++spin > HYBRID_SPIN_THRESHOLD)
+        std::this_thread::yield();
+    }
+  }
+
+  /**
+   * victims中的页均已被加排他锁，write_back为true时先写回脏页，
+   * 之后按地址连续的区间合并madvise，最后置为Evicted。调用者需持有eviction_latch_
+   */
+  void ReleaseVictims(std::vector<uint64_t>& victims, bool write_back) {
+    if (victims.empty())
+      return;
+
+    std::sort(victims.begin(), victims.end());
+    if (write_back) {
+      for (auto key : victims) {
+        auto fd = GetFd(key);
+        auto fpage_id = GetFpageId(key);
+        auto& state = GetPageState(fd, fpage_id);
+        if (state.load() & DIRTY_BIT) {
+          WritePage(fd, fpage_id);
+          state.fetch_and(~DIRTY_BIT);
+        }
+      }
+    }
+
+    // 地址连续的页合并为一次madvise
+    size_t begin = 0;
+    for (size_t idx = 1; idx <= victims.size(); idx++) {
+      if (idx == victims.size() || victims[idx] != victims[idx - 1] + 1) {
+        auto fd = GetFd(victims[begin]);
+        ::madvise(GetPageData(fd, GetFpageId(victims[begin])),
+                  (idx - begin) * PAGE_SIZE_FILE, MADV_DONTNEED);
+        begin = idx;
+      }
+    }
+
+    for (auto key : victims) {
+      auto& state = GetPageState(GetFd(key), GetFpageId(key));
+      resident_set_.Remove(key);
+      // 重新装入之后version不同，便于乐观读检测
+      state.store(WithState(state.load() + VERSION_UNIT, State::Evicted),
+                  std::memory_order_release);
+    }
+    resident_num_.fetch_sub(victims.size(), std::memory_order_relaxed);
+  }
+
+  /**
+   * 常驻页的集合（开放寻址），供clock遍历
+   * 容量为常驻页数上限的两倍，key为(fd << 32 | fpage_id)
+   */
+  class ResidentSet {
+   public:
+    constexpr static uint64_t EMPTY = std::numeric_limits<uint64_t>::max();
+    constexpr static uint64_t TOMBSTONE = EMPTY - 1;
+
+    explicit ResidentSet(size_t capacity) : clock_hand_(0) {
+      capacity_ = 1;
+      while (capacity_ < capacity * 2)
+        capacity_ <<= 1;
+      slots_ = new std::atomic<uint64_t>[capacity_];
+      for (size_t idx = 0; idx < capacity_; idx++)
+        slots_[idx].store(EMPTY);
+    }
+    ~ResidentSet() { delete[] slots_; }
+
+    void Insert(uint64_t key) {
+      for (auto pos = Hash(key);; pos = (pos + 1) & (capacity_ - 1)) {
+        auto cur = slots_[pos].load();
+        if ((cur == EMPTY || cur == TOMBSTONE) &&
+            slots_[pos].compare_exchange_strong(cur, key))
+          return;
+      }
+    }
+
+    void Remove(uint64_t key) {
+      for (auto pos = Hash(key);; pos = (pos + 1) & (capacity_ - 1)) {
+        auto cur = slots_[pos].load();
+        if (cur == key) {
+          slots_[pos].store(TOMBSTONE);
+          return;
+        }
+        if (cur == EMPTY)
+          return;
+      }
+    }
+
+    FORCE_INLINE uint64_t Next() {
+      return slots_[clock_hand_++ & (capacity_ - 1)].load();
+    }
+    size_t Capacity() const { return capacity_; }
+
+   private:
+    FORCE_INLINE size_t Hash(uint64_t key) const {
+      return (key * 0x9E3779B97F4A7C15lu) >> 20 & (capacity_ - 1);
+    }
+
+    std::atomic<uint64_t>* slots_;
+    size_t capacity_;
+    size_t clock_hand_;  // 只在持有eviction_latch_时访问
+  };
+
+  FORCE_INLINE static uint64_t GetKey(GBPfile_handle_type fd,
+                                      fpage_id_type fpage_id) {
+    return (uint64_t) fd << 32 | fpage_id;
+  }
+  FORCE_INLINE static GBPfile_handle_type GetFd(uint64_t key) {
+    return key >> 32;
+  }
+  FORCE_INLINE static fpage_id_type GetFpageId(uint64_t key) {
+    return key & 0xFFFFFFFF;
+  }
+  constexpr static size_t GetReserveSize() {
+    return VM_CACHE_MAX_FILE_NUM * VM_CACHE_FILE_RESERVE_SIZE;
+  }
+  FORCE_INLINE static size_t GetStateId(GBPfile_handle_type fd,
+                                        fpage_id_type fpage_id) {
+    return ((size_t) fd * VM_CACHE_FILE_RESERVE_SIZE >> LOG_PAGE_SIZE_FILE) +
+           fpage_id;
+  }
+  // [begin, end)按OS页对齐后改为可读写
+  static bool Protect(char* begin, char* end) {
+    static const uintptr_t os_page_size = ::sysconf(_SC_PAGESIZE);
+    auto begin_aligned = (uintptr_t) begin / os_page_size * os_page_size;
+    auto end_aligned = ceil((uintptr_t) end, os_page_size) * os_page_size;
+    return ::mprotect((void*) begin_aligned, end_aligned - begin_aligned,
+                      PROT_READ | PROT_WRITE) == 0;
+  }
+  constexpr static size_t GetStateArraySize() {
+    return (GetReserveSize() >> LOG_PAGE_SIZE_FILE) *
+           sizeof(std::atomic<uint64_t>);
+  }
+
+  // 被淘汰的页已经MADV_DONTNEED，文件末尾之后的部分读到的是0
+  void LoadPage(GBPfile_handle_type fd, fpage_id_type fpage_id) {
+    if (auto compressed = disk_manager_->GetCompressedFile(fd)) {
+      bool ret = compressed->Read((size_t) fpage_id << LOG_PAGE_SIZE_FILE,
+                                  GetPageData(fd, fpage_id), PAGE_SIZE_FILE);
+      if (unlikely(!ret))
+        GBPLOG << "compressed read error: fd = " << fd
+               << " fpage_id = " << fpage_id;
+      assert(ret);
+      return;
+    }
+    if (unlikely(!disk_manager_->AcquireFile(fd))) {
+      GBPLOG << "load a page of the closed file: fd = " << fd;
+      return;
+    }
+    auto [fd_os, offset_os] = disk_manager_->Translate(
+        fd, (size_t) fpage_id << LOG_PAGE_SIZE_FILE);
+    auto ret =
+        ::pread(fd_os, GetPageData(fd, fpage_id), PAGE_SIZE_FILE, offset_os);
+    disk_manager_->ReleaseFile(fd);
+    if (unlikely(ret == -1))
+      GBPLOG << "pread error: " << strerror(errno);
+    assert(ret != -1);
+  }
+
+  void WritePage(GBPfile_handle_type fd, fpage_id_type fpage_id) {
+    if (auto compressed = disk_manager_->GetCompressedFile(fd)) {
+      bool ret = compressed->Write((size_t) fpage_id << LOG_PAGE_SIZE_FILE,
+                                   GetPageData(fd, fpage_id), PAGE_SIZE_FILE);
+      if (unlikely(!ret))
+        GBPLOG << "compressed write error: fd = " << fd
+               << " fpage_id = " << fpage_id;
+      assert(ret);
+      return;
+    }
+    if (unlikely(!disk_manager_->AcquireFile(fd))) {
+      GBPLOG << "write back a page of the closed file: fd = " << fd;
+      return;
+    }
+    auto [fd_os, offset_os] = disk_manager_->Translate(
+        fd, (size_t) fpage_id << LOG_PAGE_SIZE_FILE);
+    auto ret =
+        ::pwrite(fd_os, GetPageData(fd, fpage_id), PAGE_SIZE_FILE, offset_os);
+    disk_manager_->ReleaseFile(fd);
+    if (unlikely(ret != (ssize_t) PAGE_SIZE_FILE))
+      GBPLOG << "pwrite error: " << strerror(errno);
+    assert(ret == (ssize_t) PAGE_SIZE_FILE);
+  }
+
+  DiskManager* disk_manager_;
+  const size_t capacity_inpage_;
+  std::atomic<size_t> resident_num_;
+  ResidentSet resident_set_;
+  std::mutex eviction_latch_;
+  std::mutex enable_latch_;
+  std::vector<fpage_id_type> enabled_page_nums_ =
+      std::vector<fpage_id_type>(VM_CACHE_MAX_FILE_NUM, 0);
+  char* data_;
+  std::atomic<uint64_t>* states_;
+};
+
+}  // namespace gbp
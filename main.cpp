@@ -524,6 +524,31 @@ int main(int argc, char** argv) {
   test::test_concurrency(argc, argv);
   // test::test_csv(
   //     "/nvme0n1/lgraph_db/sf0.1/social_network/dynamic/person_0_0.csv");
+  // test::test_chunked_csv("/tmp/gbp_chunked_csv_test.csv");
+  // test::test_column_family_projection("/tmp/gbp_column_family_test.db");
+  // test::test_column_family_pax("/tmp/gbp_column_family_test");
+  // test::test_dict_string_column("/tmp/gbp_dict_string_test");
+  // test::test_compressed_csr("/tmp/gbp_compressed_csr_test");
+  // test::test_vertex_edge_tiers("/tmp/gbp_vertex_edge_tiers_test");
+  // test::test_mutable_csr_mvcc("/tmp/gbp_mutable_csr_mvcc_test");
+  // test::test_index_probe_group("/tmp/gbp_index_probe_group_test.db");
+  // test::test_index_get_batch("/tmp/gbp_index_get_batch_test.db");
+  // test::test_vm_cache("/tmp/gbp_vm_cache_test.db");
+  // test::test_uffd_region("/tmp/gbp_uffd_region_test.db");
+  // test::test_warm_restart("/tmp/gbp_warm_restart_test.db");
+  // test::test_io_priority("/tmp/gbp_io_priority_test.db");
+  // test::test_free_list_magazine();
+  // test::test_async_future();
+  // test::test_eviction_watermark("/tmp/gbp_eviction_watermark_test.db");
+  // test::test_eviction_multi_pool("/tmp/gbp_eviction_multi_pool_test.db");
+  // test::test_disk_stripe("/tmp/gbp_disk_stripe_test");
+  // test::test_disk_close("/tmp/gbp_disk_close_test.db");
+  // test::test_page_compressor();
+  // test::test_compressed_file("/tmp/gbp_compressed_file_test.db");
+  // test::test_compressed_tier();
+  // test::test_buffer_block_pages("/tmp/gbp_buffer_block_test.db");
+  // test::test_io_local_ring("/tmp/gbp_io_local_ring_test.db");
+  // test::test_coroutine_fetch("/tmp/gbp_coroutine_fetch_test.db");
   // test::test_vertex(
   //     "/data/zhengyang/data/graphscope-flex/flex/graphscope_bufferpool/tests/"
   //     "configurations/graph_0.1_bench.yaml",
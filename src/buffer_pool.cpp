@@ -3,17 +3,17 @@
 namespace gbp {
 
 template <>
-void BP_async_request_type_instance<
-    gbp::pair_min<PTE*, char*>>::PromiseSetValue() {
-  promise.set_value(response);
+void BP_async_request_type_instance<gbp::pair_min<PTE*, char*>>::SetValue() {
+  value = response;
+  finish.Post();
 }
 
 template <>
-void BP_async_request_type_instance<BufferBlock>::PromiseSetValue() {
-  BufferBlock ret(block_size, 1);
-  ret.InsertPage(0, response.second + file_offset % PAGE_SIZE_FILE,
-                 response.first);
-  promise.set_value(std::move(ret));
+void BP_async_request_type_instance<BufferBlock>::SetValue() {
+  value = BufferBlock(block_size, 1);
+  value.InsertPage(0, response.second + file_offset % PAGE_SIZE_FILE,
+                   response.first);
+  finish.Post();
 }
 
 /*
@@ -49,16 +49,32 @@ void BufferPool::init(u_int32_t pool_ID, mpage_id_type pool_size,
   replacer_ = new SieveReplacer_v3(page_table_, pool_size_);
   // replacer_ = new ClockReplacer_v2(page_table_, pool_size_);
 
-  for (int i = 0; i < disk_manager_->fd_oss_.size(); i++) {
+  for (int i = 0; i < disk_manager_->GetFileNum(); i++) {
     uint32_t file_size_in_page =
-        ceil(disk_manager_->GetFileSize(i), PAGE_SIZE_MEMORY);
+        ceil(disk_manager_->GetFileSizeFast(i), PAGE_SIZE_MEMORY);
     page_table_->RegisterFile(file_size_in_page);
   }
 
-  free_list_ = new lockfree_queue_type<mpage_id_type>(pool_size_);
-  for (mpage_id_type i = 0; i < pool_size_; ++i) {
-    free_list_->Push(i);
+  free_list_ = new magazine_queue_type<mpage_id_type>(pool_size_);
+  {
+    // 初始的空闲页全部放入全局队列，由各线程按需refill到自己的magazine
+    std::vector<mpage_id_type> pages(pool_size_);
+    for (mpage_id_type i = 0; i < pool_size_; ++i) {
+      pages[i] = i;
+    }
+    assert(free_list_->PushBatch(pages.data(), pages.size()));
   }
+  // 小pool按比例算出的水位可能超过pool的大小：high不超过pool的一半且low < high，
+  // 否则eviction worker要么从不启动，要么把整个pool清空之后也停不下来
+  auto low_watermark = std::max<size_t>(
+      pool_size_ * EVICTION_LOW_WATERMARK_RATIO, EVICTION_MIN_WATERMARK);
+  auto high_watermark = std::max<size_t>(
+      pool_size_ * EVICTION_HIGH_WATERMARK_RATIO, 2 * low_watermark);
+  high_watermark_ = std::clamp<size_t>(high_watermark, 1,
+                                       std::max<size_t>(pool_size_ / 2, 1));
+  low_watermark_ = std::min(low_watermark, high_watermark_ - 1);
+  if (eviction_server_ != nullptr)
+    eviction_server_->RegisterPool(pool_ID_, this);
 
   stop_ = false;
   if constexpr (BP_ASYNC_ENABLE) {
@@ -129,16 +145,19 @@ bool BufferPool::FlushPage(fpage_id_type fpage_id, GBPfile_handle_type fd,
 
   if (mpage_id != PageMapping::Mapping::EMPTY_VALUE) {
     auto* tar = page_table_->FromPageId(mpage_id);
+    UnmapPage(tar);
     if (tar->dirty) {
-      assert(ReadWriteSync(
-          fpage_id * PAGE_SIZE_FILE, PAGE_SIZE_FILE,
-          (char*) memory_pool_.FromPageId(page_table_->ToPageId(tar)),
-          PAGE_SIZE_MEMORY, tar->GetFileHandler(), false));
+      WriteBack(tar, (char*) memory_pool_.FromPageId(mpage_id));
       tar->dirty = false;
     }
     if (delete_from_memory) {
+      // 之后的读从磁盘装入，不会命中压缩层中可能残留的副本
+      EraseFromTier(fd, (size_t) fpage_id * PAGE_SIZE_FILE);
       assert(page_table_->DeleteMapping(fd, fpage_id, mpage_id));
       free_list_->Push(mpage_id);
+    } else {
+      // 页仍然常驻：解除LockMapping设置的BUSY，否则之后的Flush与淘汰都无法再锁住该页
+      assert(page_table_->UnLockMapping(fd, fpage_id, mpage_id));
     }
   } else {
     assert(page_table_->UnLockMapping(fd, fpage_id, mpage_id));
@@ -161,6 +180,15 @@ bool BufferPool::ReadWriteSync(size_t offset, size_t file_size, char* buf,
   //   delete ssd_io_finished;
   //   return true;
   // } else
+  if (is_read && LoadFromTier(fd, offset, buf, buf_size))
+    return true;
+  if (!is_read)
+    EraseFromTier(fd, offset, buf_size);
+  if (auto compressed = disk_manager_->GetCompressedFile(fd);
+      unlikely(compressed != nullptr)) {
+    return is_read ? compressed->Read(offset, buf, buf_size)
+                   : compressed->Write(offset, buf, buf_size);
+  }
   {
     if (is_read)
       return io_server_->sync_io_backend_->Read(offset, buf, buf_size, fd);
@@ -171,17 +199,56 @@ bool BufferPool::ReadWriteSync(size_t offset, size_t file_size, char* buf,
 
 AsyncMesg* BufferPool::ReadWriteAsync(size_t offset, size_t file_size,
                                       char* buf, size_t buf_size,
-                                      GBPfile_handle_type fd, bool is_read) {
-  if constexpr (IO_BACKEND_TYPE == 2) {
-    AsyncMesg* ssd_io_finished = new AsyncMesg4();
-    assert(io_server_->SendRequest(fd, offset, file_size, buf, ssd_io_finished,
-                                   is_read));
+                                      GBPfile_handle_type fd, bool is_read,
+                                      AsyncMesg* finish) {
+  // 压缩层命中的页在当前线程上同步解压；压缩的文件的读经过io_uring，完成时解压（见IOURing::Read），
+  // 写需要先压缩，在当前线程上同步完成
+  if (is_read && LoadFromTier(fd, offset, buf, buf_size)) {
+    AsyncMesg* ssd_io_finished = finish != nullptr ? finish : new AsyncMesg1();
+    ssd_io_finished->Post();
+    return ssd_io_finished;
+  }
+  if (!is_read)
+    EraseFromTier(fd, offset, buf_size);
+  if (auto compressed = disk_manager_->GetCompressedFile(fd);
+      unlikely(compressed != nullptr && !is_read)) {
+    AsyncMesg* ssd_io_finished = finish != nullptr ? finish : new AsyncMesg1();
+    assert(compressed->Write(offset, buf, buf_size));
+    ssd_io_finished->Post();
+    return ssd_io_finished;
+  }
+  if constexpr (IO_LOCAL_RING_ENABLE) {
+    // 由调用线程自己回收completion，因此不需要信号量
+    AsyncMesg* ssd_io_finished = finish != nullptr ? finish : new AsyncMesg1();
+    io_server_->SubmitLocal(fd, offset, buf, buf_size, ssd_io_finished,
+                            is_read);
+    return ssd_io_finished;
+  } else if constexpr (IO_BACKEND_TYPE == 2) {
+    AsyncMesg* ssd_io_finished = finish != nullptr ? finish : new AsyncMesg4();
+    assert(GetIOServer(fd, offset)->SendRequest(fd, offset, file_size, buf,
+                                                ssd_io_finished, is_read));
     return ssd_io_finished;
   } else {
     assert(false);
   }
 }
 
+void BufferPool::WriteBackAsync(PTE* pte, char* buf, AsyncMesg* finish) {
+  auto fd = pte->GetFileHandler();
+  auto offset = pte->fpage_id_cur * PAGE_SIZE_FILE;
+  EraseFromTier(fd, offset);
+  if (IO_SERVER_ENABLE && disk_manager_->GetCompressedFile(fd) == nullptr) {
+    // 与前台读共享IOServer，以写回优先级排队，fdatasync由FlushFile统一完成
+    assert(GetIOServer(fd, offset)->SendRequest(fd, offset, PAGE_SIZE_FILE,
+                                                buf, finish, false,
+                                                IOPriority::WriteBack));
+  } else {
+    assert(ReadWriteSync(offset, PAGE_SIZE_FILE, buf, PAGE_SIZE_MEMORY, fd,
+                         false));
+    finish->Post();
+  }
+}
+
 /**
  * User should call this method for deleting a page. This routine will call
  * disk manager to deallocate the page. First, if page is found within page
@@ -269,6 +336,45 @@ PTE* BufferPool::GetVictimPage() {
   return tar;
 }
 
+/**
+ * 由EvictionServer调用：淘汰至多page_num个页，脏页先写回，然后放入free list
+ * 返回实际淘汰的页数
+ */
+size_t BufferPool::EvictBatch(size_t page_num) {
+  mpage_id_type mpage_ids[EVICTION_BATCH_SIZE];
+  page_num = std::min(page_num, EVICTION_BATCH_SIZE);
+
+  AsyncMesg1 finishes[EVICTION_BATCH_SIZE];
+  size_t evicted = 0;
+  while (evicted < page_num) {
+    // 此时mapping处于BUSY状态，其它线程无法pin该页
+    if (replacer_->Size() == 0 || !replacer_->Victim(mpage_ids[evicted]))
+      break;
+
+    auto* pte = page_table_->FromPageId(mpage_ids[evicted]);
+    UnmapPage(pte);
+    if (pte->dirty)
+      WriteBackAsync(pte, (char*) memory_pool_.FromPageId(mpage_ids[evicted]),
+                     &finishes[evicted]);
+    evicted++;
+  }
+  // 整批的写回都提交之后再等待
+  for (size_t idx = 0; idx < evicted; idx++) {
+    auto* pte = page_table_->FromPageId(mpage_ids[idx]);
+    if (pte->dirty) {
+      while (!finishes[idx].TryWait())
+        std::this_thread::yield();
+    }
+    DemotePage(pte->fd_cur, pte->fpage_id_cur,
+               (char*) memory_pool_.FromPageId(mpage_ids[idx]));
+    assert(page_table_->DeleteMapping(pte->fd_cur, pte->fpage_id_cur,
+                                      mpage_ids[idx]));
+  }
+  if (evicted != 0)
+    assert(free_list_->PushBatch(mpage_ids, evicted));
+  return evicted;
+}
+
 /**
  * 1. search hash table.
  *  1.1 if exist, pin the page and return immediately
@@ -341,29 +447,13 @@ pair_min<PTE*, char*> BufferPool::FetchPageSync(fpage_id_type fpage_id,
     }
     case BP_async_request_type::Phase::Initing: {  // 1.2
       mpage_id_type mpage_id;
-      if (free_list_->Poll(mpage_id)) {
+      if (PollFreePage(mpage_id)) {
         stat = BP_async_request_type::Phase::Loading;
       } else {
-        if constexpr (EVICTION_BATCH_ENABLE) {
-          if (!replacer_->GetFinishMark())  // 单个replacer只允许一个async
-                                            // requst存在
-            break;
-          assert(eviction_server_->SendRequest(
-              replacer_, free_list_, EVICTION_BATCH_SIZE,
-              &replacer_->GetFinishMark(), true));
-          // while (!replacer_->GetFinishMark()) {
-          //   // FIXME: 此处会导致本次query
-          //   latency变大，导致整个workload的tail
-          //   // latency变大
-          //   std::this_thread::yield();
-          // }
-          std::this_thread::yield();
+        // free list由EvictionServer在后台补充，只有耗尽时才由前台线程自己淘汰
+        if (!replacer_->Victim(mpage_id)) {
+          assert(false);
           break;
-        } else {
-          if (!replacer_->Victim(mpage_id)) {
-            assert(false);
-            break;
-          }
         }
         stat = BP_async_request_type::Phase::Evicting;
       }
@@ -388,10 +478,9 @@ pair_min<PTE*, char*> BufferPool::FetchPageSync(fpage_id_type fpage_id,
       assert(disk_manager_->GetUsedMark(fd_old, fpage_id_old) == false);
 #endif
 
+      UnmapPage(ret.first);
       if (ret.first->dirty) {
-        assert(ReadWriteSync(ret.first->fpage_id_cur * PAGE_SIZE_FILE,
-                             PAGE_SIZE_FILE, ret.second, PAGE_SIZE_MEMORY,
-                             ret.first->fd_cur, false));
+        WriteBack(ret.first, ret.second);
         // if (gbp::warmup_mark() == 1) {
         //   as_atomic(disk_manager_->counts_[fd].first)++;
         // }
@@ -404,6 +493,7 @@ pair_min<PTE*, char*> BufferPool::FetchPageSync(fpage_id_type fpage_id,
       //   as_atomic(memory_usages_[memory_pool_.ToPageId(ret.second)]) = 0;
       // }
 
+      DemotePage(ret.first->fd_cur, ret.first->fpage_id_cur, ret.second);
       assert(page_table_->DeleteMapping(ret.first->fd_cur,
                                         ret.first->fpage_id_cur,
                                         page_table_->ToPageId(ret.first)));
@@ -490,26 +580,16 @@ bool BufferPool::FetchPageSync1(BP_sync_request_type& req) {
     }
     case BP_sync_request_type::Phase::Initing: {  // 1.2
       mpage_id_type mpage_id;
-      if (free_list_->Poll(mpage_id)) {
+      if (PollFreePage(mpage_id)) {
         req.runtime_phase = BP_sync_request_type::Phase::Loading;
         req.response.first = page_table_->FromPageId(mpage_id);
         req.response.second = (char*) memory_pool_.FromPageId(mpage_id);
         return false;
       } else {
-        if constexpr (EVICTION_BATCH_ENABLE) {
-          if (!replacer_->GetFinishMark())  // 单个replacer只允许一个async
-                                            // requst存在
-            break;
-          assert(eviction_server_->SendRequest(
-              replacer_, free_list_, EVICTION_BATCH_SIZE,
-              &replacer_->GetFinishMark(), true));
-          std::this_thread::yield();
+        // free list由EvictionServer在后台补充，只有耗尽时才由前台线程自己淘汰
+        if (!replacer_->Victim(mpage_id)) {
+          assert(false);
           break;
-        } else {
-          if (!replacer_->Victim(mpage_id)) {
-            assert(false);
-            break;
-          }
         }
         req.runtime_phase = BP_sync_request_type::Phase::Evicting;
       }
@@ -519,13 +599,13 @@ bool BufferPool::FetchPageSync1(BP_sync_request_type& req) {
       break;
     }
     case BP_sync_request_type::Phase::Evicting: {  // 2
+      UnmapPage(req.response.first);
       if (req.response.first->dirty) {
-        assert(ReadWriteSync(req.response.first->fpage_id_cur * PAGE_SIZE_FILE,
-                             PAGE_SIZE_FILE, req.response.second,
-                             PAGE_SIZE_MEMORY, req.response.first->fd_cur,
-                             false));
+        WriteBack(req.response.first, req.response.second);
       }
 
+      DemotePage(req.response.first->fd_cur, req.response.first->fpage_id_cur,
+                 req.response.second);
       assert(page_table_->DeleteMapping(
           req.response.first->fd_cur, req.response.first->fpage_id_cur,
           page_table_->ToPageId(req.response.first)));
@@ -608,7 +688,7 @@ bool BufferPool::FetchPageSync2(BP_sync_request_type& req) {
     }
     case BP_sync_request_type::Phase::Initing: {  // 1.2
       mpage_id_type mpage_id;
-      if (free_list_->Poll(mpage_id)) {
+      if (PollFreePage(mpage_id)) {
         req.runtime_phase = BP_sync_request_type::Phase::Loading;
         req.response.first = page_table_->FromPageId(mpage_id);
         req.response.second = (char*) memory_pool_.FromPageId(mpage_id);
@@ -625,13 +705,13 @@ bool BufferPool::FetchPageSync2(BP_sync_request_type& req) {
       break;
     }
     case BP_sync_request_type::Phase::Evicting: {  // 2
+      UnmapPage(req.response.first);
       if (req.response.first->dirty) {
-        assert(ReadWriteSync(req.response.first->fpage_id_cur * PAGE_SIZE_FILE,
-                             PAGE_SIZE_FILE, req.response.second,
-                             PAGE_SIZE_MEMORY, req.response.first->fd_cur,
-                             false));
+        WriteBack(req.response.first, req.response.second);
       }
 
+      DemotePage(req.response.first->fd_cur, req.response.first->fpage_id_cur,
+                 req.response.second);
       assert(page_table_->DeleteMapping(
           req.response.first->fd_cur, req.response.first->fpage_id_cur,
           page_table_->ToPageId(req.response.first)));
@@ -641,10 +721,16 @@ bool BufferPool::FetchPageSync2(BP_sync_request_type& req) {
     }
     case BP_sync_request_type::Phase::Loading: {  // 4
 
-      // 创建异步请求
+      // 创建异步请求；本地ring上的请求复用请求中内联的完成消息
+      AsyncMesg* finish = nullptr;
+      if constexpr (IO_LOCAL_RING_ENABLE) {
+        req.ssd_io_finished_inline.Reset();
+        finish = &req.ssd_io_finished_inline;
+      }
       req.ssd_io_finished =
           ReadWriteAsync(req.fpage_id * PAGE_SIZE_FILE, PAGE_SIZE_MEMORY,
-                         req.response.second, PAGE_SIZE_MEMORY, req.fd, true);
+                         req.response.second, PAGE_SIZE_MEMORY, req.fd, true,
+                         finish);
 
       // assert(ReadWriteSync(req.fpage_id * PAGE_SIZE_FILE, PAGE_SIZE_MEMORY,
       //                      req.response.second, PAGE_SIZE_MEMORY, req.fd,
@@ -658,8 +744,137 @@ bool BufferPool::FetchPageSync2(BP_sync_request_type& req) {
       // if (!req.ssd_io_finished->TryWait())
       //   return false;
 
-      assert(req.ssd_io_finished->Wait());
-      delete req.ssd_io_finished;  // 删除异步请求
+      if constexpr (IO_LOCAL_RING_ENABLE) {
+        io_server_->WaitLocal(req.ssd_io_finished);
+      } else {
+        assert(req.ssd_io_finished->Wait());
+        delete req.ssd_io_finished;  // 删除异步请求
+      }
+
+      thread_local static PTE tmp;
+      tmp.Clean();
+
+      tmp.initialized = true;
+      tmp.ref_count = 1;
+      tmp.fpage_id_cur = req.fpage_id;
+      tmp.fd_cur = req.fd;
+      as_atomic(req.response.first->AsPacked()).store(tmp.AsPacked());
+      assert(replacer_->Insert(page_table_->ToPageId(req.response.first)));
+
+      std::atomic_thread_fence(std::memory_order_release);
+      assert(page_table_->CreateMapping(
+          req.fd, req.fpage_id, page_table_->ToPageId(req.response.first)));
+      req.runtime_phase = BP_sync_request_type::Phase::End;
+    }
+    case BP_sync_request_type::Phase::End: {
+      return true;
+    }
+    }
+  }
+  assert(false);
+}
+
+bool BufferPool::FetchPageCoro(BP_sync_request_type& req,
+                               IOBackend& io_backend) {
+#if ASSERT_ENABLE
+  assert(req.fpage_id <
+         CEIL(disk_manager_->GetFileSizeFast(req.fd), PAGE_SIZE_FILE));
+  assert(partitioner_->GetPartitionId(req.fpage_id) == pool_ID_);
+  assert(req.ssd_io_finished != nullptr);
+#endif
+
+  while (true) {
+    switch (req.runtime_phase) {
+    case BP_sync_request_type::Phase::Begin: {
+      auto [locked, mpage_id] = page_table_->LockMapping(req.fd, req.fpage_id);
+
+      if (locked) {
+        if (mpage_id == PageMapping::Mapping::EMPTY_VALUE) {
+          req.runtime_phase = BP_sync_request_type::Phase::Initing;
+        } else if (mpage_id != PageMapping::Mapping::
+                                   BUSY_VALUE) {  // 说明本页早已被load到内存了
+          assert(page_table_->UnLockMapping(req.fd, req.fpage_id, mpage_id));
+          req.response = Pin(req.fpage_id, req.fd);
+          if (req.response.first) {  // pin成功了就返回
+            req.runtime_phase = BP_sync_request_type::Phase::End;
+          }  // pin失败了就重新执行一遍Begin
+        } else {
+          assert(false);
+        }
+      } else {
+        if (mpage_id != PageMapping::Mapping::BUSY_VALUE) {
+          req.response = Pin(req.fpage_id, req.fd);
+          if (req.response.first) {  // pin成功了就返回
+            req.runtime_phase = BP_sync_request_type::Phase::End;
+          }
+        }
+        // 本页正在被其它请求加载，让出当前线程给其它协程
+        return req.runtime_phase == BP_sync_request_type::Phase::End;
+      }
+      break;
+    }
+    case BP_sync_request_type::Phase::ReBegin: {
+      assert(false);
+    }
+    case BP_sync_request_type::Phase::Initing: {  // 1.2
+      mpage_id_type mpage_id;
+      if (PollFreePage(mpage_id)) {
+        req.runtime_phase = BP_sync_request_type::Phase::Loading;
+      } else {
+        if (!replacer_->Victim(mpage_id)) {
+          assert(false);
+          return false;
+        }
+        req.runtime_phase = BP_sync_request_type::Phase::Evicting;
+      }
+      req.response.first = page_table_->FromPageId(mpage_id);
+      req.response.second = (char*) memory_pool_.FromPageId(mpage_id);
+      break;
+    }
+    case BP_sync_request_type::Phase::Evicting: {  // 2
+      UnmapPage(req.response.first);
+      if (req.response.first->dirty) {
+        // 脏页与其它淘汰路径一样以WriteBack优先级写回（见WriteBackAsync），写回期间让出线程给其它协程
+        req.ssd_io_finished->Reset();
+        WriteBackAsync(req.response.first, req.response.second,
+                       req.ssd_io_finished);
+      }
+      req.runtime_phase = BP_sync_request_type::Phase::EvictingFinish;
+      return false;
+    }
+    case BP_sync_request_type::Phase::EvictingFinish: {
+      if (req.response.first->dirty && !req.ssd_io_finished->TryWait())
+        return false;
+
+      DemotePage(req.response.first->fd_cur, req.response.first->fpage_id_cur,
+                 req.response.second);
+      assert(page_table_->DeleteMapping(
+          req.response.first->fd_cur, req.response.first->fpage_id_cur,
+          page_table_->ToPageId(req.response.first)));
+
+      req.runtime_phase = BP_sync_request_type::Phase::Loading;
+      break;
+    }
+    case BP_sync_request_type::Phase::Loading: {  // 4
+      req.ssd_io_finished->Reset();
+      // 与其它装入路径一样先查找压缩层，命中时不发起I/O
+      if (LoadFromTier(req.fd, req.fpage_id * PAGE_SIZE_FILE,
+                       req.response.second, PAGE_SIZE_MEMORY)) {
+        req.ssd_io_finished->Post();
+        req.runtime_phase = BP_sync_request_type::Phase::LoadingFinish;
+        break;
+      }
+      // submission queue已满时让出线程，下一次Poll时重新提交
+      if (!io_backend.Read(req.fpage_id * PAGE_SIZE_FILE, req.response.second,
+                           PAGE_SIZE_MEMORY, req.fd, req.ssd_io_finished))
+        return false;
+      io_backend.Progress();
+      req.runtime_phase = BP_sync_request_type::Phase::LoadingFinish;
+      return false;
+    }
+    case BP_sync_request_type::Phase::LoadingFinish: {
+      if (!req.ssd_io_finished->TryWait())
+        return false;
 
       thread_local static PTE tmp;
       tmp.Clean();
@@ -726,7 +941,7 @@ bool BufferPool::FetchPageAsyncInner(BP_async_request_type& req) {
     case BP_async_request_type::Phase::Initing: {  // 1.2
 
       mpage_id_type mpage_id = 10;
-      if (free_list_->Poll(mpage_id)) {
+      if (PollFreePage(mpage_id)) {
         req.runtime_phase = BP_async_request_type::Phase::Loading;
       } else {
         if (!replacer_->Victim(mpage_id)) {
@@ -743,7 +958,12 @@ bool BufferPool::FetchPageAsyncInner(BP_async_request_type& req) {
     }
     case BP_async_request_type::Phase::Evicting: {  // 2
 
-      if (req.response.first->dirty) {
+      UnmapPage(req.response.first);
+      if (req.response.first->dirty &&
+          disk_manager_->GetCompressedFile(req.response.first->fd_cur) !=
+              nullptr) {
+        WriteBack(req.response.first, req.response.second);
+      } else if (req.response.first->dirty) {
         req.ssd_IO_req.Init(req.response.second, PAGE_SIZE_MEMORY,
                             req.response.first->fpage_id_cur * PAGE_SIZE_FILE,
                             PAGE_SIZE_FILE, req.response.first->fd_cur, nullptr,
@@ -753,6 +973,8 @@ bool BufferPool::FetchPageAsyncInner(BP_async_request_type& req) {
           return false;
         }
       }
+      DemotePage(req.response.first->fd_cur, req.response.first->fpage_id_cur,
+                 req.response.second);
       assert(page_table_->DeleteMapping(
           req.response.first->fd_cur, req.response.first->fpage_id_cur,
           page_table_->ToPageId(req.response.first)));
@@ -764,6 +986,8 @@ bool BufferPool::FetchPageAsyncInner(BP_async_request_type& req) {
       if (!io_server_->ProcessFunc(req.ssd_IO_req))
         return false;
 
+      DemotePage(req.response.first->fd_cur, req.response.first->fpage_id_cur,
+                 req.response.second);
       assert(page_table_->DeleteMapping(
           req.response.first->fd_cur, req.response.first->fpage_id_cur,
           page_table_->ToPageId(req.response.first)));
@@ -781,6 +1005,13 @@ bool BufferPool::FetchPageAsyncInner(BP_async_request_type& req) {
       req.tmp.initialized = false;
       break;
 #else
+      // 压缩层命中的页不经过IOServer
+      if (LoadFromTier(req.fd, fpage_id * PAGE_SIZE_FILE,
+                       req.response.second, PAGE_SIZE_MEMORY)) {
+        req.ssd_IO_req.async_context.state =
+            IOServer::context_type::State::End;
+        break;
+      }
       req.ssd_IO_req.Init(req.response.second, PAGE_SIZE_MEMORY,
                           fpage_id * PAGE_SIZE_FILE, PAGE_SIZE_FILE, req.fd,
                           nullptr, true);
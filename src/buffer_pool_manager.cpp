@@ -2,6 +2,10 @@
 
 #include <bits/stdint-uintn.h>
 #include <sys/mman.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
 #include <utility>
 
 namespace gbp {
@@ -35,6 +39,16 @@ BufferPoolManager::~BufferPoolManager() {
   // #endif
   // #endif
 
+  // 先停止后台淘汰，避免与Flush以及pool的析构并发
+  if (eviction_server_ != nullptr)
+    eviction_server_->Stop();
+
+  if (snapshot_server_.joinable()) {
+    snapshot_stop_ = true;
+    snapshot_server_.join();
+    DumpResidentSet(snapshot_path_);
+  }
+
   if constexpr (PERSISTENT) {
     Flush();
   }
@@ -51,6 +65,9 @@ BufferPoolManager::~BufferPoolManager() {
   for (auto io_server : io_servers_)
     delete io_server;
 
+  delete vm_cache_;
+  delete compressed_tier_;
+
   delete disk_manager_;
 
   delete partitioner_;
@@ -69,18 +86,31 @@ void BufferPoolManager::init(uint16_t pool_num,
   get_pool_num().store(pool_num);
   pool_size_inpage_per_instance_ = pool_size_inpage_per_instance;
 
-  memory_pool_global_ =
-      new MemoryPool(pool_size_inpage_per_instance * pool_num_);
-
   disk_manager_ = new DiskManager(file_path);
   partitioner_ = new RoundRobinPartitioner(pool_num);
-  if constexpr (EVICTION_BATCH_ENABLE)
-    eviction_server_ = new EvictionServer();
-
   for (int idx = 0; idx < io_server_num; idx++) {
     io_servers_.push_back(new IOServer(disk_manager_));
   }
 
+  // VM模式下VMCache是唯一的缓存，帧池的页预算全部交给它，不再创建pool
+  if constexpr (VM_CACHE_ENABLE) {
+    vm_cache_ = new VMCache(disk_manager_,
+                            pool_size_inpage_per_instance * pool_num_);
+    VMCache::GetGlobalInstance() = vm_cache_;
+    initialized_ = true;
+    return;
+  }
+
+  memory_pool_global_ =
+      new MemoryPool(pool_size_inpage_per_instance * pool_num_);
+  if constexpr (EVICTION_BATCH_ENABLE)
+    eviction_server_ =
+        new EvictionServer(ceil(pool_num, EVICTION_POOL_NUM_PER_WORKER));
+  if constexpr (COMPRESSED_TIER_ENABLE)
+    compressed_tier_ = new CompressedTier(
+        pool_size_inpage_per_instance * pool_num_ * PAGE_SIZE_MEMORY *
+        COMPRESSED_TIER_CAPACITY_RATIO);
+
   for (int idx = 0; idx < pool_num; idx++) {
     pools_.push_back(new BufferPool());
     pools_[idx]->init(
@@ -88,7 +118,11 @@ void BufferPoolManager::init(uint16_t pool_num,
         memory_pool_global_->GetSubPool(pool_size_inpage_per_instance * idx,
                                         pool_size_inpage_per_instance),
         io_servers_[idx % io_server_num], partitioner_, eviction_server_);
+    pools_[idx]->SetIOServers(io_servers_);
+    pools_[idx]->SetCompressedTier(compressed_tier_);
   }
+  if (eviction_server_ != nullptr)
+    eviction_server_->Start();
   initialized_ = true;
 
   if constexpr (BP_ASYNC_ENABLE) {
@@ -99,6 +133,8 @@ void BufferPoolManager::init(uint16_t pool_num,
 bool BufferPoolManager::FlushPage(fpage_id_type fpage_id,
                                   GBPfile_handle_type fd,
                                   bool delete_from_memory) {
+  if constexpr (VM_CACHE_ENABLE)
+    return vm_cache_->FlushPage(fd, fpage_id, delete_from_memory);
   return pools_[partitioner_->GetPartitionId(fpage_id)]->FlushPage(
       fpage_id, fd, delete_from_memory);
 }
@@ -111,11 +147,17 @@ bool BufferPoolManager::FlushFile(GBPfile_handle_type fd,
   assert(disk_manager_->ValidFD(fd));
 #endif
   bool ret = true;
-  size_t fpage_num =
-      ceil(disk_manager_->file_size_inBytes_[fd], PAGE_SIZE_FILE);
-  for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
-    ret = FlushPage(fpage_id, fd, delete_from_memory);
+  if constexpr (VM_CACHE_ENABLE) {
+    ret = vm_cache_->FlushFile(fd, delete_from_memory);
+  } else {
+    size_t fpage_num =
+        ceil(disk_manager_->GetFileSizeFast(fd), PAGE_SIZE_FILE);
+    for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+      ret = FlushPage(fpage_id, fd, delete_from_memory);
+    }
   }
+  if (IO_SERVER_ENABLE || disk_manager_->GetCompressedFile(fd) != nullptr)
+    disk_manager_->Sync(fd);
   return ret;
 }
 
@@ -125,23 +167,53 @@ bool BufferPoolManager::LoadFile(GBPfile_handle_type fd) {
 #endif
   bool ret = true;
   size_t fpage_num =
-      ceil(disk_manager_->file_size_inBytes_[fd], PAGE_SIZE_FILE);
+      ceil(disk_manager_->GetFileSizeFast(fd), PAGE_SIZE_FILE);
 
-  for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
-    auto mpage = pools_[partitioner_->GetPartitionId(fpage_id)]->FetchPageSync(
-        fpage_id, fd);
-    mpage.first->DecRefCount();
+  if constexpr (VM_CACHE_ENABLE) {
+    for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+      vm_cache_->FixShared(fd, fpage_id);
+      vm_cache_->UnfixShared(fd, fpage_id);
+    }
+    return ret;
+  }
+  std::vector<BP_sync_request_type> requests;
+  for (size_t start = 0; start < fpage_num; start += BULK_LOAD_BATCH_SIZE) {
+    requests.clear();
+    for (size_t fpage_id = start;
+         fpage_id < std::min(start + BULK_LOAD_BATCH_SIZE, fpage_num);
+         fpage_id++)
+      requests.emplace_back(fd, fpage_id);
+    LoadPageBatch(requests);
   }
   return ret;
 }
 
+void BufferPoolManager::LoadPageBatch(
+    std::vector<BP_sync_request_type>& requests) const {
+  // 批量装入以最低的优先级排队，不影响前台的缺页读
+  IOPriorityScope priority_scope(IOPriority::Bulk);
+  // 先为整批请求分配帧并提交读请求，再逐个等待完成
+  for (auto& req : requests) {
+    auto pool = pools_[partitioner_->GetPartitionId(req.fpage_id)];
+    while (req.runtime_phase != BP_sync_request_type::Phase::End &&
+           req.runtime_phase != BP_sync_request_type::Phase::LoadingFinish)
+      pool->FetchPageSync2(req);
+  }
+  for (auto& req : requests) {
+    auto pool = pools_[partitioner_->GetPartitionId(req.fpage_id)];
+    while (!pool->FetchPageSync2(req))
+      ;
+    req.response.first->DecRefCount();
+  }
+}
+
 bool BufferPoolManager::Flush(bool delete_from_memory) {
 #ifdef GRAPHSCOPE
   LOG(INFO) << "Flush the whole bufferpool: Start";
 #endif
   std::vector<std::thread> thread_pool;
 
-  for (int fd = 0; fd < disk_manager_->fd_oss_.size(); fd++) {
+  for (int fd = 0; fd < disk_manager_->GetFileNum(); fd++) {
     if (disk_manager_->ValidFD(fd)) {
       thread_pool.emplace_back(
           [&, fd]() { assert(FlushFile(fd, delete_from_memory)); });
@@ -160,20 +232,206 @@ bool BufferPoolManager::Flush(bool delete_from_memory) {
   return true;
 }
 
+bool BufferPoolManager::DumpResidentSet(const std::string& path) const {
+  // 各pool按照页在本pool中的相对位置（0为最热）合并
+  std::vector<std::pair<double, uint64_t>> entries;
+  std::vector<std::pair<GBPfile_handle_type, fpage_id_type>> pages;
+  for (auto pool : pools_) {
+    pages.clear();
+    pool->GetResidentPages(pages);
+    for (size_t idx = 0; idx < pages.size(); idx++)
+      entries.emplace_back((double) idx / pages.size(),
+                           (uint64_t) pages[idx].first << 32 |
+                               pages[idx].second);
+  }
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+  // 先写临时文件再rename，保证快照文件总是完整的
+  auto path_tmp = path + ".tmp";
+  {
+    std::ofstream file(path_tmp, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+      return false;
+    auto write = [&file](const auto& value) {
+      file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    write(WARM_RESTART_SNAPSHOT_MAGIC);
+    // 文件按fd记录路径，已关闭的文件记为空
+    uint32_t file_num = disk_manager_->GetFileNum();
+    write(file_num);
+    for (uint32_t fd = 0; fd < file_num; fd++) {
+      auto file_name = disk_manager_->ValidFD(fd)
+                           ? disk_manager_->GetFilePath(fd)
+                           : std::string();
+      uint32_t name_len = file_name.size();
+      write(name_len);
+      file.write(file_name.data(), name_len);
+    }
+    uint64_t page_num = entries.size();
+    write(page_num);
+    for (auto& entry : entries)
+      write(entry.second);
+    if (!file.good())
+      return false;
+  }
+  std::filesystem::rename(path_tmp, path);
+  return true;
+}
+
+size_t BufferPoolManager::LoadResidentSet(const std::string& path,
+                                          size_t page_budget) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return 0;
+  auto read = [&file](auto& value) {
+    file.read(reinterpret_cast<char*>(&value), sizeof(value));
+  };
+
+  uint64_t magic = 0;
+  read(magic);
+  if (magic != WARM_RESTART_SNAPSHOT_MAGIC) {
+    GBPLOG << "invalid warm restart snapshot: " << path;
+    return 0;
+  }
+
+  // 快照中的fd映射到当前打开的文件
+  std::unordered_map<std::string, GBPfile_handle_type> fds_cur;
+  for (GBPfile_handle_type fd = 0; fd < disk_manager_->GetFileNum(); fd++)
+    if (disk_manager_->ValidFD(fd))
+      fds_cur[disk_manager_->GetFilePath(fd)] = fd;
+  uint32_t file_num = 0;
+  read(file_num);
+  std::vector<GBPfile_handle_type> fd_map(file_num, INVALID_FILE_HANDLE);
+  for (uint32_t fd = 0; fd < file_num; fd++) {
+    uint32_t name_len = 0;
+    read(name_len);
+    std::string file_name(name_len, '\0');
+    file.read(file_name.data(), name_len);
+    auto iter = fds_cur.find(file_name);
+    if (iter != fds_cur.end())
+      fd_map[fd] = iter->second;
+  }
+
+  // 保持热度顺序，按照当前的partitioner分到各pool
+  uint64_t page_num = 0;
+  read(page_num);
+  std::vector<std::vector<std::pair<GBPfile_handle_type, fpage_id_type>>>
+      pages(pool_num_);
+  for (uint64_t idx = 0; idx < page_num && file.good(); idx++) {
+    uint64_t entry;
+    read(entry);
+    uint32_t fd_old = entry >> 32;
+    fpage_id_type fpage_id = entry & 0xFFFFFFFF;
+    if (fd_old >= file_num || fd_map[fd_old] == INVALID_FILE_HANDLE)
+      continue;
+    auto fd = fd_map[fd_old];
+    if (fpage_id >= ceil(disk_manager_->GetFileSizeFast(fd), PAGE_SIZE_FILE))
+      continue;
+    pages[partitioner_->GetPartitionId(fpage_id)].emplace_back(fd, fpage_id);
+  }
+
+  // 每个pool一个线程，按热度顺序每次提交一批异步读，整批完成后再提交下一批；
+  // 每个pool最多装入page_budget中按pool大小分到的份额，不淘汰已经装入的更热的页
+  std::atomic<size_t> loaded_num = 0;
+  std::vector<std::thread> thread_pool;
+  for (size_t pool_id = 0; pool_id < pool_num_; pool_id++) {
+    if (pages[pool_id].empty())
+      continue;
+    thread_pool.emplace_back([&, pool_id]() {
+      // 装满的pool会被eviction worker淘汰回high watermark，而SIEVE最先淘汰的正是最先装入的最热的页：
+      // 空闲页保留high watermark，再加上装入线程的magazine可能囤积的页
+      auto pool = pools_[pool_id];
+      size_t pool_capacity = pool_size_inpage_per_instance_;
+      if (eviction_server_ != nullptr)
+        pool_capacity -= std::min(
+            pool_capacity,
+            pool->high_watermark_ + pool->free_list_->GetMagazineCapacity());
+      size_t pool_budget = std::min(
+          {pages[pool_id].size(), pool_capacity, ceil(page_budget, pool_num_)});
+      std::vector<BP_sync_request_type> requests;
+      for (size_t start = 0; start < pool_budget;
+           start += BULK_LOAD_BATCH_SIZE) {
+        requests.clear();
+        for (size_t idx = start;
+             idx < std::min(start + BULK_LOAD_BATCH_SIZE, pool_budget); idx++)
+          requests.emplace_back(pages[pool_id][idx].first,
+                                pages[pool_id][idx].second);
+        LoadPageBatch(requests);
+        loaded_num.fetch_add(requests.size(), std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto& thread : thread_pool)
+    thread.join();
+
+#ifdef GRAPHSCOPE
+  LOG(INFO) << "Warm restart: load " << loaded_num.load() << " of "
+            << page_num << " pages";
+#endif
+  return loaded_num.load();
+}
+
+void BufferPoolManager::EnableResidentSetSnapshot(const std::string& path) {
+  assert(!snapshot_server_.joinable());
+  snapshot_path_ = path;
+  snapshot_server_ = std::thread([this]() {
+    size_t elapsed = 0;
+    while (!snapshot_stop_) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      if (++elapsed % WARM_RESTART_DUMP_INTERVAL_SECOND == 0)
+        DumpResidentSet(snapshot_path_);
+    }
+  });
+}
+
 void BufferPoolManager::RegisterFile(GBPfile_handle_type fd) {
   for (auto pool : pools_) {
     pool->RegisterFile(fd);
   }
+  // VM模式下每个fd占用VMCache中的一段预留地址（GBP fd不复用），fd或文件大小超出预留范围时无法访问
+  if constexpr (VM_CACHE_ENABLE) {
+    if (!vm_cache_->EnableFile(fd, disk_manager_->GetFileSizeFast(fd))) {
+      GBPLOG << "failed to register fd = " << fd << " to VMCache";
+      exit(-1);
+    }
+  }
 }
 
 bool BufferPoolManager::ReadWrite(size_t offset, size_t file_size, char* buf,
                                   size_t buf_size, GBPfile_handle_type fd,
                                   bool is_read) const {
+  if (is_read && compressed_tier_ != nullptr &&
+      compressed_tier_->LoadRange(fd, offset, buf, buf_size))
+    return true;
+  // 写入之后压缩层中的副本已经过时
+  if (!is_read && compressed_tier_ != nullptr) {
+    for (size_t idx = 0; idx < ceil(buf_size, PAGE_SIZE_FILE); idx++)
+      compressed_tier_->Erase(fd, (offset >> LOG_PAGE_SIZE_FILE) + idx);
+  }
+  if (auto compressed = disk_manager_->GetCompressedFile(fd);
+      unlikely(compressed != nullptr)) {
+    return is_read ? compressed->Read(offset, buf, buf_size)
+                   : compressed->Write(offset, buf, buf_size);
+  }
+  // 条带化的文件按设备选择IOServer
   auto io_server =
-      io_servers_[partitioner_->GetPartitionId(offset >> LOG_PAGE_SIZE_FILE) %
-                  io_servers_.size()];
-
-  if constexpr (IO_BACKEND_TYPE == 2) {
+      disk_manager_->GetStripeNum(fd) > 1
+          ? io_servers_[disk_manager_->GetDeviceId(fd, offset) %
+                        io_servers_.size()]
+          : io_servers_[partitioner_->GetPartitionId(offset >>
+                                                     LOG_PAGE_SIZE_FILE) %
+                        io_servers_.size()];
+
+  if constexpr (IO_LOCAL_RING_ENABLE) {
+    AsyncMesg1 ssd_io_finished;
+    io_server->SubmitLocal(fd, offset, buf, buf_size, &ssd_io_finished,
+                           is_read);
+    io_server->WaitLocal(&ssd_io_finished);
+    return true;
+  } else if constexpr (IO_BACKEND_TYPE == 2) {
     AsyncMesg* ssd_io_finished = new AsyncMesg2();
     assert(io_server->SendRequest(fd, offset, file_size, buf, ssd_io_finished,
                                   is_read));
@@ -221,9 +479,50 @@ bool BufferPoolManager::LoadPage(pair_min<PTE*, char*> mpage) {
 
 bool BufferPoolManager::Clean() { return Flush(true); }
 
+BufferBlock BufferPoolManager::GetBlockFromVM(
+    size_t file_offset, size_t block_size, GBPfile_handle_type fd) const {
+  if (block_size == 0)
+    return BufferBlock();
+
+  fpage_id_type fpage_id = file_offset >> LOG_PAGE_SIZE_FILE;
+  fpage_id_type fpage_id_end =
+      (file_offset + block_size - 1) >> LOG_PAGE_SIZE_FILE;
+  size_t fpage_offset = file_offset % PAGE_SIZE_FILE;
+  BufferBlock ret(block_size, fpage_id_end - fpage_id + 1);
+  for (size_t page_id = 0; fpage_id <= fpage_id_end; page_id++, fpage_id++) {
+    ret.InsertPage(page_id, vm_cache_->FixShared(fd, fpage_id) + fpage_offset,
+                   nullptr);
+    fpage_offset = 0;
+  }
+  return ret;
+}
+
+void BufferPoolManager::SetBlockVM(size_t file_offset, size_t block_size,
+                                   GBPfile_handle_type fd, bool flush,
+                                   const std::function<void(char*)>& write) {
+  if (block_size == 0)
+    return;
+  auto guard = vm_cache_->Fix(file_offset, block_size, fd);
+  write(guard.Data());
+  guard.MarkDirty();
+  guard.Release();
+  if (flush) {
+    fpage_id_type fpage_id_end =
+        (file_offset + block_size - 1) >> LOG_PAGE_SIZE_FILE;
+    for (auto fpage_id = file_offset >> LOG_PAGE_SIZE_FILE;
+         fpage_id <= fpage_id_end; fpage_id++)
+      assert(vm_cache_->FlushPage(fd, fpage_id));
+  }
+}
+
 int BufferPoolManager::GetBlock(char* buf, size_t file_offset,
                                 size_t block_size,
                                 GBPfile_handle_type fd) const {
+  if constexpr (VM_CACHE_ENABLE) {
+    auto guard = vm_cache_->Fix(file_offset, block_size, fd);
+    memcpy(buf, guard.Data(), block_size);
+    return 0;
+  }
   // std::lock_guard<std::mutex> lck(latch_);
   fpage_id_type fpage_id = file_offset >> LOG_PAGE_SIZE_FILE;
   size_t fpage_offset = file_offset % PAGE_SIZE_FILE;
@@ -251,6 +550,11 @@ int BufferPoolManager::GetBlock(char* buf, size_t file_offset,
 int BufferPoolManager::SetBlock(const char* buf, size_t file_offset,
                                 size_t block_size, GBPfile_handle_type fd,
                                 bool flush) {
+  if constexpr (VM_CACHE_ENABLE) {
+    SetBlockVM(file_offset, block_size, fd, flush,
+               [&](char* dst) { memcpy(dst, buf, block_size); });
+    return 0;
+  }
   fpage_id_type fpage_id = file_offset >> LOG_PAGE_SIZE_FILE;
   size_t fpage_offset = file_offset % PAGE_SIZE_FILE;
   size_t object_size_t = 0;
@@ -284,6 +588,11 @@ int BufferPoolManager::SetBlock(const BufferBlock& buf, size_t file_offset,
 #if ASSERT_ENABLE
   assert(buf.Size() == block_size);
 #endif
+  if constexpr (VM_CACHE_ENABLE) {
+    SetBlockVM(file_offset, block_size, fd, flush,
+               [&](char* dst) { buf.Copy(dst, block_size); });
+    return block_size;
+  }
 
   fpage_id_type fpage_id = file_offset >> LOG_PAGE_SIZE_FILE;
   size_t fpage_offset = file_offset % PAGE_SIZE_FILE;
@@ -317,6 +626,8 @@ int BufferPoolManager::SetBlock(const BufferBlock& buf, size_t file_offset,
 
 const BufferBlock BufferPoolManager::GetBlockSync(
     size_t file_offset, size_t block_size, GBPfile_handle_type fd) const {
+  if constexpr (VM_CACHE_ENABLE)
+    return GetBlockFromVM(file_offset, block_size, fd);
   if (block_size == 0) {
     return BufferBlock();
   }
@@ -384,6 +695,8 @@ const BufferBlock BufferPoolManager::GetBlockSync(
 
 const BufferBlock BufferPoolManager::GetBlockSync1(
     size_t file_offset, size_t block_size, GBPfile_handle_type fd) const {
+  if constexpr (VM_CACHE_ENABLE)
+    return GetBlockFromVM(file_offset, block_size, fd);
   if (block_size == 0) {
     return BufferBlock();
   }
@@ -437,7 +750,12 @@ const BufferBlock BufferPoolManager::GetBlockSync1(
       fpage_offset = 0;
       fpage_id++;
     }
-    if (count_t == num_page) {
+    // 压缩的文件以及有页在压缩层中时逐页读取
+    if (count_t == num_page &&
+        disk_manager_->GetCompressedFile(fd) == nullptr &&
+        (compressed_tier_ == nullptr ||
+         !compressed_tier_->ContainsAny(fd, file_offset >> LOG_PAGE_SIZE_FILE,
+                                        num_page))) {
       // get_counter_global(11)++;
       // get_counter_global(12) += num_page;
 
@@ -527,12 +845,15 @@ const BufferBlock BufferPoolManager::GetBlockSync1(
  * @param file_offset 文件偏移量
  * @param block_size 块大小
  * @param fd 文件描述符
- * @return 一个future对象，当block准备好时，future对象会被设置为block
+ * @return 一个AsyncFuture对象，当block准备好时，AsyncFuture对象会被设置为block
  *
  * 本函数是为每一个bufferpool创建一个服务线程，用于处理异步请求
  */
-std::future<BufferBlock> BufferPoolManager::GetBlockAsync(
+AsyncFuture<BufferBlock> BufferPoolManager::GetBlockAsync(
     size_t file_offset, size_t block_size, GBPfile_handle_type fd) const {
+  if constexpr (VM_CACHE_ENABLE)
+    return AsyncFuture<BufferBlock>::Ready(
+        GetBlockFromVM(file_offset, block_size, fd));
   size_t fpage_offset = file_offset % PAGE_SIZE_FILE;
   size_t num_page =
       fpage_offset == 0 || (block_size <= (PAGE_SIZE_FILE - fpage_offset))
@@ -548,23 +869,22 @@ std::future<BufferBlock> BufferPoolManager::GetBlockAsync(
     if (mpage.first != nullptr) {
       BufferBlock block(block_size, 1);
       block.InsertPage(0, mpage.second + fpage_offset, mpage.first);
-      std::promise<BufferBlock> promise;
-      promise.set_value(block);
-      return promise.get_future();
+      return AsyncFuture<BufferBlock>::Ready(std::move(block));
     } else {
       return pools_[partitioner_->GetPartitionId(fpage_id)]->FetchBlockAsync(
           fd, file_offset, block_size);
     }
   } else {
-    auto* req = new async_request_type(fd, file_offset, block_size, num_page);
-    auto ret = req->promise.get_future();
+    auto* req = ObjectPool<async_request_type>::New(fd, file_offset,
+                                                    block_size, num_page);
+    auto ret = req->GetFuture();
 
     if (!ProcessFunc(*req)) {
       assert(req->run_time_phase != async_request_type::Phase::End);
       while (!request_channel_.push(req))
         ;
     } else {
-      delete req;
+      req->SetValue();
     }
     return ret;
   }
@@ -573,6 +893,8 @@ std::future<BufferBlock> BufferPoolManager::GetBlockAsync(
 
 const BufferBlock BufferPoolManager::GetBlockAsync1(
     size_t file_offset, size_t block_size, GBPfile_handle_type fd) const {
+  if constexpr (VM_CACHE_ENABLE)
+    return GetBlockFromVM(file_offset, block_size, fd);
   if (block_size == 0) {
     return BufferBlock();
   }
@@ -618,6 +940,71 @@ const BufferBlock BufferPoolManager::GetBlockAsync1(
   return ret;
 }
 
+#if COROUTINE_ENABLE
+bool BufferPoolManager::block_awaiter_type::await_ready() {
+  if constexpr (VM_CACHE_ENABLE) {
+    response_ = bpm_.GetBlockFromVM(file_offset_, block_size_, fd_);
+    return true;
+  }
+  if (block_size_ == 0)
+    return true;
+
+  size_t fpage_offset = file_offset_ % PAGE_SIZE_FILE;
+  const size_t num_page =
+      fpage_offset == 0 || (block_size_ <= (PAGE_SIZE_FILE - fpage_offset))
+          ? CEIL(block_size_, PAGE_SIZE_FILE)
+          : (CEIL(block_size_ - (PAGE_SIZE_FILE - fpage_offset),
+                  PAGE_SIZE_FILE) +
+             1);
+  if (unlikely(num_page > COROUTINE_MAX_PAGE_NUM)) {
+    response_ = bpm_.GetBlockSync(file_offset_, block_size_, fd_);
+    return true;
+  }
+#if ASSERT_ENABLE
+  assert(CoroScheduler::Current() != nullptr);
+#endif
+
+  response_ = BufferBlock(block_size_, num_page);
+  fpage_id_type fpage_id = file_offset_ >> LOG_PAGE_SIZE_FILE;
+  for (size_t page_id = 0; page_id < num_page; page_id++) {
+    auto result =
+        bpm_.pools_[bpm_.partitioner_->GetPartitionId(fpage_id)]->Pin(fpage_id,
+                                                                      fd_);
+    if (result.first) {
+      response_.InsertPage(page_id, result.second + fpage_offset,
+                           result.first);
+    } else {
+      auto& req = requests_[num_request_];
+      req = BP_sync_request_type(fd_, fpage_id, fpage_offset, page_id);
+      req.ssd_io_finished = &io_finished_[num_request_];
+      num_request_++;
+    }
+    fpage_id++;
+    fpage_offset = 0;
+  }
+
+  return num_request_ == 0 || Poll();
+}
+
+bool BufferPoolManager::block_awaiter_type::Poll() {
+  auto& ring = CoroScheduler::Current()->Ring();
+  for (uint32_t req_id = 0; req_id < num_request_; req_id++) {
+    auto& req = requests_[req_id];
+    if (req.is_inserted)
+      continue;
+    if (bpm_.pools_[bpm_.partitioner_->GetPartitionId(req.fpage_id)]
+            ->FetchPageCoro(req, ring)) {
+      response_.InsertPage(req.page_id_in_block,
+                           req.response.second + req.fpage_offset,
+                           req.response.first);
+      req.is_inserted = true;
+      num_finished_++;
+    }
+  }
+  return num_finished_ == num_request_;
+}
+#endif
+
 const std::vector<BufferBlock> BufferPoolManager::GetBlockBatch_new(
     const std::vector<batch_request_type>& requests) const {
   // gbp::get_counter_local(10) = 0;
@@ -625,6 +1012,13 @@ const std::vector<BufferBlock> BufferPoolManager::GetBlockBatch_new(
   if (requests.empty()) {
     return std::vector<BufferBlock>();
   }
+  if constexpr (VM_CACHE_ENABLE) {
+    std::vector<BufferBlock> rets;
+    for (auto& request : requests)
+      rets.push_back(GetBlockFromVM(request.file_offset_, request.block_size_,
+                                    request.fd_));
+    return rets;
+  }
   std::vector<BufferBlock> rets;
   std::vector<BP_sync_request_type> buf;
   std::vector<uint32_t> req_ids;
@@ -691,6 +1085,13 @@ const void BufferPoolManager::GetBlockBatchWithoutDirectCache(
   if (batch_requests.empty()) {
     return;
   }
+  if constexpr (VM_CACHE_ENABLE) {
+    for (auto& batch_request : batch_requests)
+      results.push_back(GetBlockFromVM(batch_request.file_offset_,
+                                       batch_request.block_size_,
+                                       batch_request.fd_));
+    return;
+  }
   thread_local std::vector<BP_sync_request_type> BP_sync_requests;
   BP_sync_requests.clear();
   thread_local std::vector<uint32_t> req_ids;
@@ -792,6 +1193,13 @@ const void BufferPoolManager::GetBlockBatchWithDirectCache(
   if (batch_requests.empty()) {
     return;
   }
+  if constexpr (VM_CACHE_ENABLE) {
+    for (auto& batch_request : batch_requests)
+      results.push_back(GetBlockFromVM(batch_request.file_offset_,
+                                       batch_request.block_size_,
+                                       batch_request.fd_));
+    return;
+  }
   thread_local std::vector<BP_sync_request_type> BP_sync_requests;
   BP_sync_requests.clear();
   thread_local std::vector<uint32_t> req_ids;
@@ -913,6 +1321,8 @@ const void BufferPoolManager::GetBlockBatchWithDirectCache(
 
 const BufferBlock BufferPoolManager::GetBlockBatch1(
     size_t file_offset, size_t block_size, GBPfile_handle_type fd) const {
+  if constexpr (VM_CACHE_ENABLE)
+    return GetBlockFromVM(file_offset, block_size, fd);
   thread_local std::vector<BP_sync_request_type> requests;
   requests.clear();
   if (block_size == 0) {
@@ -971,6 +1381,8 @@ const BufferBlock BufferPoolManager::GetBlockBatch1(
 
 const BufferBlock BufferPoolManager::GetBlockWithDirectCacheSync(
     size_t file_offset, size_t block_size, GBPfile_handle_type fd) const {
+  if constexpr (VM_CACHE_ENABLE)
+    return GetBlockFromVM(file_offset, block_size, fd);
   if (block_size == 0) {
     return BufferBlock();
   }
@@ -0,0 +1,80 @@
+#include "../include/eviction_server.h"
+#include "../include/buffer_pool.h"
+
+namespace gbp {
+
+bool EvictionServer::NeedRefill(BufferPool& pool) {
+  auto free_page_num = pool.free_list_->GlobalSize();
+  return free_page_num < pool.low_watermark_ ||
+         (pool.refilling_ && free_page_num < pool.high_watermark_);
+}
+
+bool EvictionServer::ProcessFunc(BufferPool& pool) {
+  auto free_page_num = pool.free_list_->GlobalSize();
+  if (free_page_num >= pool.high_watermark_) {
+    pool.refilling_ = false;
+    return false;
+  }
+  if (!pool.refilling_ && free_page_num >= pool.low_watermark_)
+    return false;
+
+  // 低于low watermark之后一直补充到high watermark，每轮最多EVICTION_BATCH_SIZE个页，避免饿死其它pool
+  pool.refilling_ = true;
+  auto page_num =
+      std::min(pool.high_watermark_ - free_page_num, EVICTION_BATCH_SIZE);
+  if (pool.EvictBatch(page_num) == 0) {  // 所有页都被pin住了
+    pool.refilling_ = false;
+    return false;
+  }
+  return true;
+}
+
+void EvictionServer::Run(eviction_worker_type& worker) {
+  size_t backoff_us = 0;
+  while (!stop_) {
+    bool busy = false;
+    for (auto* pool : worker.pools) {
+      busy |= ProcessFunc(*pool);
+    }
+    if (busy) {
+      backoff_us = 0;
+      continue;
+    }
+
+    // 先声明休眠再检查一遍，避免与Notify之间丢失唤醒
+    worker.state.store(eviction_worker_type::State::Parked);
+    bool stalled = false;
+    for (auto* pool : worker.pools) {
+      stalled |= NeedRefill(*pool);
+    }
+    if (stop_) {
+      worker.state.store(eviction_worker_type::State::Running);
+      continue;
+    }
+    if (!stalled) {
+      backoff_us = 0;
+      ::syscall(SYS_futex, &worker.state, FUTEX_WAIT_PRIVATE,
+                eviction_worker_type::State::Parked, nullptr, nullptr, 0);
+      continue;
+    }
+
+    // 需要补充却没有淘汰出任何页：等待页被unpin，期间忽略Notify（只有Stop会唤醒）
+    uint32_t expected = eviction_worker_type::State::Parked;
+    if (!worker.state.compare_exchange_strong(
+            expected, eviction_worker_type::State::BackingOff))
+      continue;
+    backoff_us =
+        backoff_us == 0
+            ? EVICTION_BACKOFF_MIN_MICROSECOND
+            : std::min(backoff_us * 2, EVICTION_BACKOFF_MAX_MICROSECOND);
+    struct timespec timeout = {(time_t) (backoff_us / 1000000),
+                               (long) (backoff_us % 1000000 * 1000)};
+    ::syscall(SYS_futex, &worker.state, FUTEX_WAIT_PRIVATE,
+              eviction_worker_type::State::BackingOff, &timeout, nullptr, 0);
+    expected = eviction_worker_type::State::BackingOff;
+    worker.state.compare_exchange_strong(
+        expected, eviction_worker_type::State::Running);
+  }
+}
+
+}  // namespace gbp
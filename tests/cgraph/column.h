@@ -16,8 +16,12 @@
 #ifndef GRAPHSCOPE_PROPERTY_COLUMN_H_
 #define GRAPHSCOPE_PROPERTY_COLUMN_H_
 
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
 #include "../include/buffer_pool_manager.h"
 #include "column_family.h"
@@ -88,7 +92,7 @@ class ColumnBaseAsync {
 
   //   virtual void set_any(size_t index, const Any& value) = 0;
 
-  virtual std::future<gbp::BufferBlock> get_async(size_t index) const = 0;
+  virtual gbp::AsyncFuture<gbp::BufferBlock> get_async(size_t index) const = 0;
   virtual void set(size_t index, const gbp::BufferBlock& value) = 0;
 
   virtual size_t get_size_in_byte() const = 0;
@@ -251,12 +255,12 @@ class StringColumn : public ColumnBase
   }
   gbp::BufferBlock get(size_t idx) const override { return get_inner(idx); }
 
-  std::future<gbp::BufferBlock> get_inner_async(size_t idx) const {
+  gbp::AsyncFuture<gbp::BufferBlock> get_inner_async(size_t idx) const {
     auto string_item_t = column_family_->getColumn(idx, column_id_);
     auto& item = gbp::BufferBlock::Ref<string_item>(string_item_t);
     return context_buffer_.get_async(item.offset, item.length);
   }
-  std::future<gbp::BufferBlock> get_async(size_t idx) const override {
+  gbp::AsyncFuture<gbp::BufferBlock> get_async(size_t idx) const override {
     return get_inner_async(idx);
   }
 
@@ -290,6 +294,217 @@ class StringColumn : public ColumnBase
   // size_t width_;
 };  // namespace gs
 
+#if !OV
+/**
+ * 字典编码的string column，适用于低基数的属性（国家、浏览器、tag等）
+ * 1. column family中只存放uint32_t的code，heap中每个不同的string只存一次（append-only）
+ * 2. dict_记录code对应的string_item，内存中维护string到code的hash表用于去重
+ * 3. 等值过滤先把常量翻译成code，然后在column family上比较整数，不需要访问heap
+ * 4. 内存中保留了字典的一份拷贝，读取时只需要一次buffer pool访问（读code）
+ * 5. .dict的第0项是header（offset为字典大小，length为DICT_MAGIC），code对应第code + 1项，
+ *    每次插入字典时同步更新，重新打开时不需要外部记录字典大小
+ */
+class DictStringColumn : public ColumnBase {
+ public:
+  using code_type = uint32_t;
+  constexpr static code_type INVALID_CODE =
+      std::numeric_limits<code_type>::max();
+
+  DictStringColumn() : column_family_(nullptr), column_id_(0), pos_(0) {}
+  ~DictStringColumn() = default;
+
+  // 绑定存放code的column，需要在open之前调用
+  void init(FixedLengthColumnFamily& column_family, size_t column_id) {
+    assert(column_family.getPropertyLength(column_id) == sizeof(code_type));
+    column_family_ = &column_family;
+    column_id_ = column_id;
+  }
+
+  // 打开heap_filename及heap_filename + ".dict"（不存在时创建），并根据header重建字典，
+  // header无效时返回false
+  bool open(FixedLengthColumnFamily& column_family, size_t column_id,
+            const std::string& heap_filename) {
+    init(column_family, column_id);
+    heap_.open(heap_filename, false);
+    dict_.open(heap_filename + ".dict", false);
+    return load_dict();
+  }
+
+  void open(const std::string& name, const std::string& snapshot_dir,
+            const std::string& work_dir) override {
+    assert(column_family_ != nullptr);
+    heap_.open(snapshot_dir + "/" + name, true);
+    heap_.touch(work_dir + "/" + name);
+    dict_.open(snapshot_dir + "/" + name + ".dict", true);
+    dict_.touch(work_dir + "/" + name + ".dict");
+    // 接口没有返回值：字典无效时记录日志后返回，字典保持为空，所有行解码为空串
+    if (!load_dict()) {
+      gbp::GBPLOG << "failed to open dict string column " << name << " from "
+                  << snapshot_dir;
+      return;
+    }
+  }
+
+  void touch(const std::string& filename) override {
+    std::unique_lock<std::shared_mutex> lck(latch_);
+    heap_.touch(filename);
+    dict_.touch(filename + ".dict");
+  }
+
+  void dump(const std::string& filename) override {
+    std::unique_lock<std::shared_mutex> lck(latch_);
+    heap_.dump(filename);
+    dict_.dump(filename + ".dict");
+  }
+
+  size_t size() const override { return column_family_->getRowNum(); }
+  // code存放在column family中，column family由多个column共享，由它的所有者resize；
+  // 本列自己的heap和dict在encode时按需增长，因此这里不需要做任何事
+  void resize(size_t size) override {}
+
+  // 返回val的code，不存在时插入字典
+  code_type encode(std::string_view val) {
+    {
+      std::shared_lock<std::shared_mutex> lck(latch_);
+      auto iter = codes_.find(val);
+      if (iter != codes_.end())
+        return iter->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lck(latch_);
+    auto iter = codes_.find(val);
+    if (iter != codes_.end())
+      return iter->second;
+
+    code_type code = values_.size();
+    assert(code != INVALID_CODE);
+    auto offset = pos_;
+    pos_ += val.size();
+    if (heap_.size() < pos_)
+      heap_.resize(std::max(pos_, heap_.size() * 2));
+    if (dict_.size() <= code + 1)
+      dict_.resize(std::max<size_t>(code + 2, dict_.size() * 2));
+    if (!val.empty())
+      heap_.set(offset, val, val.size());
+    string_item item = {offset, static_cast<uint32_t>(val.size())};
+    dict_.set(code + 1, {reinterpret_cast<const char*>(&item), sizeof(item)});
+    // 先写入字典项再更新header
+    store_header(code + 1);
+
+    // deque中的元素地址不变，hash表的key直接引用它
+    auto& value = values_.emplace_back(val);
+    codes_.emplace(value, code);
+    return code;
+  }
+
+  // 只查找不插入，用于把过滤条件中的常量翻译成code
+  code_type find_code(std::string_view val) const {
+    std::shared_lock<std::shared_mutex> lck(latch_);
+    auto iter = codes_.find(val);
+    return iter == codes_.end() ? INVALID_CODE : iter->second;
+  }
+
+  void set_value(size_t idx, std::string_view val) {
+    auto code = encode(val);
+    column_family_->setColumn(
+        idx, column_id_,
+        {reinterpret_cast<const char*>(&code), sizeof(code_type)});
+  }
+
+  code_type get_code(size_t idx) const {
+    auto item_t = column_family_->getColumn(idx, column_id_);
+    return gbp::BufferBlock::Ref<code_type>(item_t);
+  }
+
+  // 不在字典中的code（例如字典为空时未赋值的行）解码为空串
+  std::string_view decode(code_type code) const {
+    std::shared_lock<std::shared_mutex> lck(latch_);
+    if (code >= values_.size())
+      return {};
+    return values_[code];
+  }
+
+  std::string_view get_view(size_t idx) const { return decode(get_code(idx)); }
+
+  gbp::BufferBlock get(size_t idx) const override {
+    auto value = get_view(idx);
+    return gbp::BufferBlock(value.size(), const_cast<char*>(value.data()));
+  }
+
+  void set(size_t idx, const gbp::BufferBlock& value) override {
+    std::string sv(value.Size(), '\0');
+    value.Copy(sv.data(), value.Size());
+    set_value(idx, sv);
+  }
+
+  // 返回[rowId, rowId + rowNum)中值等于val的行号，只比较code
+  void filter_equal(size_t rowId, size_t rowNum, std::string_view val,
+                    std::vector<size_t>& rows) const {
+    auto code = find_code(val);
+    if (code == INVALID_CODE)
+      return;
+    column_family_->filterColumn<int32_t>(rowId, rowNum, column_id_, code,
+                                          code, rows);
+  }
+
+  size_t dict_size() const {
+    std::shared_lock<std::shared_mutex> lck(latch_);
+    return values_.size();
+  }
+
+  size_t get_size_in_byte() const override {
+    return heap_.get_size_in_byte() + dict_.get_size_in_byte();
+  }
+
+ private:
+  constexpr static uint16_t DICT_MAGIC = 0xD1C7;
+
+  void store_header(size_t dict_size) {
+    string_item header = {dict_size, DICT_MAGIC};
+    dict_.set(0, {reinterpret_cast<const char*>(&header), sizeof(header)});
+  }
+
+  bool load_dict() {
+    std::unique_lock<std::shared_mutex> lck(latch_);
+    values_.clear();
+    codes_.clear();
+    pos_ = 0;
+    if (dict_.size() == 0) {
+      dict_.resize(1);
+      store_header(0);
+      return true;
+    }
+
+    auto header_t = dict_.get(0);
+    auto header = gbp::BufferBlock::Ref<string_item>(header_t);
+    if (header.length != DICT_MAGIC || header.offset + 1 > dict_.size()) {
+      gbp::GBPLOG << "invalid dict header in " << dict_.filename();
+      return false;
+    }
+    for (code_type code = 0; code < header.offset; code++) {
+      auto item_t = dict_.get(code + 1);
+      auto& item = gbp::BufferBlock::Ref<string_item>(item_t);
+      auto value_t = heap_.get(item.offset, item.length);
+      auto& value = values_.emplace_back(item.length, '\0');
+      value_t.Copy(value.data(), item.length);
+      codes_.emplace(value, code);
+      pos_ = std::max<size_t>(pos_, item.offset + item.length);
+    }
+    return true;
+  }
+
+  mmap_array<char> heap_;
+  mmap_array<string_item> dict_;
+  FixedLengthColumnFamily* column_family_;
+  size_t column_id_;
+  size_t pos_;  // heap中下一个空闲位置，受latch_保护
+
+  mutable std::shared_mutex latch_;
+  std::deque<std::string> values_;
+  std::unordered_map<std::string_view, code_type> codes_;
+};
+#endif
+
 // std::shared_ptr<ColumnBase> CreateColumn(
 //     PropertyType type, StorageStrategy strategy = StorageStrategy::kMem);
 
@@ -1,27 +1,115 @@
 #pragma once
 
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "../mmap_array.h"
 
 namespace test {
 
+namespace pax_impl {
+// 把values[0..num)中满足low <= value <= high的行号（first_row + idx）追加到rows中
+template <typename T>
+inline void filter_range(const T* values, size_t num, T low, T high,
+                         size_t first_row, std::vector<size_t>& rows) {
+  static_assert(std::is_integral_v<T> && std::is_signed_v<T>);
+  size_t idx = 0;
+#ifdef __AVX2__
+  if constexpr (sizeof(T) == sizeof(int32_t)) {
+    const __m256i low_v = _mm256_set1_epi32(low);
+    const __m256i high_v = _mm256_set1_epi32(high);
+    for (; idx + 8 <= num; idx += 8) {
+      __m256i value = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + idx));
+      __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(low_v, value),
+                                        _mm256_cmpgt_epi32(value, high_v));
+      uint32_t mask =
+          ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF;
+      while (mask != 0) {
+        rows.push_back(first_row + idx + __builtin_ctz(mask));
+        mask &= mask - 1;
+      }
+    }
+  } else if constexpr (sizeof(T) == sizeof(int64_t)) {
+    const __m256i low_v = _mm256_set1_epi64x(low);
+    const __m256i high_v = _mm256_set1_epi64x(high);
+    for (; idx + 4 <= num; idx += 4) {
+      __m256i value = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + idx));
+      __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(low_v, value),
+                                        _mm256_cmpgt_epi64(value, high_v));
+      uint32_t mask =
+          ~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xF;
+      while (mask != 0) {
+        rows.push_back(first_row + idx + __builtin_ctz(mask));
+        mask &= mask - 1;
+      }
+    }
+  }
+#endif
+  for (; idx < num; idx++) {
+    if (values[idx] >= low && values[idx] <= high)
+      rows.push_back(first_row + idx);
+  }
+}
+}  // namespace pax_impl
+
 class FixedLengthColumnFamily {
+ public:
+  /**
+   * kRow：按行存储，每行是各个column的拼接
+   * kPAX：每个页存放row_num_perpage_行，页内每个column占一个minipage（该页所有行的这个column连续存放），
+   * 只扫描部分column时不会把其它column带进cache，并且可以直接在frame上做SIMD过滤。
+   * layout、行长度和每页行数记录在"<filename>.meta"中，打开时据此校验，避免用另一种layout解读同一个文件
+   */
+  enum class Layout { kRow, kPAX };
+
  private:
   gbp::mmap_array property_buffer_;
-  size_t row_num_;
-  size_t row_capacity_;
+  size_t row_num_ = 0;
+  size_t row_capacity_ = 0;
   std::vector<size_t> offsets_;  // 记录column family中各个column的偏移量
   std::vector<size_t> columnLengths_;
+  Layout layout_ = Layout::kRow;
+  size_t row_num_perpage_ = 0;  // 只在kPAX下有效
+
+  struct LayoutMeta {
+    uint64_t magic;
+    uint64_t layout;
+    uint64_t row_size;
+    uint64_t row_num_perpage;
+  };
+  constexpr static uint64_t LAYOUT_META_MAGIC = 0x434F4C46414D4C59;
+
+  // PAX布局下row所在的页
+  FORCE_INLINE size_t getPageId(size_t rowId) const {
+    return rowId / row_num_perpage_;
+  }
+  // PAX布局下row所在页的最后一行之后的行号
+  FORCE_INLINE size_t getPageRowEnd(size_t rowId) const {
+    return (rowId / row_num_perpage_ + 1) * row_num_perpage_;
+  }
+  // PAX布局下row的column在页内的偏移量
+  FORCE_INLINE size_t getMinipageOffset(size_t rowId, size_t columnId) const {
+    return row_num_perpage_ * offsets_[columnId] +
+           (rowId % row_num_perpage_) * columnLengths_[columnId];
+  }
 
  public:
   FixedLengthColumnFamily() = default;
   ~FixedLengthColumnFamily() = default;
 
-  void init(const std::vector<size_t>& ColumnLengths,
-            const std::string& filename) {
+  // 已有文件的layout与指定的不一致时返回false
+  bool init(const std::vector<size_t>& ColumnLengths,
+            const std::string& filename, Layout layout = Layout::kRow) {
     columnLengths_ = ColumnLengths;
+    layout_ = layout;
     // 计算column family中各个column的偏移量
     size_t offset = 0;
     for (size_t length : ColumnLengths) {
@@ -29,7 +117,14 @@ class FixedLengthColumnFamily {
       offset += length;
     }
     offsets_.push_back(offset);
-    property_buffer_.open(filename, false, offset);
+    if (layout_ == Layout::kPAX) {
+      assert(offset <= gbp::PAGE_SIZE_FILE);
+      row_num_perpage_ = gbp::PAGE_SIZE_FILE / offset;
+      property_buffer_.open(filename, false, gbp::PAGE_SIZE_FILE);
+    } else {
+      property_buffer_.open(filename, false, offset);
+    }
+    return check_meta();
   }
 
   // 设置单个column的值 (注意修改是非atomic的)
@@ -40,21 +135,63 @@ class FixedLengthColumnFamily {
     assert(newValue.size() == columnLengths_[columnId]);
 #endif
     // 更新value
+    if (layout_ == Layout::kPAX) {
+      property_buffer_.set_partial(getPageId(rowId),
+                                   getMinipageOffset(rowId, columnId),
+                                   {newValue.data(), newValue.size()});
+      return;
+    }
     property_buffer_.set_partial(rowId, offsets_[columnId],
                                  {newValue.data(), newValue.size()});
   }
 
-  // 设置整个column family的值 (注意修改是非atomic的)
-  void setColumnFamily(size_t rowId, size_t columnId,
-                       std::string_view newValue) {
+  // 设置整个column family的值，即一整行 (注意修改是非atomic的)
+  void setColumnFamily(size_t rowId, std::string_view newValue) {
 #if ASSERT_ENABLE
     assert(rowId < row_capacity_);
-    assert(columnId < offsets_.size());
-    assert(newValue.size() == columnLengths_[columnId]);
+    assert(newValue.size() == offsets_.back());
 #endif
-    // 更新value
-    property_buffer_.set(rowId * offsets_.back(), newValue.data(),
-                         newValue.size());
+    // PAX：各个column分别写入所在的minipage
+    if (layout_ == Layout::kPAX) {
+      setRows(rowId, 1, newValue);
+      return;
+    }
+    property_buffer_.set(rowId, newValue);
+  }
+
+  // 批量设置[rowId, rowId + rowNum)的整行数据，rows按行紧密排列 (注意修改是非atomic的)
+  void setRows(size_t rowId, size_t rowNum, std::string_view rows) {
+#if ASSERT_ENABLE
+    assert(rowId + rowNum <= row_capacity_);
+    assert(rows.size() == rowNum * offsets_.back());
+#endif
+    if (layout_ == Layout::kRow) {
+      property_buffer_.set_batch(rowId, rows, rowNum);
+      return;
+    }
+
+    // PAX：同一页中的行的同一个column是连续的，每个(页, column)只调用一次set_partial
+    std::vector<char> minipage;
+    size_t row_idx = 0;
+    while (row_idx < rowNum) {
+      auto row_num = std::min(rowNum - row_idx,
+                              row_num_perpage_ -
+                                  (rowId + row_idx) % row_num_perpage_);
+      for (size_t columnId = 0; columnId < columnLengths_.size(); columnId++) {
+        auto length = columnLengths_[columnId];
+        minipage.resize(row_num * length);
+        for (size_t idx = 0; idx < row_num; idx++)
+          ::memcpy(minipage.data() + idx * length,
+                   rows.data() + (row_idx + idx) * offsets_.back() +
+                       offsets_[columnId],
+                   length);
+        property_buffer_.set_partial(
+            getPageId(rowId + row_idx),
+            getMinipageOffset(rowId + row_idx, columnId),
+            {minipage.data(), minipage.size()});
+      }
+      row_idx += row_num;
+    }
   }
 
   // 获取单个column的值
@@ -68,22 +205,206 @@ class FixedLengthColumnFamily {
     }
     assert(columnId < offsets_.size());
 #endif
+    if (layout_ == Layout::kPAX)
+      return property_buffer_.get_partial(getPageId(rowId),
+                                          getMinipageOffset(rowId, columnId),
+                                          columnLengths_[columnId]);
     return property_buffer_.get_partial(rowId, offsets_[columnId],
                                         columnLengths_[columnId]);
   }
 
+  /**
+   * 读取同一行的多个column，整行（请求的column所覆盖的部分）只被pin一次
+   * 返回的BufferBlock中按columnIds的顺序紧密排列各个column的值；行跨页时同样适用
+   */
+  gbp::BufferBlock getColumns(size_t rowId,
+                              const std::vector<size_t>& columnIds) const {
+#if ASSERT_ENABLE
+    assert(rowId < row_capacity_);
+#endif
+    size_t size = 0, start = getRowSize(), end = 0;
+    for (auto columnId : columnIds) {
+      size += columnLengths_[columnId];
+      start = std::min(start, offsets_[columnId]);
+      end = std::max(end, offsets_[columnId] + columnLengths_[columnId]);
+    }
+    gbp::BufferBlock ret(size);
+    if (size == 0)
+      return ret;
+
+    if (layout_ == Layout::kPAX) {
+      auto page = property_buffer_.get(getPageId(rowId));
+      char* dst = ret.Data();
+      for (auto columnId : columnIds) {
+        page.Copy(dst, columnLengths_[columnId],
+                  getMinipageOffset(rowId, columnId));
+        dst += columnLengths_[columnId];
+      }
+      return ret;
+    }
+
+    auto row = property_buffer_.get_partial(rowId, start, end - start);
+    char* dst = ret.Data();
+    for (auto columnId : columnIds) {
+      row.Copy(dst, columnLengths_[columnId], offsets_[columnId] - start);
+      dst += columnLengths_[columnId];
+    }
+    return ret;
+  }
+
+  /**
+   * 扫描[rowId, rowId + rowNum)行的columnIds列
+   * 1. 每次取连续的一批行（约SCAN_BATCH_SIZE_IN_BYTE），每个页只pin一次
+   * 2. 对每一行调用cb(rowId, columns)，columns[i]指向columnIds[i]的值，只在cb内有效
+   * 3. 跨页的column会先被拷贝到临时缓冲区中
+   */
+  void scanColumns(
+      size_t rowId, size_t rowNum, const std::vector<size_t>& columnIds,
+      const std::function<void(size_t, const char* const*)>& cb) const {
+    constexpr size_t SCAN_BATCH_SIZE_IN_BYTE = 64 * gbp::PAGE_SIZE_MEMORY;
+#if ASSERT_ENABLE
+    assert(rowId + rowNum <= row_capacity_);
+#endif
+    const size_t batch_row_num =
+        std::max<size_t>(SCAN_BATCH_SIZE_IN_BYTE / getRowSize(), 1);
+    std::vector<const char*> columns(columnIds.size());
+    if (layout_ == Layout::kPAX) {
+      // 每个页只pin一次，column在minipage中，不会跨页
+      for (size_t row_id = rowId; row_id < rowId + rowNum;) {
+        auto page = property_buffer_.get(getPageId(row_id));
+        auto row_end = std::min(rowId + rowNum,
+                                getPageRowEnd(row_id));
+        for (; row_id < row_end; row_id++) {
+          for (size_t idx = 0; idx < columnIds.size(); idx++)
+            columns[idx] =
+                page.Data() + getMinipageOffset(row_id, columnIds[idx]);
+          cb(row_id, columns.data());
+        }
+      }
+      return;
+    }
+
+    size_t scratch_size = 0;
+    for (auto columnId : columnIds)
+      scratch_size += columnLengths_[columnId];
+    std::vector<char> scratch(scratch_size);
+
+    for (size_t batch_start = rowId; batch_start < rowId + rowNum;
+         batch_start += batch_row_num) {
+      auto row_num = std::min(batch_row_num, rowId + rowNum - batch_start);
+      auto rows = property_buffer_.get(batch_start, row_num);
+      const size_t base = property_buffer_.get_file_offset(batch_start);
+
+      for (size_t row_id = batch_start; row_id < batch_start + row_num;
+           row_id++) {
+        size_t row_offset = property_buffer_.get_file_offset(row_id) - base;
+        char* scratch_ptr = scratch.data();
+        for (size_t idx = 0; idx < columnIds.size(); idx++) {
+          auto offset = row_offset + offsets_[columnIds[idx]];
+          auto length = columnLengths_[columnIds[idx]];
+          const char* column = rows.Ptr<char>(offset);
+          if ((uintptr_t) column % gbp::PAGE_SIZE_MEMORY + length >
+              gbp::PAGE_SIZE_MEMORY) {
+            rows.Copy(scratch_ptr, length, offset);
+            column = scratch_ptr;
+            scratch_ptr += length;
+          }
+          columns[idx] = column;
+        }
+        cb(row_id, columns.data());
+      }
+    }
+  }
+
+  /**
+   * 返回[rowId, rowId + rowNum)中column的值在[low, high]之间的行号（升序）
+   * PAX布局下直接在frame中的minipage上做SIMD比较；T为int32_t（int32）或int64_t（Date）
+   */
+  template <typename T>
+  void filterColumn(size_t rowId, size_t rowNum, size_t columnId, T low,
+                    T high, std::vector<size_t>& rows) const {
+    assert(columnLengths_[columnId] == sizeof(T));
+    if (layout_ == Layout::kPAX) {
+      for (size_t row_id = rowId; row_id < rowId + rowNum;) {
+        auto page = property_buffer_.get(getPageId(row_id));
+        auto row_end = std::min(rowId + rowNum,
+                                getPageRowEnd(row_id));
+        pax_impl::filter_range(reinterpret_cast<const T*>(
+                                   page.Data() +
+                                   getMinipageOffset(row_id, columnId)),
+                               row_end - row_id, low, high, row_id, rows);
+        row_id = row_end;
+      }
+      return;
+    }
+
+    scanColumns(rowId, rowNum, {columnId},
+                [&](size_t row_id, const char* const* columns) {
+                  T value;
+                  ::memcpy(&value, columns[0], sizeof(T));
+                  if (value >= low && value <= high)
+                    rows.push_back(row_id);
+                });
+  }
+
+  Layout getLayout() const { return layout_; }
   // 获取column的长度
   size_t getPropertyLength(size_t columnId) const {
     return columnLengths_[columnId];
   }
+  // 获取column在行内的偏移量
+  size_t getColumnOffset(size_t columnId) const { return offsets_[columnId]; }
+  // 获取一行的长度
+  size_t getRowSize() const { return offsets_.back(); }
   // 获取column的长度
   size_t getRowNum() const { return row_num_; }
   size_t getSizeInByte() const { return property_buffer_.get_size_in_byte(); }
   // size的单位为byte
   void resize(size_t size) {
-    property_buffer_.resize(size * offsets_.back());
+    if (layout_ == Layout::kPAX)
+      property_buffer_.resize(gbp::ceil(size, row_num_perpage_));
+    else
+      property_buffer_.resize(size * offsets_.back());
+    row_num_ = size;
     row_capacity_ = size;
   }
+
+ private:
+  /**
+   * 新建的文件写入meta；已有文件的meta必须与init时指定的一致。
+   * 没有meta的已有文件是引入kPAX之前建立的，只能按kRow打开
+   */
+  bool check_meta() {
+    const std::string meta_path = property_buffer_.filename() + ".meta";
+    const LayoutMeta expected = {LAYOUT_META_MAGIC,
+                                 static_cast<uint64_t>(layout_), getRowSize(),
+                                 row_num_perpage_};
+    std::ifstream meta_file(meta_path, std::ios::binary);
+    if (meta_file) {
+      LayoutMeta meta;
+      meta_file.read(reinterpret_cast<char*>(&meta), sizeof(meta));
+      if (!meta_file || ::memcmp(&meta, &expected, sizeof(meta)) != 0) {
+        gbp::GBPLOG << "column family layout does not match "
+                    << meta_path;
+        return false;
+      }
+      return true;
+    }
+    if (property_buffer_.size() != 0 && layout_ != Layout::kRow) {
+      gbp::GBPLOG << "column family without layout meta opened as PAX: "
+                  << property_buffer_.filename();
+      return false;
+    }
+
+    std::ofstream out(meta_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&expected), sizeof(expected));
+    out.flush();
+    if (!out) {
+      gbp::GBPLOG << "failed to write column family meta " << meta_path;
+      return false;
+    }
+    return true;
+  }
 };
 
 }  // namespace test
@@ -0,0 +1,513 @@
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../mmap_array.h"
+#include "mutable_csr.h"
+
+namespace test {
+
+namespace svb_impl {
+/**
+ * StreamVByte编码
+ * 1. 每4个值共用一个控制字节，每个值占2bit，表示该值编码后的字节数-1
+ * 2. 控制字节与数据字节分开存放，解码时根据控制字节查表得到shuffle mask，一次解出4个值
+ */
+struct shuffle_table {
+  shuffle_table() {
+    for (size_t ctrl = 0; ctrl < 256; ctrl++) {
+      uint8_t offset = 0;
+      for (size_t lane = 0; lane < 4; lane++) {
+        uint8_t len = ((ctrl >> (2 * lane)) & 3) + 1;
+        for (uint8_t byte = 0; byte < 4; byte++)
+          masks[ctrl][lane * 4 + byte] = byte < len ? offset + byte : 0x80;
+        offset += len;
+      }
+      lengths[ctrl] = offset;
+    }
+  }
+
+  alignas(16) uint8_t masks[256][16];
+  uint8_t lengths[256];
+};
+
+inline const shuffle_table& get_shuffle_table() {
+  static const shuffle_table table;
+  return table;
+}
+
+FORCE_INLINE inline uint8_t encoded_length(uint32_t value) {
+  return value < (1u << 8)    ? 1
+         : value < (1u << 16) ? 2
+         : value < (1u << 24) ? 3
+                              : 4;
+}
+
+/**
+ * chunk格式：[first: 4B][num: 2B][control bytes][data bytes]
+ * 1. first为第一个邻居的绝对值，之后num - 1个值为与前一个邻居的差
+ * 2. chunk不会跨页，可以直接在buffer pool的页上解码
+ * 3. num为0表示该页剩余部分是padding
+ */
+constexpr static size_t CHUNK_HEADER_SIZE =
+    sizeof(uint32_t) + sizeof(uint16_t);
+constexpr static size_t CHUNK_VALUE_NUM = 128;
+constexpr static size_t CHUNK_MAX_SIZE =
+    CHUNK_HEADER_SIZE + (CHUNK_VALUE_NUM - 1 + 3) / 4 +
+    (CHUNK_VALUE_NUM - 1) * sizeof(uint32_t);
+static_assert(CHUNK_MAX_SIZE <= gbp::PAGE_SIZE_MEMORY);
+
+// values已经排好序，返回编码后的字节数
+inline size_t encode_chunk(const vid_t* values, size_t num, char* out) {
+  assert(num != 0 && num <= CHUNK_VALUE_NUM);
+  uint32_t first = values[0];
+  uint16_t num_t = num;
+  ::memcpy(out, &first, sizeof(uint32_t));
+  ::memcpy(out + sizeof(uint32_t), &num_t, sizeof(uint16_t));
+
+  size_t delta_num = num - 1;
+  auto* ctrl = reinterpret_cast<uint8_t*>(out + CHUNK_HEADER_SIZE);
+  auto* data = reinterpret_cast<uint8_t*>(ctrl + (delta_num + 3) / 4);
+  ::memset(ctrl, 0, (delta_num + 3) / 4);
+  for (size_t idx = 0; idx < delta_num; idx++) {
+    uint32_t delta = values[idx + 1] - values[idx];
+    auto len = encoded_length(delta);
+    ctrl[idx / 4] |= (len - 1) << (2 * (idx % 4));
+    ::memcpy(data, &delta, len);
+    data += len;
+  }
+  return reinterpret_cast<char*>(data) - out;
+}
+
+// 解码一个chunk，page_end为chunk所在页的末尾（SIMD load不能越过它），返回chunk的字节数
+inline size_t decode_chunk(const char* in, const char* page_end, vid_t* out,
+                           size_t& num) {
+  uint32_t prev;
+  uint16_t num_t;
+  ::memcpy(&prev, in, sizeof(uint32_t));
+  ::memcpy(&num_t, in + sizeof(uint32_t), sizeof(uint16_t));
+  num = num_t;
+  out[0] = prev;
+
+  size_t delta_num = num - 1;
+  auto* ctrl = reinterpret_cast<const uint8_t*>(in + CHUNK_HEADER_SIZE);
+  auto* data = ctrl + (delta_num + 3) / 4;
+  size_t idx = 0;
+#ifdef __SSSE3__
+  auto& table = get_shuffle_table();
+  __m128i prev_v = _mm_set1_epi32(prev);
+  for (; idx + 4 <= delta_num &&
+         reinterpret_cast<const char*>(data) + 16 <= page_end;
+       idx += 4) {
+    auto c = ctrl[idx / 4];
+    __m128i deltas = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)),
+        _mm_load_si128(reinterpret_cast<const __m128i*>(table.masks[c])));
+    data += table.lengths[c];
+    // 4个差值的前缀和
+    deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+    deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+    prev_v = _mm_add_epi32(deltas, prev_v);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + idx + 1), prev_v);
+    prev_v = _mm_shuffle_epi32(prev_v, 0xFF);
+  }
+  prev = out[idx];
+#endif
+  for (; idx < delta_num; idx++) {
+    uint8_t len = ((ctrl[idx / 4] >> (2 * (idx % 4))) & 3) + 1;
+    uint32_t delta = 0;
+    ::memcpy(&delta, data, len);
+    data += len;
+    prev += delta;
+    out[idx + 1] = prev;
+  }
+  return reinterpret_cast<const char*>(data) - in;
+}
+
+// 从chunks的pos处解码下一个chunk到out中（跳过页尾的padding），返回解码出的邻居个数
+inline size_t decode_next_chunk(const gbp::BufferBlock& chunks, size_t& pos,
+                                vid_t* out) {
+  while (true) {
+    auto* chunk = chunks.Ptr<char>(pos);
+    auto remaining =
+        gbp::PAGE_SIZE_MEMORY - ((uintptr_t) chunk % gbp::PAGE_SIZE_MEMORY);
+    uint16_t num = 0;
+    if (remaining >= CHUNK_HEADER_SIZE)
+      ::memcpy(&num, chunk + sizeof(uint32_t), sizeof(uint16_t));
+    if (num == 0) {  // padding，跳到下一页
+      pos += remaining;
+      continue;
+    }
+    size_t num_t = 0;
+    pos += decode_chunk(chunk, chunk + remaining, out, num_t);
+    return num_t;
+  }
+}
+}  // namespace svb_impl
+
+// CompressedCsr中插入之后还没有压缩的边
+struct CompressedDeltaEdge {
+  vid_t neighbor;
+  timestamp_t timestamp;
+};
+
+/**
+ * 压缩邻接表的迭代器
+ * 1. 每次只解码一个chunk到迭代器内部的数组中，不需要为整个邻接表分配空间
+ * 2. 压缩的部分遍历完之后再遍历增量边，只有存在增量边时才会分配delta_
+ */
+class CompressedCsrConstEdgeIter : public MutableCsrConstEdgeIterBase {
+ public:
+  CompressedCsrConstEdgeIter()
+      : compressed_num_(0), pos_(0), value_num_(0), value_idx_(0) {}
+  CompressedCsrConstEdgeIter(gbp::BufferBlock&& chunks, size_t degree,
+                             std::vector<CompressedDeltaEdge>&& delta)
+      : chunks_(std::move(chunks)),
+        compressed_num_(degree),
+        pos_(0),
+        value_num_(0),
+        value_idx_(0),
+        delta_(std::move(delta)),
+        delta_idx_(0) {
+    load_chunk();
+  }
+  ~CompressedCsrConstEdgeIter() = default;
+
+  vid_t get_neighbor() const override {
+    return value_idx_ < value_num_ ? values_[value_idx_]
+                                   : delta_[delta_idx_].neighbor;
+  }
+  const void* get_data() const override { return &data_; }
+  // 压缩的边在构建时都已经可见
+  timestamp_t get_timestamp() const override {
+    return value_idx_ < value_num_ ? 0 : delta_[delta_idx_].timestamp;
+  }
+  size_t size() const override {
+    return compressed_num_ + (value_num_ - value_idx_) + delta_.size() -
+           delta_idx_;
+  }
+
+  void next() override {
+    if (value_idx_ < value_num_) {
+      if (++value_idx_ == value_num_)
+        load_chunk();
+    } else {
+      ++delta_idx_;
+    }
+  }
+  bool is_valid() const override {
+    return value_idx_ < value_num_ || delta_idx_ < delta_.size();
+  }
+
+ private:
+  void load_chunk() {
+    value_idx_ = 0;
+    value_num_ = 0;
+    if (compressed_num_ != 0) {
+      value_num_ = svb_impl::decode_next_chunk(chunks_, pos_, values_);
+      compressed_num_ -= value_num_;
+    }
+  }
+
+  gbp::BufferBlock chunks_;
+  size_t compressed_num_;  // 还没有解码的邻居个数
+  size_t pos_;
+  vid_t values_[svb_impl::CHUNK_VALUE_NUM];
+  size_t value_num_;
+  size_t value_idx_;
+  std::vector<CompressedDeltaEdge> delta_;
+  size_t delta_idx_;
+  EmptyType data_;
+};
+
+// 边上没有属性，并且压缩的边不保存时间戳，set_data不需要做任何修改
+class CompressedCsrEdgeIter : public MutableCsrEdgeIterBase {
+ public:
+  explicit CompressedCsrEdgeIter(CompressedCsrConstEdgeIter&& iter)
+      : iter_(std::move(iter)) {}
+  ~CompressedCsrEdgeIter() = default;
+
+  vid_t get_neighbor() const override { return iter_.get_neighbor(); }
+  const void* get_data() const override { return iter_.get_data(); }
+  timestamp_t get_timestamp() const override { return iter_.get_timestamp(); }
+  void set_data(const std::string_view value, timestamp_t ts) override {}
+
+  void next() override { iter_.next(); }
+  bool is_valid() const override { return iter_.is_valid(); }
+
+ private:
+  CompressedCsrConstEdgeIter iter_;
+};
+
+/**
+ * 压缩CSR（边上没有属性，对应MutableNbr<EmptyType>）
+ * 1. 每个顶点的邻居排序后按chunk进行差分 + StreamVByte编码，不再存储timestamp
+ * 2. 解码直接在buffer pool的页上进行，chunk不跨页，所以不需要先拷贝出来
+ * 3. 通过build从MutableCsr等构建；之后插入的边先存放在内存中的delta_里（带timestamp），
+ *    dump时与压缩的部分合并后重新编码
+ */
+class CompressedCsr : public MutableCsrBase {
+ public:
+  struct adjlist_t {
+    uint64_t offset;     // 在.cnbr文件中的起始位置（byte）
+    uint32_t degree;     // 邻居个数
+    uint32_t byte_size;  // 编码后的字节数（包括padding）
+  };
+  using get_neighbors_func_t =
+      std::function<void(vid_t, std::vector<vid_t>&)>;
+
+  CompressedCsr() : delta_num_(0) {}
+  ~CompressedCsr() = default;
+
+  // 创建degree.size()个顶点的空CSR，之后通过put_generic_edge插入，dump时压缩
+  void batch_init(const std::string& name, const std::string& work_dir,
+                  const std::vector<int>& degree) override {
+    build(name, work_dir, degree.size(),
+          [](vid_t, std::vector<vid_t>&) {});
+    for (size_t v = 0; v < degree.size(); v++)
+      delta_[v].reserve(degree[v]);
+  }
+
+  void open(const std::string& name, const std::string& snapshot_dir,
+            const std::string& work_dir) override {
+    adj_lists_.open(snapshot_dir + "/" + name + ".cadj", true);
+    adj_lists_.touch(work_dir + "/" + name + ".cadj");
+    nbr_list_.open(snapshot_dir + "/" + name + ".cnbr", true);
+    reset_delta(adj_lists_.size());
+  }
+
+  // get_neighbors(v, nbrs)把v的所有邻居追加到nbrs中
+  void build(const std::string& name, const std::string& work_dir,
+             size_t vertex_num, const get_neighbors_func_t& get_neighbors) {
+    std::vector<adjlist_t> adj_lists;
+    std::vector<char> buffer;
+    encode(vertex_num, get_neighbors, adj_lists, buffer);
+    write(work_dir + "/" + name, adj_lists, buffer, adj_lists_, nbr_list_);
+    reset_delta(vertex_num);
+  }
+
+  // 只保留对read_ts可见的边
+  void build(const std::string& name, const std::string& work_dir,
+             const MutableCsrBase& csr, timestamp_t read_ts) {
+    build(name, work_dir, csr.size(),
+          [&](vid_t v, std::vector<vid_t>& neighbors) {
+            csr.get_neighbors(v, read_ts, neighbors);
+          });
+  }
+
+  // 没有增量边时直接复用文件，否则合并之后重新编码
+  void dump(const std::string& name,
+            const std::string& new_spanshot_dir) override {
+    if (delta_num_.load() == 0) {
+      adj_lists_.dump(new_spanshot_dir + "/" + name + ".cadj");
+      nbr_list_.dump(new_spanshot_dir + "/" + name + ".cnbr");
+      return;
+    }
+    std::vector<adjlist_t> adj_lists;
+    std::vector<char> buffer;
+    encode(
+        size(),
+        [&](vid_t v, std::vector<vid_t>& neighbors) {
+          get_neighbors(v, neighbors);
+        },
+        adj_lists, buffer);
+    mmap_array<adjlist_t> adj_lists_new;
+    mmap_array<char> nbr_list_new;
+    write(new_spanshot_dir + "/" + name, adj_lists, buffer, adj_lists_new,
+          nbr_list_new);
+  }
+
+  size_t size() const override { return adj_lists_.size(); }
+
+  // 插入的边暂存在delta_中，dump时才会被压缩
+  void put_generic_edge(vid_t src, vid_t dst, const std::string_view data,
+                        timestamp_t ts) override {
+    assert(src < delta_.size());
+    std::lock_guard<std::mutex> guard(delta_lock_);
+    delta_[src].push_back({dst, ts});
+    delta_num_.fetch_add(1);
+  }
+
+  int degree(vid_t v) const {
+    auto item = adj_lists_.get(v);
+    return gbp::BufferBlock::Ref<adjlist_t>(item).degree + delta_degree(v);
+  }
+
+  // 把v压缩部分的邻居（升序）解码到neighbors中，neighbors的长度不小于degree(v)，返回邻居个数
+  size_t decode_edges(vid_t v, vid_t* neighbors) const {
+    auto item = adj_lists_.get(v);
+    auto adj_list = gbp::BufferBlock::Ref<adjlist_t>(item);
+    if (adj_list.degree == 0)
+      return 0;
+
+    auto chunks = nbr_list_.get(adj_list.offset, adj_list.byte_size);
+    size_t pos = 0, decoded_num = 0;
+    while (decoded_num < adj_list.degree)
+      decoded_num +=
+          svb_impl::decode_next_chunk(chunks, pos, neighbors + decoded_num);
+    return decoded_num;
+  }
+
+  // 压缩部分的邻居（升序）之后是增量边
+  size_t get_neighbors(vid_t v, std::vector<vid_t>& neighbors) const {
+    return get_neighbors(v, MAX_TIMESTAMP, neighbors);
+  }
+
+  // 压缩的边对所有读者可见，增量边按read_ts过滤
+  size_t get_neighbors(vid_t v, timestamp_t read_ts,
+                       std::vector<vid_t>& neighbors) const override {
+    auto offset = neighbors.size();
+    neighbors.resize(offset + degree(v));
+    auto num = decode_edges(v, neighbors.data() + offset);
+    neighbors.resize(offset + num);
+    if (has_delta()) {
+      std::lock_guard<std::mutex> guard(delta_lock_);
+      for (auto& edge : delta_[v]) {
+        if (is_visible(edge.timestamp, read_ts))
+          neighbors.push_back(edge.neighbor);
+      }
+    }
+    return neighbors.size() - offset;
+  }
+
+  std::shared_ptr<MutableCsrConstEdgeIterBase> edge_iter(
+      vid_t v) const override {
+    return std::make_shared<CompressedCsrConstEdgeIter>(
+        make_edge_iter(v, MAX_TIMESTAMP));
+  }
+
+  MutableCsrConstEdgeIterBase* edge_iter_raw(vid_t v) const override {
+    return new CompressedCsrConstEdgeIter(make_edge_iter(v, MAX_TIMESTAMP));
+  }
+
+  std::shared_ptr<MutableCsrConstEdgeIterBase> snapshot_edge_iter(
+      vid_t v, timestamp_t read_ts) const override {
+    return std::make_shared<CompressedCsrConstEdgeIter>(
+        make_edge_iter(v, read_ts));
+  }
+
+  std::shared_ptr<MutableCsrEdgeIterBase> edge_iter_mut(vid_t v) override {
+    return std::make_shared<CompressedCsrEdgeIter>(
+        make_edge_iter(v, MAX_TIMESTAMP));
+  }
+
+  size_t get_index_size_in_byte() const override {
+    return adj_lists_.get_size_in_byte();
+  }
+  size_t get_data_size_in_byte() const override {
+    return nbr_list_.get_size_in_byte();
+  }
+
+  // 新增的顶点没有压缩的邻居
+  void resize(size_t size) override {
+    size_t size_old = adj_lists_.size();
+    adj_lists_.resize(size);
+    adjlist_t empty = {0, 0, 0};
+    for (size_t v = size_old; v < size; v++)
+      adj_lists_.set(v, {reinterpret_cast<const char*>(&empty),
+                         sizeof(adjlist_t)});
+    std::lock_guard<std::mutex> guard(delta_lock_);
+    delta_.resize(size);
+  }
+
+ private:
+  static void encode(size_t vertex_num,
+                     const get_neighbors_func_t& get_neighbors,
+                     std::vector<adjlist_t>& adj_lists,
+                     std::vector<char>& buffer) {
+    adj_lists.resize(vertex_num);
+    std::vector<vid_t> neighbors;
+    for (size_t v = 0; v < vertex_num; v++) {
+      neighbors.clear();
+      get_neighbors(v, neighbors);
+      std::sort(neighbors.begin(), neighbors.end());
+
+      auto& adj_list = adj_lists[v];
+      adj_list.offset = buffer.size();
+      adj_list.degree = neighbors.size();
+      for (size_t idx = 0; idx < neighbors.size();
+           idx += svb_impl::CHUNK_VALUE_NUM) {
+        auto num = std::min(svb_impl::CHUNK_VALUE_NUM, neighbors.size() - idx);
+        char chunk[svb_impl::CHUNK_MAX_SIZE];
+        auto chunk_size =
+            svb_impl::encode_chunk(neighbors.data() + idx, num, chunk);
+        // 当前页放不下时用0填充到页尾
+        auto remaining =
+            gbp::PAGE_SIZE_MEMORY - buffer.size() % gbp::PAGE_SIZE_MEMORY;
+        if (remaining < chunk_size)
+          buffer.resize(buffer.size() + remaining, 0);
+        buffer.insert(buffer.end(), chunk, chunk + chunk_size);
+      }
+      adj_list.byte_size = buffer.size() - adj_list.offset;
+    }
+  }
+
+  static void write(const std::string& prefix,
+                    const std::vector<adjlist_t>& adj_lists,
+                    const std::vector<char>& buffer,
+                    mmap_array<adjlist_t>& adj_array,
+                    mmap_array<char>& nbr_array) {
+    adj_array.open(prefix + ".cadj", false);
+    adj_array.resize(adj_lists.size());
+    if (!adj_lists.empty())
+      adj_array.set(0,
+                    {reinterpret_cast<const char*>(adj_lists.data()),
+                     adj_lists.size() * sizeof(adjlist_t)},
+                    adj_lists.size());
+    nbr_array.open(prefix + ".cnbr", false);
+    nbr_array.resize(buffer.size());
+    if (!buffer.empty())
+      nbr_array.set(0, {buffer.data(), buffer.size()}, buffer.size());
+  }
+
+  void reset_delta(size_t vertex_num) {
+    std::lock_guard<std::mutex> guard(delta_lock_);
+    delta_.clear();
+    delta_.resize(vertex_num);
+    delta_num_.store(0);
+  }
+
+  FORCE_INLINE bool has_delta() const { return delta_num_.load() != 0; }
+
+  size_t delta_degree(vid_t v) const {
+    if (!has_delta())
+      return 0;
+    std::lock_guard<std::mutex> guard(delta_lock_);
+    return delta_[v].size();
+  }
+
+  CompressedCsrConstEdgeIter make_edge_iter(vid_t v,
+                                            timestamp_t read_ts) const {
+    auto item = adj_lists_.get(v);
+    auto adj_list = gbp::BufferBlock::Ref<adjlist_t>(item);
+    gbp::BufferBlock chunks;
+    if (adj_list.degree != 0)
+      chunks = nbr_list_.get(adj_list.offset, adj_list.byte_size);
+
+    std::vector<CompressedDeltaEdge> delta;
+    if (has_delta()) {
+      std::lock_guard<std::mutex> guard(delta_lock_);
+      for (auto& edge : delta_[v]) {
+        if (is_visible(edge.timestamp, read_ts))
+          delta.push_back(edge);
+      }
+    }
+    return CompressedCsrConstEdgeIter(std::move(chunks), adj_list.degree,
+                                      std::move(delta));
+  }
+
+  mmap_array<adjlist_t> adj_lists_;
+  mmap_array<char> nbr_list_;
+
+  mutable std::mutex delta_lock_;
+  std::vector<std::vector<CompressedDeltaEdge>> delta_;
+  std::atomic<size_t> delta_num_;
+};
+
+}  // namespace test
@@ -17,12 +17,15 @@ limitations under the License.
 #include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <memory>
 #include <mutex>
 #include <string_view>
 #include <type_traits>
 #include <vector>
 
+#include "id_indexer_groups.h"
+
 namespace gs {
 template <typename INDEX_T>
 class index_key_item {
@@ -179,6 +182,18 @@ class LFIndexer {
         rhs.hash_policy_.get_mod_function_index());
   }
 
+  // .meta以META_MAGIC和.indices的格式版本开头：
+  // INDICES_VERSION_FLAT为按slot平铺的INDEX_T数组，
+  // INDICES_VERSION_GROUP为index_key_group数组
+  static constexpr uint64_t META_MAGIC = 0x5844494c46504247;  // "GBPFLIDX"
+  static constexpr uint32_t INDICES_VERSION_FLAT = 1;
+  static constexpr uint32_t INDICES_VERSION_GROUP = 2;
+#if OV
+  static constexpr uint32_t INDICES_VERSION = INDICES_VERSION_FLAT;
+#else
+  static constexpr uint32_t INDICES_VERSION = INDICES_VERSION_GROUP;
+#endif
+
   size_t size() const { return num_elements_.load(); }
 
   INDEX_T insert(int64_t oid) {
@@ -202,36 +217,7 @@ class LFIndexer {
       gbp::BufferBlock::UpdateContent<int64_t>(
           [&](int64_t& item) { item = oid; }, item1);
     }
-    size_t index =
-        hash_policy_.index_for_hash(hasher_(oid), num_slots_minus_one_);
-    static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
-
-    int mark = 0;
-    // TODO: 此处实现未被测试正确性
-    uint32_t num_get =
-        indices_.OBJ_NUM_PERPAGE - index % indices_.OBJ_NUM_PERPAGE;
-    uint32_t start_index = index, end_index = index + num_get;
-    auto items = indices_.get(index, num_get);
-    while (true) {
-      if (unlikely(index < start_index || index >= end_index)) {
-        num_get = indices_.OBJ_NUM_PERPAGE - index % indices_.OBJ_NUM_PERPAGE;
-        items = indices_.get(index, num_get);
-        start_index = index, end_index = index + num_get;
-      }
-
-      gbp::BufferBlock::UpdateContent<index_key_item<INDEX_T>>(
-          [&](index_key_item<INDEX_T>& item) {
-            mark = __sync_bool_compare_and_swap(&(item.index), sentinel, ind);
-            if (mark) {
-              item.key = oid;
-            }
-          },
-          items, index - start_index);
-      if (mark) {
-        break;
-      }
-      index = (index + 1) % num_slots_minus_one_;
-    }
+    insert_slot(oid, ind);
 #endif
     return ind;
   }
@@ -252,31 +238,11 @@ class LFIndexer {
       }
     }
 #else
-    auto num_get = indices_.OBJ_NUM_PERPAGE - index % indices_.OBJ_NUM_PERPAGE;
-    num_get = std::min(num_get, indices_.size() - index);
-    uint32_t start_index = index, end_index = index + num_get;
-    auto items = indices_.get(index, num_get);
-    while (true) {
-      if (unlikely(index < start_index || index >= end_index)) {
-        num_get = indices_.OBJ_NUM_PERPAGE - index % indices_.OBJ_NUM_PERPAGE;
-        num_get = std::min(num_get, indices_.size() - index);
-        items = indices_.get(index, num_get);
-        start_index = index, end_index = index + num_get;
-      }
-
-      auto& ind = gbp::BufferBlock::Ref<index_key_item<INDEX_T>>(
-          items, index - start_index);
-      if (ind.index == sentinel) {
-        LOG(FATAL) << "cannot find " << oid << " in id_indexer";
-      } else {
-        // auto item = keys_.get(ind.index);
-        // assert(gbp::BufferBlock::Ref<int64_t>(item) == ind.key);
-        if (ind.key == oid) {
-          return ind.index;
-        }
-      }
-      index = (index + 1) % num_slots_minus_one_;
+    INDEX_T ind = probe(oid, index);
+    if (ind == sentinel) {
+      LOG(FATAL) << "cannot find " << oid << " in id_indexer";
     }
+    return ind;
 #endif
   }
 
@@ -308,37 +274,8 @@ class LFIndexer {
         hash_policy_.index_for_hash(hasher_(oid), num_slots_minus_one_);
     static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
 
-    uint32_t num_get =
-        indices_.OBJ_NUM_PERPAGE - index % indices_.OBJ_NUM_PERPAGE;
-    num_get =
-        num_get > indices_.size() - index ? indices_.size() - index : num_get;
-    uint32_t start_index = index, end_index = index + num_get;
-    auto items = indices_.get(index, num_get);
-    while (true) {
-      if (unlikely(index < start_index || index >= end_index)) {
-        num_get = indices_.OBJ_NUM_PERPAGE - index % indices_.OBJ_NUM_PERPAGE;
-        num_get = num_get > indices_.size() - index ? indices_.size() - index
-                                                    : num_get;
-        items = indices_.get(index, num_get);
-        start_index = index, end_index = index + num_get;
-      }
-
-      auto& ind = gbp::BufferBlock::Ref<index_key_item<INDEX_T>>(
-          items, index - start_index);
-      if (ind.index == sentinel) {
-        return false;
-      } else {
-        // auto item = keys_.get(ind.index);
-        // assert(gbp::BufferBlock::Ref<int64_t>(item) == ind.key);
-        if (ind.key == oid) {
-          ret = ind.index;
-          return true;
-        }
-      }
-      index = (index + 1) % num_slots_minus_one_;
-    }
-
-    return false;
+    ret = probe(oid, index);
+    return ret != sentinel;
   }
 
   int64_t get_key(const INDEX_T& index) const {
@@ -347,14 +284,68 @@ class LFIndexer {
   }
 #endif
 
+  /**
+   * 批量查找oids[0, num)，结果写入rets，找不到的oid对应sentinel
+   * 1. OV：每组先计算所有oid的slot并对整组的slot发出prefetch（group prefetch），隐藏DRAM的访问延迟
+   * 2. 否则计算所有oid的slot之后由id_indexer_impl::probe_batch探测，
+   * 落在同一页上的oid共享一次页的获取，缺页的SSD IO并发提交
+   */
+  void get_index_batch(const int64_t* oids, size_t num, INDEX_T* rets) const {
+#if OV
+    static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+    static constexpr size_t group_size = 64;
+    size_t slots[group_size];
+    for (size_t group_start = 0; group_start < num;
+         group_start += group_size) {
+      size_t group_num = std::min(group_size, num - group_start);
+      for (size_t k = 0; k < group_num; k++) {
+        slots[k] = hash_policy_.index_for_hash(hasher_(oids[group_start + k]),
+                                               num_slots_minus_one_);
+        __builtin_prefetch(&indices_.data()[slots[k]]);
+      }
+      for (size_t k = 0; k < group_num; k++) {
+        INDEX_T ind = indices_.get(slots[k]);
+        if (ind != sentinel)
+          __builtin_prefetch(&keys_.data()[ind]);
+      }
+      for (size_t k = 0; k < group_num; k++) {
+        auto oid = oids[group_start + k];
+        size_t index = slots[k];
+        while (true) {
+          INDEX_T ind = indices_.get(index);
+          if (ind == sentinel || keys_.get(ind) == oid) {
+            rets[group_start + k] = ind;
+            break;
+          }
+          index = (index + 1) % num_slots_minus_one_;
+        }
+      }
+    }
+#else
+    thread_local std::vector<size_t> slots;
+    slots.resize(num);
+    for (size_t k = 0; k < num; k++)
+      slots[k] = hash_policy_.index_for_hash(hasher_(oids[k]),
+                                             num_slots_minus_one_);
+    id_indexer_impl::probe_batch(indices_, num_slots_minus_one_, oids,
+                                 slots.data(), num, rets);
+#endif
+  }
+
   void open(const std::string& name, const std::string& snapshot_dir,
             const std::string& work_dir) {
+    uint32_t version = load_meta(snapshot_dir + "/" + name + ".meta");
+
     keys_.open(snapshot_dir + "/" + name + ".keys", true);
     keys_.touch(work_dir + "/" + name + ".keys");
     indices_.open(snapshot_dir + "/" + name + ".indices", true);
     indices_.touch(work_dir + "/" + name + ".indices");
 
+#if OV
     indices_size_ = indices_.size();
+#else
+    indices_size_ = indices_.size() * index_key_group<INDEX_T>::WIDTH;
+#endif
     for (size_t k = keys_.size() - 1; k >= 0; --k) {
 #if OV
       if (keys_.get(k) != std::numeric_limits<int64_t>::max()) {
@@ -371,7 +362,18 @@ class LFIndexer {
 #endif
     }
 
-    load_meta(snapshot_dir + "/" + name + ".meta");
+    if (version != INDICES_VERSION) {
+#if !OV
+      if (version == INDICES_VERSION_FLAT) {
+        // 旧版本的.indices按slot平铺存放，根据keys_重建分组的indices_
+        rebuild_indices();
+        return;
+      }
+#endif
+      LOG(FATAL) << "unsupported .indices version " << version << " of "
+                 << snapshot_dir + "/" + name << " (expected "
+                 << INDICES_VERSION << ")";
+    }
   }
 
   size_t get_size_in_byte() {
@@ -386,14 +388,16 @@ class LFIndexer {
 
   void dump_meta(const std::string& filename) const {
     grape::InArchive arc;
-    arc << num_slots_minus_one_ << hash_policy_.get_mod_function_index();
+    arc << META_MAGIC << INDICES_VERSION << num_slots_minus_one_
+        << hash_policy_.get_mod_function_index();
     FILE* fout = fopen(filename.c_str(), "wb");
     fwrite(arc.GetBuffer(), sizeof(char), arc.GetSize(), fout);
     fflush(fout);
     fclose(fout);
   }
 
-  void load_meta(const std::string& filename) {
+  // 返回.indices的格式版本，没有magic的旧.meta视为INDICES_VERSION_FLAT
+  uint32_t load_meta(const std::string& filename) {
     grape::OutArchive arc;
     FILE* fin = fopen(filename.c_str(), "r");
 
@@ -402,25 +406,81 @@ class LFIndexer {
     std::vector<char> buf(meta_file_size);
     CHECK_EQ(fread(buf.data(), sizeof(char), meta_file_size, fin),
              meta_file_size);
+    fclose(fin);
     arc.SetSlice(buf.data(), meta_file_size);
+
+    uint32_t version = INDICES_VERSION_FLAT;
+    uint64_t magic = 0;
+    if (meta_file_size >= sizeof(magic)) {
+      memcpy(&magic, buf.data(), sizeof(magic));
+    }
+    if (magic == META_MAGIC) {
+      arc >> magic >> version;
+    }
     size_t mod_function_index;
     arc >> num_slots_minus_one_ >> mod_function_index;
     hash_policy_.set_mod_function_by_index(mod_function_index);
+    return version;
   }
 
   // get keys
   const mmap_array<int64_t>& get_keys() const { return keys_; }
 
  private:
+#if !OV
+  using group_t = index_key_group<INDEX_T>;
+
+  static uint32_t lane_mask_from(size_t slot) {
+    return id_indexer_impl::lane_mask_from(slot);
+  }
+  size_t get_group_num() const {
+    return id_indexer_impl::get_group_num<INDEX_T>(num_slots_minus_one_);
+  }
+
+  // 分组的探测与插入见id_indexer_groups.h
+  bool probe_groups(const gbp::BufferBlock& items, size_t start_group,
+                    size_t end_group, size_t& group_id, uint32_t& lane_mask,
+                    int64_t oid, INDEX_T& ret) const {
+    return id_indexer_impl::probe_groups(items, num_slots_minus_one_,
+                                         start_group, end_group, group_id,
+                                         lane_mask, oid, ret);
+  }
+
+  // 将indices_置为get_group_num()个空group
+  void reset_indices() {
+    id_indexer_impl::reset_groups(indices_, num_slots_minus_one_);
+    indices_size_ = get_group_num() * group_t::WIDTH;
+  }
+
+  void rebuild_indices() {
+    reset_indices();
+    for (size_t ind = 0; ind < num_elements_.load(); ++ind) {
+      auto item = keys_.get(ind);
+      insert_slot(gbp::BufferBlock::Ref<int64_t>(item),
+                  static_cast<INDEX_T>(ind));
+    }
+  }
+
+  void insert_slot(int64_t oid, INDEX_T ind) {
+    size_t index =
+        hash_policy_.index_for_hash(hasher_(oid), num_slots_minus_one_);
+    id_indexer_impl::insert_slot(indices_, num_slots_minus_one_, index, oid,
+                                 ind);
+  }
+
+  INDEX_T probe(int64_t oid, size_t slot) const {
+    return id_indexer_impl::probe(indices_, num_slots_minus_one_, slot, oid);
+  }
+#endif
+
   mmap_array<int64_t> keys_;
 #if OV
   mmap_array<INDEX_T>
       indices_;  // size() == indices_size_ == num_slots_minus_one_
                  // +log(num_slots_minus_one_)
 #else
-  mmap_array<index_key_item<INDEX_T>>
-      indices_;  // size() == indices_size_ == num_slots_minus_one_
-                 // +log(num_slots_minus_one_)
+  id_indexer_impl::index_groups_type<INDEX_T>
+      indices_;  // size() == ceil(num_slots_minus_one_ / WIDTH)
 #endif
   std::atomic<size_t> num_elements_;
   size_t num_slots_minus_one_;
@@ -970,18 +1030,25 @@ void build_lf_indexer(const IdIndexer<int64_t, INDEX_T>& input,
 
   lf.num_elements_.store(size);
 
-  lf.indices_.open(filename + ".indices", false);
-  lf.indices_.resize(input.indices_.size());
-
-  index_key_item<INDEX_T> empty_value_1{std::numeric_limits<INDEX_T>::max(), 0};
-  for (size_t k = 0; k != input.indices_.size(); ++k) {
-    lf.indices_.set(k, &empty_value_1);
-  }
-  lf.indices_size_ = input.indices_.size();
-
   lf.hash_policy_.set_mod_function_by_index(
       input.hash_policy_.get_mod_function_index());
   lf.num_slots_minus_one_ = input.num_slots_minus_one_;
+
+  using group_t = index_key_group<INDEX_T>;
+  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+  lf.indices_.open(filename + ".indices", false);
+  lf.reset_indices();
+
+  // 将<oid, ind>写入第index个slot
+  auto set_slot = [&](size_t index, int64_t oid, INDEX_T ind) {
+    auto item = lf.indices_.get(index / group_t::WIDTH);
+    gbp::BufferBlock::UpdateContent<group_t>(
+        [&](group_t& group) {
+          group.indices[index % group_t::WIDTH] = ind;
+          group.keys[index % group_t::WIDTH] = oid;
+        },
+        item);
+  };
   std::vector<std::pair<int64_t, INDEX_T>> extra;
 
   for (auto oid : input.keys_) {
@@ -994,26 +1061,21 @@ void build_lf_indexer(const IdIndexer<int64_t, INDEX_T>& input,
         if (index >= input.num_slots_minus_one_) {
           extra.emplace_back(oid, ret);
         } else {
-          empty_value_1.index = ret;
-          empty_value_1.key = oid;
-          lf.indices_.set(index, &empty_value_1);
+          set_slot(index, oid, ret);
         }
         break;
       }
     }
   }
 
-  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
   for (auto& pair : extra) {
     size_t index = input.hash_policy_.index_for_hash(
         input.hasher_(pair.first), input.num_slots_minus_one_);
     while (true) {
-      auto item = lf.indices_.get(index);
-      if (gbp::BufferBlock::Ref<index_key_item<INDEX_T>>(item).index ==
-          sentinel) {
-        empty_value_1.index = pair.second;
-        empty_value_1.key = pair.first;
-        lf.indices_.set(index, &(empty_value_1));
+      auto item = lf.indices_.get(index / group_t::WIDTH);
+      if (gbp::BufferBlock::Ref<group_t>(item)
+              .indices[index % group_t::WIDTH] == sentinel) {
+        set_slot(index, pair.first, pair.second);
         break;
       }
       index = (index + 1) % input.num_slots_minus_one_;
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "../mmap_array.h"
+#include "id_indexer_probe.h"
+
+namespace gs {
+
+/**
+ * LFIndexer中分组的indices_的读写：slot_num个slot按index_key_group分组存放在mmap_array中，
+ * 从slot开始逐个group线性探测。不依赖hash policy，slot由调用者计算，可以单独测试
+ */
+namespace id_indexer_impl {
+
+template <typename INDEX_T>
+using index_groups_type = test::mmap_array<index_key_group<INDEX_T>>;
+
+template <typename INDEX_T>
+constexpr size_t group_num_per_page() {
+  return gbp::PAGE_SIZE_FILE / sizeof(index_key_group<INDEX_T>);
+}
+
+template <typename INDEX_T>
+inline size_t get_group_num(size_t slot_num) {
+  return (slot_num + index_key_group<INDEX_T>::WIDTH - 1) /
+         index_key_group<INDEX_T>::WIDTH;
+}
+
+inline size_t next_group(size_t group_id, size_t group_num) {
+  return group_id + 1 == group_num ? 0 : group_id + 1;
+}
+
+// 将groups置为get_group_num(slot_num)个空group
+template <typename INDEX_T>
+void reset_groups(index_groups_type<INDEX_T>& groups, size_t slot_num) {
+  using group_t = index_key_group<INDEX_T>;
+  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+  auto group_num = get_group_num<INDEX_T>(slot_num);
+  groups.resize(group_num);
+
+  group_t empty_group;
+  std::fill(std::begin(empty_group.keys), std::end(empty_group.keys), 0);
+  std::fill(std::begin(empty_group.indices), std::end(empty_group.indices),
+            sentinel);
+  for (size_t k = 0; k != group_num; ++k) {
+    groups.set_single_obj(
+        k, {reinterpret_cast<const char*>(&empty_group), sizeof(group_t)});
+  }
+}
+
+// 获取group_id所在页中从group_id开始的所有group
+template <typename INDEX_T>
+gbp::BufferBlock get_groups(const index_groups_type<INDEX_T>& groups,
+                            size_t slot_num, size_t group_id,
+                            size_t& start_group, size_t& end_group) {
+  size_t num_get = group_num_per_page<INDEX_T>() -
+                   group_id % group_num_per_page<INDEX_T>();
+  num_get = std::min(num_get, get_group_num<INDEX_T>(slot_num) - group_id);
+  start_group = group_id;
+  end_group = group_id + num_get;
+  return groups.get(group_id, num_get);
+}
+
+// 在items中的[start_group, end_group)内从group_id开始探测，
+// 遇到key为oid或者为空的slot时返回true，ret为该slot中的index
+template <typename INDEX_T>
+bool probe_groups(const gbp::BufferBlock& items, size_t slot_num,
+                  size_t start_group, size_t end_group, size_t& group_id,
+                  uint32_t& lane_mask, int64_t oid, INDEX_T& ret) {
+  using group_t = index_key_group<INDEX_T>;
+  while (group_id >= start_group && group_id < end_group) {
+    auto& group = gbp::BufferBlock::Ref<group_t>(items, group_id - start_group);
+    uint32_t empty_mask;
+    uint32_t match_mask = probe_group(group, oid, empty_mask);
+    uint32_t hit_mask = ((match_mask & ~empty_mask) | empty_mask) & lane_mask &
+                        valid_lane_mask(slot_num, group_id);
+    if (hit_mask != 0) {
+      ret = group.indices[__builtin_ctz(hit_mask)];
+      return true;
+    }
+    group_id = next_group(group_id, get_group_num<INDEX_T>(slot_num));
+    lane_mask = 0xff;
+  }
+  return false;
+}
+
+// 从slot开始线性探测，返回oid对应的index，不存在时返回sentinel
+template <typename INDEX_T>
+INDEX_T probe(const index_groups_type<INDEX_T>& groups, size_t slot_num,
+              size_t slot, int64_t oid) {
+  size_t group_id = slot / index_key_group<INDEX_T>::WIDTH, start_group,
+         end_group;
+  uint32_t lane_mask = lane_mask_from(slot);
+  INDEX_T ret;
+  while (true) {
+    auto items =
+        get_groups(groups, slot_num, group_id, start_group, end_group);
+    if (probe_groups(items, slot_num, start_group, end_group, group_id,
+                     lane_mask, oid, ret))
+      return ret;
+  }
+}
+
+/**
+ * 批量探测oids[0, num)，slots[k]为oids[k]的起始slot，结果写入rets，不存在的oid对应sentinel
+ * 1. 每批最多BATCH_SIZE个oid，按起始group所在的页排序，每个页只获取一次（整页的group），
+ * 所有页通过get_batch一起获取，缺页的SSD IO并发提交
+ * 2. 探测之前先对每个oid的起始group发出prefetch，隐藏DRAM的访问延迟
+ * 3. 探测超出所在的页时，从下一页开始退化为单个oid的probe
+ */
+template <typename INDEX_T>
+void probe_batch(const index_groups_type<INDEX_T>& groups, size_t slot_num,
+                 const int64_t* oids, const size_t* slots, size_t num,
+                 INDEX_T* rets) {
+  using group_t = index_key_group<INDEX_T>;
+  static constexpr size_t BATCH_SIZE = 64;
+  constexpr size_t groups_per_page = group_num_per_page<INDEX_T>();
+  const size_t group_num = get_group_num<INDEX_T>(slot_num);
+  // <页号, oid在本批中的下标>
+  thread_local std::vector<std::pair<size_t, uint32_t>> order;
+  thread_local std::vector<std::pair<size_t, size_t>> ranges;
+  thread_local std::vector<gbp::BufferBlock> items;
+  uint32_t item_ids[BATCH_SIZE];
+
+  for (size_t batch_start = 0; batch_start < num; batch_start += BATCH_SIZE) {
+    size_t batch_num = std::min(BATCH_SIZE, num - batch_start);
+    order.clear();
+    for (uint32_t k = 0; k < batch_num; k++)
+      order.emplace_back(
+          slots[batch_start + k] / group_t::WIDTH / groups_per_page, k);
+    std::sort(order.begin(), order.end());
+
+    ranges.clear();
+    for (auto& [page_id, k] : order) {
+      size_t start_group = page_id * groups_per_page;
+      if (ranges.empty() || ranges.back().first != start_group)
+        ranges.emplace_back(start_group,
+                            std::min(groups_per_page, group_num - start_group));
+      item_ids[k] = ranges.size() - 1;
+    }
+    items.clear();
+    groups.get_batch(ranges, items);
+    for (uint32_t k = 0; k < batch_num; k++) {
+      auto& range = ranges[item_ids[k]];
+      __builtin_prefetch(&gbp::BufferBlock::Ref<group_t>(
+          items[item_ids[k]],
+          slots[batch_start + k] / group_t::WIDTH - range.first));
+    }
+
+    for (uint32_t k = 0; k < batch_num; k++) {
+      auto oid = oids[batch_start + k];
+      auto slot = slots[batch_start + k];
+      auto& ret = rets[batch_start + k];
+      auto& range = ranges[item_ids[k]];
+      size_t group_id = slot / group_t::WIDTH;
+      uint32_t lane_mask = lane_mask_from(slot);
+      if (unlikely(!probe_groups(items[item_ids[k]], slot_num, range.first,
+                                 range.first + range.second, group_id,
+                                 lane_mask, oid, ret))) {
+        // group_id已经是下一页的第一个group
+        ret = probe(groups, slot_num, group_id * group_t::WIDTH, oid);
+      }
+    }
+    items.clear();  // 释放本批的页
+  }
+}
+
+// 将<oid, ind>写入从slot开始的探测序列上的第一个空slot，
+// 每次处理一个group，在空的lane上CAS
+template <typename INDEX_T>
+void insert_slot(const index_groups_type<INDEX_T>& groups, size_t slot_num,
+                 size_t slot, int64_t oid, INDEX_T ind) {
+  using group_t = index_key_group<INDEX_T>;
+  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+
+  size_t group_id = slot / group_t::WIDTH;
+  uint32_t lane_mask = lane_mask_from(slot);
+  size_t start_group = group_id, end_group = group_id;
+  gbp::BufferBlock items;
+  bool mark = false;
+  while (true) {
+    if (unlikely(group_id < start_group || group_id >= end_group)) {
+      items = get_groups(groups, slot_num, group_id, start_group, end_group);
+    }
+
+    gbp::BufferBlock::UpdateContent<group_t>(
+        [&](group_t& group) {
+          uint32_t empty_mask;
+          probe_group(group, oid, empty_mask);
+          empty_mask &= lane_mask & valid_lane_mask(slot_num, group_id);
+          while (empty_mask != 0) {
+            auto lane = __builtin_ctz(empty_mask);
+            if (__sync_bool_compare_and_swap(&(group.indices[lane]), sentinel,
+                                             ind)) {
+              group.keys[lane] = oid;
+              mark = true;
+              return;
+            }
+            empty_mask &= empty_mask - 1;
+          }
+        },
+        items, group_id - start_group);
+    if (mark) {
+      break;
+    }
+    group_id = next_group(group_id, get_group_num<INDEX_T>(slot_num));
+    lane_mask = 0xff;
+  }
+}
+
+}  // namespace id_indexer_impl
+}  // namespace gs
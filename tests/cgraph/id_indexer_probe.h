@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace gs {
+
+/**
+ * LFIndexer的slot按照WIDTH个一组存放，key与index分开（SoA），
+ * 使得一次可以用SIMD比较一组中所有slot的key。第s个slot位于第s / WIDTH个group的第s % WIDTH个lane，
+ * 线性探测的顺序与逐个slot探测完全一致。group的大小为128B，不会跨页
+ */
+template <typename INDEX_T>
+struct alignas(64) index_key_group {
+  static constexpr size_t WIDTH = 8;
+
+  int64_t keys[WIDTH];
+  INDEX_T indices[WIDTH];
+};
+
+/**
+ * 探测一个group的kernel，不依赖LFIndexer的其它部分（hash policy、mmap_array），可以单独测试
+ * AVX2/AVX-512版本用target属性编译，不需要-mavx2/-mavx512f，probe_group在运行时按CPU支持的指令集选择
+ */
+namespace id_indexer_impl {
+
+enum class SimdLevel { kScalar = 0, kAVX2 = 1, kAVX512 = 2 };
+
+inline SimdLevel detect_simd_level() {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return SimdLevel::kAVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return SimdLevel::kAVX2;
+#endif
+  return SimdLevel::kScalar;
+}
+
+inline SimdLevel simd_level() {
+  static const SimdLevel level = detect_simd_level();
+  return level;
+}
+
+template <typename INDEX_T>
+inline uint32_t probe_group_scalar(const index_key_group<INDEX_T>& group,
+                                   int64_t oid, uint32_t& empty_mask) {
+  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+  uint32_t match_mask = 0;
+  empty_mask = 0;
+  for (size_t lane = 0; lane < 8; lane++) {
+    match_mask |= static_cast<uint32_t>(group.keys[lane] == oid) << lane;
+    empty_mask |= static_cast<uint32_t>(group.indices[lane] == sentinel)
+                  << lane;
+  }
+  return match_mask;
+}
+
+#if defined(__x86_64__)
+// 8个int64的比较结果，每个lane一个bit
+__attribute__((target("avx2"))) inline uint32_t cmpeq_mask_epi64x8(
+    const void* data, __m256i pattern) {
+  auto* ptr = reinterpret_cast<const __m256i*>(data);
+  return _mm256_movemask_pd(_mm256_castsi256_pd(
+             _mm256_cmpeq_epi64(_mm256_loadu_si256(ptr), pattern))) |
+         (_mm256_movemask_pd(_mm256_castsi256_pd(
+              _mm256_cmpeq_epi64(_mm256_loadu_si256(ptr + 1), pattern)))
+          << 4);
+}
+
+template <typename INDEX_T>
+__attribute__((target("avx2"))) inline uint32_t empty_mask_avx2(
+    const index_key_group<INDEX_T>& group) {
+  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+  if constexpr (sizeof(INDEX_T) == sizeof(uint32_t)) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(group.indices)),
+        _mm256_set1_epi32(sentinel))));
+  } else if constexpr (sizeof(INDEX_T) == sizeof(uint64_t)) {
+    return cmpeq_mask_epi64x8(group.indices, _mm256_set1_epi64x(sentinel));
+  } else {
+    uint32_t empty_mask = 0;
+    for (size_t lane = 0; lane < 8; lane++)
+      empty_mask |= static_cast<uint32_t>(group.indices[lane] == sentinel)
+                    << lane;
+    return empty_mask;
+  }
+}
+
+template <typename INDEX_T>
+__attribute__((target("avx2"))) inline uint32_t probe_group_avx2(
+    const index_key_group<INDEX_T>& group, int64_t oid, uint32_t& empty_mask) {
+  empty_mask = empty_mask_avx2(group);
+  return cmpeq_mask_epi64x8(group.keys, _mm256_set1_epi64x(oid));
+}
+
+template <typename INDEX_T>
+__attribute__((target("avx2,avx512f"))) inline uint32_t probe_group_avx512(
+    const index_key_group<INDEX_T>& group, int64_t oid, uint32_t& empty_mask) {
+  empty_mask = empty_mask_avx2(group);
+  return _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(group.keys),
+                                 _mm512_set1_epi64(oid));
+}
+#endif
+
+// 返回group中key等于oid的lane的掩码，empty_mask中为index等于sentinel的lane
+template <typename INDEX_T>
+inline uint32_t probe_group(const index_key_group<INDEX_T>& group, int64_t oid,
+                            uint32_t& empty_mask) {
+  static_assert(index_key_group<INDEX_T>::WIDTH == 8);
+#if defined(__x86_64__)
+  switch (simd_level()) {
+  case SimdLevel::kAVX512:
+    return probe_group_avx512(group, oid, empty_mask);
+  case SimdLevel::kAVX2:
+    return probe_group_avx2(group, oid, empty_mask);
+  default:
+    break;
+  }
+#endif
+  return probe_group_scalar(group, oid, empty_mask);
+}
+
+// 第一个group中，从slot所在lane开始的lane才需要探测
+inline uint32_t lane_mask_from(size_t slot) {
+  return (0xffu << (slot % 8)) & 0xffu;
+}
+
+// 共slot_num个slot时，最后一个group中超出slot_num的lane不参与探测
+inline uint32_t valid_lane_mask(size_t slot_num, size_t group_id) {
+  size_t rest = slot_num - group_id * 8;
+  return rest >= 8 ? 0xffu : (1u << rest) - 1;
+}
+
+}  // namespace id_indexer_impl
+}  // namespace gs
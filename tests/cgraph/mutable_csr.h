@@ -16,19 +16,23 @@
 #ifndef GRAPHSCOPE_GRAPH_MUTABLE_CSR_H_
 #define GRAPHSCOPE_GRAPH_MUTABLE_CSR_H_
 
+#include <immintrin.h>
 #include <algorithm>
 #include <atomic>
+#include <charconv>
 #include <filesystem>
+#include <map>
+#include <mutex>
 #include <type_traits>
 #include <vector>
 
 #include "../mmap_array.h"
 #include "column_family.h"
 #include "spinlock.h"
+#include "version_manager.h"
 
 namespace test {
 struct EmptyType {};
-using timestamp_t = uint32_t;
 using vid_t = uint32_t;
 
 template <typename EDATA_T>
@@ -47,7 +51,8 @@ struct MutableNbr {
 
 template <>
 struct MutableNbr<EmptyType> {
-  MutableNbr() = default;
+  // C++20中std::atomic的默认构造函数不再是trivial的，匿名union需要显式初始化其中一个成员
+  MutableNbr() : timestamp(0) {}
   MutableNbr(const MutableNbr& rhs)
       : neighbor(rhs.neighbor), timestamp(rhs.timestamp.load()) {}
   ~MutableNbr() = default;
@@ -59,6 +64,45 @@ struct MutableNbr<EmptyType> {
   };
 };
 
+namespace mvcc_impl {
+constexpr static size_t FILTER_WIDTH = 8;
+
+// 返回从base开始的num（不超过FILTER_WIDTH）个邻居中对read_ts可见的位图，base[0..num)必须在同一页内
+template <typename NBR_T>
+FORCE_INLINE inline uint32_t visible_mask(const NBR_T* base, size_t num,
+                                          timestamp_t read_ts) {
+#if ASSERT_ENABLE
+  assert(num <= FILTER_WIDTH && read_ts <= MAX_TIMESTAMP);
+#endif
+#ifdef __AVX2__
+  // 通过gather一次取8个timestamp，只取前num个，不会越过页边界
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i vindex =
+      _mm256_mullo_epi32(lane, _mm256_set1_epi32(sizeof(NBR_T)));
+  const __m256i load_mask =
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(num), lane);
+  const int* ts_base = reinterpret_cast<const int*>(&(base->timestamp));
+  __m256i ts = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), ts_base,
+                                           vindex, load_mask, 1);
+  // 插入的边可见 <=> ts <= read_ts；删除的边可见 <=> ts > read_ts
+  __m256i gt = _mm256_cmpgt_epi32(
+      _mm256_and_si256(ts, _mm256_set1_epi32(MAX_TIMESTAMP)),
+      _mm256_set1_epi32(read_ts));
+  __m256i visible = _mm256_cmpeq_epi32(gt, _mm256_srai_epi32(ts, 31));
+  return _mm256_movemask_ps(_mm256_castsi256_ps(visible)) &
+         ((1u << num) - 1);
+#else
+  uint32_t ret = 0;
+  for (size_t idx = 0; idx < num; idx++) {
+    if (is_visible(base[idx].timestamp.load(std::memory_order_relaxed),
+                   read_ts))
+      ret |= 1u << idx;
+  }
+  return ret;
+#endif
+}
+}  // namespace mvcc_impl
+
 #if OV
 template <typename EDATA_T>
 class MutableNbrSlice {
@@ -125,6 +169,7 @@ struct MutableNbrSlice {
   const mmap_array<nbr_t>* mmap_array_;
   size_t start_idx_;
   size_t size_;
+  ReaderEpoch::Guard guard_;  // 持有期间区间不会被复用
 };
 
 template <typename EDATA_T>
@@ -138,6 +183,7 @@ struct MutableNbrSliceMut {
   mmap_array<nbr_t>* mmap_array_;
   size_t start_idx_;
   size_t size_;
+  ReaderEpoch::Guard guard_;  // 持有期间区间不会被复用
 };
 #endif
 template <typename T>
@@ -322,27 +368,110 @@ class MutableAdjlist {
 //   size_t start_idx_;
 // };
 
+// 内联的邻居与start_idx_共用空间，邻接表头为64B（一个cache line），
+// 可以放下4个MutableNbr<int32_t>、6个MutableNbr<EmptyType>或者3个MutableNbr<uint64_t>
+constexpr static size_t ADJLIST_INLINE_SIZE = 48;
+
+/**
+ * 按度数分层存储邻接表
+ * 1. kInline：邻居直接存放在邻接表头（即顶点的property行）中，不需要额外的页，
+ *    此时没有start_idx_，其空间用于存放邻居（最多ADJLIST_INLINE_SIZE字节）
+ * 2. kPacked：多个中等度数的邻接表共享页，但单个邻接表不会跨页，一次扩展只访问一个页
+ * 3. kExtent：大度数的邻接表从页边界开始分配整页，可以通过一次多页I/O读出
+ * 全0的邻接表头（新resize出来的行）对应kPacked，与之前的行为一致
+ */
 struct MutableAdjlist {
  public:
   // using nbr_t = MutableNbr<EDATA_T>;
   // using slice_t = MutableNbrSlice<EDATA_T>;
   // using mut_slice_t = MutableNbrSliceMut<EDATA_T>;
+  enum Tier : u_int8_t { kPacked = 0, kInline = 1, kExtent = 2 };
 
-  MutableAdjlist() : start_idx_(0), size_(0), capacity_(0) {}
+  MutableAdjlist()
+      : size_(0), capacity_(0), tier_(kPacked), version_(0), start_idx_(0) {}
   ~MutableAdjlist() {}
 
-  void init(size_t start_idx, size_t cap, size_t size) {
+  void init(size_t start_idx, size_t cap, size_t size, Tier tier = kPacked) {
     size_ = size;
     capacity_ = cap;
     start_idx_ = start_idx;
+    tier_ = tier;
 
     lock_.store(0);
+    version_.store(0);
+  }
+
+  /**
+   * 一致地读出(start_idx_, size_)
+   * 写者通过publish同时修改二者，修改期间version_为奇数（seqlock），读者读到奇数或者前后不一致时重读
+   */
+  FORCE_INLINE void load_range(size_t& start_idx, size_t& size) const {
+    while (true) {
+      auto version = version_.load(std::memory_order_acquire);
+      if (likely((version & 1) == 0)) {
+        start_idx = start_idx_;
+        size = size_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (likely(version_.load(std::memory_order_relaxed) == version))
+          return;
+      }
+      gbp::nano_spin();
+    }
   }
+
+  // 切换到新的区间，调用者需要持有该邻接表的写锁
+  FORCE_INLINE void publish(size_t start_idx, size_t size, size_t capacity) {
+    auto version = version_.load(std::memory_order_relaxed);
+    version_.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    start_idx_ = start_idx;
+    size_.store(size, std::memory_order_relaxed);
+    capacity_ = capacity;
+    version_.store(version + 2, std::memory_order_release);
+  }
+
+  /**
+   * 为度数为degree的邻接表分配空间，tail为边文件中下一个空闲位置（以item为单位）
+   * item不会跨页，每页可以放PAGE_SIZE_MEMORY / item_size个
+   */
+  static Tier allocate(size_t degree, size_t item_size, size_t& tail,
+                       size_t& start_idx, size_t& capacity) {
+    if (degree * item_size <= ADJLIST_INLINE_SIZE) {
+      start_idx = 0;
+      capacity = ADJLIST_INLINE_SIZE / item_size;
+      return kInline;
+    }
+
+    const size_t obj_num_perpage = gbp::PAGE_SIZE_MEMORY / item_size;
+    if (degree <= obj_num_perpage) {
+      if (tail % obj_num_perpage + degree > obj_num_perpage)
+        tail = gbp::ceil(tail, obj_num_perpage) * obj_num_perpage;
+      start_idx = tail;
+      capacity = degree;
+      tail += capacity;
+      return kPacked;
+    }
+
+    tail = gbp::ceil(tail, obj_num_perpage) * obj_num_perpage;
+    start_idx = tail;
+    capacity = gbp::ceil(degree, obj_num_perpage) * obj_num_perpage;
+    tail += capacity;
+    return kExtent;
+  }
+
+  FORCE_INLINE bool is_inline() const { return tier_ == kInline; }
+
   std::atomic<u_int32_t> size_;  // 有效数据的大小
   u_int32_t capacity_;           // 空闲空间的大小
   std::atomic<u_int16_t> lock_;  // 锁 1表示锁住，0表示未锁住
-  size_t start_idx_;
+  Tier tier_;
+  std::atomic<u_int32_t> version_;  // publish的版本号，奇数表示正在切换区间
+  union {
+    size_t start_idx_;                       // 只有非kInline时有效
+    char inline_data_[ADJLIST_INLINE_SIZE];  // 只有kInline时有效
+  };
 };
+static_assert(sizeof(MutableAdjlist) == 64);
 #endif
 
 #if OV
@@ -437,6 +566,16 @@ class MutableCsrBase {
 
   virtual std::shared_ptr<MutableCsrEdgeIterBase> edge_iter_mut(vid_t v) = 0;
 
+#if !OV
+  // 只返回对read_ts可见的边
+  virtual std::shared_ptr<MutableCsrConstEdgeIterBase> snapshot_edge_iter(
+      vid_t v, timestamp_t read_ts) const = 0;
+
+  // 把v的所有对read_ts可见的邻居追加到neighbors中，每个顶点只有一次虚函数调用，返回追加的个数
+  virtual size_t get_neighbors(vid_t v, timestamp_t read_ts,
+                               std::vector<vid_t>& neighbors) const = 0;
+#endif
+
   virtual size_t get_index_size_in_byte() const = 0;
 
   virtual size_t get_data_size_in_byte() const = 0;
@@ -500,7 +639,7 @@ class TypedMutableCsrConstEdgeIter : public MutableCsrConstEdgeIterBase {
  public:
   TypedMutableCsrConstEdgeIter() : objs_(), cur_idx_(0), size_(0) {}
   explicit TypedMutableCsrConstEdgeIter(const MutableNbrSlice<EDATA_T>& slice)
-      : cur_idx_(0), size_(slice.size_) {
+      : cur_idx_(0), size_(slice.size_), guard_(slice.guard_) {
 #ifdef USING_EDGE_ITER
     auto tmp = slice.get_mmap_array()->get(slice.get_start_idx(), slice.size());
     objs_ = gbp::BufferBlockIter<nbr_t>(tmp);
@@ -590,6 +729,7 @@ class TypedMutableCsrConstEdgeIter : public MutableCsrConstEdgeIterBase {
 #endif
   size_t cur_idx_;
   size_t size_;
+  ReaderEpoch::Guard guard_;
 };
 
 template <typename EDATA_T>
@@ -599,7 +739,7 @@ class TypedMutableCsrEdgeIter : public MutableCsrEdgeIterBase {
  public:
   TypedMutableCsrEdgeIter() : objs_(), cur_idx_(0), size_(0) {}
   explicit TypedMutableCsrEdgeIter(MutableNbrSliceMut<EDATA_T> slice)
-      : cur_idx_(0), size_(slice.size_) {
+      : cur_idx_(0), size_(slice.size_), guard_(std::move(slice.guard_)) {
     objs_ = slice.mmap_array_->get(slice.start_idx_, size_);
   }
   explicit TypedMutableCsrEdgeIter(mmap_array<nbr_t>* ma, size_t start_idx,
@@ -647,7 +787,7 @@ class TypedMutableCsrEdgeIter : public MutableCsrEdgeIterBase {
 
     gbp::BufferBlock::UpdateContent<nbr_t>(
         [&](nbr_t& item) {
-          item.data = reinterpret_cast<const EDATA_T&>(value.data());
+          item.data = *reinterpret_cast<const EDATA_T*>(value.data());
           item.timestamp.store(ts);
         },
         objs_, cur_idx_);
@@ -665,6 +805,219 @@ class TypedMutableCsrEdgeIter : public MutableCsrEdgeIterBase {
   size_t cur_idx_;
   gbp::BufferBlock objs_;
   size_t size_;
+  ReaderEpoch::Guard guard_;
+};
+
+/**
+ * 带快照的只读迭代器，只返回对read_ts可见的边
+ * 1. 每次以页内连续的一段（最多WINDOW_SIZE个）邻居为单位，用mvcc_impl::visible_mask生成可见位图
+ * 2. next()只需要在位图上找下一个置位，整段都不可见时直接跳到下一段
+ */
+template <typename EDATA_T>
+class TypedMutableCsrSnapshotEdgeIter : public MutableCsrConstEdgeIterBase {
+  using nbr_t = MutableNbr<EDATA_T>;
+  constexpr static size_t WINDOW_SIZE = 64;
+
+ public:
+  TypedMutableCsrSnapshotEdgeIter()
+      : objs_(),
+        read_ts_(0),
+        cur_idx_(0),
+        size_(0),
+        window_start_(0),
+        window_end_(0),
+        window_mask_(0) {}
+  explicit TypedMutableCsrSnapshotEdgeIter(
+      const MutableNbrSlice<EDATA_T>& slice, timestamp_t read_ts)
+      : read_ts_(read_ts),
+        cur_idx_(0),
+        size_(slice.size_),
+        window_start_(0),
+        window_end_(0),
+        window_mask_(0),
+        guard_(slice.guard_) {
+    if (size_ != 0)
+      objs_ = slice.mmap_array_->get(slice.start_idx_, size_);
+    seek();
+  }
+  // objs中连续存放的size个邻居
+  TypedMutableCsrSnapshotEdgeIter(gbp::BufferBlock&& objs, size_t size,
+                                  timestamp_t read_ts)
+      : objs_(std::move(objs)),
+        read_ts_(read_ts),
+        cur_idx_(0),
+        size_(size),
+        window_start_(0),
+        window_end_(0),
+        window_mask_(0) {
+    seek();
+  }
+  ~TypedMutableCsrSnapshotEdgeIter() = default;
+
+  FORCE_INLINE vid_t get_neighbor() const {
+#if ASSERT_ENABLE
+    assert(is_valid());
+#endif
+    return gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).neighbor;
+  }
+
+  FORCE_INLINE const void* get_data() const {
+#if ASSERT_ENABLE
+    assert(is_valid());
+#endif
+    return &(gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).data);
+  }
+
+  FORCE_INLINE timestamp_t get_timestamp() const {
+#if ASSERT_ENABLE
+    assert(is_valid());
+#endif
+    return gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).timestamp.load();
+  }
+
+  FORCE_INLINE void next() {
+    window_mask_ &= window_mask_ - 1;
+    seek();
+  }
+  FORCE_INLINE bool is_valid() const { return cur_idx_ < size_; }
+  // 快照中可见的边数只有遍历之后才知道，这里返回剩余边数的上界
+  FORCE_INLINE size_t size() const { return size_ - cur_idx_; }
+  timestamp_t read_timestamp() const { return read_ts_; }
+
+ private:
+  // 定位到下一个可见的边，不存在时cur_idx_ = size_
+  FORCE_INLINE void seek() {
+    while (window_mask_ == 0) {
+      if (window_end_ >= size_) {
+        cur_idx_ = size_;
+        return;
+      }
+      load_window(window_end_);
+    }
+    cur_idx_ = window_start_ + __builtin_ctzll(window_mask_);
+  }
+
+  void load_window(size_t start) {
+    auto* base = objs_.Ptr<nbr_t>(start);
+    // 同一页内的邻居是连续的
+    size_t num =
+        (gbp::PAGE_SIZE_MEMORY - ((uintptr_t) base % gbp::PAGE_SIZE_MEMORY)) /
+        sizeof(nbr_t);
+    num = std::min({num, size_ - start, WINDOW_SIZE});
+
+    window_mask_ = 0;
+    for (size_t idx = 0; idx < num; idx += mvcc_impl::FILTER_WIDTH) {
+      auto width = std::min(num - idx, mvcc_impl::FILTER_WIDTH);
+      window_mask_ |=
+          (uint64_t) mvcc_impl::visible_mask(base + idx, width, read_ts_)
+          << idx;
+    }
+    window_start_ = start;
+    window_end_ = start + num;
+  }
+
+  gbp::BufferBlock objs_;
+  timestamp_t read_ts_;
+  size_t cur_idx_;
+  size_t size_;
+  size_t window_start_;
+  size_t window_end_;
+  uint64_t window_mask_;
+  ReaderEpoch::Guard guard_;
+};
+
+/**
+ * 按页批量遍历邻接表（非虚接口）
+ * 1. 每次next_chunk()返回一段同一页内连续存放的邻居，调用者可以直接在chunk上写紧凑的循环
+ * 2. 整个邻接表只调用一次mmap_array::get，不需要对每条边调用BufferBlock::Ref
+ * 3. chunk中包含对read_ts不可见的边（未提交或已删除），遍历chunk时需要用visible(i)过滤，
+ *    fill只输出可见的边
+ */
+template <typename EDATA_T>
+class TypedMutableCsrBatchEdgeIter {
+  using nbr_t = MutableNbr<EDATA_T>;
+
+ public:
+  TypedMutableCsrBatchEdgeIter()
+      : objs_(),
+        read_ts_(0),
+        size_(0),
+        chunk_(nullptr),
+        chunk_start_(0),
+        chunk_size_(0) {}
+  TypedMutableCsrBatchEdgeIter(const MutableNbrSlice<EDATA_T>& slice,
+                               timestamp_t read_ts)
+      : read_ts_(read_ts),
+        size_(slice.size_),
+        chunk_(nullptr),
+        chunk_start_(0),
+        chunk_size_(0),
+        guard_(slice.guard_) {
+    if (size_ != 0)
+      objs_ = slice.mmap_array_->get(slice.start_idx_, size_);
+  }
+  ~TypedMutableCsrBatchEdgeIter() = default;
+
+  // 切换到下一段，没有剩余的边时返回false
+  FORCE_INLINE bool next_chunk() {
+    chunk_start_ += chunk_size_;
+    if (chunk_start_ >= size_) {
+      chunk_ = nullptr;
+      chunk_size_ = 0;
+      return false;
+    }
+    chunk_ = objs_.Ptr<nbr_t>(chunk_start_);
+    chunk_size_ =
+        (gbp::PAGE_SIZE_MEMORY - ((uintptr_t) chunk_ % gbp::PAGE_SIZE_MEMORY)) /
+        sizeof(nbr_t);
+    chunk_size_ = std::min(chunk_size_, size_ - chunk_start_);
+    return true;
+  }
+
+  FORCE_INLINE const nbr_t* chunk() const { return chunk_; }
+  FORCE_INLINE size_t chunk_size() const { return chunk_size_; }
+  FORCE_INLINE bool visible(size_t idx) const {
+    return is_visible(chunk_[idx].timestamp.load(std::memory_order_relaxed),
+                      read_ts_);
+  }
+  // 可见的边数只有遍历之后才知道，这里返回上界
+  FORCE_INLINE size_t size() const { return size_; }
+  timestamp_t read_timestamp() const { return read_ts_; }
+
+  // 把所有可见的邻居（以及边上的数据和时间戳）拷贝到调用者提供的数组中，数组长度不小于size()
+  size_t fill(vid_t* neighbors, EDATA_T* data = nullptr,
+              timestamp_t* timestamps = nullptr) {
+    size_t num = 0;
+    while (next_chunk()) {
+      const nbr_t* nbrs = chunk_;
+      const size_t chunk_size = chunk_size_;
+      for (size_t idx = 0; idx < chunk_size; idx += mvcc_impl::FILTER_WIDTH) {
+        auto width = std::min(chunk_size - idx, mvcc_impl::FILTER_WIDTH);
+        uint32_t mask = mvcc_impl::visible_mask(nbrs + idx, width, read_ts_);
+        while (mask != 0) {
+          auto i = idx + __builtin_ctz(mask);
+          neighbors[num] = nbrs[i].neighbor;
+          if (data != nullptr)
+            data[num] = nbrs[i].data;
+          if (timestamps != nullptr)
+            timestamps[num] =
+                nbrs[i].timestamp.load(std::memory_order_relaxed);
+          num++;
+          mask &= mask - 1;
+        }
+      }
+    }
+    return num;
+  }
+
+ private:
+  gbp::BufferBlock objs_;
+  timestamp_t read_ts_;
+  size_t size_;
+  const nbr_t* chunk_;
+  size_t chunk_start_;
+  size_t chunk_size_;
+  ReaderEpoch::Guard guard_;
 };
 #endif
 
@@ -687,18 +1040,29 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
   using slice_t = MutableNbrSlice<EDATA_T>;
   using mut_slice_t = MutableNbrSliceMut<EDATA_T>;
 
+#if OV
   MutableCsr() : locks_(nullptr) {}
+#else
+  // adj_lists的第column_id列存放各个顶点的MutableAdjlist，由Vertex持有
+  MutableCsr(FixedLengthColumnFamily& adj_lists, size_t column_id)
+      : locks_(nullptr),
+        adj_lists_(adj_lists),
+        column_id_(column_id),
+        size_(0),
+        capacity_(0) {}
+#endif
   ~MutableCsr() {
     if (locks_ != nullptr) {
       delete[] locks_;
     }
   }
 
+#if OV
   void batch_init(const std::string& name, const std::string& work_dir,
                   const std::vector<int>& degree) override {
     assert(false);
   }
-#if OV
+
   void open(const std::string& name, const std::string& snapshot_dir,
             const std::string& work_dir) override {
     mmap_array<int> degree_list;
@@ -721,7 +1085,59 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
             const std::string& work_dir) override {
     assert(false);
   }
-  void resize(size_t size) override { nbr_list_.resize(size); }
+
+  /**
+   * bulkload：按度数一次性为所有顶点分配邻居区间，之后通过batch_put_edges填充
+   * 区间按顶点顺序首尾相连（与OV下open的布局相同），不在degree中的顶点为空邻接表。
+   * 邻居文件恰好放下所有区间，之后还要通过put_edge插入时由调用者先resize预留空间
+   */
+  void batch_init(const std::string& name, const std::string& work_dir,
+                  const std::vector<int>& degree) override {
+    assert(degree.size() <= adj_lists_.getRowNum());
+    size_t nbr_capacity = 0;
+    for (auto d : degree)
+      nbr_capacity += d;
+    nbr_list_.open(work_dir + "/" + name + ".nbr", false);
+    nbr_list_.resize(nbr_capacity);
+    capacity_ = nbr_capacity;
+    size_ = nbr_capacity;
+    if (locks_ != nullptr)
+      delete[] locks_;
+    locks_ = new SpinLock[adj_lists_.getRowNum()];
+
+    size_t start_idx = 0;
+    for (size_t v = 0; v < adj_lists_.getRowNum(); v++) {
+      adjlist_t adj_list;
+      if (v < degree.size()) {
+        adj_list.init(start_idx, degree[v], 0);
+        start_idx += degree[v];
+      }
+      adj_lists_.setColumn(v, column_id_,
+                           {reinterpret_cast<const char*>(&adj_list),
+                            sizeof(adjlist_t)});
+    }
+  }
+
+  // 打开存放邻居的文件，adj_lists_中的邻接表都为空，nbr_capacity为邻居区间的总容量
+  void init(const std::string& nbr_filename, size_t nbr_capacity) {
+    nbr_list_.open(nbr_filename, false);
+    nbr_list_.resize(nbr_capacity);
+    capacity_ = nbr_capacity;
+    size_ = 0;
+    if (locks_ != nullptr)
+      delete[] locks_;
+    locks_ = new SpinLock[adj_lists_.getRowNum()];
+    adjlist_t empty;
+    for (size_t v = 0; v < adj_lists_.getRowNum(); v++)
+      adj_lists_.setColumn(v, column_id_,
+                           {reinterpret_cast<const char*>(&empty),
+                            sizeof(adjlist_t)});
+  }
+
+  void resize(size_t size) override {
+    nbr_list_.resize(size);
+    capacity_ = size;
+  }
 
   void copy_before_insert(vid_t v) override {
     assert(v < adj_lists_.getRowNum());
@@ -729,15 +1145,11 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
     auto adj_list_item = adj_lists_.getColumn(v, column_id_);
     auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
 
-    auto capacity_new = adj_list.capacity_;
-    size_t start_idx_new;
-    capacity_new += ((capacity_new) >> 1);
+    size_t capacity_old = adj_list.capacity_,
+           start_idx_old = adj_list.start_idx_;
+    size_t capacity_new = capacity_old + (capacity_old >> 1);
     capacity_new = capacity_new > 8 ? capacity_new : 8;
-
-    bool success = false;
-    std::tie<bool, size_t>(success, start_idx_new) =
-        gbp::atomic_add<size_t>(size_, capacity_new, nbr_list_.size());
-    assert(success);
+    size_t start_idx_new = allocate_range(capacity_new);
 
     // 复制数据到新的位置
     auto nbr_slice_old = nbr_list_.get(adj_list.start_idx_, adj_list.size_);
@@ -754,10 +1166,10 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
 
     gbp::BufferBlock::UpdateContent<adjlist_t>(
         [&](adjlist_t& item) {
-          item.capacity_ = capacity_new;
-          item.start_idx_ = start_idx_new;
+          item.publish(start_idx_new, item.size_.load(), capacity_new);
         },
         adj_list_item);
+    retire_range(start_idx_old, capacity_old);
 
     locks_[v].unlock();
   }
@@ -808,8 +1220,6 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
   }
 #endif
 
-  void resize(vid_t vnum) override { assert(false); }
-
   size_t size() const override { return adj_lists_.getRowNum(); }
 #if OV
   void batch_put_edge(vid_t src, vid_t dst, const EDATA_T& data,
@@ -832,7 +1242,7 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
   void put_generic_edge(vid_t src, vid_t dst, const std::string_view value,
                         timestamp_t ts) override {
     assert(value.size() == sizeof(EDATA_T));
-    put_edge(src, dst, reinterpret_cast<const EDATA_T&>(value.data()), ts);
+    put_edge(src, dst, *reinterpret_cast<const EDATA_T*>(value.data()), ts);
   }
 #if OV
   void put_edge(vid_t src, vid_t dst, const EDATA_T& data, timestamp_t ts,
@@ -846,7 +1256,7 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
   void put_edge(vid_t src, vid_t dst, const std::string_view value,
                 timestamp_t ts) {
     assert(value.size() == sizeof(EDATA_T));
-    put_edge(src, dst, reinterpret_cast<const EDATA_T&>(value.data()), ts);
+    put_edge(src, dst, *reinterpret_cast<const EDATA_T*>(value.data()), ts);
   }
 
   void put_edge(vid_t src, vid_t dst, const EDATA_T& data, timestamp_t ts) {
@@ -854,38 +1264,9 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
     locks_[src].lock();
     auto adj_list_item = adj_lists_.getColumn(src, column_id_);
     auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
+    assert(!adj_list.is_inline());  // MutableCsr只使用nbr_list_中的空间
 
-    auto capacity_new = adj_list.capacity_;
-    size_t start_idx_new;
-    if (adj_list.size_ == adj_list.capacity_) {
-      capacity_new += ((capacity_new) >> 1);
-      capacity_new = capacity_new > 8 ? capacity_new : 8;
-
-      bool success = false;
-      std::tie<bool, size_t>(success, start_idx_new) =
-          gbp::atomic_add<size_t>(size_, capacity_new, nbr_list_.size());
-      assert(success);
-
-      // 复制数据到新的位置
-      auto nbr_slice_old = nbr_list_.get(adj_list.start_idx_, adj_list.size_);
-      auto nbr_slice_new = nbr_list_.get(start_idx_new, adj_list.size_);
-      for (size_t i = 0; i < adj_list.size_; i++)
-        gbp::BufferBlock::UpdateContent<nbr_t>(
-            [&](nbr_t& item) {
-              auto& item_old = gbp::BufferBlock::Ref<nbr_t>(nbr_slice_old, i);
-              item.data = item_old.data;
-              item.neighbor = item_old.neighbor;
-              item.timestamp = item_old.timestamp.load();
-            },
-            nbr_slice_new, i);
-
-      gbp::BufferBlock::UpdateContent<adjlist_t>(
-          [&](adjlist_t& item) {
-            item.capacity_ = capacity_new;
-            item.start_idx_ = start_idx_new;
-          },
-          adj_list_item);
-    }
+    reserve(adj_list_item, adj_list, adj_list.size_ + 1);
     size_t idx_new = 0;
     gbp::BufferBlock::UpdateContent<adjlist_t>(
         [&](adjlist_t& item) { idx_new = item.size_.fetch_add(1); },
@@ -901,6 +1282,211 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
         nbr_item_new);
     locks_[src].unlock();
   }
+
+  /**
+   * bulkload：把src的num条边追加到其邻接表的末尾，EDATA_T为EmptyType时data可以为nullptr
+   * 邻居先在内存中拼好，再通过set_batch写入，每个页面只调用一次SetBlock；
+   * 写完之后才增加size_，读者不会读到未写入的邻居。容量不足时与put_edge一样扩容
+   */
+  void batch_put_edges(vid_t src, const vid_t* neighbors, const EDATA_T* data,
+                       size_t num, timestamp_t ts = 0) {
+    assert(src < adj_lists_.getRowNum());
+    if (num == 0)
+      return;
+    thread_local std::vector<char> nbrs;
+    nbrs.resize(num * sizeof(nbr_t));
+    for (size_t i = 0; i < num; i++) {
+      auto nbr = new (nbrs.data() + i * sizeof(nbr_t)) nbr_t();
+      nbr->neighbor = neighbors[i];
+      if constexpr (!std::is_same_v<EDATA_T, EmptyType>)
+        nbr->data = data[i];
+      nbr->timestamp.store(ts);
+    }
+
+    locks_[src].lock();
+    auto adj_list_item = adj_lists_.getColumn(src, column_id_);
+    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
+    assert(!adj_list.is_inline());
+    reserve(adj_list_item, adj_list, adj_list.size_ + num);
+    nbr_list_.set_batch(adj_list.start_idx_ + adj_list.size_,
+                        {nbrs.data(), nbrs.size()}, num);
+    gbp::BufferBlock::UpdateContent<adjlist_t>(
+        [&](adjlist_t& item) { item.size_.fetch_add(num); }, adj_list_item);
+    locks_[src].unlock();
+  }
+
+  /**
+   * bulkload：写入ChunkedCSVReader解析出的一个batch，cells按行主序排列，每行column_num个，
+   * 第0列为src，第1列为dst，EDATA_T不是EmptyType时第2列为边上的数据。
+   * batch中的边按src分组（保持文件中的顺序），每个src调用一次batch_put_edges
+   */
+  void batch_put_edges(const std::vector<std::string_view>& cells,
+                       size_t column_num, timestamp_t ts = 0) {
+    static_assert(std::is_integral_v<EDATA_T> ||
+                  std::is_same_v<EDATA_T, EmptyType>);
+    assert(column_num >= (std::is_same_v<EDATA_T, EmptyType> ? 2 : 3));
+    auto parse = [](std::string_view cell, auto& value) {
+      std::from_chars(cell.data(), cell.data() + cell.size(), value);
+    };
+    size_t row_num = cells.size() / column_num;
+    thread_local std::vector<std::pair<vid_t, size_t>> order;  // <src, row_id>
+    order.resize(row_num);
+    for (size_t row_id = 0; row_id < row_num; row_id++) {
+      vid_t src = 0;
+      parse(cells[row_id * column_num], src);
+      order[row_id] = {src, row_id};
+    }
+    std::sort(order.begin(), order.end());
+
+    thread_local std::vector<vid_t> neighbors;
+    thread_local std::vector<EDATA_T> data;
+    for (size_t begin = 0, end = 0; begin < row_num; begin = end) {
+      vid_t src = order[begin].first;
+      neighbors.clear();
+      data.clear();
+      for (end = begin; end < row_num && order[end].first == src; end++) {
+        auto row = &cells[order[end].second * column_num];
+        neighbors.emplace_back();
+        parse(row[1], neighbors.back());
+        if constexpr (!std::is_same_v<EDATA_T, EmptyType>) {
+          data.emplace_back();
+          parse(row[2], data.back());
+        }
+      }
+      batch_put_edges(src, neighbors.data(), data.data(), neighbors.size(),
+                      ts);
+    }
+  }
+
+  /**
+   * 把src到dst的一条未删除的边标记为在ts处删除，read_ts < ts的读者仍然可以看到它
+   * 删除之后边上只剩删除时间戳，插入时间戳丢失，read_ts早于插入时间戳的读者会错误地看到这条边。
+   * 因此只删除插入时间戳不大于vm.min_read_timestamp()的边：此时所有活跃读者以及之后的读者都已经能看到它，
+   * 丢掉插入时间戳不影响任何读者。插入得更晚的边不会被删除，返回false，由调用者在读者推进之后重试
+   */
+  bool delete_edge(vid_t src, vid_t dst, timestamp_t ts,
+                   const VersionManager& vm) {
+    assert(src < adj_lists_.getRowNum());
+    assert(ts <= MAX_TIMESTAMP);
+    bool deleted = false;
+    locks_[src].lock();
+    auto min_read_ts = vm.min_read_timestamp();
+    auto adj_list_item = adj_lists_.getColumn(src, column_id_);
+    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
+    if (adj_list.size_ != 0) {
+      auto nbr_slice = nbr_list_.get(adj_list.start_idx_, adj_list.size_);
+      for (size_t i = 0; i < adj_list.size_; i++) {
+        auto& nbr = gbp::BufferBlock::Ref<nbr_t>(nbr_slice, i);
+        auto insert_ts = nbr.timestamp.load();
+        if (nbr.neighbor == dst && !is_deleted(insert_ts) &&
+            insert_ts <= min_read_ts) {
+          assert(insert_ts < ts);
+          gbp::BufferBlock::UpdateContent<nbr_t>(
+              [&](nbr_t& item) {
+                item.timestamp.store(ts | TIMESTAMP_DELETE_MASK);
+              },
+              nbr_slice, i);
+          deleted = true;
+          break;
+        }
+      }
+    }
+    locks_[src].unlock();
+    return deleted;
+  }
+
+  /**
+   * 回收删除时间戳不大于vm.min_read_timestamp()的边，这些边对所有读者都不可见。
+   * 为了不影响正在遍历旧邻接表的读者，存活的边被复制到新的位置（与put_edge扩容相同），
+   * 旧的区间在可能读到它的读者都退出之后由reclaim_ranges复用，返回回收的边数
+   */
+  size_t compact(const VersionManager& vm) {
+    auto min_read_ts = vm.min_read_timestamp();
+    size_t reclaimed_num = 0;
+    for (vid_t v = 0; v < adj_lists_.getRowNum(); v++)
+      reclaimed_num += compact(v, min_read_ts);
+    reclaim_ranges();
+    return reclaimed_num;
+  }
+
+  size_t compact(vid_t v, timestamp_t min_read_ts) {
+    assert(v < adj_lists_.getRowNum());
+    locks_[v].lock();
+    auto adj_list_item = adj_lists_.getColumn(v, column_id_);
+    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
+    size_t size_old = adj_list.size_;
+    if (size_old == 0) {
+      locks_[v].unlock();
+      return 0;
+    }
+
+    auto nbr_slice_old = nbr_list_.get(adj_list.start_idx_, size_old);
+    auto reclaimable = [&](size_t idx) {
+      auto ts = gbp::BufferBlock::Ref<nbr_t>(nbr_slice_old, idx)
+                    .timestamp.load();
+      return is_deleted(ts) && (ts & MAX_TIMESTAMP) <= min_read_ts;
+    };
+    size_t size_new = 0;
+    for (size_t i = 0; i < size_old; i++) {
+      if (!reclaimable(i))
+        size_new++;
+    }
+    if (size_new == size_old) {
+      locks_[v].unlock();
+      return 0;
+    }
+
+    // 所有的边都被回收时不需要新的区间，之后的put_edge会重新分配
+    size_t capacity_new = 0, start_idx_new = 0;
+    if (size_new != 0) {
+      capacity_new = size_new + (size_new >> 1);
+      capacity_new = capacity_new > 8 ? capacity_new : 8;
+      start_idx_new = allocate_range(capacity_new);
+
+      auto nbr_slice_new = nbr_list_.get(start_idx_new, size_new);
+      for (size_t i = 0, j = 0; i < size_old; i++) {
+        if (reclaimable(i))
+          continue;
+        gbp::BufferBlock::UpdateContent<nbr_t>(
+            [&](nbr_t& item) {
+              auto& item_old = gbp::BufferBlock::Ref<nbr_t>(nbr_slice_old, i);
+              item.data = item_old.data;
+              item.neighbor = item_old.neighbor;
+              item.timestamp = item_old.timestamp.load();
+            },
+            nbr_slice_new, j++);
+      }
+    }
+
+    size_t capacity_old = adj_list.capacity_,
+           start_idx_old = adj_list.start_idx_;
+    // (start_idx_, size_)一起切换，读者要么看到旧的邻接表，要么看到新的邻接表
+    gbp::BufferBlock::UpdateContent<adjlist_t>(
+        [&](adjlist_t& item) {
+          item.publish(start_idx_new, size_new, capacity_new);
+        },
+        adj_list_item);
+    retire_range(start_idx_old, capacity_old);
+    locks_[v].unlock();
+    return size_old - size_new;
+  }
+
+  /**
+   * 复用被替换下来的旧区间（扩容和compact都会产生）。
+   * 读取区间的读者（get_edges、各种迭代器、get_neighbors）都持有epoch_的Guard，
+   * 登记的纪元不大于区间退休纪元的读者都退出之后，区间才进入free_ranges_
+   */
+  void reclaim_ranges() {
+    std::lock_guard<std::mutex> guard(range_lock_);
+    size_t kept = 0;
+    for (auto& range : retired_ranges_) {
+      if (epoch_.reclaimable(range.retire_epoch))
+        free_ranges_.emplace(range.capacity, range.start_idx);
+      else
+        retired_ranges_[kept++] = range;
+    }
+    retired_ranges_.resize(kept);
+  }
 #endif
 
 #if OV
@@ -915,32 +1501,37 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
     return gbp::BufferBlock::Ref<adjlist_t>(adj_list).size_;
   }
 
+  // 与get_edges相同，读取区间期间持有epoch_的Guard，区间不会被并发的扩容或compact回收复用
   gbp::BufferBlock get_edge(vid_t src, vid_t i) const {
+    auto guard = epoch_.enter();
     auto item = adj_lists_.getColumn(src, column_id_);
-    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(item);
+    size_t start_idx, size;
+    gbp::BufferBlock::Ref<adjlist_t>(item).load_range(start_idx, size);
+#if ASSERT_ENABLE
+    assert(i < size);
+#endif
 
-    return nbr_list_.get(adj_list.start_idx_ + i);
+    return nbr_list_.get(start_idx + i);
   }
 
+  // 返回的slice（以及由它构造的迭代器）持有ReaderEpoch::Guard，读者需要在读取区间之前进入
   const slice_t get_edges(vid_t i) const override {
     slice_t ret;
+    ret.guard_ = epoch_.enter();
     auto item = adj_lists_.getColumn(i, column_id_);
-    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(item);
-
     ret.mmap_array_ = &nbr_list_;
-    ret.start_idx_ = adj_list.start_idx_;
-    ret.size_ = adj_list.size_.load(std::memory_order_acquire);
+    gbp::BufferBlock::Ref<adjlist_t>(item).load_range(ret.start_idx_,
+                                                      ret.size_);
     return ret;
   }
 
   mut_slice_t get_edges_mut(vid_t i) {
-    auto item = adj_lists_.getColumn(i, column_id_);
-    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(item);
-
     mut_slice_t ret;
+    ret.guard_ = epoch_.enter();
+    auto item = adj_lists_.getColumn(i, column_id_);
     ret.mmap_array_ = &nbr_list_;
-    ret.start_idx_ = adj_list.start_idx_;
-    ret.size_ = adj_list.size_.load();
+    gbp::BufferBlock::Ref<adjlist_t>(item).load_range(ret.start_idx_,
+                                                      ret.size_);
     return ret;
   }
 
@@ -979,6 +1570,35 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
   std::shared_ptr<MutableCsrEdgeIterBase> edge_iter_mut(vid_t v) override {
     return std::make_shared<TypedMutableCsrEdgeIter<EDATA_T>>(get_edges_mut(v));
   }
+#if !OV
+  std::shared_ptr<MutableCsrConstEdgeIterBase> snapshot_edge_iter(
+      vid_t v, timestamp_t read_ts) const override {
+    return std::make_shared<TypedMutableCsrSnapshotEdgeIter<EDATA_T>>(
+        get_edges(v), read_ts);
+  }
+
+  TypedMutableCsrBatchEdgeIter<EDATA_T> batch_edge_iter(
+      vid_t v, timestamp_t read_ts) const {
+    return TypedMutableCsrBatchEdgeIter<EDATA_T>(get_edges(v), read_ts);
+  }
+
+  // neighbors（以及data和timestamps）的长度不小于degree(v)
+  size_t get_neighbors(vid_t v, timestamp_t read_ts, vid_t* neighbors,
+                       EDATA_T* data = nullptr,
+                       timestamp_t* timestamps = nullptr) const {
+    return batch_edge_iter(v, read_ts).fill(neighbors, data, timestamps);
+  }
+
+  size_t get_neighbors(vid_t v, timestamp_t read_ts,
+                       std::vector<vid_t>& neighbors) const override {
+    auto iter = batch_edge_iter(v, read_ts);
+    auto offset = neighbors.size();
+    neighbors.resize(offset + iter.size());
+    auto num = iter.fill(neighbors.data() + offset);
+    neighbors.resize(offset + num);
+    return num;
+  }
+#endif
 
  private:
 #if OV
@@ -986,12 +1606,86 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
   mmap_array<adjlist_t> adj_lists_;
   mmap_array<nbr_t> nbr_list_;
 #else
+  // 优先复用free_ranges_中不小于capacity的最小区间，多余的部分放回free_ranges_
+  size_t allocate_range(size_t capacity) {
+    {
+      std::lock_guard<std::mutex> guard(range_lock_);
+      auto iter = free_ranges_.lower_bound(capacity);
+      if (iter != free_ranges_.end()) {
+        size_t start_idx = iter->second, rest = iter->first - capacity;
+        free_ranges_.erase(iter);
+        if (rest != 0)
+          free_ranges_.emplace(rest, start_idx + capacity);
+        return start_idx;
+      }
+    }
+    bool success = false;
+    size_t start_idx = 0;
+    std::tie<bool, size_t>(success, start_idx) =
+        gbp::atomic_add<size_t>(size_, capacity, nbr_list_.size());
+    assert(success);
+    return start_idx;
+  }
+
+  // 容量小于size时把邻接表复制到新的区间并发布，调用者需要持有该邻接表的锁
+  void reserve(gbp::BufferBlock& adj_list_item, const adjlist_t& adj_list,
+               size_t size) {
+    if (size <= adj_list.capacity_)
+      return;
+    size_t capacity_old = adj_list.capacity_,
+           start_idx_old = adj_list.start_idx_;
+    size_t capacity_new = capacity_old + (capacity_old >> 1);
+    capacity_new = capacity_new > 8 ? capacity_new : 8;
+    capacity_new = capacity_new > size ? capacity_new : size;
+    size_t start_idx_new = allocate_range(capacity_new);
+
+    // 复制数据到新的位置
+    auto nbr_slice_old = nbr_list_.get(adj_list.start_idx_, adj_list.size_);
+    auto nbr_slice_new = nbr_list_.get(start_idx_new, adj_list.size_);
+    for (size_t i = 0; i < adj_list.size_; i++)
+      gbp::BufferBlock::UpdateContent<nbr_t>(
+          [&](nbr_t& item) {
+            auto& item_old = gbp::BufferBlock::Ref<nbr_t>(nbr_slice_old, i);
+            item.data = item_old.data;
+            item.neighbor = item_old.neighbor;
+            item.timestamp = item_old.timestamp.load();
+          },
+          nbr_slice_new, i);
+
+    gbp::BufferBlock::UpdateContent<adjlist_t>(
+        [&](adjlist_t& item) {
+          item.publish(start_idx_new, item.size_.load(), capacity_new);
+        },
+        adj_list_item);
+    retire_range(start_idx_old, capacity_old);
+  }
+
+  void retire_range(size_t start_idx, size_t capacity) {
+    if (capacity == 0)
+      return;
+    // 新区间已经发布，之后进入的读者不会再读到旧区间
+    auto retire_epoch = epoch_.retire();
+    std::lock_guard<std::mutex> guard(range_lock_);
+    retired_ranges_.push_back({start_idx, capacity, retire_epoch});
+  }
+
+  struct RetiredRange {
+    size_t start_idx;
+    size_t capacity;
+    uint64_t retire_epoch;
+  };
+
   SpinLock* locks_;
   FixedLengthColumnFamily& adj_lists_;
   size_t column_id_;
   mmap_array<nbr_t> nbr_list_;
   std::atomic<size_t> size_;
   size_t capacity_;
+
+  std::mutex range_lock_;
+  mutable ReaderEpoch epoch_;
+  std::vector<RetiredRange> retired_ranges_;
+  std::multimap<size_t, size_t> free_ranges_;  // capacity -> start_idx
 #endif
 };
 
@@ -1049,7 +1743,7 @@ class SingleMutableCsr : public TypedMutableCsrBase<EDATA_T> {
   void put_generic_edge(vid_t src, vid_t dst, const std::string_view value,
                         timestamp_t ts) override {
     assert(value.size() == sizeof(EDATA_T));
-    put_edge(src, dst, reinterpret_cast<const EDATA_T&>(value.data()), ts);
+    put_edge(src, dst, *reinterpret_cast<const EDATA_T*>(value.data()), ts);
   }
 #if OV
   void put_edge(vid_t src, vid_t dst, const EDATA_T& data, timestamp_t ts,
@@ -1137,6 +1831,32 @@ class SingleMutableCsr : public TypedMutableCsrBase<EDATA_T> {
     return std::make_shared<TypedMutableCsrEdgeIter<EDATA_T>>(get_edges_mut(v));
   }
 
+#if !OV
+  // 每个顶点至多一条边，时间戳为max表示没有边
+  std::shared_ptr<MutableCsrConstEdgeIterBase> snapshot_edge_iter(
+      vid_t v, timestamp_t read_ts) const override {
+    auto item = get_edge(v);
+    size_t size = gbp::BufferBlock::Ref<nbr_t>(item).timestamp.load() ==
+                          std::numeric_limits<timestamp_t>::max()
+                      ? 0
+                      : 1;
+    return std::make_shared<TypedMutableCsrSnapshotEdgeIter<EDATA_T>>(
+        std::move(item), size, read_ts);
+  }
+
+  size_t get_neighbors(vid_t v, timestamp_t read_ts,
+                       std::vector<vid_t>& neighbors) const override {
+    auto item = get_edge(v);
+    auto& nbr = gbp::BufferBlock::Ref<nbr_t>(item);
+    auto ts = nbr.timestamp.load();
+    if (ts == std::numeric_limits<timestamp_t>::max() ||
+        !is_visible(ts, read_ts))
+      return 0;
+    neighbors.push_back(nbr.neighbor);
+    return 1;
+  }
+#endif
+
  private:
   FixedLengthColumnFamily& nbr_list_column_;
   size_t column_id_;
@@ -1196,6 +1916,16 @@ class EmptyCsr : public TypedMutableCsrBase<EDATA_T> {
     return std::make_shared<TypedMutableCsrEdgeIter<EDATA_T>>(
         MutableNbrSliceMut<EDATA_T>::empty());
   }
+#if !OV
+  std::shared_ptr<MutableCsrConstEdgeIterBase> snapshot_edge_iter(
+      vid_t v, timestamp_t read_ts) const override {
+    return std::make_shared<TypedMutableCsrSnapshotEdgeIter<EDATA_T>>();
+  }
+  size_t get_neighbors(vid_t v, timestamp_t read_ts,
+                       std::vector<vid_t>& neighbors) const override {
+    return 0;
+  }
+#endif
   size_t get_index_size_in_byte() const override { return 0; }
   size_t get_data_size_in_byte() const override { return 0; }
 };
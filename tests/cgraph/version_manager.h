@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include "../../include/config.h"
+#include "../../include/utils.h"
+
+namespace test {
+using timestamp_t = uint32_t;
+
+/**
+ * 边上的timestamp编码（MVCC）
+ * 1. 最高位为0：插入时间戳为ts，read_ts >= ts的读者可见
+ * 2. 最高位为1：边在ts处被删除，read_ts < ts的读者仍可见（删除后不再保留插入时间戳）
+ * 3. 因此有效时间戳只有31位，最大为MAX_TIMESTAMP
+ * 4. 由于插入时间戳被覆盖，只有插入时间戳不大于VersionManager::min_read_timestamp()
+ * （所有读者都已经能看到插入）的边才可以被删除，见MutableCsr::delete_edge
+ */
+constexpr timestamp_t TIMESTAMP_DELETE_MASK = timestamp_t(1) << 31;
+constexpr timestamp_t MAX_TIMESTAMP = TIMESTAMP_DELETE_MASK - 1;
+constexpr timestamp_t INVALID_READ_TIMESTAMP =
+    std::numeric_limits<timestamp_t>::max();
+constexpr static size_t VERSION_MANAGER_READER_SLOT_NUM = 256;
+
+FORCE_INLINE inline bool is_deleted(timestamp_t ts) {
+  return ts & TIMESTAMP_DELETE_MASK;
+}
+
+FORCE_INLINE inline bool is_visible(timestamp_t ts, timestamp_t read_ts) {
+  return is_deleted(ts) ? read_ts < (ts & MAX_TIMESTAMP) : ts <= read_ts;
+}
+
+/**
+ * 分配读快照与写时间戳
+ * 1. 写者通过acquire_insert_timestamp获取递增的时间戳，release时按照时间戳顺序推进read_ts_，
+ * 所以读者拿到的read_ts之前的所有写都已经完成
+ * 2. 读者把自己的read_ts登记在slot中，min_read_timestamp返回所有活跃读者中最小的read_ts，
+ * 删除时间戳不大于它的边对所有读者（包括之后的读者）都不可见，可以被compaction回收
+ */
+class VersionManager {
+ public:
+  class ReadSnapshot {
+   public:
+    ReadSnapshot() : vm_(nullptr), slot_(0), read_ts_(0) {}
+    ReadSnapshot(VersionManager* vm, size_t slot, timestamp_t read_ts)
+        : vm_(vm), slot_(slot), read_ts_(read_ts) {}
+    ReadSnapshot(const ReadSnapshot&) = delete;
+    ReadSnapshot& operator=(const ReadSnapshot&) = delete;
+    ReadSnapshot(ReadSnapshot&& src) noexcept
+        : vm_(src.vm_), slot_(src.slot_), read_ts_(src.read_ts_) {
+      src.vm_ = nullptr;
+    }
+    ReadSnapshot& operator=(ReadSnapshot&& src) noexcept {
+      if (this != &src) {
+        release();
+        vm_ = src.vm_;
+        slot_ = src.slot_;
+        read_ts_ = src.read_ts_;
+        src.vm_ = nullptr;
+      }
+      return *this;
+    }
+    ~ReadSnapshot() { release(); }
+
+    timestamp_t timestamp() const { return read_ts_; }
+    void release() {
+      if (vm_ != nullptr) {
+        vm_->release_read_timestamp(slot_);
+        vm_ = nullptr;
+      }
+    }
+
+   private:
+    VersionManager* vm_;
+    size_t slot_;
+    timestamp_t read_ts_;
+  };
+
+  VersionManager() { init_ts(0); }
+  ~VersionManager() = default;
+
+  // 只能在没有读者和写者时调用
+  void init_ts(timestamp_t ts) {
+    assert(ts < MAX_TIMESTAMP);
+    read_ts_.store(ts);
+    write_ts_.store(ts + 1);
+    for (auto& slot : reader_slots_)
+      slot.store(INVALID_READ_TIMESTAMP);
+  }
+
+  ReadSnapshot acquire_read_snapshot() {
+    auto slot_id = gbp::get_thread_id() % VERSION_MANAGER_READER_SLOT_NUM;
+    timestamp_t read_ts;
+    while (true) {
+      read_ts = read_ts_.load();
+      auto expected = INVALID_READ_TIMESTAMP;
+      if (reader_slots_[slot_id].compare_exchange_weak(expected, read_ts))
+        break;
+      slot_id = (slot_id + 1) % VERSION_MANAGER_READER_SLOT_NUM;
+    }
+    // 登记之后再确认一次，保证与min_read_timestamp之间不会漏掉该读者
+    while (true) {
+      auto read_ts_cur = read_ts_.load();
+      if (read_ts_cur == read_ts)
+        break;
+      read_ts = read_ts_cur;
+      reader_slots_[slot_id].store(read_ts);
+    }
+    return ReadSnapshot(this, slot_id, read_ts);
+  }
+
+  timestamp_t acquire_insert_timestamp() {
+    auto ts = write_ts_.fetch_add(1);
+    assert(ts <= MAX_TIMESTAMP);
+    return ts;
+  }
+
+  // 按时间戳顺序提交，保证read_ts_之前没有未完成的写
+  void release_insert_timestamp(timestamp_t ts) {
+    while (read_ts_.load(std::memory_order_acquire) + 1 != ts)
+      std::this_thread::yield();
+    read_ts_.store(ts, std::memory_order_release);
+  }
+
+  timestamp_t read_timestamp() const { return read_ts_.load(); }
+
+  timestamp_t min_read_timestamp() const {
+    auto ret = read_ts_.load();
+    for (auto& slot : reader_slots_) {
+      auto read_ts = slot.load();
+      if (read_ts < ret)
+        ret = read_ts;
+    }
+    return ret;
+  }
+
+  // 活跃读者中最小的read_ts，没有活跃读者时返回INVALID_READ_TIMESTAMP
+  timestamp_t min_active_read_timestamp() const {
+    auto ret = INVALID_READ_TIMESTAMP;
+    for (auto& slot : reader_slots_) {
+      auto read_ts = slot.load();
+      if (read_ts < ret)
+        ret = read_ts;
+    }
+    return ret;
+  }
+
+ private:
+  void release_read_timestamp(size_t slot_id) {
+    reader_slots_[slot_id].store(INVALID_READ_TIMESTAMP,
+                                 std::memory_order_release);
+  }
+
+  std::atomic<timestamp_t> read_ts_;
+  std::atomic<timestamp_t> write_ts_;
+  std::atomic<timestamp_t> reader_slots_[VERSION_MANAGER_READER_SLOT_NUM];
+};
+
+/**
+ * 邻接表区间的读者纪元（epoch-based reclamation）
+ * 1. 读者在读取邻接表的(start_idx_, size_)之前进入，把进入时的纪元登记在slot中；
+ * Guard可以拷贝（slot上的引用计数），随slice与迭代器一起传递，最后一个Guard析构时退出
+ * 2. 写者发布新区间之后调用retire()取得旧区间的退休纪元e并推进纪元，
+ * 之后进入的读者都只能看到新区间，因此活跃读者登记的纪元都大于e时旧区间可以复用
+ * 3. 与VersionManager不同，不要求读者持有ReadSnapshot（get_edges、edge_iter等没有read_ts）
+ */
+class ReaderEpoch {
+ public:
+  constexpr static uint64_t IDLE = 0;
+
+  class Guard {
+   public:
+    Guard() : epoch_(nullptr), slot_(0) {}
+    Guard(ReaderEpoch* epoch, size_t slot) : epoch_(epoch), slot_(slot) {}
+    Guard(const Guard& src) : epoch_(src.epoch_), slot_(src.slot_) {
+      if (epoch_ != nullptr)
+        epoch_->slots_[slot_].ref_count.fetch_add(1);
+    }
+    Guard& operator=(const Guard& src) {
+      if (this != &src) {
+        Guard tmp(src);
+        std::swap(epoch_, tmp.epoch_);
+        std::swap(slot_, tmp.slot_);
+      }
+      return *this;
+    }
+    Guard(Guard&& src) noexcept : epoch_(src.epoch_), slot_(src.slot_) {
+      src.epoch_ = nullptr;
+    }
+    Guard& operator=(Guard&& src) noexcept {
+      std::swap(epoch_, src.epoch_);
+      std::swap(slot_, src.slot_);
+      return *this;
+    }
+    ~Guard() {
+      if (epoch_ != nullptr)
+        epoch_->exit(slot_);
+    }
+
+   private:
+    ReaderEpoch* epoch_;
+    size_t slot_;
+  };
+
+  ReaderEpoch() : epoch_(1) {
+    for (auto& slot : slots_) {
+      slot.epoch.store(IDLE);
+      slot.ref_count.store(0);
+    }
+  }
+
+  Guard enter() {
+    auto slot_id = gbp::get_thread_id() % VERSION_MANAGER_READER_SLOT_NUM;
+    while (true) {
+      auto expected = IDLE;
+      if (slots_[slot_id].epoch.compare_exchange_weak(expected,
+                                                      epoch_.load()))
+        break;
+      slot_id = (slot_id + 1) % VERSION_MANAGER_READER_SLOT_NUM;
+    }
+    slots_[slot_id].ref_count.store(1);
+    return Guard(this, slot_id);
+  }
+
+  // 在新区间发布之后调用，返回旧区间的退休纪元
+  uint64_t retire() { return epoch_.fetch_add(1); }
+
+  // 退休纪元为e的区间在reclaimable(e)之后不会再被读到
+  bool reclaimable(uint64_t retire_epoch) const {
+    for (auto& slot : slots_) {
+      auto epoch = slot.epoch.load();
+      if (epoch != IDLE && epoch <= retire_epoch)
+        return false;
+    }
+    return true;
+  }
+
+ private:
+  void exit(size_t slot_id) {
+    if (slots_[slot_id].ref_count.fetch_sub(1) == 1)
+      slots_[slot_id].epoch.store(IDLE);
+  }
+
+  struct alignas(gbp::CACHELINE_SIZE) Slot {
+    std::atomic<uint64_t> epoch;
+    std::atomic<uint32_t> ref_count;
+  };
+
+  std::atomic<uint64_t> epoch_;
+  Slot slots_[VERSION_MANAGER_READER_SLOT_NUM];
+};
+
+}  // namespace test
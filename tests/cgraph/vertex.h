@@ -1,3 +1,4 @@
+#include <charconv>
 #include <vector>
 
 #include "../../include/mmap_array.h"
@@ -204,11 +205,13 @@ class Vertex {
         }
       }
       // 初始化固定长度的column family
-      datas_of_all_column_family_[column_family_id]
-          .fixed_length_column_family->init(
-              column_lengths, db_dir_path_ + "/column_family_" +
-                                  std::to_string(column_family_id) +
-                                  ".property");
+      if (!datas_of_all_column_family_[column_family_id]
+               .fixed_length_column_family->init(
+                   column_lengths, db_dir_path_ + "/column_family_" +
+                                       std::to_string(column_family_id) +
+                                       ".property")) {
+        assert(false);
+      }
 
       // 初始化存储string的文件
       if (string_mark) {
@@ -230,6 +233,107 @@ class Vertex {
     }
   }
 
+  /**
+   * bulkload：批量插入[start_vertex_id, start_vertex_id + vertex_num)个顶点
+   * 1. cells按行主序排列，每行column_num个，第i列对应property_id为i的column
+   * 2. 每个column family先在内存中拼好整行，再通过batched SetBlock写入（会覆盖整行）
+   * 3. 同一个column family的string内容只申请一次空间并一次写入
+   * 4. edge list被初始化为空，之后通过EdgeListInitBatch分配空间
+   */
+  void InsertVertexBatch(size_t start_vertex_id, size_t vertex_num,
+                         const std::vector<std::string_view>& cells,
+                         size_t column_num) {
+    std::vector<char> rows;
+    std::vector<char> string_content;
+    for (size_t column_family_id = 0;
+         column_family_id < datas_of_all_column_family_.size();
+         column_family_id++) {
+      auto& data = datas_of_all_column_family_[column_family_id];
+      auto row_size = data.fixed_length_column_family->getRowSize();
+      rows.assign(row_size * vertex_num, 0);
+
+      // string的起始位置：整个batch只申请一次
+      size_t string_size = 0;
+      for (auto& column_to_column_family : column_to_column_familys_) {
+        if (column_to_column_family.column_family_id == column_family_id &&
+            column_to_column_family.column_type == ColumnType::kDynamicString &&
+            column_to_column_family.property_id < column_num) {
+          for (size_t row_id = 0; row_id < vertex_num; row_id++)
+            string_size +=
+                cells[row_id * column_num + column_to_column_family.property_id]
+                    .size();
+        }
+      }
+      auto string_start_pos =
+          string_size == 0 ? 0
+                           : gbp::as_atomic(data.dynamic_length_column_family_size)
+                                 .fetch_add(string_size);
+      string_content.resize(string_size);
+      size_t string_offset = 0;
+
+      for (auto& column_to_column_family : column_to_column_familys_) {
+        if (column_to_column_family.column_family_id != column_family_id)
+          continue;
+        auto column_offset = data.fixed_length_column_family->getColumnOffset(
+            column_to_column_family.column_id_in_column_family);
+
+        for (size_t row_id = 0; row_id < vertex_num; row_id++) {
+          char* dst = rows.data() + row_id * row_size + column_offset;
+          if (column_to_column_family.column_type ==
+              ColumnType::kDynamicEdgeList) {
+            new (dst) MutableAdjlist();
+            // 与EdgeListInitBatch的约定一致：未分配空间的邻接表头全为0
+            reinterpret_cast<MutableAdjlist*>(dst)->init(0, 0, 0);
+            continue;
+          }
+          if (column_to_column_family.property_id >= column_num)
+            continue;
+          auto cell =
+              cells[row_id * column_num + column_to_column_family.property_id];
+          switch (column_to_column_family.column_type) {
+          case ColumnType::kInt32: {
+            int32_t value = 0;
+            std::from_chars(cell.data(), cell.data() + cell.size(), value);
+            ::memcpy(dst, &value, sizeof(int32_t));
+            break;
+          }
+          case ColumnType::kInt64: {
+            int64_t value = 0;
+            std::from_chars(cell.data(), cell.data() + cell.size(), value);
+            ::memcpy(dst, &value, sizeof(int64_t));
+            break;
+          }
+          case ColumnType::kDate: {
+            uint64_t value =
+                gbp::parseDateTimeToMilliseconds(std::string(cell));
+            ::memcpy(dst, &value, sizeof(uint64_t));
+            break;
+          }
+          case ColumnType::kDynamicString: {
+            ::memcpy(string_content.data() + string_offset, cell.data(),
+                     cell.size());
+            string_item position = {string_start_pos + string_offset,
+                                    static_cast<uint32_t>(cell.size())};
+            ::memcpy(dst, &position, sizeof(string_item));
+            string_offset += cell.size();
+            break;
+          }
+          default: {
+            assert(false);
+          }
+          }
+        }
+      }
+
+      if (string_size != 0)
+        data.dynamic_length_column_family->set(
+            string_start_pos, {string_content.data(), string_size},
+            string_size);
+      data.fixed_length_column_family->setRows(
+          start_vertex_id, vertex_num, {rows.data(), rows.size()});
+    }
+  }
+
   void InsertColumn(size_t vertex_id,
                     const std::pair<size_t, std::string_view> value) {
     auto column_to_column_family = column_to_column_familys_
@@ -258,7 +362,8 @@ class Vertex {
                                              value.second.size());
 
       // 存储string的position
-      string_item position = {start_pos, value.second.size()};
+      string_item position = {start_pos,
+                              static_cast<uint32_t>(value.second.size())};
       datas_of_all_column_family_[column_to_column_family.column_family_id]
           .fixed_length_column_family->setColumn(
               vertex_id, column_to_column_family.column_id_in_column_family,
@@ -278,6 +383,10 @@ class Vertex {
                          std::vector<std::pair<size_t, size_t>>& values) {
     auto column_to_column_family = column_to_column_familys_
         [property_id_to_ColumnToColumnFamily_[column_id]];
+    auto& csr =
+        datas_of_all_column_family_[column_to_column_family.column_family_id]
+            .csr[column_to_column_family.edge_list_id];
+    auto item_size = csr.second->item_size();
     for (auto& value : values) {
       auto item_t =
           datas_of_all_column_family_[column_to_column_family.column_family_id]
@@ -290,18 +399,14 @@ class Vertex {
             assert(item.start_idx_ == 0);
             assert(item.capacity_ == 0);
             assert(item.size_ == 0);
-            item.start_idx_ =
-                datas_of_all_column_family_[column_to_column_family
-                                                .column_family_id]
-                    .csr[column_to_column_family.edge_list_id]
-                    .first;
-            item.capacity_ = value.second;
+            // 按度数选择内联/共享页/整页三种存储方式
+            size_t start_idx = 0, capacity = 0;
+            item.tier_ = MutableAdjlist::allocate(value.second, item_size,
+                                                  csr.first, start_idx,
+                                                  capacity);
+            item.start_idx_ = start_idx;
+            item.capacity_ = capacity;
             item.size_ = 0;
-
-            datas_of_all_column_family_[column_to_column_family
-                                            .column_family_id]
-                .csr[column_to_column_family.edge_list_id]
-                .first += value.second;
           },
           item_t);
     }
@@ -317,6 +422,7 @@ class Vertex {
                   vertex_id,
                   column_to_column_family.column_id_in_column_family);
       size_t idx_new = 0;
+      bool is_inline = false;
       gbp::BufferBlock::UpdateContent<MutableAdjlist>(
           [&](MutableAdjlist& item) {
             // 获得锁
@@ -329,13 +435,21 @@ class Vertex {
             if (item.capacity_ <= idx_new) {
               assert(false);  // 没有空闲空间，需要重新分配
             }
-            idx_new += item.start_idx_;
+            // 内联的邻接表直接写入邻接表头所在的页
+            is_inline = item.is_inline();
+            if (is_inline) {
+              ::memcpy(item.inline_data_ + idx_new * value.second.size(),
+                       value.second.data(), value.second.size());
+            } else {
+              idx_new += item.start_idx_;
+            }
           },
           item_t);
       // 插入边
-      datas_of_all_column_family_[column_to_column_family.column_family_id]
-          .csr[column_to_column_family.edge_list_id]
-          .second->set_single_obj(idx_new, value.second);
+      if (!is_inline)
+        datas_of_all_column_family_[column_to_column_family.column_family_id]
+            .csr[column_to_column_family.edge_list_id]
+            .second->set_single_obj(idx_new, value.second);
       gbp::BufferBlock::UpdateContent<MutableAdjlist>(
           [&](MutableAdjlist& item) { item.lock_.store(0); },
           item_t);  // 释放锁
@@ -355,6 +469,7 @@ class Vertex {
                   vertex_id,
                   column_to_column_family.column_id_in_column_family);
       size_t idx_new = 0;
+      bool is_inline = false;
       gbp::BufferBlock::UpdateContent<MutableAdjlist>(
           [&](MutableAdjlist& item) {
             // 获得锁
@@ -364,18 +479,29 @@ class Vertex {
                                                     std::memory_order_relaxed))
               ;
             idx_new = item.size_.fetch_add(value.second.size());
-            if (item.capacity_ <= idx_new) {
+            if (item.capacity_ < idx_new + value.second.size()) {
               assert(false);  // 没有空闲空间，需要重新分配
             }
-            idx_new += item.start_idx_;
+            is_inline = item.is_inline();
+            if (is_inline) {
+              for (auto& edge : value.second) {
+                ::memcpy(item.inline_data_ + idx_new * edge.size(),
+                         edge.data(), edge.size());
+                idx_new++;
+              }
+            } else {
+              idx_new += item.start_idx_;
+            }
           },
           item_t);
       // 插入边
-      for (auto& item : value.second) {
-        datas_of_all_column_family_[column_to_column_family.column_family_id]
-            .csr[column_to_column_family.edge_list_id]
-            .second->set_single_obj(idx_new, item);
-        idx_new++;
+      if (!is_inline) {
+        for (auto& item : value.second) {
+          datas_of_all_column_family_[column_to_column_family.column_family_id]
+              .csr[column_to_column_family.edge_list_id]
+              .second->set_single_obj(idx_new, item);
+          idx_new++;
+        }
       }
       gbp::BufferBlock::UpdateContent<MutableAdjlist>(
           [&](MutableAdjlist& item) { item.lock_.store(0); },
@@ -396,9 +522,15 @@ class Vertex {
             .fixed_length_column_family->getColumn(
                 vertex_id, column_to_column_family.column_id_in_column_family);
     auto& item = gbp::BufferBlock::Ref<MutableAdjlist>(item_t);
-    return datas_of_all_column_family_[column_to_column_family.column_family_id]
-        .csr[column_to_column_family.edge_list_id]
-        .second->get(item.start_idx_, item.size_);
+    auto& csr =
+        datas_of_all_column_family_[column_to_column_family.column_family_id]
+            .csr[column_to_column_family.edge_list_id];
+    if (item.is_inline()) {
+      // 邻接表头所在的页已经被访问过，拷贝出来即可，不需要再访问边文件
+      return gbp::BufferBlock(item.size_ * csr.second->item_size(),
+                              const_cast<char*>(item.inline_data_));
+    }
+    return csr.second->get(item.start_idx_, item.size_);
   }
 
   // std::vector<std::pair<size_t, std::string_view>> void ReadVertex(
@@ -1,9 +1,107 @@
 #include <yaml-cpp/yaml.h>
+#include <algorithm>
+#include <random>
+#include <unordered_set>
 
+#include "cgraph/compressed_csr.h"
+#include "cgraph/id_indexer_groups.h"
 #include "tests.h"
 
 namespace test {
 
+/**
+ * 边文件的bulkload：生成src|dst[|data]格式的边文件，第一遍统计度数并通过batch_init一次性分配邻居区间，
+ * 第二遍把ChunkedCSVReader的每个batch交给batch_put_edges按src批量写入，之后逐个顶点校验。
+ * 各个src的第k条边排在一起，同一个src的边分散在不同的batch（线程）中；少数顶点的邻居跨越多个页
+ */
+template <typename EDATA_T>
+static void check_edge_file_bulkload(MutableCsr<EDATA_T>& csr,
+                                     const std::string& name,
+                                     const std::string& work_dir,
+                                     size_t vertex_num) {
+  constexpr bool has_data = !std::is_same_v<EDATA_T, EmptyType>;
+  auto degree_of = [](size_t v) -> size_t {
+    return v % 64 == 0 ? 1000 : v % 5;
+  };
+  auto neighbor_of = [&](size_t v, size_t k) {
+    return (vid_t) ((v * 31 + k * 7) % vertex_num);
+  };
+  auto edge_file_path = work_dir + "/" + name + ".csv";
+  {
+    std::ofstream edge_file(edge_file_path);
+    edge_file << (has_data ? "src|dst|data\n" : "src|dst\n");
+    for (size_t k = 0; k < degree_of(0); k++) {
+      for (size_t v = 0; v < vertex_num; v++) {
+        if (k >= degree_of(v))
+          continue;
+        edge_file << v << "|" << neighbor_of(v, k);
+        if (has_data)
+          edge_file << "|" << v + k;
+        edge_file << "\n";
+      }
+    }
+  }
+
+  csv::ChunkedCSVReader reader;
+  if (!reader.open(edge_file_path)) {
+    std::cerr << "边文件加载失败" << std::endl;
+    return;
+  }
+  std::vector<int> degree(vertex_num, 0);
+  std::mutex degree_lock;
+  reader.Parse([&](size_t first_row_id, size_t row_num,
+                   const std::vector<std::string_view>& cells) {
+    std::vector<std::pair<vid_t, int>> batch_degree;
+    for (size_t row_id = 0; row_id < row_num; row_id++) {
+      auto cell = cells[row_id * reader.column_count()];
+      vid_t src = 0;
+      std::from_chars(cell.data(), cell.data() + cell.size(), src);
+      if (batch_degree.empty() || batch_degree.back().first != src)
+        batch_degree.emplace_back(src, 0);
+      batch_degree.back().second++;
+    }
+    std::lock_guard<std::mutex> guard(degree_lock);
+    for (auto& [src, num] : batch_degree)
+      degree[src] += num;
+  });
+  csr.batch_init(name, work_dir, degree);
+  reader.Parse([&](size_t first_row_id, size_t row_num,
+                   const std::vector<std::string_view>& cells) {
+    csr.batch_put_edges(cells, reader.column_count());
+  });
+
+  for (size_t v = 0; v < vertex_num; v++) {
+    assert((size_t) csr.degree(v) == degree_of(v));
+    std::vector<vid_t> neighbors(degree_of(v));
+    std::vector<EDATA_T> data(degree_of(v));
+    auto num = csr.get_neighbors(v, MAX_TIMESTAMP, neighbors.data(),
+                                 has_data ? data.data() : nullptr);
+    assert(num == degree_of(v));
+    // 不同batch中的边的写入顺序不确定，按邻居排序之后比较
+    std::vector<std::pair<vid_t, EDATA_T>> edges, expected;
+    for (size_t k = 0; k < num; k++) {
+      edges.emplace_back(neighbors[k], data[k]);
+      expected.emplace_back(neighbor_of(v, k), EDATA_T());
+      if constexpr (has_data)
+        expected.back().second = v + k;
+    }
+    auto by_neighbor = [](auto& a, auto& b) {
+      if constexpr (has_data)
+        return a < b;
+      else
+        return a.first < b.first;
+    };
+    std::sort(edges.begin(), edges.end(), by_neighbor);
+    std::sort(expected.begin(), expected.end(), by_neighbor);
+    for (size_t k = 0; k < num; k++) {
+      assert(edges[k].first == expected[k].first);
+      if constexpr (has_data)
+        assert(edges[k].second == expected[k].second);
+    }
+  }
+  std::filesystem::remove(edge_file_path);
+}
+
 void test_vertex(const std::string& config_file_path,
                  const std::string& data_file_path,
                  const std::string& db_dir_path) {
@@ -50,8 +148,8 @@ void test_vertex(const std::string& config_file_path,
   }
 
   // 测试 CSV 加载
-  csv::CSVLoader loader;
-  if (!loader.load(data_file_path)) {
+  csv::ChunkedCSVReader reader;
+  if (!reader.open(data_file_path)) {
     std::cerr << "CSV文件加载失败" << std::endl;
     return;
   }
@@ -105,148 +203,82 @@ void test_vertex(const std::string& config_file_path,
   std::cout << "people.capacity_in_row_: " << person.CapacityInRow()
             << std::endl;
 
-  // bulkload
-  size_t row_num = 100;
-  for (auto i = 0; i < column_configurations.size(); i++) {
-    for (auto j = 0; j < column_configurations[i].size() - 1; j++) {
-      auto property_id = column_families[i][j]["property_id"].as<size_t>();
-      auto value = loader.get_column(property_id);
-      switch (column_configurations[i][j].column_type) {
-      case Vertex::ColumnType::kDate: {
-        for (int k = 0; k < row_num; k++) {
-          uint64_t data = gbp::parseDateTimeToMilliseconds(value[k]);
-          gbp::GBPLOG << data;
-          person.InsertColumn(
-              k, {property_id,
-                  {reinterpret_cast<char*>(&data), sizeof(uint64_t)}});
-
-          auto result = person.ReadColumn(k, property_id);
-          assert(gbp::BufferBlock::Ref<uint64_t>(result) == data);
-        }
-        break;
-      }
-      case Vertex::ColumnType::kInt32: {
-        for (int k = 0; k < row_num; k++) {
-          int32_t data = std::stoi(value[k]);
-          gbp::GBPLOG << data;
-          person.InsertColumn(
-              k,
-              {property_id, {reinterpret_cast<char*>(&data), sizeof(int32_t)}});
-          auto result = person.ReadColumn(k, property_id);
-          assert(gbp::BufferBlock::Ref<int32_t>(result) == data);
-        }
-        break;
-      }
-      case Vertex::ColumnType::kInt64: {
-        for (int k = 0; k < row_num; k++) {
-          int64_t data = std::stoll(value[k]);
-          gbp::GBPLOG << data;
-          person.InsertColumn(
-              k,
-              {property_id, {reinterpret_cast<char*>(&data), sizeof(int64_t)}});
-          auto result = person.ReadColumn(k, property_id);
-          assert(gbp::BufferBlock::Ref<int64_t>(result) == data);
-        }
-        break;
-      }
-      case Vertex::ColumnType::kDynamicString: {
-        for (int k = 0; k < row_num; k++) {
-          std::string data = value[k];
-          gbp::GBPLOG << data;
-          person.InsertColumn(k, {property_id, data});
-          auto result = person.ReadColumn(k, property_id);
-          assert(result == data);
-        }
-        break;
-      }
-      case Vertex::ColumnType::kDynamicEdgeList: {
-        break;
-      }
-      default:
-        assert(false);
-      }
-    }
-  }
+  // bulkload：并行解析CSV，批量写入各个column family
+  reader.Parse([&](size_t first_row_id, size_t row_num,
+                   const std::vector<std::string_view>& cells) {
+    assert(first_row_id + row_num <= max_vertex_num);
+    person.InsertVertexBatch(first_row_id, row_num, cells,
+                             reader.column_count());
+  });
+  std::cout << "bulkload row_num: " << reader.row_count() << std::endl;
 
-  for (auto i = 0; i < column_configurations.size(); i++) {
-    auto column_configuration = column_configurations[i].back();
-    if (column_configuration.column_type ==
-        Vertex::ColumnType::kDynamicEdgeList) {
-      switch (column_configuration.edge_type) {
-      case Vertex::EdgeType::kEmpty: {
-        std::array<uint64_t, 3> edge_list = {10, 100, 299};
-        std::vector<std::pair<size_t, size_t>> edge_list_len;
-        for (auto vertex_id = 0; vertex_id < 100; vertex_id++) {
-          edge_list_len.push_back({vertex_id, edge_list.size()});
-        }
-        person.EdgeListInitBatch(column_configuration.property_id,
-                                 edge_list_len);
-        for (auto vertex_id = 0; vertex_id < 100; vertex_id++) {
-          for (auto edge : edge_list) {
-            MutableNbr<EmptyType> item;
-            item.neighbor = edge;
-            item.timestamp = 0;
-            person.InsertEdge(vertex_id, {column_configuration.property_id,
-                                          {reinterpret_cast<const char*>(&item),
-                                           sizeof(MutableNbr<EmptyType>)}});
-          }
-          auto datas =
-              person.ReadEdgeList(vertex_id, column_configuration.property_id);
-          for (auto edge_id = 0; edge_id < edge_list.size(); edge_id++) {
-            auto nbr =
-                gbp::BufferBlock::Ref<MutableNbr<EmptyType>>(datas, edge_id)
-                    .neighbor;
-            if (nbr != edge_list[edge_id]) {
-              gbp::GBPLOG << "vertex_id: " << vertex_id
-                          << " edge_id: " << edge_id << " nbr: " << nbr
-                          << " edge_list[edge_id]: " << edge_list[edge_id];
+  // 校验前row_num行
+  size_t row_num = std::min<size_t>(100, reader.row_count());
+  reader.Parse(
+      [&](size_t first_row_id, size_t batch_row_num,
+          const std::vector<std::string_view>& cells) {
+        for (size_t k = first_row_id;
+             k < std::min(first_row_id + batch_row_num, row_num); k++) {
+          for (auto i = 0; i < column_configurations.size(); i++) {
+            for (auto j = 0; j < column_configurations[i].size() - 1; j++) {
+              auto property_id = column_configurations[i][j].property_id;
+              auto value = std::string(
+                  cells[(k - first_row_id) * reader.column_count() +
+                        property_id]);
+              auto result = person.ReadColumn(k, property_id);
+              switch (column_configurations[i][j].column_type) {
+              case Vertex::ColumnType::kDate: {
+                assert(gbp::BufferBlock::Ref<uint64_t>(result) ==
+                       gbp::parseDateTimeToMilliseconds(value));
+                break;
+              }
+              case Vertex::ColumnType::kInt32: {
+                assert(gbp::BufferBlock::Ref<int32_t>(result) ==
+                       std::stoi(value));
+                break;
+              }
+              case Vertex::ColumnType::kInt64: {
+                assert(gbp::BufferBlock::Ref<int64_t>(result) ==
+                       std::stoll(value));
+                break;
+              }
+              case Vertex::ColumnType::kDynamicString: {
+                assert(result == value);
+                break;
+              }
+              case Vertex::ColumnType::kDynamicEdgeList: {
+                break;
+              }
+              default:
+                assert(false);
+              }
             }
-            assert(nbr == edge_list[edge_id]);
           }
-          // return;
-        }
-        break;
-      }
-      case Vertex::EdgeType::kDate: {
-        std::array<uint64_t, 3> edge_list = {10, 100, 299};
-        std::vector<std::pair<size_t, size_t>> edge_list_len;
-        for (auto vertex_id = 0; vertex_id < 100; vertex_id++) {
-          edge_list_len.push_back({vertex_id, edge_list.size()});
         }
-        person.EdgeListInitBatch(column_configuration.property_id,
-                                 edge_list_len);
-        for (auto vertex_id = 0; vertex_id < 100; vertex_id++) {
-          for (auto edge : edge_list) {
-            MutableNbr<uint64_t> item;
-            item.neighbor = edge;
-            item.timestamp = 0;
-            item.data = 100;
-            person.InsertEdge(vertex_id, {column_configuration.property_id,
-                                          {reinterpret_cast<const char*>(&item),
-                                           sizeof(MutableNbr<uint64_t>)}});
-          }
-          auto datas =
-              person.ReadEdgeList(vertex_id, column_configuration.property_id);
-          for (auto edge_id = 0; edge_id < edge_list.size(); edge_id++) {
-            auto nbr =
-                gbp::BufferBlock::Ref<MutableNbr<uint64_t>>(datas, edge_id)
-                    .neighbor;
-            if (nbr != edge_list[edge_id]) {
-              gbp::GBPLOG << "vertex_id: " << vertex_id
-                          << " edge_id: " << edge_id << " nbr: " << nbr
-                          << " edge_list[edge_id]: " << edge_list[edge_id];
-            }
+      },
+      1);
 
-            assert(nbr == edge_list[edge_id]);
-          }
-          // return;
-        }
-        break;
-      }
-      default:
-        assert(false);
-      }
-    } else {
+  // 边文件的bulkload：每个edge list列对应一个MutableCsr，邻接表头存放在person的行中
+  for (auto i = 0; i < column_configurations.size(); i++) {
+    auto column_configuration = column_configurations[i].back();
+    assert(column_configuration.column_type ==
+           Vertex::ColumnType::kDynamicEdgeList);
+    auto name =
+        "person_edge_" + std::to_string(column_configuration.property_id);
+    auto& adj_lists = person.GetColumnFamily(i);
+    auto column_id = column_configurations[i].size() - 1;
+    switch (column_configuration.edge_type) {
+    case Vertex::EdgeType::kEmpty: {
+      MutableCsr<EmptyType> csr(adj_lists, column_id);
+      check_edge_file_bulkload(csr, name, db_dir_path, reader.row_count());
+      break;
+    }
+    case Vertex::EdgeType::kDate: {
+      MutableCsr<uint64_t> csr(adj_lists, column_id);
+      check_edge_file_bulkload(csr, name, db_dir_path, reader.row_count());
+      break;
+    }
+    default:
       assert(false);
     }
   }
@@ -288,6 +320,792 @@ void test_csv(const std::string& file_path) {
   std::cout << "第1行第2列的元素: " << loader.get_element(0, 1) << std::endl;
 }
 
+// ChunkedCSVReader：带引号的cell（包含分隔符、换行与转义的引号）以及多线程切分
+void test_chunked_csv(const std::string& file_path) {
+  const size_t row_num = 10000;
+  {
+    std::ofstream file(file_path, std::ios::trunc);
+    file << "id|name|note\n";
+    for (size_t row_id = 0; row_id < row_num; row_id++) {
+      if (row_id % 7 == 0)
+        file << row_id << "|\"a|b\nc\"|\"x\"\"y\"\n";
+      else
+        file << row_id << "|n" << row_id << "|plain\r\n";
+      if (row_id % 100 == 0)
+        file << "\n";  // 空行不计入行数
+    }
+  }
+
+  for (size_t thread_num : {1, 3, 8}) {
+    csv::ChunkedCSVReader reader;
+    assert(reader.open(file_path));
+    assert(reader.column_count() == 3);
+    std::atomic<size_t> parsed = 0;
+    reader.Parse(
+        [&](size_t first_row_id, size_t batch_row_num,
+            const std::vector<std::string_view>& cells) {
+          for (size_t k = 0; k < batch_row_num; k++) {
+            auto row_id = first_row_id + k;
+            assert(std::stoul(std::string(cells[k * 3])) == row_id);
+            if (row_id % 7 == 0) {
+              assert(cells[k * 3 + 1] == "a|b\nc");
+              assert(cells[k * 3 + 2] == "x\"y");
+            } else {
+              assert(cells[k * 3 + 1] == "n" + std::to_string(row_id));
+              assert(cells[k * 3 + 2] == "plain");
+            }
+          }
+          parsed += batch_row_num;
+        },
+        thread_num, 64);
+    assert(reader.row_count() == row_num && parsed == row_num);
+  }
+  std::cout << "test_chunked_csv passed" << std::endl;
+}
+
+// FixedLengthColumnFamily的多列投影（getColumns）与按行范围扫描（scanColumns/filterColumn）
+void test_column_family_projection(const std::string& file_path) {
+  auto& bpm = gbp::BufferPoolManager::GetGlobalInstance();
+  bpm.init(1, 1024 * 16, 1);
+
+  // 最后一列为100B的字符串，扫描时一批行跨越多个页
+  const std::vector<size_t> column_lengths = {sizeof(int32_t), sizeof(int64_t),
+                                              sizeof(int16_t), 100};
+  const size_t row_size = 4 + 8 + 2 + 100, row_num = 20000;
+  auto make_row = [&](size_t row_id, char* row) {
+    int32_t c0 = static_cast<int32_t>(row_id) * 3 - 1000;
+    int64_t c1 = static_cast<int64_t>(row_id) * row_id;
+    int16_t c2 = row_id % 1000;
+    ::memcpy(row, &c0, sizeof(c0));
+    ::memcpy(row + 4, &c1, sizeof(c1));
+    ::memcpy(row + 12, &c2, sizeof(c2));
+    ::memset(row + 14, 'a' + row_id % 26, 100);
+  };
+
+  FixedLengthColumnFamily column_family;
+  column_family.init(column_lengths, file_path);
+  column_family.resize(row_num);
+  std::vector<char> rows(row_num * row_size);
+  for (size_t row_id = 0; row_id < row_num; row_id++)
+    make_row(row_id, rows.data() + row_id * row_size);
+  column_family.setRows(0, row_num, {rows.data(), rows.size()});
+
+  // 乱序的投影，结果按columnIds的顺序排列
+  const std::vector<size_t> column_ids = {3, 0, 2};
+  std::vector<char> expected(row_size);
+  for (size_t row_id = 0; row_id < row_num; row_id += 97) {
+    make_row(row_id, expected.data());
+    auto item = column_family.getColumns(row_id, column_ids);
+    assert(item.Size() == 100 + 4 + 2);
+    assert(item.Compare({expected.data() + 14, 100}, 0) == 0);
+    assert(item.Compare({expected.data(), 4}, 100) == 0);
+    assert(item.Compare({expected.data() + 12, 2}, 104) == 0);
+  }
+
+  // 范围扫描：每一行恰好回调一次，行号递增
+  const size_t scan_start = 123, scan_num = 15000;
+  size_t next_row = scan_start;
+  column_family.scanColumns(
+      scan_start, scan_num, {1, 3},
+      [&](size_t row_id, const char* const* columns) {
+        assert(row_id == next_row++);
+        make_row(row_id, expected.data());
+        assert(::memcmp(columns[0], expected.data() + 4, 8) == 0);
+        assert(::memcmp(columns[1], expected.data() + 14, 100) == 0);
+      });
+  assert(next_row == scan_start + scan_num);
+
+  std::vector<size_t> result;
+  column_family.filterColumn<int32_t>(0, row_num, 0, 0, 2999, result);
+  assert(result.size() == 1000);
+  for (size_t idx = 0; idx < result.size(); idx++)
+    assert(result[idx] == 334 + idx);
+  std::cout << "test_column_family_projection passed" << std::endl;
+}
+
+// PAX布局与行布局在相同的写入（setRows/setColumnFamily/setColumn）之后读出的结果一致
+void test_column_family_pax(const std::string& file_path) {
+  auto& bpm = gbp::BufferPoolManager::GetGlobalInstance();
+  bpm.init(1, 1024 * 16, 1);
+
+  const std::vector<size_t> column_lengths = {sizeof(int32_t), sizeof(int64_t),
+                                              24};
+  const size_t row_size = 4 + 8 + 24, row_num = 10000;
+  auto make_row = [&](size_t row_id, size_t version, char* row) {
+    int32_t c0 = static_cast<int32_t>((row_id * 7 + version) % 5000);
+    int64_t c1 = static_cast<int64_t>(row_id) << 20 | version;
+    ::memcpy(row, &c0, sizeof(c0));
+    ::memcpy(row + 4, &c1, sizeof(c1));
+    ::memset(row + 12, 'a' + (row_id + version) % 26, 24);
+  };
+
+  for (auto suffix : {".row", ".pax", ".row.meta", ".pax.meta"})
+    std::filesystem::remove(file_path + suffix);
+  FixedLengthColumnFamily row_layout, pax_layout;
+  row_layout.init(column_lengths, file_path + ".row");
+  pax_layout.init(column_lengths, file_path + ".pax",
+                  FixedLengthColumnFamily::Layout::kPAX);
+  std::vector<char> rows(row_num * row_size), row(row_size);
+  for (size_t row_id = 0; row_id < row_num; row_id++)
+    make_row(row_id, 0, rows.data() + row_id * row_size);
+  for (auto* column_family : {&row_layout, &pax_layout}) {
+    column_family->resize(row_num);
+    // 从页中间开始的一批行
+    column_family->setRows(0, 37, {rows.data(), 37 * row_size});
+    column_family->setRows(37, row_num - 37,
+                           {rows.data() + 37 * row_size,
+                            (row_num - 37) * row_size});
+    for (size_t row_id = 0; row_id < row_num; row_id += 13) {
+      make_row(row_id, 1, row.data());
+      column_family->setColumnFamily(row_id, {row.data(), row_size});
+    }
+    for (size_t row_id = 5; row_id < row_num; row_id += 11) {
+      make_row(row_id, 2, row.data());
+      column_family->setColumn(row_id, 2, {row.data() + 12, 24});
+    }
+  }
+
+  for (size_t row_id = 0; row_id < row_num; row_id++) {
+    for (size_t column_id = 0; column_id < column_lengths.size();
+         column_id++) {
+      auto expected = row_layout.getColumn(row_id, column_id);
+      auto actual = pax_layout.getColumn(row_id, column_id);
+      assert(expected.Compare(actual) == 0);
+    }
+    auto expected = row_layout.getColumns(row_id, {2, 0});
+    auto actual = pax_layout.getColumns(row_id, {2, 0});
+    assert(expected.Compare(actual) == 0);
+  }
+  make_row(13 * 5, 1, row.data());
+  assert(pax_layout.getColumn(13 * 5, 1).Compare({row.data() + 4, 8}) == 0);
+
+  size_t scanned = 0;
+  pax_layout.scanColumns(100, 5000, {1},
+                         [&](size_t row_id, const char* const* columns) {
+                           auto expected = row_layout.getColumn(row_id, 1);
+                           assert(expected.Compare({columns[0], 8}) == 0);
+                           scanned++;
+                         });
+  assert(scanned == 5000);
+
+  std::vector<size_t> expected_rows, actual_rows;
+  row_layout.filterColumn<int32_t>(0, row_num, 0, 1000, 1999, expected_rows);
+  pax_layout.filterColumn<int32_t>(0, row_num, 0, 1000, 1999, actual_rows);
+  assert(!expected_rows.empty() && expected_rows == actual_rows);
+
+  // 以相同的layout重新打开时数据不变，layout不一致时init返回false
+  bpm.Flush();
+  {
+    FixedLengthColumnFamily reopened;
+    assert(reopened.init(column_lengths, file_path + ".pax",
+                         FixedLengthColumnFamily::Layout::kPAX));
+    reopened.resize(row_num);
+    for (size_t row_id = 0; row_id < row_num; row_id += 97) {
+      auto expected = row_layout.getColumns(row_id, {0, 1, 2});
+      auto actual = reopened.getColumns(row_id, {0, 1, 2});
+      assert(expected.Compare(actual) == 0);
+    }
+  }
+  auto open_fails = [&](const std::vector<size_t>& lengths,
+                        const std::string& filename,
+                        FixedLengthColumnFamily::Layout layout) {
+    FixedLengthColumnFamily column_family;
+    return !column_family.init(lengths, filename, layout);
+  };
+  assert(open_fails(column_lengths, file_path + ".pax",
+                    FixedLengthColumnFamily::Layout::kRow));
+  assert(open_fails({8, 8}, file_path + ".pax",
+                    FixedLengthColumnFamily::Layout::kPAX));
+  assert(open_fails(column_lengths, file_path + ".row",
+                    FixedLengthColumnFamily::Layout::kPAX));
+  assert(!open_fails(column_lengths, file_path + ".row",
+                     FixedLengthColumnFamily::Layout::kRow));
+  // 没有meta的已有文件（引入kPAX之前建立的）只能按kRow打开
+  std::filesystem::remove(file_path + ".row.meta");
+  assert(open_fails(column_lengths, file_path + ".row",
+                    FixedLengthColumnFamily::Layout::kPAX));
+  assert(!open_fails(column_lengths, file_path + ".row",
+                     FixedLengthColumnFamily::Layout::kRow));
+  assert(std::filesystem::exists(file_path + ".row.meta"));
+  std::cout << "test_column_family_pax passed" << std::endl;
+}
+
+// DictStringColumn：字典在dump之后可以重新打开，code保持不变，新的值继续分配code
+void test_dict_string_column(const std::string& dir_path) {
+  auto& bpm = gbp::BufferPoolManager::GetGlobalInstance();
+  bpm.init(1, 1024 * 16, 1);
+  const std::string work_dir = dir_path + "/work",
+                    snapshot_dir = dir_path + "/snapshot",
+                    work_dir_new = dir_path + "/work_new";
+  for (auto& dir : {work_dir, snapshot_dir, work_dir_new}) {
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+  }
+
+  const std::vector<std::string> countries = {"China", "India", "",
+                                              "Germany", "Brazil"};
+  const size_t row_num = 5000;
+  FixedLengthColumnFamily column_family;
+  column_family.init({sizeof(DictStringColumn::code_type)},
+                     work_dir + "/country.cf");
+  column_family.resize(row_num);
+
+  std::vector<DictStringColumn::code_type> codes(countries.size());
+  {
+    DictStringColumn column;
+    assert(column.open(column_family, 0, work_dir + "/country"));
+    // 字典为空时未赋值的行解码为空串；resize不改变共享的column family
+    assert(column.get_view(0).empty());
+    auto column_family_size = column_family.getSizeInByte();
+    column.resize(row_num * 2);
+    assert(column_family.getSizeInByte() == column_family_size);
+    for (size_t row_id = 0; row_id < row_num; row_id++)
+      column.set_value(row_id, countries[row_id % 3]);
+    assert(column.dict_size() == 3);
+    for (size_t idx = 0; idx < 3; idx++)
+      codes[idx] = column.find_code(countries[idx]);
+    column.dump(snapshot_dir + "/country");
+  }
+
+  DictStringColumn column;
+  column.init(column_family, 0);
+  column.open("country", snapshot_dir, work_dir_new);
+  assert(column.dict_size() == 3);
+  for (size_t idx = 0; idx < 3; idx++)
+    assert(column.find_code(countries[idx]) == codes[idx]);
+  for (size_t row_id = 0; row_id < row_num; row_id += 17)
+    assert(column.get_view(row_id) == countries[row_id % 3]);
+
+  // 重新打开之后插入新的值
+  column.set_value(1, countries[3]);
+  column.set_value(2, countries[4]);
+  assert(column.dict_size() == 5);
+  assert(column.get_view(1) == countries[3]);
+  assert(column.get_view(2) == countries[4]);
+  assert(column.find_code(countries[0]) == codes[0]);
+
+  std::vector<size_t> rows;
+  column.filter_equal(0, row_num, countries[0], rows);
+  assert(rows.size() == (row_num + 2) / 3);
+
+  // header无效的字典文件：open返回false
+  {
+    std::ofstream dict_file(work_dir + "/broken.dict",
+                            std::ios::binary | std::ios::trunc);
+    std::vector<char> page(gbp::PAGE_SIZE_FILE, 0);
+    dict_file.write(page.data(), page.size());
+  }
+  DictStringColumn broken;
+  assert(!broken.open(column_family, 0, work_dir + "/broken"));
+  std::cout << "test_dict_string_column passed" << std::endl;
+}
+
+// CompressedCsr：编码/解码（SIMD与标量的尾部、chunk在页尾的padding）、增量边按read_ts过滤、dump之后重新打开
+void test_compressed_csr(const std::string& dir_path) {
+  auto& bpm = gbp::BufferPoolManager::GetGlobalInstance();
+  bpm.init(1, 1024 * 16, 1);
+  const std::string work_dir = dir_path + "/work",
+                    snapshot_dir = dir_path + "/snapshot",
+                    work_dir_new = dir_path + "/work_new";
+  for (auto& dir : {work_dir, snapshot_dir, work_dir_new}) {
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+  }
+
+  // 度数覆盖单个邻居、不足4个差值的尾部、整数个chunk与多个chunk，
+  // 差值从1字节到4字节，累计的大小使chunk落在页尾并跨页
+  const std::vector<size_t> degrees = {0, 1, 2, 5, 8, 128, 129, 300, 3000};
+  const std::vector<uint32_t> max_deltas = {1u << 7, 1u << 15, 1u << 23,
+                                            1u << 29};
+  const size_t vertex_num = 200;
+  std::mt19937 rng(0);
+  std::vector<std::vector<vid_t>> expected(vertex_num);
+  for (size_t v = 0; v < vertex_num; v++) {
+    auto degree = degrees[v % degrees.size()];
+    auto max_delta = max_deltas[v % max_deltas.size()];
+    vid_t neighbor = rng() % 1000;
+    for (size_t idx = 0; idx < degree; idx++) {
+      expected[v].push_back(neighbor);
+      neighbor += 1 + rng() % std::min<uint32_t>(
+                          max_delta, (0xFFFFFFFFu - neighbor) / degree);
+    }
+    // 输入的顺序是打乱的，build时排序
+    std::shuffle(expected[v].begin(), expected[v].end(), rng);
+  }
+
+  CompressedCsr csr;
+  csr.build("knows", work_dir, vertex_num,
+            [&](vid_t v, std::vector<vid_t>& neighbors) {
+              neighbors.insert(neighbors.end(), expected[v].begin(),
+                               expected[v].end());
+            });
+  for (auto& neighbors : expected)
+    std::sort(neighbors.begin(), neighbors.end());
+  assert(csr.get_data_size_in_byte() > 2 * gbp::PAGE_SIZE_MEMORY);
+
+  auto check_neighbors = [&](const CompressedCsr& csr, vid_t v,
+                             timestamp_t read_ts,
+                             const std::vector<vid_t>& expected) {
+    std::vector<vid_t> neighbors;
+    assert(csr.get_neighbors(v, read_ts, neighbors) == expected.size());
+    assert(neighbors == expected);
+    neighbors.clear();
+    for (auto iter = csr.snapshot_edge_iter(v, read_ts); iter->is_valid();
+         iter->next())
+      neighbors.push_back(iter->get_neighbor());
+    assert(neighbors == expected);
+  };
+  for (vid_t v = 0; v < vertex_num; v++) {
+    assert(csr.degree(v) == (int) expected[v].size());
+    std::vector<vid_t> neighbors(expected[v].size());
+    assert(csr.decode_edges(v, neighbors.data()) == expected[v].size());
+    assert(neighbors == expected[v]);
+    check_neighbors(csr, v, MAX_TIMESTAMP, expected[v]);
+  }
+
+  // 增量边：ts为10的边对read_ts < 10的读者不可见，删除的边对之后的读者不可见
+  std::vector<std::vector<vid_t>> expected_ts5 = expected;
+  for (vid_t v = 0; v < vertex_num; v += 3) {
+    csr.put_generic_edge(v, 7, {}, 5);
+    csr.put_generic_edge(v, 9, {}, 10);
+    csr.put_generic_edge(v, 11, {}, 3 | TIMESTAMP_DELETE_MASK);
+    expected_ts5[v].push_back(7);
+    expected[v].push_back(7);
+    expected[v].push_back(9);
+  }
+  for (vid_t v = 0; v < vertex_num; v++) {
+    check_neighbors(csr, v, 5, expected_ts5[v]);
+    check_neighbors(csr, v, MAX_TIMESTAMP, expected[v]);
+  }
+
+  // dump时增量边与压缩的部分合并后重新编码
+  csr.dump("knows", snapshot_dir);
+  CompressedCsr csr_new;
+  csr_new.open("knows", snapshot_dir, work_dir_new);
+  for (vid_t v = 0; v < vertex_num; v++) {
+    std::sort(expected[v].begin(), expected[v].end());
+    assert(csr_new.degree(v) == (int) expected[v].size());
+    check_neighbors(csr_new, v, 0, expected[v]);
+  }
+  std::cout << "test_compressed_csr passed" << std::endl;
+}
+
+// Vertex的邻接表分层：按度数选择kInline/kPacked/kExtent，经InsertEdge、InsertEdgeList写入后用ReadEdgeList读出
+void test_vertex_edge_tiers(const std::string& db_dir_path) {
+  auto& bpm = gbp::BufferPoolManager::GetGlobalInstance();
+  bpm.init(1, 1024 * 16, 1);
+  std::filesystem::remove_all(db_dir_path);
+  std::filesystem::create_directories(db_dir_path);
+
+  using nbr_t = MutableNbr<int32_t>;
+  const size_t property_id = 1, column_id_in_column_family = 1;
+  const size_t obj_num_perpage = gbp::PAGE_SIZE_MEMORY / sizeof(nbr_t);
+  const size_t inline_capacity = ADJLIST_INLINE_SIZE / sizeof(nbr_t);
+  assert(inline_capacity >= 4);
+
+  // 度数覆盖：内联的边界、共享页的边界（恰好一页）、整页
+  const std::vector<size_t> degrees = {
+      0,   1, inline_capacity - 1, inline_capacity, inline_capacity + 1, 100,
+      200, obj_num_perpage,        obj_num_perpage + 1, 3 * obj_num_perpage};
+  const std::vector<MutableAdjlist::Tier> tiers = {
+      MutableAdjlist::kInline, MutableAdjlist::kInline,
+      MutableAdjlist::kInline, MutableAdjlist::kInline,
+      MutableAdjlist::kPacked, MutableAdjlist::kPacked,
+      MutableAdjlist::kPacked, MutableAdjlist::kPacked,
+      MutableAdjlist::kExtent, MutableAdjlist::kExtent};
+
+  Vertex vertex(1, db_dir_path);
+  vertex.Init({{{0, 0, Vertex::ColumnType::kInt64, Vertex::EdgeType::kNone},
+                {property_id, 0, Vertex::ColumnType::kDynamicEdgeList,
+                 Vertex::EdgeType::kInt32}}});
+  vertex.Resize(degrees.size());
+
+  std::vector<std::pair<size_t, size_t>> edge_list_len;
+  for (size_t vertex_id = 0; vertex_id < degrees.size(); vertex_id++)
+    edge_list_len.push_back({vertex_id, degrees[vertex_id]});
+  vertex.EdgeListInitBatch(property_id, edge_list_len);
+
+  auto& column_family = vertex.GetColumnFamily(0);
+  for (size_t vertex_id = 0; vertex_id < degrees.size(); vertex_id++) {
+    auto item_t =
+        column_family.getColumn(vertex_id, column_id_in_column_family);
+    auto& adj_list = gbp::BufferBlock::Ref<MutableAdjlist>(item_t);
+    assert(adj_list.tier_ == tiers[vertex_id]);
+    assert(adj_list.capacity_ >= degrees[vertex_id]);
+    switch (adj_list.tier_) {
+    case MutableAdjlist::kInline:
+      assert(adj_list.capacity_ == inline_capacity);
+      break;
+    case MutableAdjlist::kPacked:  // 不跨页
+      assert(adj_list.start_idx_ % obj_num_perpage + adj_list.capacity_ <=
+             obj_num_perpage);
+      break;
+    case MutableAdjlist::kExtent:  // 从页边界开始，占整页
+      assert(adj_list.start_idx_ % obj_num_perpage == 0);
+      assert(adj_list.capacity_ % obj_num_perpage == 0);
+      break;
+    }
+  }
+
+  auto make_nbr = [](size_t vertex_id, size_t idx) {
+    nbr_t nbr;
+    nbr.neighbor = vertex_id * 10000 + idx;
+    nbr.timestamp.store(idx);
+    nbr.data = -static_cast<int32_t>(idx);
+    return nbr;
+  };
+  // 前一半逐条插入，后一半一次插入
+  for (size_t vertex_id = 0; vertex_id < degrees.size(); vertex_id++) {
+    const size_t degree = degrees[vertex_id];
+    std::vector<nbr_t> nbrs;
+    for (size_t idx = 0; idx < degree; idx++)
+      nbrs.push_back(make_nbr(vertex_id, idx));
+    for (size_t idx = 0; idx < degree / 2; idx++)
+      vertex.InsertEdge(vertex_id,
+                        {property_id,
+                         {reinterpret_cast<const char*>(&nbrs[idx]),
+                          sizeof(nbr_t)}});
+    std::vector<std::string_view> edges;
+    for (size_t idx = degree / 2; idx < degree; idx++)
+      edges.emplace_back(reinterpret_cast<const char*>(&nbrs[idx]),
+                         sizeof(nbr_t));
+    if (!edges.empty())
+      vertex.InsertEdgeList(vertex_id, {property_id, edges});
+  }
+
+  // 全部插入之后再读，内联的邻居不会被其它顶点的写入覆盖
+  for (size_t vertex_id = 0; vertex_id < degrees.size(); vertex_id++) {
+    auto datas = vertex.ReadEdgeList(vertex_id, property_id);
+    assert(datas.Size() == degrees[vertex_id] * sizeof(nbr_t));
+    for (size_t idx = 0; idx < degrees[vertex_id]; idx++) {
+      auto expected = make_nbr(vertex_id, idx);
+      auto& nbr = gbp::BufferBlock::Ref<nbr_t>(datas, idx);
+      assert(nbr.neighbor == expected.neighbor);
+      assert(nbr.timestamp.load() == expected.timestamp.load());
+      assert(nbr.data == expected.data);
+    }
+  }
+  std::cout << "test_vertex_edge_tiers passed" << std::endl;
+}
+
+// MutableCsr的MVCC：VersionManager的读快照、delete_edge只删除所有读者都已经看到的边、
+// 快照迭代器与批量迭代器在插入之前/插入与删除之间/删除之后的可见性、compact与ReaderEpoch对旧区间的保护
+void test_mutable_csr_mvcc(const std::string& dir_path) {
+  auto& bpm = gbp::BufferPoolManager::GetGlobalInstance();
+  bpm.init(1, 1024 * 16, 1);
+  std::filesystem::remove_all(dir_path);
+  std::filesystem::create_directories(dir_path);
+
+  // ReaderEpoch：Guard（及其拷贝）全部析构之前，进入时纪元不大于退休纪元的区间不可回收
+  {
+    ReaderEpoch epoch;
+    auto guard = epoch.enter();
+    auto retire_epoch = epoch.retire();
+    assert(!epoch.reclaimable(retire_epoch));
+    {
+      auto guard_copy = guard;
+      guard = ReaderEpoch::Guard();
+      assert(!epoch.reclaimable(retire_epoch));
+    }
+    assert(epoch.reclaimable(retire_epoch));
+    auto guard_new = epoch.enter();  // 退休之后进入的读者看不到旧区间
+    assert(epoch.reclaimable(retire_epoch));
+    assert(!epoch.reclaimable(epoch.retire()));
+  }
+
+  // VersionManager：写按时间戳顺序提交，min_read_timestamp覆盖活跃读者与之后的读者
+  VersionManager vm;
+  assert(vm.read_timestamp() == 0);
+  assert(vm.min_active_read_timestamp() == INVALID_READ_TIMESTAMP);
+  {
+    auto ts_a = vm.acquire_insert_timestamp(),
+         ts_b = vm.acquire_insert_timestamp();
+    assert(ts_a == 1 && ts_b == 2);
+    std::thread committer([&]() { vm.release_insert_timestamp(ts_b); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    assert(vm.read_timestamp() == 0);  // ts_b要等ts_a提交
+    vm.release_insert_timestamp(ts_a);
+    committer.join();
+    assert(vm.read_timestamp() == 2);
+    auto snapshot = vm.acquire_read_snapshot();
+    assert(snapshot.timestamp() == 2);
+    assert(vm.min_active_read_timestamp() == 2);
+    vm.release_insert_timestamp(vm.acquire_insert_timestamp());
+    assert(vm.min_read_timestamp() == 2);
+    snapshot.release();
+    assert(vm.min_active_read_timestamp() == INVALID_READ_TIMESTAMP);
+    assert(vm.min_read_timestamp() == 3);
+  }
+
+  const vid_t vertex_num = 4;
+  const size_t degree = 1000;  // 跨页，覆盖多个窗口
+  FixedLengthColumnFamily adj_lists;
+  adj_lists.init({sizeof(MutableAdjlist)}, dir_path + "/adj");
+  adj_lists.resize(vertex_num);
+  MutableCsr<int32_t> csr(adj_lists, 0);
+  csr.init(dir_path + "/nbr", vertex_num * degree * 16);
+
+  auto visible = [&](vid_t v, timestamp_t read_ts) {
+    std::vector<vid_t> snapshot_neighbors, batch_neighbors;
+    for (auto iter = csr.snapshot_edge_iter(v, read_ts); iter->is_valid();
+         iter->next())
+      snapshot_neighbors.push_back(iter->get_neighbor());
+    csr.get_neighbors(v, read_ts, batch_neighbors);
+    std::vector<vid_t> neighbors(csr.degree(v));
+    std::vector<int32_t> data(csr.degree(v));
+    std::vector<timestamp_t> timestamps(csr.degree(v));
+    auto num = csr.get_neighbors(v, read_ts, neighbors.data(), data.data(),
+                                 timestamps.data());
+    neighbors.resize(num);
+    for (size_t i = 0; i < num; i++) {
+      assert(data[i] == (int32_t) neighbors[i]);
+      assert(is_visible(timestamps[i], read_ts));
+    }
+    assert(snapshot_neighbors == batch_neighbors);
+    assert(snapshot_neighbors == neighbors);
+    return snapshot_neighbors;
+  };
+  auto range = [](vid_t begin, vid_t end, vid_t skip = 0) {
+    std::vector<vid_t> ret;
+    for (vid_t dst = begin; dst < end; dst++)
+      if (skip == 0 || dst % skip != 0)
+        ret.push_back(dst);
+    return ret;
+  };
+
+  auto snapshot_before = vm.acquire_read_snapshot();
+  auto insert_ts = vm.acquire_insert_timestamp();
+  for (vid_t v = 0; v < vertex_num; v++)
+    for (vid_t dst = 0; dst < degree; dst++)
+      csr.put_edge(v, dst, (int32_t) dst, insert_ts);
+  vm.release_insert_timestamp(insert_ts);
+  auto snapshot_between = vm.acquire_read_snapshot();
+  assert(snapshot_before.timestamp() < insert_ts &&
+         snapshot_between.timestamp() == insert_ts);
+
+  // 插入之前的读者还在，删除会丢掉它需要的插入时间戳，因此被拒绝
+  auto delete_ts = vm.acquire_insert_timestamp();
+  for (vid_t dst = 0; dst < degree; dst += 7)
+    assert(!csr.delete_edge(0, dst, delete_ts, vm));
+  vm.release_insert_timestamp(delete_ts);
+  assert(visible(0, snapshot_before.timestamp()).empty());
+  assert(visible(0, snapshot_between.timestamp()) == range(0, degree));
+
+  snapshot_before.release();
+  delete_ts = vm.acquire_insert_timestamp();
+  for (vid_t dst = 0; dst < degree; dst += 7)
+    assert(csr.delete_edge(0, dst, delete_ts, vm));
+  assert(!csr.delete_edge(0, 0, delete_ts, vm));       // 已经删除
+  assert(!csr.delete_edge(0, degree, delete_ts, vm));  // 不存在
+  vm.release_insert_timestamp(delete_ts);
+  auto snapshot_after = vm.acquire_read_snapshot();
+  assert(snapshot_after.timestamp() == delete_ts);
+
+  assert(visible(0, snapshot_between.timestamp()) == range(0, degree));
+  assert(visible(0, snapshot_after.timestamp()) == range(0, degree, 7));
+  assert(visible(1, snapshot_after.timestamp()) == range(0, degree));
+
+  // snapshot_between还能看到被删除的边，compact不回收
+  assert(csr.compact(vm) == 0);
+  assert(visible(0, snapshot_between.timestamp()) == range(0, degree));
+
+  // 持有旧区间的slice时compact，旧区间在slice析构之前不会被复用
+  auto slice_old = csr.get_edges(0);
+  snapshot_between.release();
+  const size_t deleted_num = (degree + 6) / 7;
+  assert(csr.compact(vm) == deleted_num);
+  assert(csr.degree(0) == (int) (degree - deleted_num));
+  assert(visible(0, snapshot_after.timestamp()) == range(0, degree, 7));
+  assert(visible(0, MAX_TIMESTAMP) == range(0, degree, 7));
+  // get_edge读取compact之后的新区间
+  {
+    auto kept = range(0, degree, 7);
+    for (size_t i = 0; i < kept.size(); i += 97) {
+      auto item = csr.get_edge(0, i);
+      assert(gbp::BufferBlock::Ref<MutableNbr<int32_t>>(item).neighbor ==
+             kept[i]);
+    }
+  }
+
+  auto refill_ts = vm.acquire_insert_timestamp();
+  for (vid_t v = 1; v < vertex_num; v++)
+    for (vid_t dst = degree; dst < 2 * degree; dst++)
+      csr.put_edge(v, dst, (int32_t) dst, refill_ts);
+  vm.release_insert_timestamp(refill_ts);
+  {
+    TypedMutableCsrConstEdgeIter<int32_t> iter(slice_old);
+    for (vid_t dst = 0; dst < degree; dst++, iter.next()) {
+      assert(iter.is_valid() && iter.get_neighbor() == dst);
+      assert(is_deleted(iter.get_timestamp()) == (dst % 7 == 0));
+    }
+    assert(!iter.is_valid());
+  }
+  slice_old = MutableNbrSlice<int32_t>();
+  csr.reclaim_ranges();
+  assert(visible(1, snapshot_after.timestamp()) == range(0, degree));
+  assert(visible(1, refill_ts) == range(0, 2 * degree));
+  std::cout << "test_mutable_csr_mvcc passed" << std::endl;
+}
+
+template <typename INDEX_T>
+static void check_probe_group_kernels(size_t round) {
+  using namespace gs::id_indexer_impl;
+  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+  std::mt19937_64 rng(round);
+  gs::index_key_group<INDEX_T> group;
+  for (size_t k = 0; k < round; k++) {
+    // key的取值范围很小，使一个group中有多个lane相等
+    for (size_t lane = 0; lane < 8; lane++) {
+      group.keys[lane] = rng() % 4 - 2;
+      group.indices[lane] = rng() % 3 == 0 ? sentinel : lane;
+    }
+    int64_t oid = rng() % 4 - 2;
+    uint32_t empty_scalar, empty_simd;
+    uint32_t match_scalar = probe_group_scalar(group, oid, empty_scalar);
+    for (size_t lane = 0; lane < 8; lane++) {
+      assert(((match_scalar >> lane) & 1) == (group.keys[lane] == oid));
+      assert(((empty_scalar >> lane) & 1) == (group.indices[lane] == sentinel));
+    }
+#if defined(__x86_64__)
+    if (simd_level() >= SimdLevel::kAVX2) {
+      assert(probe_group_avx2(group, oid, empty_simd) == match_scalar);
+      assert(empty_simd == empty_scalar);
+    }
+    if (simd_level() >= SimdLevel::kAVX512) {
+      assert(probe_group_avx512(group, oid, empty_simd) == match_scalar);
+      assert(empty_simd == empty_scalar);
+    }
+#endif
+    assert(probe_group(group, oid, empty_simd) == match_scalar);
+    assert(empty_simd == empty_scalar);
+  }
+}
+
+// LFIndexer的group探测：各指令集的kernel结果一致；id_indexer_groups.h中的insert_slot（rebuild_indices从flat布局迁移时的做法）
+// 按index顺序插入之后与flat布局的线性探测落在相同的slot上，probe的查找结果相同
+void test_index_probe_group(const std::string& file_path) {
+  using namespace gs::id_indexer_impl;
+  using INDEX_T = uint32_t;
+  using group_t = gs::index_key_group<INDEX_T>;
+  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+  std::cout << "simd level: " << static_cast<int>(simd_level()) << std::endl;
+  check_probe_group_kernels<uint32_t>(10000);
+  check_probe_group_kernels<uint64_t>(10000);
+
+  auto& bpm = gbp::BufferPoolManager::GetGlobalInstance();
+  bpm.init(1, 1024 * 16, 1);
+  std::filesystem::remove(file_path);
+
+  // slot数不是WIDTH的整数倍，最后一个group中有无效的lane；group跨越多个页，探测会跨页并从末尾回绕
+  const size_t slot_num = 1003, key_num = 900;
+  const size_t group_num = get_group_num<INDEX_T>(slot_num);
+  assert(group_num > 2 * group_num_per_page<INDEX_T>());
+  std::vector<int64_t> keys(key_num);
+  std::mt19937_64 rng(7);
+  std::unordered_set<int64_t> used;
+  for (auto& key : keys) {
+    do {
+      key = static_cast<int64_t>(rng() % (slot_num * 16));
+    } while (!used.insert(key).second);
+  }
+  auto slot_of = [&](int64_t oid) { return static_cast<size_t>(oid) % slot_num; };
+
+  index_groups_type<INDEX_T> groups;
+  groups.open(file_path, false);
+  reset_groups(groups, slot_num);
+  assert(groups.size() == group_num);
+
+  std::vector<int64_t> flat_keys(slot_num, 0);
+  std::vector<INDEX_T> flat_indices(slot_num, sentinel);
+  for (size_t ind = 0; ind < key_num; ind++) {
+    size_t slot = slot_of(keys[ind]);
+    while (flat_indices[slot] != sentinel)
+      slot = slot + 1 == slot_num ? 0 : slot + 1;
+    flat_keys[slot] = keys[ind];
+    flat_indices[slot] = ind;
+    insert_slot<INDEX_T>(groups, slot_num, slot_of(keys[ind]), keys[ind], ind);
+  }
+  for (size_t group_id = 0; group_id < group_num; group_id++) {
+    auto item = groups.get(group_id);
+    auto& group = gbp::BufferBlock::Ref<group_t>(item);
+    for (size_t lane = 0; lane < group_t::WIDTH; lane++) {
+      size_t slot = group_id * group_t::WIDTH + lane;
+      if (slot >= slot_num) {
+        assert(group.indices[lane] == sentinel);
+        continue;
+      }
+      assert(group.indices[lane] == flat_indices[slot]);
+      if (flat_indices[slot] != sentinel)
+        assert(group.keys[lane] == flat_keys[slot]);
+    }
+  }
+
+  for (size_t ind = 0; ind < key_num; ind++)
+    assert(probe(groups, slot_num, slot_of(keys[ind]), keys[ind]) == ind);
+  for (size_t k = 0; k < 1000; k++) {
+    int64_t oid = static_cast<int64_t>(slot_num * 16 + rng() % slot_num);
+    assert(probe(groups, slot_num, slot_of(oid), oid) == sentinel);
+  }
+  std::cout << "test_index_probe_group passed" << std::endl;
+}
+
+// LFIndexer::get_index_batch的探测（id_indexer_impl::probe_batch）：与逐个probe的结果相同，
+// 覆盖不存在的key、重复的key、同一页上的多个key以及跨页/回绕的探测，批的大小不是BATCH_SIZE的整数倍
+void test_index_get_batch(const std::string& file_path) {
+  using namespace gs::id_indexer_impl;
+  using INDEX_T = uint32_t;
+  static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+  auto& bpm = gbp::BufferPoolManager::GetGlobalInstance();
+  bpm.init(1, 1024 * 16, 1);
+  std::filesystem::remove(file_path);
+
+  const size_t slot_num = 20011, key_num = 15000;
+  auto slot_of = [&](int64_t oid) { return static_cast<size_t>(oid) % slot_num; };
+  index_groups_type<INDEX_T> groups;
+  groups.open(file_path, false);
+  reset_groups(groups, slot_num);
+  std::mt19937_64 rng(11);
+  std::unordered_set<int64_t> used;
+  std::vector<int64_t> keys(key_num);
+  for (size_t ind = 0; ind < key_num; ind++) {
+    do {
+      keys[ind] = static_cast<int64_t>(rng() % (slot_num * 16));
+    } while (!used.insert(keys[ind]).second);
+    insert_slot<INDEX_T>(groups, slot_num, slot_of(keys[ind]), keys[ind], ind);
+  }
+
+  std::vector<int64_t> oids;
+  std::vector<INDEX_T> expected;
+  for (size_t k = 0; k < 3 * key_num; k++) {
+    if (k % 3 == 0) {  // 不存在的key
+      oids.push_back(static_cast<int64_t>(slot_num * 16 + rng() % slot_num));
+      expected.push_back(sentinel);
+    } else {  // 存在的key，其中有重复
+      auto ind = rng() % key_num;
+      oids.push_back(keys[ind]);
+      expected.push_back(ind);
+    }
+  }
+  std::vector<size_t> slots(oids.size());
+  for (size_t k = 0; k < oids.size(); k++)
+    slots[k] = slot_of(oids[k]);
+
+  std::vector<INDEX_T> rets(oids.size(), 0);
+  for (size_t num : {oids.size(), (size_t) 1, (size_t) 63, (size_t) 65}) {
+    std::fill(rets.begin(), rets.end(), 0);
+    probe_batch(groups, slot_num, oids.data(), slots.data(), num, rets.data());
+    for (size_t k = 0; k < num; k++) {
+      assert(rets[k] == expected[k]);
+      assert(rets[k] == probe(groups, slot_num, slots[k], oids[k]));
+    }
+    for (size_t k = num; k < oids.size(); k++)
+      assert(rets[k] == 0);
+  }
+  // get_batch获取的页被本线程的DirectCache持有，关闭文件之前释放
+  gbp::DirectCache::GetDirectCache().Clean();
+  std::cout << "test_index_get_batch passed" << std::endl;
+}
+
 void test_graph(const std::string& config_file_path,
                 const std::string& data_file_path,
                 const std::string& db_dir_path) {
@@ -27,11 +27,13 @@
 #include <algorithm>
 #include <atomic>
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <string_view>
 
 #include "../include/buffer_pool_manager.h"
 #include "../include/mmap_array.h"
+#include "../include/uffd_region.h"
 
 namespace test {
 struct string_item {
@@ -50,6 +52,7 @@ class mmap_array_base {
   virtual bool read_only() const = 0;
   virtual const std::string& filename() const = 0;
   virtual size_t size() const = 0;
+  virtual size_t item_size() const = 0;
   virtual void set(size_t idx, std::string_view val, size_t len = 1) = 0;
   virtual void set_single_obj(size_t idx, std::string_view val) = 0;
   virtual const gbp::BufferBlock get(size_t idx, size_t len = 1) const = 0;
@@ -94,6 +97,8 @@ class mmap_array : public mmap_array_base {
   ~mmap_array() { close(); }
 
   void close() {
+    // 先把映射中的dirty页写回buffer pool
+    uffd_region_.reset();
     if (fd_gbp_ != gbp::INVALID_FILE_HANDLE) {
       buffer_pool_manager_->CloseFile(fd_gbp_);
       fd_gbp_ = gbp::INVALID_FILE_HANDLE;
@@ -344,6 +349,26 @@ class mmap_array : public mmap_array_base {
                                    file_offset, sizeof(T), fd_gbp_, false);
   }
 
+  // 批量设置[idx, idx + len)个obj，val中的obj紧密排列，obj不跨页，因此每个页面调用一次SetBlock
+  void set_batch(size_t idx, std::string_view val, size_t len) {
+#if ASSERT_ENABLE
+    assert(idx + len <= size_);
+    assert(sizeof(T) * len == val.size());
+#endif
+    const char* buf = val.data();
+    while (len != 0) {
+      size_t obj_num =
+          std::min<size_t>(len, OBJ_NUM_PERPAGE - idx % OBJ_NUM_PERPAGE);
+      const size_t file_offset = idx / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_FILE +
+                                 (idx % OBJ_NUM_PERPAGE) * sizeof(T);
+      buffer_pool_manager_->SetBlock(buf, file_offset, obj_num * sizeof(T),
+                                     fd_gbp_, false);
+      buf += obj_num * sizeof(T);
+      idx += obj_num;
+      len -= obj_num;
+    }
+  }
+
   // // FIXME: 无法保证atomic
   // void set(size_t idx, const gbp::BufferBlock& val) {
   //   const size_t file_offset = idx / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_FILE +
@@ -404,7 +429,25 @@ class mmap_array : public mmap_array_base {
     // return ret;
   }
 
-  const std::future<gbp::BufferBlock> get_async(size_t idx,
+  // 批量获取多个<idx, len>区间（每个区间不能跨页），缺页的IO通过GetBlockBatch一起提交
+  void get_batch(const std::vector<std::pair<size_t, size_t>>& ranges,
+                 std::vector<gbp::BufferBlock>& results) const {
+    thread_local std::vector<gbp::batch_request_type> requests;
+    requests.clear();
+    for (auto& range : ranges) {
+#if ASSERT_ENABLE
+      assert(range.first + range.second <= size_);
+      assert(range.first % OBJ_NUM_PERPAGE + range.second <= OBJ_NUM_PERPAGE);
+#endif
+      const size_t file_offset =
+          range.first / OBJ_NUM_PERPAGE * gbp::PAGE_SIZE_FILE +
+          (range.first % OBJ_NUM_PERPAGE) * sizeof(T);
+      requests.emplace_back(file_offset, range.second * sizeof(T), fd_gbp_);
+    }
+    buffer_pool_manager_->GetBlockBatch(requests, results);
+  }
+
+  gbp::AsyncFuture<gbp::BufferBlock> get_async(size_t idx,
                                                 size_t len = 1) const {
 #if ASSERT_ENABLE
     assert(idx + len <= size_);
@@ -437,6 +480,30 @@ class mmap_array : public mmap_array_base {
 #if OV
   T& operator[](size_t idx) { return data_[idx]; }
   const T& operator[](size_t idx) const { return data_[idx]; }
+#else
+  /**
+   * userfaultfd模式：把整个文件映射为一段普通内存，缺页时由buffer pool提供数据
+   * 映射与文件布局一致（每页OBJ_NUM_PERPAGE个obj），sizeof(T)整除页大小时可以直接当作T*使用
+   */
+  char* map_uffd() {
+    assert(fd_gbp_ != gbp::INVALID_FILE_HANDLE);
+    if (uffd_region_ == nullptr)
+      uffd_region_ = std::make_unique<gbp::UffdRegion>(buffer_pool_manager_,
+                                                       fd_gbp_, read_only_);
+    return uffd_region_->Data();
+  }
+  // 需要先调用map_uffd
+  T& operator[](size_t idx) {
+#if ASSERT_ENABLE
+    assert(uffd_region_ != nullptr && idx < size_);
+#endif
+    return *reinterpret_cast<T*>(
+        uffd_region_->Data() + (idx / OBJ_NUM_PERPAGE) * gbp::PAGE_SIZE_FILE +
+        (idx % OBJ_NUM_PERPAGE) * sizeof(T));
+  }
+  const T& operator[](size_t idx) const {
+    return const_cast<mmap_array&>(*this)[idx];
+  }
 #endif
 
   size_t size() const { return size_; }
@@ -457,6 +524,7 @@ class mmap_array : public mmap_array_base {
     std::swap(size_, rhs.size_);
     std::swap(buffer_pool_manager_, rhs.buffer_pool_manager_);
     std::swap(chunk_size_, rhs.chunk_size_);
+    std::swap(uffd_region_, rhs.uffd_region_);
     rhs.fd_gbp_ = gbp::INVALID_FILE_HANDLE;
   }
 
@@ -468,6 +536,7 @@ class mmap_array : public mmap_array_base {
 #endif
 
   const std::string& filename() const { return filename_; }
+  size_t item_size() const { return sizeof(T); }
 
  private:
   mutable bool mark_used_ = false;
@@ -503,6 +572,7 @@ class mmap_array : public mmap_array_base {
 
   size_t chunk_size_;
   uint16_t OBJ_NUM_PERPAGE = gbp::PAGE_SIZE_FILE / sizeof(T);
+  std::unique_ptr<gbp::UffdRegion> uffd_region_;
 #endif
 };
 
@@ -564,7 +634,7 @@ class mmap_array<std::string_view> {
     auto& item = gbp::BufferBlock::Ref<string_item>(value);
     return data_.get(item.offset, item.length);
   }
-  std::future<gbp::BufferBlock> get_async(size_t idx) const {
+  gbp::AsyncFuture<gbp::BufferBlock> get_async(size_t idx) const {
     auto value = items_.get(idx);
     auto& item = gbp::BufferBlock::Ref<string_item>(value);
     return data_.get_async(item.offset, item.length);
@@ -8,9 +8,14 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <bitset>
+#include <deque>
 #include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <numeric>
 #include <string>
 #include <thread>
 
@@ -769,4 +774,1084 @@ int test_concurrency(int argc, char** argv) {
 
   return 0;
 }
+
+// 测试用的BufferPoolManager：一个pool、一个IOServer，file_path作为fd 0打开。
+// fresh为true时先删除旧文件，file_size_inpage不为0时把文件扩展到该大小
+static void init_test_bpm(BufferPoolManager& bpm, const std::string& file_path,
+                          size_t pool_size_inpage, size_t file_size_inpage = 0,
+                          bool fresh = true) {
+  if (fresh)
+    std::filesystem::remove(file_path);
+  bpm.init(1, pool_size_inpage, 1, file_path);
+  if (file_size_inpage != 0)
+    bpm.Resize(0, file_size_inpage * PAGE_SIZE_FILE);
+}
+
+// 可压缩的测试页：每个size_t为seed + i % 16
+static void fill_compressible_page(char* page, size_t seed) {
+  for (size_t i = 0; i < PAGE_SIZE_FILE / sizeof(size_t); i++)
+    ((size_t*) page)[i] = seed + i % 16;
+}
+
+// VMCache：被淘汰的脏页写回后可以重新装入，Truncate丢弃的页不会写回
+void test_vm_cache(const std::string& file_path) {
+  constexpr size_t capacity_inpage = VM_CACHE_EVICTION_BATCH_SIZE * 2;
+  constexpr size_t fpage_num = capacity_inpage * 4;
+  std::filesystem::remove(file_path);
+  DiskManager disk_manager;
+  auto fd = disk_manager.OpenFile(file_path, O_RDWR | O_CREAT);
+  disk_manager.Resize(fd, fpage_num * PAGE_SIZE_FILE);
+  VMCache cache(&disk_manager, capacity_inpage);
+  // 超出预留范围的fd与文件大小被拒绝，范围内的文件可以扩大
+  assert(!cache.EnableFile(VM_CACHE_MAX_FILE_NUM, PAGE_SIZE_FILE));
+  assert(!cache.EnableFile(fd, VM_CACHE_FILE_RESERVE_SIZE + PAGE_SIZE_FILE));
+  assert(cache.EnableFile(fd, fpage_num * PAGE_SIZE_FILE * 2));
+
+  for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+    auto guard = cache.Fix(fpage_id * PAGE_SIZE_FILE, sizeof(size_t), fd);
+    *guard.Ptr<size_t>() = fpage_id;
+    guard.MarkDirty();
+  }
+  assert(cache.GetResidentPageNum() <= capacity_inpage);
+
+  // 跨页的obj在虚拟地址上连续
+  {
+    auto guard = cache.Fix(PAGE_SIZE_FILE * 2 - sizeof(size_t),
+                           sizeof(size_t) * 2, fd);
+    assert(guard.Ptr<size_t>()[1] == 2);
+  }
+  for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+    auto guard = cache.Fix(fpage_id * PAGE_SIZE_FILE, sizeof(size_t), fd);
+    assert(*guard.Ptr<size_t>() == fpage_id);
+  }
+
+  assert(cache.FlushFile(fd, true));
+  assert(cache.GetResidentPageNum() == 0);
+  size_t value;
+  assert(::pread(disk_manager.GetFileDescriptor(fd), &value, sizeof(size_t),
+                 (fpage_num - 1) * PAGE_SIZE_FILE) == sizeof(size_t));
+  assert(value == fpage_num - 1);
+
+  // 被截断的脏页直接丢弃，重新装入时读到的是文件中的数据
+  {
+    auto guard =
+        cache.Fix((fpage_num - 1) * PAGE_SIZE_FILE, sizeof(size_t), fd);
+    *guard.Ptr<size_t>() = 0;
+    guard.MarkDirty();
+  }
+  cache.Truncate(fd, fpage_num - 1, fpage_num);
+  {
+    auto guard =
+        cache.Fix((fpage_num - 1) * PAGE_SIZE_FILE, sizeof(size_t), fd);
+    assert(*guard.Ptr<size_t>() == fpage_num - 1);
+  }
+
+  // 所有常驻页都被持有时，缺页的线程等待页被释放，而不是超出容量
+  {
+    std::vector<VMCache::Guard> guards;
+    for (size_t fpage_id = 0; fpage_id < capacity_inpage; fpage_id++)
+      guards.push_back(
+          cache.Fix(fpage_id * PAGE_SIZE_FILE, sizeof(size_t), fd));
+    std::atomic<bool> loaded = false;
+    std::thread reader([&]() {
+      auto guard =
+          cache.Fix(capacity_inpage * PAGE_SIZE_FILE, sizeof(size_t), fd);
+      assert(*guard.Ptr<size_t>() == capacity_inpage);
+      loaded = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    assert(!loaded && cache.GetResidentPageNum() <= capacity_inpage);
+    guards.clear();
+    reader.join();
+    assert(loaded && cache.GetResidentPageNum() <= capacity_inpage);
+  }
+
+  // 截断与关闭时等待持有者释放页
+  for (bool truncate : {true, false}) {
+    auto guard = cache.Fix(0, sizeof(size_t), fd);
+    std::thread releaser([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      guard.Release();
+    });
+    if (truncate)
+      cache.Truncate(fd, 0, 1);
+    else
+      assert(cache.FlushFile(fd, true));
+    releaser.join();
+  }
+  assert(cache.GetResidentPageNum() == 0);
+  std::cout << "test_vm_cache passed" << std::endl;
+}
+
+// UffdRegion：映射的就是buffer pool中的帧，与SetBlock/GetBlock互相可见，帧由replacer淘汰
+void test_uffd_region(const std::string& file_path) {
+  if constexpr (!UFFD_REGION_ENABLE) {
+    std::cout << "test_uffd_region skipped: UFFD_REGION_ENABLE is off"
+              << std::endl;
+    return;
+  }
+  constexpr size_t pool_size_inpage = 64;
+  constexpr size_t fpage_num = pool_size_inpage * 4;
+  BufferPoolManager bpm;
+  init_test_bpm(bpm, file_path, pool_size_inpage, fpage_num);
+  GBPfile_handle_type fd = 0;
+  size_t value;
+  {
+    UffdRegion region(&bpm, fd, false);
+    auto data = region.Data();
+    // 页数是pool的4倍，通过映射写入的页在被replacer淘汰时写回
+    for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++)
+      *(size_t*) (data + fpage_id * PAGE_SIZE_FILE) = fpage_id;
+    assert(region.GetMappedPageNum() <= pool_size_inpage);
+    // 被Unmap的页重新映射回匿名映射，VMA数量随当前映射着的页数而不是映射过的页数增长
+    size_t vma_num = 0;
+    std::ifstream maps("/proc/self/maps");
+    for (std::string line; std::getline(maps, line);) {
+      auto begin = std::stoul(line.substr(0, line.find('-')), nullptr, 16);
+      if (begin >= (uintptr_t) data &&
+          begin < (uintptr_t) data + UFFD_REGION_RESERVE_SIZE)
+        vma_num++;
+    }
+    assert(vma_num <= 2 * region.GetMappedPageNum() + 1);
+
+    for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+      bpm.GetBlock((char*) &value, fpage_id * PAGE_SIZE_FILE, sizeof(size_t),
+                   fd);
+      assert(value == fpage_id);
+    }
+
+    // 经过buffer pool的写入在映射中可见，反之亦然
+    value = 42;
+    bpm.SetBlock((char*) &value, 0, sizeof(size_t), fd);
+    assert(*(size_t*) data == 42);
+    *(size_t*) (data + sizeof(size_t)) = 43;
+    bpm.GetBlock((char*) &value, sizeof(size_t), sizeof(size_t), fd);
+    assert(value == 43);
+  }
+
+  // 析构时所有映射过的页都已写回
+  bpm.FlushFile(fd);
+  assert(::pread(bpm.GetFileDescriptor(fd), &value, sizeof(size_t),
+                 sizeof(size_t)) == sizeof(size_t));
+  assert(value == 43);
+  std::cout << "test_uffd_region passed" << std::endl;
+}
+
+// warm restart：快照中的页按热度分批装入，装入的页数不超过page_budget，
+// 装入完成之后（eviction worker补充完空闲页）最热的页仍然常驻
+void test_warm_restart(const std::string& file_path) {
+  constexpr size_t pool_size_inpage = 64;
+  constexpr size_t fpage_num = pool_size_inpage * 2;
+  auto snapshot_path = file_path + ".snapshot";
+  {
+    BufferPoolManager bpm;
+    init_test_bpm(bpm, file_path, pool_size_inpage, fpage_num);
+    for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++)
+      bpm.SetBlock((char*) &fpage_id, fpage_id * PAGE_SIZE_FILE,
+                   sizeof(size_t), 0);
+    assert(bpm.FlushFile(0));
+    assert(bpm.DumpResidentSet(snapshot_path));
+  }
+
+  // 快照中的页按热度从高到低排列（格式见BufferPoolManager::DumpResidentSet）
+  std::vector<fpage_id_type> snapshot_pages;
+  {
+    std::ifstream file(snapshot_path, std::ios::binary);
+    auto read = [&file](auto& value) {
+      file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    };
+    uint64_t magic, page_num;
+    uint32_t file_num, name_len;
+    read(magic);
+    read(file_num);
+    for (uint32_t fd = 0; fd < file_num; fd++) {
+      read(name_len);
+      file.seekg(name_len, std::ios::cur);
+    }
+    read(page_num);
+    for (uint64_t idx = 0; idx < page_num; idx++) {
+      uint64_t entry;
+      read(entry);
+      snapshot_pages.push_back(entry & 0xFFFFFFFF);
+    }
+    assert(file.good() && !snapshot_pages.empty());
+  }
+
+  BufferPoolManager bpm;
+  init_test_bpm(bpm, file_path, pool_size_inpage, 0, false);
+  assert(bpm.LoadResidentSet(snapshot_path, 16) == 16);
+  auto loaded_num = bpm.LoadResidentSet(snapshot_path);
+  assert(loaded_num >= 16 && loaded_num < pool_size_inpage);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  for (size_t idx = 0; idx < loaded_num; idx++)
+    assert(bpm.IsPageResident(snapshot_pages[idx]));
+  for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+    size_t value;
+    bpm.GetBlock((char*) &value, fpage_id * PAGE_SIZE_FILE, sizeof(size_t), 0);
+    assert(value == fpage_id);
+  }
+  std::cout << "test_warm_restart passed" << std::endl;
+}
+
+// IOServer的优先级：淘汰的脏页以WriteBack优先级写回，LoadFile以Bulk优先级装入
+void test_io_priority(const std::string& file_path) {
+  {
+    IOPriorityScope bulk(IOPriority::Bulk);
+    assert(IOPriorityScope::Current() == IOPriority::Bulk);
+    {
+      IOPriorityScope write_back(IOPriority::WriteBack);
+      assert(IOPriorityScope::Current() == IOPriority::WriteBack);
+    }
+    assert(IOPriorityScope::Current() == IOPriority::Bulk);
+  }
+  assert(IOPriorityScope::Current() == IOPriority::Foreground);
+
+  // 调度顺序、每一级的在途请求数上限与deadline提升
+  {
+    using request_type = IOServer::async_SSD_IO_request_type;
+    constexpr size_t fg_limit = IO_PRIORITY_INFLIGHT_LIMIT[0],
+                     wb_limit = IO_PRIORITY_INFLIGHT_LIMIT[1],
+                     bulk_limit = IO_PRIORITY_INFLIGHT_LIMIT[2];
+    auto now = std::chrono::steady_clock::now();
+    auto overdue = now - std::chrono::microseconds(
+                             IO_PRIORITY_DEADLINE_MICROSECOND[2] + 1000);
+    std::deque<request_type> reqs;
+    auto make = [&](IOPriority priority,
+                    std::chrono::steady_clock::time_point enqueue_time) {
+      auto& req = reqs.emplace_back();
+      req.priority = priority;
+      req.enqueue_time = enqueue_time;
+      return &req;
+    };
+
+    // 按优先级选择，同一级内FIFO；达到上限的级别不再被选择
+    IOServer::Scheduler scheduler;
+    std::vector<request_type*> fg_reqs, wb_reqs;
+    for (size_t i = 0; i < wb_limit * 2; i++) {
+      wb_reqs.push_back(make(IOPriority::WriteBack, now));
+      scheduler.Push(wb_reqs.back());
+    }
+    for (size_t i = 0; i < fg_limit + 1; i++) {
+      fg_reqs.push_back(make(IOPriority::Foreground, now));
+      scheduler.Push(fg_reqs.back());
+    }
+    for (size_t i = 0; i < fg_limit; i++)
+      assert(scheduler.Schedule(now) == fg_reqs[i]);
+    for (size_t i = 0; i < wb_limit; i++)
+      assert(scheduler.Schedule(now) == wb_reqs[i]);
+    assert(scheduler.Schedule(now) == nullptr);
+    assert(scheduler.GetInflightNum(IOPriority::Foreground) == fg_limit);
+    assert(scheduler.GetInflightNum(IOPriority::WriteBack) == wb_limit);
+    scheduler.Complete(IOPriority::WriteBack);
+    scheduler.Complete(IOPriority::Foreground);
+    assert(scheduler.Schedule(now) == fg_reqs[fg_limit]);
+    assert(scheduler.Schedule(now) == wb_reqs[wb_limit]);
+
+    // 等待超过deadline的后台请求先于前台请求被处理
+    IOServer::Scheduler promoted;
+    auto fg_req = make(IOPriority::Foreground, now);
+    auto bulk_req = make(IOPriority::Bulk, overdue);
+    promoted.Push(fg_req);
+    promoted.Push(bulk_req);
+    assert(promoted.Schedule(now) == bulk_req);
+    assert(promoted.Schedule(now) == fg_req);
+
+    // 被提升的请求也不超过该级的上限，前台请求不会被饿死
+    IOServer::Scheduler capped;
+    for (size_t i = 0; i < bulk_limit; i++) {
+      bulk_req = make(IOPriority::Bulk, overdue);
+      capped.Push(bulk_req);
+      assert(capped.Schedule(now) == bulk_req);
+    }
+    bulk_req = make(IOPriority::Bulk, overdue);
+    fg_req = make(IOPriority::Foreground, now);
+    capped.Push(bulk_req);
+    capped.Push(fg_req);
+    assert(capped.Schedule(now) == fg_req);
+    assert(capped.Schedule(now) == nullptr);
+    capped.Complete(IOPriority::Bulk);
+    assert(capped.Schedule(now) == bulk_req);
+    assert(capped.GetInflightNum(IOPriority::Bulk) == bulk_limit);
+  }
+
+  constexpr size_t pool_size_inpage = 64;
+  constexpr size_t fpage_num = pool_size_inpage * 4;
+  BufferPoolManager bpm;
+  init_test_bpm(bpm, file_path, pool_size_inpage, fpage_num);
+  for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+    size_t value = fpage_id + 1;
+    bpm.SetBlock((char*) &value, fpage_id * PAGE_SIZE_FILE, sizeof(size_t), 0);
+  }
+  // 最早写入的页已经被淘汰并写回
+  size_t value;
+  assert(::pread(bpm.GetFileDescriptor(0), &value, sizeof(size_t), 0) ==
+         sizeof(size_t));
+  assert(value == 1);
+
+  assert(bpm.FlushFile(0, true));
+  assert(bpm.LoadFile(0));
+  for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+    bpm.GetBlock((char*) &value, fpage_id * PAGE_SIZE_FILE, sizeof(size_t), 0);
+    assert(value == fpage_id + 1);
+  }
+  std::cout << "test_io_priority passed" << std::endl;
+}
+
+// magazine的槽位：线程退出时magazine中的空闲页归还全局队列，槽位被之后的线程复用；
+// 槽位被占满时新线程没有magazine，直接访问全局队列
+void test_free_list_magazine() {
+  // 容量足够大时才启用magazine
+  constexpr size_t capacity =
+      4 * FREE_LIST_MAGAZINE_NUM * FREE_LIST_MAGAZINE_SIZE;
+  constexpr size_t item_num = FREE_LIST_MAGAZINE_SIZE / 2;
+  magazine_queue_type<mpage_id_type> queue(capacity);
+  assert(queue.GetMagazineCapacity() == FREE_LIST_MAGAZINE_SIZE);
+
+  // 放入的空闲页在线程退出之前只在它自己的magazine中，退出时归还全局队列
+  uint32_t first_slot;
+  std::thread([&]() {
+    first_slot = MagazineSlots::GetSlot();
+    assert(first_slot != MagazineSlots::INVALID_SLOT);
+    for (mpage_id_type item = 0; item < item_num; item++)
+      assert(queue.Push(item));
+    assert(queue.GlobalSize() == 0);
+    assert(queue.Size() == item_num);
+  }).join();
+  assert(queue.GlobalSize() == item_num);
+  assert(queue.Size() == item_num);
+
+  // 释放的槽位被下一个线程复用，复用时magazine为空，第一次Poll从全局队列refill
+  std::thread([&]() {
+    assert(MagazineSlots::GetSlot() == first_slot);
+    mpage_id_type item;
+    bool global_polled;
+    assert(queue.Poll(item, global_polled) && global_polled);
+    assert(item < item_num);
+    assert(queue.GlobalSize() == 0);
+    assert(queue.Size() == item_num - 1);
+    // 之后从magazine中取，不访问全局队列
+    assert(queue.Poll(item, global_polled) && !global_polled);
+    assert(queue.Push(item));
+  }).join();
+  assert(queue.GlobalSize() == item_num - 1);
+
+  // 逐个创建线程占用槽位，直到有线程拿不到槽位：它的Push/Poll直接访问全局队列
+  std::atomic<bool> done = false;
+  std::vector<std::thread> holders;
+  while (true) {
+    assert(holders.size() <= FREE_LIST_MAGAZINE_NUM);
+    std::promise<uint32_t> slot_promise;
+    auto slot_future = slot_promise.get_future();
+    holders.emplace_back(
+        [&, slot_promise = std::move(slot_promise)]() mutable {
+          auto slot = MagazineSlots::GetSlot();
+          if (slot == MagazineSlots::INVALID_SLOT) {
+            auto global_size = queue.GlobalSize();
+            assert(queue.Push(item_num));
+            assert(queue.GlobalSize() == global_size + 1);
+            mpage_id_type item;
+            assert(queue.Poll(item));
+            assert(queue.GlobalSize() == global_size);
+            assert(queue.Size() == global_size);
+          }
+          slot_promise.set_value(slot);
+          while (!done)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    if (slot_future.get() == MagazineSlots::INVALID_SLOT)
+      break;
+  }
+  done = true;
+  for (auto& holder : holders)
+    holder.join();
+  assert(queue.GlobalSize() == item_num - 1);
+  std::cout << "test_free_list_magazine passed" << std::endl;
+}
+
+// AsyncFuture：生产者的Post与消费者的Wait并发（分别落在自旋与futex park阶段），
+// AsyncState在取得结果后归还ObjectPool，之后的New复用同一块内存
+void test_async_future() {
+  using state_type = AsyncState<size_t>;
+  constexpr size_t round_num = 3000;
+  auto release = [](state_type* state) {
+    ObjectPool<state_type>::Delete(state);
+  };
+
+  // 已经完成的future
+  auto ready = AsyncFuture<size_t>::Ready(7);
+  assert(ready.valid() && ready.is_ready());
+  assert(ready.get() == 7);
+  assert(!ready.valid());
+
+  // 生产者逐个取走state，按round选择立即Post、自旋之后Post或者sleep之后Post（消费者已经park）
+  std::atomic<state_type*> pending = nullptr;
+  std::thread producer([&]() {
+    for (size_t round = 0; round < round_num; round++) {
+      state_type* state;
+      while ((state = pending.exchange(nullptr)) == nullptr)
+        nano_spin();
+      if (round % 3 == 1) {
+        for (size_t k = 0; k < round % 64; k++)
+          nano_spin();
+      } else if (round % 3 == 2) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      state->value = round;
+      state->finish.Post();
+    }
+  });
+  for (size_t round = 0; round < round_num; round++) {
+    auto* state = ObjectPool<state_type>::New();
+    AsyncFuture<size_t> future(state, release);
+    pending.store(state);
+    if (round % 2 == 0)
+      future.wait();
+    assert(future.get() == round);
+  }
+  producer.join();
+
+  // 归还的state按LIFO复用，复用时重新构造，finish回到未完成状态
+  auto* state = ObjectPool<state_type>::New();
+  state->finish.Post();
+  {
+    AsyncFuture<size_t> future(state, release);
+    assert(future.is_ready());
+  }
+  auto* reused = ObjectPool<state_type>::New();
+  assert(reused == state);
+  assert(!reused->finish.TryWait());
+
+  // 在其它线程Delete时归还到该线程的freelist
+  std::thread([&]() {
+    ObjectPool<state_type>::Delete(reused);
+    assert(ObjectPool<state_type>::New() == reused);
+    ObjectPool<state_type>::Delete(reused);
+  }).join();
+  std::cout << "test_async_future passed" << std::endl;
+}
+
+// 主动淘汰的水位只按全局队列计算：多个线程的magazine中留有空闲页时，
+// 全局队列耗尽之后eviction worker仍然会被唤醒，把全局队列补充到low watermark之上
+void test_eviction_watermark(const std::string& file_path) {
+  // 容量足够大时free list才启用magazine
+  constexpr size_t pool_size_inpage =
+      4 * FREE_LIST_MAGAZINE_NUM * FREE_LIST_MAGAZINE_SIZE;
+  constexpr size_t fpage_num = pool_size_inpage + pool_size_inpage / 4;
+  constexpr size_t thread_num = 64;
+  const size_t low_watermark = std::max<size_t>(
+      pool_size_inpage * EVICTION_LOW_WATERMARK_RATIO, EVICTION_MIN_WATERMARK);
+  // 这些线程的magazine中的空闲页之和超过low watermark
+  assert(thread_num * (FREE_LIST_MAGAZINE_SIZE / 2 - 1) > low_watermark);
+  BufferPoolManager bpm;
+  init_test_bpm(bpm, file_path, pool_size_inpage, fpage_num);
+
+  // 每个线程只读一个页，magazine中留下refill得到的其余空闲页；线程退出时才归还
+  std::atomic<size_t> ready = 0;
+  std::atomic<bool> done = false;
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < thread_num; tid++) {
+    threads.emplace_back([&, tid]() {
+      size_t value;
+      bpm.GetBlock((char*) &value, tid * PAGE_SIZE_FILE, sizeof(size_t), 0);
+      ready++;
+      while (!done)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+  }
+  while (ready < thread_num)
+    std::this_thread::yield();
+
+  // 读入其余的页，全局队列中的空闲页被取完
+  size_t value;
+  for (size_t fpage_id = thread_num; fpage_id < fpage_num; fpage_id++)
+    bpm.GetBlock((char*) &value, fpage_id * PAGE_SIZE_FILE, sizeof(size_t),
+                 0);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (bpm.GetSharedFreePageNum() < low_watermark) {
+    assert(std::chrono::steady_clock::now() < deadline);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  done = true;
+  for (auto& thread : threads)
+    thread.join();
+  std::cout << "test_eviction_watermark passed" << std::endl;
+}
+
+// 多个pool、多个eviction worker：每个pool的全局队列低于low watermark之后都被补充到
+// high watermark，没有工作时所有worker都在futex上休眠
+void test_eviction_multi_pool(const std::string& file_path) {
+  constexpr uint16_t pool_num = 8;  // RoundRobinPartitioner要求pool数为2的幂
+  constexpr size_t pool_size_inpage = 1024;
+  constexpr size_t fpage_num = pool_num * pool_size_inpage * 2;
+  std::filesystem::remove(file_path);
+  BufferPoolManager bpm;
+  bpm.init(pool_num, pool_size_inpage, 1, file_path);
+  bpm.Resize(0, fpage_num * PAGE_SIZE_FILE);
+  auto* eviction_server = bpm.GetEvictionServer();
+  assert(eviction_server != nullptr);
+  assert(eviction_server->GetWorkerNum() > 1);
+
+  auto wait_until = [](auto&& cond) {
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!cond()) {
+      assert(std::chrono::steady_clock::now() < deadline);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  };
+  auto all_parked = [&]() {
+    return eviction_server->GetParkedWorkerNum() ==
+           eviction_server->GetWorkerNum();
+  };
+  // 初始时pool全部空闲，worker没有工作
+  wait_until(all_parked);
+
+  // 读入文件的前一半，每个pool的空闲页都被取到low watermark之下若干次
+  size_t value;
+  for (size_t fpage_id = 0; fpage_id < fpage_num / 2; fpage_id++)
+    bpm.GetBlock((char*) &value, fpage_id * PAGE_SIZE_FILE, sizeof(size_t),
+                 0);
+  wait_until(all_parked);
+
+  // 每个pool恰好读入(空闲页数 - low watermark + 1)个新页，最后一次缺页使其低于low watermark
+  std::vector<size_t> next_fpage_id(pool_num);
+  for (uint16_t pool_id = 0; pool_id < pool_num; pool_id++) {
+    auto [low_watermark, high_watermark] = bpm.GetWatermark(pool_id);
+    assert(low_watermark < high_watermark);
+    auto free_page_num = bpm.GetSharedFreePageNum(pool_id);
+    assert(free_page_num >= low_watermark);
+    for (size_t k = 0; k <= free_page_num - low_watermark; k++) {
+      size_t fpage_id = fpage_num / 2 + pool_id + k * pool_num;
+      assert(fpage_id < fpage_num);
+      bpm.GetBlock((char*) &value, fpage_id * PAGE_SIZE_FILE, sizeof(size_t),
+                   0);
+    }
+  }
+  wait_until([&]() {
+    for (uint16_t pool_id = 0; pool_id < pool_num; pool_id++) {
+      if (bpm.GetSharedFreePageNum(pool_id) <
+          bpm.GetWatermark(pool_id).second)
+        return false;
+    }
+    return true;
+  });
+  wait_until(all_parked);
+  // worker补充到high watermark即停止
+  for (uint16_t pool_id = 0; pool_id < pool_num; pool_id++)
+    assert(bpm.GetSharedFreePageNum(pool_id) ==
+           bpm.GetWatermark(pool_id).second);
+  std::cout << "test_eviction_multi_pool passed" << std::endl;
+}
+
+// 条带化：只有条带化创建的文件才按条带访问，已有的普通文件按原样打开
+void test_disk_stripe(const std::string& dir_path) {
+  std::filesystem::remove_all(dir_path);
+  std::vector<std::string> stripe_dirs = {dir_path + "/stripe_0",
+                                          dir_path + "/stripe_1"};
+  auto plain_path = dir_path + "/plain.db";
+  auto striped_path = dir_path + "/striped.db";
+  std::filesystem::create_directories(dir_path);
+  size_t value = 1;
+  {
+    DiskManager disk_manager;
+    auto fd = disk_manager.OpenFile(plain_path, O_RDWR | O_CREAT);
+    disk_manager.Resize(fd, DISK_STRIPE_CHUNK_SIZE * 4);
+    assert(::pwrite(disk_manager.GetFileDescriptor(fd), &value,
+                    sizeof(size_t), DISK_STRIPE_CHUNK_SIZE) == sizeof(size_t));
+    disk_manager.CloseFile(fd);
+  }
+
+  {
+    DiskManager disk_manager;
+    disk_manager.SetStripeDirs(stripe_dirs);
+    auto fd = disk_manager.OpenFile(plain_path, O_RDWR | O_CREAT);
+    assert(disk_manager.GetStripeNum(fd) == 1);
+    assert(std::filesystem::is_empty(stripe_dirs[0]));
+    auto [fd_os, offset_os] =
+        disk_manager.Translate(fd, DISK_STRIPE_CHUNK_SIZE);
+    value = 0;
+    assert(::pread(fd_os, &value, sizeof(size_t), offset_os) ==
+           sizeof(size_t));
+    assert(value == 1);
+    disk_manager.CloseFile(fd);
+
+    fd = disk_manager.OpenFile(striped_path, O_RDWR | O_CREAT);
+    assert(disk_manager.GetStripeNum(fd) == 2);
+    disk_manager.Resize(fd, DISK_STRIPE_CHUNK_SIZE * 4);
+    std::tie(fd_os, offset_os) =
+        disk_manager.Translate(fd, DISK_STRIPE_CHUNK_SIZE);
+    assert(offset_os == 0);
+    value = 2;
+    assert(::pwrite(fd_os, &value, sizeof(size_t), offset_os) ==
+           sizeof(size_t));
+    disk_manager.CloseFile(fd);
+  }
+
+  // 条带化创建的文件不依赖当前的stripe dirs
+  {
+    DiskManager disk_manager;
+    auto fd = disk_manager.OpenFile(striped_path, O_RDWR);
+    assert(disk_manager.GetStripeNum(fd) == 2);
+    auto [fd_os, offset_os] =
+        disk_manager.Translate(fd, DISK_STRIPE_CHUNK_SIZE);
+    value = 0;
+    assert(::pread(fd_os, &value, sizeof(size_t), offset_os) ==
+           sizeof(size_t));
+    assert(value == 2);
+
+    // 跨越chunk的读写按chunk拆分到各个backing file
+    RWSysCall io_backend(&disk_manager);
+    std::vector<size_t> out(DISK_STRIPE_CHUNK_SIZE * 2 / sizeof(size_t));
+    std::vector<size_t> in(out.size());
+    for (size_t idx = 0; idx < out.size(); idx++)
+      out[idx] = idx;
+    size_t offset = DISK_STRIPE_CHUNK_SIZE / 2;
+    io_backend.Write(offset, (const char*) out.data(),
+                     out.size() * sizeof(size_t), fd);
+    io_backend.Read(offset, (char*) in.data(), in.size() * sizeof(size_t), fd);
+    assert(in == out);
+    std::tie(fd_os, offset_os) =
+        disk_manager.Translate(fd, DISK_STRIPE_CHUNK_SIZE);
+    assert(::pread(fd_os, &value, sizeof(size_t), offset_os) ==
+           sizeof(size_t));
+    assert(value == DISK_STRIPE_CHUNK_SIZE / 2 / sizeof(size_t));
+    disk_manager.CloseFile(fd);
+  }
+
+  assert(DiskManager::RemoveFile(striped_path));
+  assert(std::filesystem::is_empty(stripe_dirs[0]) &&
+         std::filesystem::is_empty(stripe_dirs[1]));
+  std::cout << "test_disk_stripe passed" << std::endl;
+}
+
+// CloseFile等待已经AcquireFile的I/O结束之后才close OS fd，关闭之后AcquireFile失败
+void test_disk_close(const std::string& file_path) {
+  std::filesystem::remove(file_path);
+  DiskManager disk_manager;
+  auto fd = disk_manager.OpenFile(file_path, O_RDWR | O_CREAT);
+  disk_manager.Resize(fd, PAGE_SIZE_FILE);
+  assert(disk_manager.AcquireFile(fd));
+  auto [fd_os, offset_os] = disk_manager.Translate(fd, 0);
+
+  std::atomic<bool> closed = false;
+  std::thread closer([&]() {
+    disk_manager.CloseFile(fd);
+    closed = true;
+  });
+  while (disk_manager.ValidFD(fd))
+    std::this_thread::yield();
+  // CloseFile已经开始，但是在ReleaseFile之前不会close fd_os
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  assert(!closed);
+  assert(!disk_manager.AcquireFile(fd));
+  size_t value;
+  assert(::pread(fd_os, &value, sizeof(size_t), offset_os) ==
+         sizeof(size_t));
+  disk_manager.ReleaseFile(fd);
+  closer.join();
+  assert(::fcntl(fd_os, F_GETFD) == -1);
+
+#if !ASSERT_ENABLE
+  // 已经关闭的文件上的I/O不使用OS fd，仍然通知调用者（ASSERT_ENABLE时直接断言失败）
+  RWSysCall io_backend(&disk_manager);
+  AsyncMesg1 finish;
+  assert(io_backend.Read(0, (char*) &value, sizeof(size_t), fd, &finish));
+  assert(finish.TryWait());
+#endif
+  std::cout << "test_disk_close passed" << std::endl;
+}
+
+// 页面压缩：可压缩的页、全0的页与不可压缩的页，以及输出空间不足与非法输入
+void test_page_compressor() {
+  alignas(PAGE_SIZE_MEMORY) static char page[PAGE_SIZE_FILE];
+  alignas(PAGE_SIZE_MEMORY) static char out[PAGE_SIZE_FILE];
+  alignas(PAGE_SIZE_MEMORY) static char compressed[PAGE_SIZE_FILE];
+  auto round_trip = [&](size_t size) {
+    assert(PageCompressor::Decompress(compressed, size, out, PAGE_SIZE_FILE) ==
+           PAGE_SIZE_FILE);
+    assert(::memcmp(page, out, PAGE_SIZE_FILE) == 0);
+  };
+
+  fill_compressible_page(page, 1);
+  auto size = PageCompressor::Compress(page, PAGE_SIZE_FILE, compressed,
+                                       PAGE_SIZE_FILE);
+  assert(size > 0 && size < PAGE_SIZE_FILE / 4);
+  round_trip(size);
+  // 输出空间不足时返回0，不会越界写
+  assert(PageCompressor::Compress(page, PAGE_SIZE_FILE, compressed,
+                                  size - 1) == 0);
+  // 截断或损坏的输入返回0
+  assert(PageCompressor::Decompress(compressed, size - 1, out,
+                                    PAGE_SIZE_FILE) != PAGE_SIZE_FILE);
+  assert(PageCompressor::Decompress(compressed, size, out,
+                                    PAGE_SIZE_FILE / 2) == 0);
+
+  // 全0的页压缩为很少的字节（重叠的match）
+  ::memset(page, 0, PAGE_SIZE_FILE);
+  size = PageCompressor::Compress(page, PAGE_SIZE_FILE, compressed,
+                                  PAGE_SIZE_FILE);
+  assert(size > 0 && size < 64);
+  ::memset(out, 1, PAGE_SIZE_FILE);
+  round_trip(size);
+
+  // 不可压缩的页在PAGE_SIZE_FILE内放不下，调用者按原样存储
+  std::mt19937_64 rng(0);
+  for (size_t i = 0; i < PAGE_SIZE_FILE / sizeof(size_t); i++)
+    ((size_t*) page)[i] = rng();
+  assert(PageCompressor::Compress(page, PAGE_SIZE_FILE, compressed,
+                                  PAGE_SIZE_FILE) == 0);
+  std::cout << "test_page_compressor passed" << std::endl;
+}
+
+// 压缩的文件：页的读写与重写，以及重写后释放的slot被合并复用
+void test_compressed_file(const std::string& file_path) {
+  // 单独使用CompressedFile，没有原路径上的占位文件
+  std::filesystem::remove(file_path + ".cdata");
+  std::filesystem::remove(file_path + ".cidx");
+  std::mt19937_64 rng(0);
+  auto fill_page = [&](char* page, size_t seed, bool compressible) {
+    if (compressible) {
+      fill_compressible_page(page, seed);
+      return;
+    }
+    for (size_t i = 0; i < PAGE_SIZE_FILE / sizeof(size_t); i++)
+      ((size_t*) page)[i] = rng();
+  };
+
+  alignas(PAGE_SIZE_MEMORY) static char page[PAGE_SIZE_FILE];
+  alignas(PAGE_SIZE_MEMORY) static char out[PAGE_SIZE_FILE];
+
+  constexpr size_t page_num = 16;
+  // 偶数页可压缩，奇数页按原样存储
+  auto check_pages = [&](CompressedFile& file, size_t round) {
+    for (size_t fpage_id = 0; fpage_id < page_num; fpage_id++) {
+      assert(file.Read(fpage_id * PAGE_SIZE_FILE, out, PAGE_SIZE_FILE));
+      if (fpage_id % 2 == 0) {
+        fill_page(page, round * page_num + fpage_id, true);
+        assert(::memcmp(page, out, PAGE_SIZE_FILE) == 0);
+      }
+    }
+    // 没有写入过的页读为0
+    assert(file.Read(page_num * PAGE_SIZE_FILE, out, PAGE_SIZE_FILE));
+    assert(std::all_of(out, out + PAGE_SIZE_FILE,
+                       [](char c) { return c == 0; }));
+  };
+  std::vector<std::string> raw_pages(page_num);
+  size_t storage_size_first = 0;
+  {
+    CompressedFile file(file_path, O_RDWR | O_CREAT);
+    for (size_t round = 0; round < 4; round++) {
+      for (size_t fpage_id = 0; fpage_id < page_num; fpage_id++) {
+        fill_page(page, round * page_num + fpage_id, fpage_id % 2 == 0);
+        if (fpage_id % 2 == 1)
+          raw_pages[fpage_id].assign(page, PAGE_SIZE_FILE);
+        assert(file.Write(fpage_id * PAGE_SIZE_FILE, page, PAGE_SIZE_FILE));
+      }
+      check_pages(file, round);
+      for (size_t fpage_id = 1; fpage_id < page_num; fpage_id += 2) {
+        assert(file.Read(fpage_id * PAGE_SIZE_FILE, out, PAGE_SIZE_FILE));
+        assert(::memcmp(raw_pages[fpage_id].data(), out, PAGE_SIZE_FILE) ==
+               0);
+      }
+      file.Flush();
+      // 每轮重写都复用上一轮Flush回收的slot，占用空间不超过两份数据
+      if (round == 0)
+        storage_size_first = file.GetStorageSize();
+      else
+        assert(file.GetStorageSize() <= 2 * storage_size_first);
+    }
+    assert(storage_size_first < page_num * PAGE_SIZE_FILE);
+  }
+
+  // 重新打开之后从索引恢复，空闲的slot也能继续复用
+  {
+    CompressedFile file(file_path, O_RDWR);
+    check_pages(file, 3);
+    auto storage_size = file.GetStorageSize();
+    for (size_t fpage_id = 0; fpage_id < page_num; fpage_id += 2) {
+      fill_page(page, 3 * page_num + fpage_id, true);
+      assert(file.Write(fpage_id * PAGE_SIZE_FILE, page, PAGE_SIZE_FILE));
+    }
+    assert(file.GetStorageSize() == storage_size);
+  }
+
+  // 调用者的O_DIRECT不作用于数据文件：512B的extent在4Kn设备上也可以读写；
+  // 缩小之后新末尾之后的页读为0，再次扩大也不会读到旧的数据，它们的extent在Flush之后被复用
+  {
+    CompressedFile file(file_path, O_RDWR | O_DIRECT);
+    check_pages(file, 3);
+    auto storage_size = file.GetStorageSize();
+    file.Truncate(page_num / 2 * PAGE_SIZE_FILE);
+    for (size_t fpage_id = page_num / 2; fpage_id < page_num; fpage_id++) {
+      assert(file.Read(fpage_id * PAGE_SIZE_FILE, out, PAGE_SIZE_FILE));
+      assert(std::all_of(out, out + PAGE_SIZE_FILE,
+                         [](char c) { return c == 0; }));
+    }
+    file.Flush();
+    for (size_t fpage_id = page_num / 2; fpage_id < page_num; fpage_id++) {
+      fill_page(page, fpage_id, fpage_id % 2 == 0);
+      assert(file.Write(fpage_id * PAGE_SIZE_FILE, page, PAGE_SIZE_FILE));
+      assert(file.Read(fpage_id * PAGE_SIZE_FILE, out, PAGE_SIZE_FILE));
+      assert(::memcmp(page, out, PAGE_SIZE_FILE) == 0);
+    }
+    assert(file.GetStorageSize() <= storage_size);
+  }
+  assert(std::filesystem::remove(file_path + ".cdata") &&
+         std::filesystem::remove(file_path + ".cidx"));
+  std::cout << "test_compressed_file passed" << std::endl;
+}
+
+// 压缩层：后台压缩、命中后promote（从压缩层删除）、压缩率不足的页被丢弃、按文件范围删除
+void test_compressed_tier() {
+  constexpr size_t page_num = 64;
+  CompressedTier tier(page_num * PAGE_SIZE_FILE * COMPRESSED_TIER_SHARD_NUM);
+  std::mt19937_64 rng(0);
+  alignas(PAGE_SIZE_MEMORY) static char page[PAGE_SIZE_FILE];
+  alignas(PAGE_SIZE_MEMORY) static char out[PAGE_SIZE_FILE];
+  auto fill_page = [&](size_t seed) { fill_compressible_page(page, seed); };
+
+  for (size_t fpage_id = 0; fpage_id < page_num; fpage_id++) {
+    fill_page(fpage_id);
+    tier.Insert(0, fpage_id, page);
+  }
+  // 压缩完成之前raw项同样可以命中
+  assert(tier.Load(0, 0, out));
+  fill_page(0);
+  assert(::memcmp(page, out, PAGE_SIZE_FILE) == 0);
+  // 等待后台线程压缩大部分的页，之后的Load同时覆盖raw项与压缩项
+  while (std::get<0>(tier.GetStats()) >= (page_num - 1) * PAGE_SIZE_FILE / 4)
+    std::this_thread::yield();
+  for (size_t fpage_id = 1; fpage_id < page_num / 2; fpage_id++) {
+    assert(tier.Load(0, fpage_id, out));
+    fill_page(fpage_id);
+    assert(::memcmp(page, out, PAGE_SIZE_FILE) == 0);
+    // promote之后该页只在帧中，不再命中
+    assert(!tier.Load(0, fpage_id, out));
+  }
+
+  // 再次放入的页覆盖旧的副本
+  fill_page(page_num);
+  tier.Insert(0, page_num / 2, page);
+  // 多页的读不经过该层，留给调用者整体读磁盘
+  alignas(PAGE_SIZE_MEMORY) static char out_range[PAGE_SIZE_FILE * 2];
+  assert(!tier.LoadRange(0, page_num / 2 * PAGE_SIZE_FILE, out_range,
+                         sizeof(out_range)));
+  assert(tier.LoadRange(0, page_num / 2 * PAGE_SIZE_FILE, out,
+                        PAGE_SIZE_FILE));
+  assert(::memcmp(page, out, PAGE_SIZE_FILE) == 0);
+
+  // 压缩率不足的页在后台压缩之后被丢弃
+  for (size_t i = 0; i < PAGE_SIZE_FILE / sizeof(size_t); i++)
+    ((size_t*) page)[i] = rng();
+  tier.Insert(1, 0, page);
+  while (std::get<3>(tier.GetStats()) == 0)
+    std::this_thread::yield();
+  assert(!tier.Load(1, 0, out));
+
+  // 写回之后删除单个页
+  assert(tier.ContainsAny(0, page_num - 1));
+  tier.Erase(0, page_num - 1);
+  assert(!tier.ContainsAny(0, page_num - 1));
+
+  // 超出预算时从LRU尾部淘汰，占用的内存不超过预先分配的slab
+  for (size_t fpage_id = 0; fpage_id < page_num * COMPRESSED_TIER_SHARD_NUM * 4;
+       fpage_id++) {
+    fill_page(fpage_id);
+    tier.Insert(2, fpage_id, page);
+    assert(std::get<0>(tier.GetStats()) <=
+           page_num * PAGE_SIZE_FILE * COMPRESSED_TIER_SHARD_NUM);
+  }
+  tier.EraseFile(2);
+
+  // 文件缩小时删除新末尾之后的页，其余的页仍然可以命中
+  tier.EraseFile(0, page_num - 4);
+  assert(!tier.ContainsAny(0, page_num - 4, 4));
+  assert(tier.ContainsAny(0, page_num / 2 + 1));
+  tier.EraseFile(0);
+  assert(!tier.ContainsAny(0, 0, page_num));
+  // 正在压缩的项的slot由后台线程释放
+  while (std::get<0>(tier.GetStats()) != 0)
+    std::this_thread::yield();
+  std::cout << "test_compressed_tier passed" << std::endl;
+}
+
+// 多页BufferBlock：内联的页表（移动后重新指向对象内部）与slab中的页表（释放后被复用）
+void test_buffer_block_pages(const std::string& file_path) {
+  constexpr size_t pool_size_inpage = 256;
+  constexpr size_t fpage_num = pool_size_inpage * 2;
+  BufferPoolManager bpm;
+  init_test_bpm(bpm, file_path, pool_size_inpage, fpage_num);
+  std::vector<char> buf(fpage_num * PAGE_SIZE_FILE);
+  for (size_t idx = 0; idx < buf.size(); idx++)
+    buf[idx] = (char) (idx / PAGE_SIZE_FILE + idx);
+  bpm.SetBlock(buf.data(), 0, buf.size(), 0);
+
+  std::vector<char> out(fpage_num * PAGE_SIZE_FILE);
+  for (size_t round = 0; round < 4; round++) {
+    for (size_t page_num : {(size_t) 2, BUFFER_BLOCK_INLINE_PAGE_NUM,
+                            BUFFER_BLOCK_INLINE_PAGE_NUM + 1,
+                            BUFFER_BLOCK_INLINE_PAGE_NUM * 16}) {
+      // 起止都不在页边界上，跨越page_num个页
+      auto offset = (round * page_num + 1) * PAGE_SIZE_FILE - 8;
+      auto size = (page_num - 1) * PAGE_SIZE_FILE + 16;
+      BufferBlock block = bpm.GetBlockSync(offset, size, 0);
+      assert(block.Copy(out.data(), size) == size);
+      assert(::memcmp(out.data(), buf.data() + offset, size) == 0);
+
+      BufferBlock moved = std::move(block);
+      ::memset(out.data(), 0, size);
+      assert(moved.Copy(out.data(), size) == size);
+      assert(::memcmp(out.data(), buf.data() + offset, size) == 0);
+    }
+  }
+  // 所有BufferBlock都已释放，页都可以被淘汰
+  for (size_t fpage_id = 0; fpage_id < fpage_num; fpage_id++) {
+    char value;
+    bpm.GetBlock(&value, fpage_id * PAGE_SIZE_FILE, sizeof(char), 0);
+    assert(value == buf[fpage_id * PAGE_SIZE_FILE]);
+  }
+  std::cout << "test_buffer_block_pages passed" << std::endl;
+}
+
+// per-worker io_uring：每个线程在自己的ring上提交并回收I/O，普通文件与压缩的文件都可以读写
+void test_io_local_ring(const std::string& file_path) {
+  constexpr size_t thread_num = 4;
+  constexpr size_t fpage_num_per_thread = 64;
+  constexpr size_t fpage_num = thread_num * fpage_num_per_thread;
+  auto compressed_path = file_path + ".compressed";
+  std::filesystem::remove(file_path);
+  DiskManager::RemoveFile(compressed_path);
+
+  DiskManager disk_manager;
+  std::vector<GBPfile_handle_type> fds = {
+      disk_manager.OpenFile(file_path),
+      disk_manager.OpenFile(compressed_path, O_RDWR | O_CREAT, true)};
+  for (auto fd : fds)
+    disk_manager.Resize(fd, fpage_num * PAGE_SIZE_FILE);
+  IOServer io_server(&disk_manager);
+
+  std::vector<std::thread> threads;
+  for (size_t thread_id = 0; thread_id < thread_num; thread_id++) {
+    threads.emplace_back([&, thread_id]() {
+      auto page = (char*) ::aligned_alloc(PAGE_SIZE_MEMORY, PAGE_SIZE_FILE);
+      auto out = (char*) ::aligned_alloc(PAGE_SIZE_MEMORY, PAGE_SIZE_FILE);
+      for (auto fd : fds) {
+        for (size_t idx = 0; idx < fpage_num_per_thread; idx++) {
+          auto fpage_id = thread_id * fpage_num_per_thread + idx;
+          fill_compressible_page(page, fpage_id);
+          AsyncMesg1 write_finish;
+          io_server.SubmitLocal(fd, fpage_id * PAGE_SIZE_FILE, page,
+                                PAGE_SIZE_FILE, &write_finish, false);
+          io_server.WaitLocal(&write_finish);
+
+          AsyncMesg1 read_finish;
+          io_server.SubmitLocal(fd, fpage_id * PAGE_SIZE_FILE, out,
+                                PAGE_SIZE_FILE, &read_finish, true);
+          io_server.WaitLocal(&read_finish);
+          assert(::memcmp(page, out, PAGE_SIZE_FILE) == 0);
+        }
+      }
+      ::free(page);
+      ::free(out);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  // 同一个线程交替使用两个IOServer，GBP fd相同，但I/O落在各自DiskManager的文件上
+  {
+    auto other_path = file_path + ".other";
+    std::filesystem::remove(other_path);
+    DiskManager other_disk_manager;
+    auto other_fd = other_disk_manager.OpenFile(other_path);
+    assert(other_fd == fds[0]);
+    other_disk_manager.Resize(other_fd, PAGE_SIZE_FILE);
+    IOServer other_io_server(&other_disk_manager);
+    auto page = (char*) ::aligned_alloc(PAGE_SIZE_MEMORY, PAGE_SIZE_FILE);
+    for (auto [server, value] : {std::pair(&io_server, 'a'),
+                                 std::pair(&other_io_server, 'b')}) {
+      ::memset(page, value, PAGE_SIZE_FILE);
+      AsyncMesg1 finish;
+      server->SubmitLocal(fds[0], 0, page, PAGE_SIZE_FILE, &finish, false);
+      server->WaitLocal(&finish);
+    }
+    for (auto [manager, value] : {std::pair(&disk_manager, 'a'),
+                                  std::pair(&other_disk_manager, 'b')}) {
+      assert(::pread(manager->GetFileDescriptor(fds[0]), page, PAGE_SIZE_FILE,
+                     0) == (ssize_t) PAGE_SIZE_FILE);
+      assert(page[0] == value && page[PAGE_SIZE_FILE - 1] == value);
+    }
+    ::free(page);
+    other_disk_manager.CloseFile(other_fd);
+    std::filesystem::remove(other_path);
+  }
+
+  for (auto fd : fds)
+    disk_manager.CloseFile(fd);
+  std::filesystem::remove(file_path);
+  assert(DiskManager::RemoveFile(compressed_path));
+  std::cout << "test_io_local_ring passed" << std::endl;
+}
+
+#if COROUTINE_ENABLE
+// 依次读取fpage_ids中每个页的末尾与下一页的开头（跨页的block），校验页中的内容
+static CoroTask coro_fetch_pages(const BufferPoolManager& bpm,
+                                 std::vector<size_t> fpage_ids,
+                                 std::atomic<size_t>& finished) {
+  for (auto fpage_id : fpage_ids) {
+    BufferBlock block = co_await bpm.GetBlockCoro(
+        (fpage_id + 1) * PAGE_SIZE_FILE - sizeof(size_t), sizeof(size_t) * 2,
+        0);
+    size_t values[2];
+    assert(block.Copy((char*) values, sizeof(values)) == sizeof(values));
+    assert(values[0] == fpage_id && values[1] == fpage_id + 1);
+  }
+  finished++;
+}
+#endif
+
+// 协程接口：同一个scheduler中的多个协程（以及多个线程的scheduler）并发地缺页同一个页与不同的页
+void test_coroutine_fetch(const std::string& file_path) {
+#if COROUTINE_ENABLE
+  constexpr size_t pool_size_inpage = 256;
+  constexpr size_t fpage_num = pool_size_inpage * 4;
+  constexpr size_t thread_num = 4;
+  constexpr size_t coro_num_per_thread = 8;
+  BufferPoolManager bpm;
+  init_test_bpm(bpm, file_path, pool_size_inpage, fpage_num + 1);
+  std::vector<size_t> page(PAGE_SIZE_FILE / sizeof(size_t));
+  for (size_t fpage_id = 0; fpage_id <= fpage_num; fpage_id++) {
+    std::fill(page.begin(), page.end(), fpage_id);
+    bpm.SetBlock((char*) page.data(), fpage_id * PAGE_SIZE_FILE,
+                 PAGE_SIZE_FILE, 0);
+  }
+  // 淘汰所有的页，之后的读取都从缺页开始
+  assert(bpm.FlushFile(0, true));
+
+  std::atomic<size_t> finished = 0;
+  std::vector<std::thread> threads;
+  for (size_t thread_id = 0; thread_id < thread_num; thread_id++) {
+    threads.emplace_back([&, thread_id]() {
+      CoroScheduler scheduler(bpm.GetDiskManager());
+      std::mt19937 rng(thread_id);
+      for (size_t coro_id = 0; coro_id < coro_num_per_thread; coro_id++) {
+        // 偶数号协程按相同的顺序读（同一个页的并发缺页），奇数号协程各自打乱顺序
+        std::vector<size_t> fpage_ids(fpage_num);
+        std::iota(fpage_ids.begin(), fpage_ids.end(), 0);
+        if (coro_id % 2 == 1)
+          std::shuffle(fpage_ids.begin(), fpage_ids.end(), rng);
+        scheduler.Spawn(coro_fetch_pages(bpm, std::move(fpage_ids), finished));
+      }
+      scheduler.Run();
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  assert(finished == thread_num * coro_num_per_thread);
+  std::cout << "test_coroutine_fetch passed" << std::endl;
+#else
+  std::cout << "test_coroutine_fetch skipped: build with WITH_COROUTINE"
+            << std::endl;
+#endif
+}
 }  // namespace test
\ No newline at end of file
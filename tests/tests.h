@@ -40,6 +40,31 @@ struct Page_mine {
 int test_graph(int argc, char** argv);
 
 void test_csv(const std::string& file_path);
+void test_chunked_csv(const std::string& file_path);
+void test_column_family_projection(const std::string& file_path);
+void test_column_family_pax(const std::string& file_path);
+void test_dict_string_column(const std::string& dir_path);
+void test_compressed_csr(const std::string& dir_path);
+void test_vertex_edge_tiers(const std::string& db_dir_path);
+void test_mutable_csr_mvcc(const std::string& dir_path);
+void test_index_probe_group(const std::string& file_path);
+void test_index_get_batch(const std::string& file_path);
+void test_vm_cache(const std::string& file_path);
+void test_uffd_region(const std::string& file_path);
+void test_warm_restart(const std::string& file_path);
+void test_io_priority(const std::string& file_path);
+void test_free_list_magazine();
+void test_async_future();
+void test_eviction_watermark(const std::string& file_path);
+void test_eviction_multi_pool(const std::string& file_path);
+void test_disk_stripe(const std::string& dir_path);
+void test_disk_close(const std::string& file_path);
+void test_page_compressor();
+void test_compressed_file(const std::string& file_path);
+void test_compressed_tier();
+void test_buffer_block_pages(const std::string& file_path);
+void test_io_local_ring(const std::string& file_path);
+void test_coroutine_fetch(const std::string& file_path);
 void test_vertex(const std::string& config_file_path,
                  const std::string& data_file_path,
                  const std::string& db_dir_path);